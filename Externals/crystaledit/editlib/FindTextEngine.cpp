@@ -0,0 +1,221 @@
+/**
+ * @file  FindTextEngine.cpp
+ *
+ * @brief Implementation of FindTextEngine class.
+ */
+
+#include <windows.h>
+#include <tchar.h>
+#include <string>
+#include "FindTextEngine.h"
+#include "string_util.h"
+
+/** @brief Most characters of the same case looked for with separate scans. */
+static const int MaxFirstChars = 4;
+
+/**
+ * @brief Constructor.
+ */
+FindTextEngine::FindTextEngine()
+: m_dwFlags(0)
+, m_bCompiled(false)
+, m_rxnode(NULL)
+{
+}
+
+/**
+ * @brief Destructor.
+ */
+FindTextEngine::~FindTextEngine()
+{
+	if (m_rxnode)
+		RxFree(m_rxnode);
+}
+
+/**
+ * @brief Compile the text to find, unless it was compiled already.
+ * @param [in] pszFindWhat Text or regular expression to find.
+ * @param [in] dwFlags Search flags, FIND_MATCH_CASE, FIND_WHOLE_WORD and
+ *  FIND_REGEXP are used.
+ * @return false if the regular expression is invalid.
+ */
+bool FindTextEngine::Compile(LPCTSTR pszFindWhat, DWORD dwFlags)
+{
+	dwFlags &= FIND_MATCH_CASE | FIND_WHOLE_WORD | FIND_REGEXP;
+	if (m_bCompiled && dwFlags == m_dwFlags && m_sFindWhat == pszFindWhat)
+		return (dwFlags & FIND_REGEXP) == 0 || m_rxnode != NULL;
+
+	m_sFindWhat = pszFindWhat;
+	m_dwFlags = dwFlags;
+	m_bCompiled = true;
+	if (m_rxnode)
+	{
+		RxFree(m_rxnode);
+		m_rxnode = NULL;
+	}
+	m_what.clear();
+	m_first.clear();
+
+	if (dwFlags & FIND_REGEXP)
+	{
+		m_rxnode = RxCompile(pszFindWhat, (dwFlags & FIND_MATCH_CASE) != 0 ? RX_CASE : 0);
+		return m_rxnode != NULL;
+	}
+
+	for (LPCTSTR p = pszFindWhat; *p; p++)
+		m_what.push_back(Fold(*p));
+	if (m_what.empty())
+		return true;
+	if (dwFlags & FIND_MATCH_CASE)
+	{
+		m_first.push_back(m_what[0]);
+		return true;
+	}
+	// All characters having the first character as upper case, e.g. for 'I'
+	// 'i', 'I' and the dotless i. If there are too many, every character
+	// of the line is folded and compared instead.
+	const unsigned nMaxChar = sizeof(TCHAR) > 1 ? 0xFFFF : 0xFF;
+	for (unsigned ch = 1; ch <= nMaxChar && m_first.size() <= MaxFirstChars; ch++)
+	{
+		if (Fold((TCHAR) ch) == m_what[0])
+			m_first.push_back((TCHAR) ch);
+	}
+	if (m_first.size() > MaxFirstChars)
+		m_first.clear();
+	return true;
+}
+
+/**
+ * @brief Find the first match in a text at or after a position.
+ * @param [in] pszText Text to search, need not be zero-terminated.
+ * @param [in] nLength Length of the text.
+ * @param [in] nStart Position to start from. A whole word may start there,
+ *  but ^ matches only at the start of @p pszText.
+ * @param [out] nLen Length of the match. Not changed if a regular
+ *  expression does not match.
+ * @param [out] rxmatch Groups of the regular expression, relative to
+ *  @p pszText, may be NULL.
+ * @return Position of the match in @p pszText, or -1 if not found.
+ */
+int FindTextEngine::Find(LPCTSTR pszText, int nLength, int nStart, int &nLen, RxMatchRes *rxmatch) const
+{
+	if (m_dwFlags & FIND_REGEXP)
+	{
+		RxMatchRes match;
+		if (rxmatch == NULL)
+			rxmatch = &match;
+		if (m_rxnode == NULL || !RxExec(m_rxnode, pszText, nLength, pszText + nStart, rxmatch) ||
+			rxmatch->Open[0] < 0)
+			return -1;
+		nLen = rxmatch->Close[0] - rxmatch->Open[0];
+		return rxmatch->Open[0];
+	}
+	nLen = (int) m_what.size();
+	return FindLiteral(pszText, nLength, nStart);
+}
+
+/**
+ * @brief Find all matches in a text.
+ * The search continues after the end of each match, or after the next
+ * character if the match is empty. A whole word may start right after a
+ * match, but ^ matches only at the start of @p pszText.
+ * @param [in] pszText Text to search, need not be zero-terminated.
+ * @param [in] nLength Length of the text.
+ * @param [out] matches Matches found, in ascending order.
+ */
+void FindTextEngine::FindAll(LPCTSTR pszText, int nLength, std::vector<Match> &matches) const
+{
+	matches.clear();
+	int nStart = 0;
+	while (nStart <= nLength)
+	{
+		Match match;
+		match.nPos = Find(pszText, nLength, nStart, match.nLen, NULL);
+		if (match.nPos < 0)
+			break;
+		matches.push_back(match);
+		nStart = match.nPos + (match.nLen > 0 ? match.nLen : 1);
+	}
+}
+
+/**
+ * @brief Find the text at or after a position.
+ * @param [in] pszText Text to search.
+ * @param [in] nLength Length of the text.
+ * @param [in] nStart Position to start from. Whole words may start there.
+ * @return Position of the match, or -1 if not found.
+ */
+int FindTextEngine::FindLiteral(LPCTSTR pszText, int nLength, int nStart) const
+{
+	const int nWhat = (int) m_what.size();
+	if (nWhat == 0)
+		return nStart <= nLength ? nStart : -1;
+	const int nLast = nLength - nWhat;
+	const bool bWholeWord = (m_dwFlags & FIND_WHOLE_WORD) != 0;
+	const int nFirst = (int) m_first.size();
+	// Next position of each first character, -1 if there is none and -2
+	// if it has not been looked for yet
+	int anNext[MaxFirstChars];
+	for (int k = 0; k < nFirst; k++)
+		anNext[k] = -2;
+
+	for (int i = nStart; i <= nLast; )
+	{
+		int nPos = i;
+		if (nFirst > 0)
+		{
+			nPos = nLast + 1;
+			for (int k = 0; k < nFirst; k++)
+			{
+				if (anNext[k] != -1 && anNext[k] < i)
+				{
+					const TCHAR *p = std::char_traits<TCHAR>::find(pszText + i, nLast + 1 - i, m_first[k]);
+					anNext[k] = p ? (int) (p - pszText) : -1;
+				}
+				if (anNext[k] >= 0 && anNext[k] < nPos)
+					nPos = anNext[k];
+			}
+			if (nPos > nLast)
+				return -1;
+		}
+		else if (Fold(pszText[nPos]) != m_what[0])
+		{
+			i++;
+			continue;
+		}
+		if (IsMatchAt(pszText + nPos) &&
+			(!bWholeWord ||
+			 ((nPos == nStart || !xisalnum(Fold(pszText[nPos - 1]))) &&
+			  (nPos + nWhat >= nLength || !xisalnum(Fold(pszText[nPos + nWhat]))))))
+			return nPos;
+		i = nPos + 1;
+	}
+	return -1;
+}
+
+/**
+ * @brief Check if the text after its first character matches.
+ * @param [in] pszText Text whose first character matched.
+ */
+bool FindTextEngine::IsMatchAt(LPCTSTR pszText) const
+{
+	const size_t nWhat = m_what.size();
+	for (size_t i = 1; i < nWhat; i++)
+	{
+		if (Fold(pszText[i]) != m_what[i])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Fold a character to the case it is compared in.
+ * Case-insensitive searches compare in upper case, like the lines and the
+ * text to find were converted with CString::MakeUpper() before.
+ */
+TCHAR FindTextEngine::Fold(TCHAR ch) const
+{
+	if (m_dwFlags & FIND_MATCH_CASE)
+		return ch;
+	return (TCHAR) _totupper(ch);
+}
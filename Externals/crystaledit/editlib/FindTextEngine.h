@@ -0,0 +1,74 @@
+/**
+ * @file  FindTextEngine.h
+ *
+ * @brief Declaration file for FindTextEngine class.
+ */
+
+#ifndef _FIND_TEXT_ENGINE_H_
+#define _FIND_TEXT_ENGINE_H_
+
+#include <vector>
+#include <string>
+#include "cregexp.h"
+
+//  CCrystalTextView::FindText() flags
+enum
+{
+  FIND_MATCH_CASE = 0x0001,
+  FIND_WHOLE_WORD = 0x0002,
+  FIND_REGEXP = 0x0004,
+  FIND_DIRECTION_UP = 0x0010,
+  REPLACE_SELECTION = 0x0100, 
+  FIND_NO_WRAP = 0x200,
+  FIND_NO_CLOSE = 0x400
+};
+
+/**
+ * @brief Finds text in lines of the editor.
+ *
+ * The text to find is compiled once by Compile(), which does nothing if the
+ * text and the flags did not change since the last call, so that searching
+ * many lines doesn't compile a regular expression per line.
+ *
+ * Lines are searched in place. For the literal search, the first character
+ * of the text (in all its cases, if the search is case-insensitive) is
+ * looked for with memchr-like scans and the rest of the text is compared
+ * at the candidates only, folding the case of one character at a time.
+ *
+ * A search may start inside a line. Regular expressions still see the text
+ * before the start, so ^ doesn't match at the start of the rest of a line.
+ */
+class FindTextEngine
+{
+public:
+	/** @brief Position and length of a match in a line. */
+	struct Match
+	{
+		int nPos;
+		int nLen;
+	};
+
+	FindTextEngine();
+	~FindTextEngine();
+
+	bool Compile(LPCTSTR pszFindWhat, DWORD dwFlags);
+	int Find(LPCTSTR pszText, int nLength, int nStart, int &nLen, RxMatchRes *rxmatch) const;
+	void FindAll(LPCTSTR pszText, int nLength, std::vector<Match> &matches) const;
+
+private:
+	int FindLiteral(LPCTSTR pszText, int nLength, int nStart) const;
+	bool IsMatchAt(LPCTSTR pszText) const;
+	TCHAR Fold(TCHAR ch) const;
+
+	FindTextEngine(const FindTextEngine &);
+	FindTextEngine &operator=(const FindTextEngine &);
+
+	std::basic_string<TCHAR> m_sFindWhat; /**< Text last compiled */
+	DWORD m_dwFlags; /**< Flags last compiled */
+	bool m_bCompiled; /**< Has Compile() been called? */
+	RxNode *m_rxnode; /**< Compiled regular expression, or NULL */
+	std::vector<TCHAR> m_what; /**< Text to find, case folded */
+	std::vector<TCHAR> m_first; /**< Characters folding to the first character */
+};
+
+#endif // _FIND_TEXT_ENGINE_H_
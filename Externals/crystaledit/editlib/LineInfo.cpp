@@ -34,7 +34,8 @@ void LineInfo::Clear()
 {
   if (m_pcLine != NULL)
     {
-      delete[] m_pcLine;
+      if (!IsShared())
+        delete[] m_pcLine;
       m_pcLine = NULL;
       m_nLength = 0;
       m_nMax = 0;
@@ -52,7 +53,8 @@ void LineInfo::FreeBuffer()
 {
   if (m_pcLine != NULL)
     {
-      delete[] m_pcLine;
+      if (!IsShared())
+        delete[] m_pcLine;
       m_pcLine = NULL;
       m_nLength = 0;
       m_nMax = 0;
@@ -73,11 +75,11 @@ void LineInfo::Create(LPCTSTR pszLine, int nLength)
       return;
     }
 
+  if (m_pcLine != NULL && !IsShared())
+    delete[] m_pcLine;
   m_nLength = nLength;
   m_nMax = ALIGN_BUF_SIZE (m_nLength + 1);
   ASSERT (m_nMax >= m_nLength + 1);
-  if (m_pcLine != NULL)
-    delete[] m_pcLine;
   m_pcLine = new TCHAR[m_nMax];
   ZeroMemory(m_pcLine, m_nMax * sizeof(TCHAR));
   const DWORD dwLen = sizeof (TCHAR) * m_nLength;
@@ -93,16 +95,54 @@ void LineInfo::Create(LPCTSTR pszLine, int nLength)
   m_nEolChars = nEols;
 }
 
+/**
+ * @brief Create a line referring to text owned by the buffer.
+ * The text is copied to a buffer of the line when the line is changed
+ * for the first time, so loading a file needs no allocation per line.
+ * @param [in] pszLine Line data, must be zero-terminated and live as
+ * long as the line.
+ * @param [in] nLength Line length.
+ */
+void LineInfo::CreateShared(LPCTSTR pszLine, int nLength)
+{
+  ASSERT (pszLine[nLength] == '\0');
+  if (m_pcLine != NULL && !IsShared())
+    delete[] m_pcLine;
+  m_pcLine = const_cast<TCHAR *>(pszLine);
+  m_nMax = 0;
+
+  int nEols = 0;
+  if (nLength > 1 && IsDosEol(&pszLine[nLength - 2]))
+    nEols = 2;
+  else if (nLength && IsEol(pszLine[nLength - 1]))
+    nEols = 1;
+  m_nLength = nLength - nEols;
+  m_nEolChars = nEols;
+}
+
+/**
+ * @brief Copy shared line data to a buffer of the line.
+ */
+void LineInfo::Unshare()
+{
+  if (!IsShared())
+    return;
+  m_nMax = ALIGN_BUF_SIZE (FullLength() + 1);
+  TCHAR *pcNewBuf = new TCHAR[m_nMax];
+  memcpy (pcNewBuf, m_pcLine, sizeof (TCHAR) * (FullLength() + 1));
+  m_pcLine = pcNewBuf;
+}
+
 /**
  * @brief Create an empty line.
  */
 void LineInfo::CreateEmpty()
 {
+  if (m_pcLine != NULL && !IsShared())
+    delete [] m_pcLine;
   m_nLength = 0;
   m_nEolChars = 0;
   m_nMax = ALIGN_BUF_SIZE (m_nLength + 1);
-  if (m_pcLine != NULL)
-    delete [] m_pcLine;
   m_pcLine = new TCHAR[m_nMax];
   ZeroMemory(m_pcLine, m_nMax * sizeof(TCHAR));
 }
@@ -114,6 +154,7 @@ void LineInfo::CreateEmpty()
  */
 void LineInfo::Append(LPCTSTR pszChars, int nLength)
 {
+  Unshare();
   int nBufNeeded = m_nLength + nLength + 1;
   if (nBufNeeded > m_nMax)
     {
@@ -181,6 +222,7 @@ bool LineInfo::ChangeEol(LPCTSTR lpEOL)
     if (_tcscmp(m_pcLine + Length(), lpEOL) == 0)
       return false;
 
+  Unshare();
   int nBufNeeded = m_nLength + nNewEolChars+1;
   if (nBufNeeded > m_nMax)
     {
@@ -206,6 +248,7 @@ bool LineInfo::ChangeEol(LPCTSTR lpEOL)
  */
 void LineInfo::Delete(int nStartChar, int nEndChar)
 {
+  Unshare();
   if (nEndChar < Length() || m_nEolChars)
     {
       // preserve characters after deleted range by shifting up
@@ -222,6 +265,7 @@ void LineInfo::Delete(int nStartChar, int nEndChar)
  */
 void LineInfo::DeleteEnd(int nStartChar)
 {
+  Unshare();
   m_nLength = nStartChar;
   if (m_pcLine)
     m_pcLine[nStartChar] = 0;
@@ -234,10 +278,20 @@ void LineInfo::DeleteEnd(int nStartChar)
  */
 void LineInfo::CopyFrom(const LineInfo &li)
 {
-  if (m_pcLine != NULL)
+  if (m_pcLine != NULL && !IsShared())
     delete [] m_pcLine;
-  m_pcLine = new TCHAR[li.m_nMax];
-  memcpy(m_pcLine, li.m_pcLine, li.m_nMax * sizeof(TCHAR));
+  if (li.IsShared())
+    {
+      m_nMax = ALIGN_BUF_SIZE (li.FullLength() + 1);
+      m_pcLine = new TCHAR[m_nMax];
+      memcpy(m_pcLine, li.m_pcLine, (li.FullLength() + 1) * sizeof(TCHAR));
+    }
+  else
+    {
+      m_nMax = li.m_nMax;
+      m_pcLine = new TCHAR[li.m_nMax];
+      memcpy(m_pcLine, li.m_pcLine, li.m_nMax * sizeof(TCHAR));
+    }
 }
 
 /**
@@ -247,6 +301,7 @@ void LineInfo::RemoveEol()
 {
   if (HasEol())
   {
+    Unshare();
     m_pcLine[m_nLength] = '\0';
     m_nEolChars = 0;
   }
@@ -28,6 +28,7 @@ public:
     void Clear();
     void FreeBuffer();
     void Create(LPCTSTR pszLine, int nLength);
+    void CreateShared(LPCTSTR pszLine, int nLength);
     void CreateEmpty();
     void Append(LPCTSTR pszChars, int nLength);
     void Delete(int nStartChar, int nEndChar);
@@ -57,8 +58,12 @@ public:
     };
 
 private:
+    /** @brief Does the line refer to text owned by the buffer? */
+    bool IsShared() const { return m_pcLine != NULL && m_nMax == 0; }
+    void Unshare();
+
     TCHAR *m_pcLine; /**< Line data. */
-    int m_nMax; /**< Allocated space for line data. */
+    int m_nMax; /**< Allocated space for line data (0 if shared). */
     int m_nLength; /**< Line length (without EOL bytes). */
     int m_nEolChars; /**< # of EOL bytes. */
   };
@@ -64,6 +64,7 @@
 
 #include "StdAfx.h"
 #include <vector>
+#include <algorithm>
 #include <malloc.h>
 #include "editcmd.h"
 #include "LineInfo.h"
@@ -87,6 +88,9 @@ using std::vector;
 
 const TCHAR crlf[] = _T ("\r\n");
 
+/** @brief Size of blocks holding text of loaded lines (in chars). */
+static const int LINE_ARENA_BLOCK_SIZE = 256 * 1024;
+
 #ifdef _DEBUG
 #define _ADVANCED_BUGCHECK  1
 #endif
@@ -165,11 +169,14 @@ CCrystalTextBuffer::CCrystalTextBuffer ()
   m_nSourceEncoding = m_nDefaultEncoding;
   m_dwCurrentRevisionNumber = 0;
   m_dwRevisionNumberOnSave = 0;
+  m_pcLineArenaNext = NULL;
+  m_nLineArenaFree = 0;
 }
 
 CCrystalTextBuffer:: ~ CCrystalTextBuffer ()
 {
   ASSERT (!m_bInit);            //  You must call FreeAll() before deleting the object
+  FreeLineArena ();
 }
 
 
@@ -234,6 +241,59 @@ AppendLine (int nLineIndex, LPCTSTR pszChars, int nLength /*= -1*/ )
   li.Append(pszChars, nLength);
 }
 
+/**
+ * @brief Set text of a line read from file.
+ *
+ * The text is stored in large blocks shared by all loaded lines instead
+ * of a buffer of its own; a line gets its own buffer when it is changed.
+ *
+ * @param nLineIndex : index of the line, which must not have text yet
+ * @param pszChars, nLength : line text without EOL
+ * @param pszEol, nEolLength : EOL of the line
+ */
+void CCrystalTextBuffer::
+SetLoadedLine (int nLineIndex, LPCTSTR pszChars, int nLength, LPCTSTR pszEol, int nEolLength)
+{
+  const int nFullLength = nLength + nEolLength;
+  if (nFullLength == 0)
+    {
+      m_aLines[nLineIndex].CreateEmpty ();
+      return;
+    }
+
+  //  Arena blocks are never reallocated, lines keep pointing to them
+  const int nNeeded = nFullLength + 1;
+  if (nNeeded > m_nLineArenaFree)
+    {
+      const int nBlockSize = (std::max) (nNeeded, LINE_ARENA_BLOCK_SIZE);
+      m_aLineArena.push_back (new TCHAR[nBlockSize]);
+      m_pcLineArenaNext = m_aLineArena.back ();
+      m_nLineArenaFree = nBlockSize;
+    }
+  TCHAR *pcLine = m_pcLineArenaNext;
+  m_pcLineArenaNext += nNeeded;
+  m_nLineArenaFree -= nNeeded;
+
+  memcpy (pcLine, pszChars, sizeof (TCHAR) * nLength);
+  memcpy (pcLine + nLength, pszEol, sizeof (TCHAR) * nEolLength);
+  pcLine[nFullLength] = '\0';
+  m_aLines[nLineIndex].CreateShared (pcLine, nFullLength);
+}
+
+/**
+ * @brief Free blocks holding text of loaded lines.
+ * Lines referring to the blocks must have been freed before.
+ */
+void CCrystalTextBuffer::
+FreeLineArena ()
+{
+  for (std::vector<TCHAR *>::iterator iter = m_aLineArena.begin (); iter != m_aLineArena.end (); ++iter)
+    delete[] *iter;
+  m_aLineArena.clear ();
+  m_pcLineArenaNext = NULL;
+  m_nLineArenaFree = 0;
+}
+
 /**
  * @brief Copy line range [line1;line2] to range starting at newline1
  *
@@ -294,6 +354,7 @@ FreeAll ()
       ++iter;
     }
   m_aLines.clear();
+  FreeLineArena ();
 
   // Undo buffer will be cleared by its destructor
 
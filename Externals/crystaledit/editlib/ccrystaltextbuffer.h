@@ -155,6 +155,9 @@ public :
 
     //  Lines of text
     std::vector<LineInfo> m_aLines; /**< Text lines. */
+    std::vector<TCHAR *> m_aLineArena; /**< Blocks holding text of loaded lines. */
+    TCHAR *m_pcLineArenaNext; /**< Free space in last arena block. */
+    int m_nLineArenaFree; /**< Count of free chars in last arena block. */
 
     //  Undo
     std::vector<UndoRecord> m_aUndoBuf; /**< Undo records. */
@@ -173,6 +176,8 @@ public :
     //  Helper methods
     void InsertLine (LPCTSTR pszLine, int nLength, int nPosition = -1, int nCount = 1);
     void AppendLine (int nLineIndex, LPCTSTR pszChars, int nLength);
+    void SetLoadedLine (int nLineIndex, LPCTSTR pszChars, int nLength, LPCTSTR pszEol, int nEolLength);
+    void FreeLineArena ();
     void MoveLine(int line1, int line2, int newline1);
     void SetEmptyLine(int nPosition, int nCount = 1);
 
@@ -104,6 +104,7 @@
 #include "ViewableWhitespace.h"
 #include "SyntaxColors.h"
 #include "string_util.h"
+#include "FindTextEngine.h"
 
 using std::vector;
 
@@ -505,7 +506,7 @@ CCrystalTextView::CCrystalTextView()
 	, m_pFindTextDlg(NULL)
 {
 	memset(((CView*)this) + 1, 0, sizeof(*this) - sizeof(class CView)); // AFX_ZERO_INIT_OBJECT (CView)
-	m_rxnode = NULL;
+	m_pFindEngine = new FindTextEngine;
 	m_pszMatched = NULL;
 	m_bSelMargin = true;
 	m_bViewLineNumbers = false;
@@ -553,14 +554,10 @@ CCrystalTextView::~CCrystalTextView()
 		free(m_pszLastFindWhat);
 		m_pszLastFindWhat = NULL;
 	}
-	if (m_rxnode)
-	{
-		RxFree(m_rxnode);
-		m_rxnode = NULL;
-	}
+	delete m_pFindEngine;
 	if (m_pszMatched)
 	{
-		free(m_pszMatched); // Allocated by _tcsdup()
+		free(m_pszMatched); // Allocated by malloc()
 		m_pszMatched = NULL;
 	}
 	//BEGIN SW
@@ -4206,62 +4203,6 @@ PrepareDragData()
 	return hData;
 }
 
-static int
-FindStringHelper(LPCTSTR pszFindWhere, LPCTSTR pszFindWhat, DWORD dwFlags, int &nLen, RxNode *&rxnode, RxMatchRes *rxmatch)
-{
-	if (dwFlags & FIND_REGEXP)
-	{
-		int pos;
-
-		if (rxnode)
-			RxFree(rxnode);
-		rxnode = RxCompile(pszFindWhat, (dwFlags & FIND_MATCH_CASE) != 0 ? RX_CASE : 0);
-		if (rxnode && RxExec(rxnode, pszFindWhere, _tcslen(pszFindWhere), pszFindWhere, rxmatch))
-		{
-			pos = rxmatch->Open[0];
-			nLen = rxmatch->Close[0] - rxmatch->Open[0];
-		}
-		else
-		{
-			pos = -1;
-		}
-		return pos;
-	}
-	else
-	{
-		ASSERT(pszFindWhere != NULL);
-		ASSERT(pszFindWhat != NULL);
-		int nCur = 0;
-		int nLength = (int)_tcslen(pszFindWhat);
-		LPCTSTR pszFindWhereOrig = pszFindWhere;
-		nLen = nLength;
-		for (;;)
-		{
-			LPCTSTR pszPos = _tcsstr(pszFindWhere, pszFindWhat);
-			if (pszPos == NULL)
-				return -1;
-			if ((dwFlags & FIND_WHOLE_WORD) == 0)
-				return nCur + (int)(pszPos - pszFindWhere);
-			if (pszPos > pszFindWhereOrig && xisalnum(pszPos[-1]))
-			{
-				nCur += (int)(pszPos - pszFindWhere + 1);
-				pszFindWhere = pszPos + 1;
-				continue;
-			}
-			if (xisalnum(pszPos[nLength]))
-			{
-				nCur += (int)(pszPos - pszFindWhere + 1);
-				pszFindWhere = pszPos + 1;
-				continue;
-			}
-			return nCur + (int)(pszPos - pszFindWhere);
-		}
-	}
-	ASSERT(false);               // Unreachable
-
-	return -1;
-}
-
 /**
  * @brief Select text in editor.
  * @param [in] ptStartPos Star position for highlight.
@@ -4345,6 +4286,21 @@ int HowManyStr(LPCTSTR s, TCHAR c)
 	return n;
 }
 
+/**
+ * @brief Keep a copy of the text a regular expression was matched in.
+ * @param [in,out] pszMatched Copy of the text, allocated by malloc().
+ * @param [in] pszText Text matched, need not be zero-terminated.
+ * @param [in] nLength Length of the text.
+ */
+static void SetMatchedText(LPTSTR &pszMatched, LPCTSTR pszText, int nLength)
+{
+	if (pszMatched)
+		free(pszMatched);
+	pszMatched = (LPTSTR)malloc((nLength + 1) * sizeof(TCHAR));
+	memcpy(pszMatched, pszText, nLength * sizeof(TCHAR));
+	pszMatched[nLength] = _T('\0');
+}
+
 bool CCrystalTextView::
 FindTextInBlock(LPCTSTR pszText, const CPoint & ptStartPosition,
 	const CPoint & ptBlockBegin, const CPoint & ptBlockEnd,
@@ -4365,18 +4321,12 @@ FindTextInBlock(LPCTSTR pszText, const CPoint & ptStartPosition,
 		ptCurrentPos.x < ptBlockBegin.x)
 		ptCurrentPos = ptBlockBegin;
 
-	CString what = pszText;
-	int nEolns;
+	if (!m_pFindEngine->Compile(pszText, dwFlags))
+		return false;
+	int nEolns = 0;
 	if (dwFlags & FIND_REGEXP)
-	{
-		nEolns = HowManyStr(what, _T("\\n"));
-	}
-	else
-	{
-		nEolns = 0;
-		if ((dwFlags & FIND_MATCH_CASE) == 0)
-			what.MakeUpper();
-	}
+		nEolns = HowManyStr(pszText, _T("\\n"));
+	std::vector<FindTextEngine::Match> matches;
 	if (dwFlags & FIND_DIRECTION_UP)
 	{
 		//  Let's check if we deal with whole text.
@@ -4392,6 +4342,8 @@ FindTextInBlock(LPCTSTR pszText, const CPoint & ptStartPosition,
 			{
 				int nLineLength;
 				CString line;
+				LPCTSTR pszLine;
+				int nSearchLen;
 				if (dwFlags & FIND_REGEXP)
 				{
 					for (int i = 0; i <= nEolns && ptCurrentPos.y >= i; i++)
@@ -4416,9 +4368,10 @@ FindTextInBlock(LPCTSTR pszText, const CPoint & ptStartPosition,
 							line = item + line;
 						}
 					}
-					nLineLength = line.GetLength();
 					if (ptCurrentPos.x == -1)
 						ptCurrentPos.x = 0;
+					pszLine = line;
+					nSearchLen = line.GetLength();
 				}
 				else
 				{
@@ -4431,32 +4384,23 @@ FindTextInBlock(LPCTSTR pszText, const CPoint & ptStartPosition,
 						if (ptCurrentPos.x >= nLineLength)
 							ptCurrentPos.x = nLineLength - 1;
 
-					LPCTSTR pszChars = GetLineChars(ptCurrentPos.y);
-					_tcsncpy(line.GetBuffer(ptCurrentPos.x + 2), pszChars, ptCurrentPos.x + 1);
-					line.ReleaseBuffer(ptCurrentPos.x + 1);
-					if ((dwFlags & FIND_MATCH_CASE) == 0)
-						line.MakeUpper();
+					//  Search the line in place up to the current position
+					pszLine = GetLineChars(ptCurrentPos.y);
+					nSearchLen = min(ptCurrentPos.x + 1, nLineLength);
 				}
 
-				int nFoundPos = -1;
-				int nMatchLen = what.GetLength();
-				int nLineLen = line.GetLength();
-				int nPos;
-				do
+				//  The last match in the line is the one found
+				m_pFindEngine->FindAll(pszLine, nSearchLen, matches);
+				if (!matches.empty())	// Found text!
 				{
-					nPos = ::FindStringHelper(line, what, dwFlags, m_nLastFindWhatLen, m_rxnode, &m_rxmatch);
-					if (nPos >= 0)
+					ptCurrentPos.x = matches.back().nPos;
+					m_nLastFindWhatLen = matches.back().nLen;
+					if (dwFlags & FIND_REGEXP)
 					{
-						nFoundPos = (nFoundPos == -1) ? nPos : nFoundPos + nPos;
-						nFoundPos += nMatchLen;
-						line = line.Right(nLineLen - (nMatchLen + nPos));
-						nLineLen = line.GetLength();
+						//  Match it again for its groups, replacing refers to them
+						m_pFindEngine->Find(pszLine, nSearchLen, matches.back().nPos, m_nLastFindWhatLen, &m_rxmatch);
+						SetMatchedText(m_pszMatched, pszLine, nSearchLen);
 					}
-				} while (nPos >= 0);
-
-				if (nFoundPos >= 0)	// Found text!
-				{
-					ptCurrentPos.x = nFoundPos - nMatchLen;
 					*pptFoundPos = ptCurrentPos;
 					return true;
 				}
@@ -4483,7 +4427,10 @@ FindTextInBlock(LPCTSTR pszText, const CPoint & ptStartPosition,
 			{
 				int nLineLength, nLines;
 				CString line;
-				if (dwFlags & FIND_REGEXP)
+				LPCTSTR pszLine;
+				int nSearchLen;
+				int nStart = 0;
+				if (nEolns)
 				{
 					nLines = m_pTextBuffer->GetLineCount();
 					for (int i = 0; i <= nEolns && ptCurrentPos.y + i < nLines; i++)
@@ -4508,36 +4455,37 @@ FindTextInBlock(LPCTSTR pszText, const CPoint & ptStartPosition,
 							line += item;
 						}
 					}
-					nLineLength = line.GetLength();
+					pszLine = line;
+					nSearchLen = line.GetLength();
 				}
 				else
 				{
-					nLineLength = GetLineLength(ptCurrentPos.y) - ptCurrentPos.x;
-					if (nLineLength <= 0)
+					nLineLength = GetLineLength(ptCurrentPos.y);
+					//  Only regular expressions are searched in empty lines,
+					//  as ^ and $ match there. The empty rest of a line isn't
+					//  searched, or $ would be found again at the end of the
+					//  line after each replacement or Find Next.
+					if (ptCurrentPos.x >= nLineLength &&
+						(ptCurrentPos.x > 0 || (dwFlags & FIND_REGEXP) == 0))
 					{
 						ptCurrentPos.x = 0;
 						ptCurrentPos.y++;
 						continue;
 					}
 
-					LPCTSTR pszChars = GetLineChars(ptCurrentPos.y);
-					pszChars += ptCurrentPos.x;
-
-					//  Prepare necessary part of line
-					LPTSTR pszBuf = line.GetBuffer(nLineLength + 1);
-					_tcsncpy(pszBuf, pszChars, nLineLength);
-					line.ReleaseBuffer(nLineLength);
-					if ((dwFlags & FIND_MATCH_CASE) == 0)
-						line.MakeUpper();
+					//  Search the rest of the line in place, regular
+					//  expressions see the start of the line
+					pszLine = GetLineChars(ptCurrentPos.y);
+					nSearchLen = nLineLength;
+					nStart = ptCurrentPos.x;
 				}
 
 				//  Perform search in the line
-				int nPos = ::FindStringHelper(line, what, dwFlags, m_nLastFindWhatLen, m_rxnode, &m_rxmatch);
+				int nPos = m_pFindEngine->Find(pszLine, nSearchLen, nStart, m_nLastFindWhatLen, &m_rxmatch);
 				if (nPos >= 0)
 				{
-					if (m_pszMatched)
-						free(m_pszMatched);
-					m_pszMatched = _tcsdup(line);
+					//  Keep the text searched, replacing refers to its groups
+					SetMatchedText(m_pszMatched, pszLine, nSearchLen);
 					if (nEolns)
 					{
 						CString item = line.Left(nPos);
@@ -4561,7 +4509,7 @@ FindTextInBlock(LPCTSTR pszText, const CPoint & ptStartPosition,
 					}
 					else
 					{
-						ptCurrentPos.x += nPos;
+						ptCurrentPos.x = nPos;
 					}
 					//  Check of the text found is outside the block.
 					if (ptCurrentPos.y == ptBlockEnd.y && ptCurrentPos.x >= ptBlockEnd.x)
@@ -4625,12 +4573,44 @@ static void ConvertSearchFlagsToLastSearchInfos(LastSearchInfos *lastSearch, DWO
 	lastSearch->m_bNoClose = (dwFlags & FIND_NO_CLOSE) != 0;
 }
 
+/**
+ * @brief Move a search position past a zero-length match found there.
+ * The match would be found at its own position again, so the search
+ * continues from the next character, or from the start of the next line.
+ * @param [in,out] ptPos Position of the match.
+ * @return false if the match is at the end of the text.
+ */
+bool CCrystalTextView::
+SkipZeroLengthMatch(CPoint & ptPos)
+{
+	if (ptPos.x < GetLineLength(ptPos.y))
+	{
+		ptPos.x++;
+		return true;
+	}
+	if (ptPos.y + 1 >= GetLineCount())
+		return false;
+	ptPos.x = 0;
+	ptPos.y++;
+	return true;
+}
+
 bool CCrystalTextView::
 FindText(const LastSearchInfos * lastSearch)
 {
 	CPoint ptTextPos;
 	DWORD dwSearchFlags = ConvertSearchInfosToSearchFlags(lastSearch);
-	if (!FindText(lastSearch->m_sText, m_ptCursorPos, dwSearchFlags, !lastSearch->m_bNoWrap,
+	CPoint ptSearchPos = m_ptCursorPos;
+	//  Don't find a zero-length match at the cursor again
+	if (m_bLastSearch && (m_dwLastSearchFlags & FIND_REGEXP) && m_nLastFindWhatLen == 0 &&
+		(dwSearchFlags & FIND_DIRECTION_UP) == 0 && !IsSelection() &&
+		!SkipZeroLengthMatch(ptSearchPos))
+	{
+		if (lastSearch->m_bNoWrap)
+			return false;
+		ptSearchPos = CPoint(0, 0);
+	}
+	if (!FindText(lastSearch->m_sText, ptSearchPos, dwSearchFlags, !lastSearch->m_bNoWrap,
 		&ptTextPos))
 	{
 		return false;
@@ -4758,8 +4738,16 @@ OnEditRepeat()
 			CPoint ptDummy;
 			GetSelection(ptSearchPos, ptDummy);
 		}
+		//  Don't find a zero-length match at the cursor again
+		bool bEnd = false;
+		if ((m_dwLastSearchFlags & (FIND_REGEXP | FIND_DIRECTION_UP)) == FIND_REGEXP &&
+			m_nLastFindWhatLen == 0 && !IsSelection() && !SkipZeroLengthMatch(ptSearchPos))
+		{
+			bEnd = (m_dwLastSearchFlags & FIND_NO_WRAP) != 0;
+			ptSearchPos = CPoint(0, 0);
+		}
 
-		if (!FindText(sText, ptSearchPos, m_dwLastSearchFlags,
+		if (bEnd || !FindText(sText, ptSearchPos, m_dwLastSearchFlags,
 			(m_dwLastSearchFlags & FIND_NO_WRAP) == 0, &ptFoundPos))
 		{
 			CString prompt;
@@ -5912,18 +5900,12 @@ void CCrystalTextView::EnsureVisible(CPoint ptStart, CPoint ptEnd)
 bool CCrystalTextView::
 SetTextTypeByContent(LPCTSTR pszContent)
 {
-	RxNode *rxnode = NULL;
+	FindTextEngine engine;
 	RxMatchRes rxmatch;
 	int nLen;
-	if (::FindStringHelper(pszContent, _T("^\\s*\\<\\?xml\\s+.+?\\?\\>\\s*$"),
-		FIND_REGEXP, nLen, rxnode, &rxmatch) == 0)
-	{
-		if (rxnode)
-			RxFree(rxnode);
+	if (engine.Compile(_T("^\\s*\\<\\?xml\\s+.+?\\?\\>\\s*$"), FIND_REGEXP) &&
+		engine.Find(pszContent, (int)_tcslen(pszContent), 0, nLen, &rxmatch) == 0)
 		return SetTextType(CCrystalTextView::SRC_XML);
-	}
-	if (rxnode)
-		RxFree(rxnode);
 	return false;
 }
 
@@ -41,6 +41,7 @@
 #include <vector>
 #include "cregexp.h"
 #include "crystalparser.h"
+#include "FindTextEngine.h"
 
 ////////////////////////////////////////////////////////////////////////////
 // Forward class declarations
@@ -56,18 +57,6 @@ struct LastSearchInfos;
 ////////////////////////////////////////////////////////////////////////////
 // CCrystalTextView class declaration
 
-//  CCrystalTextView::FindText() flags
-enum
-{
-  FIND_MATCH_CASE = 0x0001,
-  FIND_WHOLE_WORD = 0x0002,
-  FIND_REGEXP = 0x0004,
-  FIND_DIRECTION_UP = 0x0010,
-  REPLACE_SELECTION = 0x0100, 
-  FIND_NO_WRAP = 0x200,
-  FIND_NO_CLOSE = 0x400
-};
-
 //  CCrystalTextView::UpdateView() flags
 enum
 {
@@ -728,7 +717,7 @@ public :
     static HINSTANCE s_hResourceInst;
 
     int m_nLastFindWhatLen;
-    RxNode *m_rxnode;
+    FindTextEngine *m_pFindEngine;
     RxMatchRes m_rxmatch;
     LPTSTR m_pszMatched;
     static LOGFONT m_LogFont;
@@ -843,6 +832,7 @@ public :
 	bool FindText (const LastSearchInfos * lastSearch);
     bool HighlightText (const CPoint & ptStartPos, int nLength,
       bool bCursorToLeft = false);
+    bool SkipZeroLengthMatch (CPoint & ptPos);
 
     // IME (input method editor)
     void UpdateCompositionWindowPos();
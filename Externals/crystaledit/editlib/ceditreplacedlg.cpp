@@ -451,6 +451,14 @@ OnEditReplaceAll ()
       m_ptFoundAt = m_pBuddy->GetCursorPos ();
       nNumReplaced++;
 
+      // a zero-length match would be found again where it was replaced
+      if (!m_pBuddy->m_nLastFindWhatLen && !m_pBuddy->SkipZeroLengthMatch (m_ptFoundAt))
+        {
+          if (m_nScope == 0 || m_bDontWrap)
+            break;
+          m_ptFoundAt = CPoint (0, 0);
+        }
+
       // find the next instance
       m_bFound = DoHighlightText ( false );
 
@@ -14,7 +14,8 @@
 //  - LEAVE THIS HEADER INTACT
 ////////////////////////////////////////////////////////////////////////////
 
-#include "StdAfx.h"
+#include <windows.h>
+#include <tchar.h>
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -86,7 +87,7 @@ int RxExec(RxNode *Regexp, LPCTSTR Data, int Len, LPCTSTR Start, RxMatchRes *Mat
 	UnicodeConverter::toUTF8(Data, Len, compString);
 #else
 	int startoffset = Start - Data;
-	compString = Data;
+	compString.assign(Data, Len);
 #endif
 	int result = 0;
 	try {
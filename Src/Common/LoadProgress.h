@@ -0,0 +1,48 @@
+/**
+ * @file  LoadProgress.h
+ *
+ * @brief Declaration of LoadProgress class.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Progress of loading one or more files at the same time.
+ *
+ * Threads loading files add the count of bytes they have read without
+ * locking; any thread may read the progress of all files meanwhile.
+ */
+class LoadProgress
+{
+public:
+	LoadProgress() : m_total(0), m_loaded(0) { }
+
+	/** @brief Add the size of a file to load. */
+	void AddTotal(int64_t size) { m_total += size; }
+	/** @brief Add a count of bytes read. */
+	void AddLoaded(int64_t size) { m_loaded += size; }
+	int64_t GetTotal() const { return m_total; }
+	int64_t GetLoaded() const { return m_loaded; }
+
+	/**
+	 * @brief Get the percentage of bytes read, at most 100.
+	 * Files may be read twice (e.g. to try another encoding).
+	 */
+	int GetPercent() const
+	{
+		int64_t total = m_total;
+		int64_t loaded = m_loaded;
+		if (total <= 0 || loaded >= total)
+			return total <= 0 ? 0 : 100;
+		return static_cast<int>(loaded * 100 / total);
+	}
+
+private:
+	LoadProgress(const LoadProgress&);
+	LoadProgress& operator=(const LoadProgress&);
+
+	std::atomic<int64_t> m_total; /**< Count of bytes to read */
+	std::atomic<int64_t> m_loaded; /**< Count of bytes read */
+};
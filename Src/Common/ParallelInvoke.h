@@ -0,0 +1,170 @@
+/**
+ * @file  ParallelInvoke.h
+ *
+ * @brief Declaration of ParallelInvoke function templates.
+ */
+#pragma once
+
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/Thread.h>
+#include <Poco/Runnable.h>
+#include <Poco/Exception.h>
+#include <exception>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Run two functions concurrently and wait until both have returned.
+ * @p f1 runs in a new thread and @p f2 in the calling thread. Both run in the
+ * calling thread, one after the other, if @p bConcurrent is false or the
+ * thread can't be started.
+ * An exception thrown by @p f1 is thrown to the caller after @p f2 has run.
+ * @param [in] f1 Function to run in the new thread.
+ * @param [in] f2 Function to run in the calling thread.
+ * @param [in] bConcurrent Run functions concurrently? Starting a thread costs
+ *  more than running small tasks in sequence.
+ * @note Thread-local state of the calling thread (e.g. diffutils options) is
+ *  not visible to @p f1, so it must set up such state itself.
+ */
+template <class F1, class F2>
+void ParallelInvoke(F1 f1, F2 f2, bool bConcurrent = true)
+{
+	class Task : public Poco::Runnable
+	{
+	public:
+		explicit Task(F1& f) : m_f(f) { }
+		void run()
+		{
+			try
+			{
+				m_f();
+			}
+			catch (...)
+			{
+				m_exception = std::current_exception();
+			}
+		}
+		std::exception_ptr m_exception;
+	private:
+		F1& m_f;
+	};
+
+	Task task(f1);
+	Poco::Thread thread;
+	bool bStarted = false;
+	if (bConcurrent)
+	{
+		try
+		{
+			thread.start(task);
+			bStarted = true;
+		}
+		catch (Poco::Exception&)
+		{
+		}
+	}
+	if (!bStarted)
+		task.run();
+	try
+	{
+		f2();
+	}
+	catch (...)
+	{
+		if (bStarted)
+			thread.join();
+		throw;
+	}
+	if (bStarted)
+		thread.join();
+	if (task.m_exception)
+		std::rethrow_exception(task.m_exception);
+}
+
+/**
+ * @brief Run a function for each index from 0 to @p count - 1, each in a
+ * thread of its own, and wait until all have returned.
+ * While waiting, @p wait is called in the calling thread every @p interval
+ * milliseconds, e.g. to show progress. The function runs in the calling
+ * thread for indexes whose thread can't be started.
+ * An exception thrown for an index is thrown to the caller after all have
+ * returned; if several threw, the one of the lowest index.
+ * @param [in] count Count of indexes.
+ * @param [in] f Function taking the index.
+ * @param [in] wait Function called while waiting.
+ * @param [in] interval Milliseconds between calls of @p wait.
+ * @note As with ParallelInvoke(), thread-local state of the calling thread
+ *  is not visible to @p f.
+ */
+template <class F, class W>
+void ParallelInvokeEach(int count, F f, W wait, long interval)
+{
+	class Task : public Poco::Runnable
+	{
+	public:
+		Task(F& f, int index) : m_f(f), m_index(index) { }
+		void run()
+		{
+			try
+			{
+				m_f(m_index);
+			}
+			catch (...)
+			{
+				m_exception = std::current_exception();
+			}
+		}
+		std::exception_ptr m_exception;
+	private:
+		F& m_f;
+		int m_index;
+	};
+
+	std::vector<std::unique_ptr<Task> > tasks;
+	std::vector<std::unique_ptr<Poco::Thread> > threads(count);
+	for (int i = 0; i < count; ++i)
+		tasks.push_back(std::unique_ptr<Task>(new Task(f, i)));
+	for (int i = 0; i < count; ++i)
+	{
+		threads[i].reset(new Poco::Thread);
+		try
+		{
+			threads[i]->start(*tasks[i]);
+		}
+		catch (Poco::Exception&)
+		{
+			threads[i].reset();
+		}
+	}
+	std::exception_ptr waitException;
+	for (int i = 0; i < count; ++i)
+	{
+		if (!threads[i])
+			tasks[i]->run();
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		if (!threads[i])
+			continue;
+		while (!waitException && !threads[i]->tryJoin(interval))
+		{
+			try
+			{
+				wait();
+			}
+			catch (...)
+			{
+				waitException = std::current_exception();
+			}
+		}
+		if (waitException)
+			threads[i]->join();
+	}
+	if (waitException)
+		std::rethrow_exception(waitException);
+	for (int i = 0; i < count; ++i)
+	{
+		if (tasks[i]->m_exception)
+			std::rethrow_exception(tasks[i]->m_exception);
+	}
+}
@@ -32,7 +32,16 @@ THE SOFTWARE.
 #include <cstdio>
 #include <cassert>
 #include <memory>
+#include <algorithm>
 #include <cstdint>
+#include <cwchar>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define UNIFILE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #include <Poco/SharedMemory.h>
 #include <Poco/Exception.h>
 #include "UnicodeString.h"
@@ -48,6 +57,7 @@ using Poco::Exception;
 
 static void Append(String &strBuffer, const TCHAR *pchTail, size_t cchTail,
 		size_t cchBufferMin = 1024);
+static TCHAR *AppendSpace(String &strBuffer, size_t cchTail, size_t cchBufferMin = 1024);
 
 /**
  * @brief The constructor.
@@ -401,6 +411,19 @@ bool UniMemFile::ReadString(String & line, bool * lossy)
  */
 static void Append(String &strBuffer, const TCHAR *pchTail,
 		size_t cchTail, size_t cchBufferMin)
+{
+	std::copy(pchTail, pchTail + cchTail, AppendSpace(strBuffer, cchTail, cchBufferMin));
+}
+
+/**
+ * @brief Append space for characters to string.
+ * The storage for the string is grown like in Append().
+ * @param [in, out] strBuffer A string to wich space is appended.
+ * @param [in] cchTail Amount of characters to append.
+ * @param [in] cchBufferMin Minimum size for the buffer.
+ * @return Pointer to the appended characters, to be filled by caller.
+ */
+static TCHAR *AppendSpace(String &strBuffer, size_t cchTail, size_t cchBufferMin)
 {
 	size_t cchBuffer = strBuffer.capacity();
 	size_t cchHead = strBuffer.length();
@@ -414,9 +437,129 @@ static void Append(String &strBuffer, const TCHAR *pchTail,
 			cchBuffer = cchBufferMin;
 	}
 	strBuffer.reserve(cchBuffer);
-	strBuffer.append(pchTail, cchTail);
+	strBuffer.resize(cchLength);
+	return &strBuffer[cchHead];
+}
+
+#ifdef UNIFILE_SSE2
+/** @brief Get index of lowest set bit in non-zero mask. */
+static inline unsigned LowestBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+/**
+ * @brief Count leading bytes which are ASCII characters other than EOL or zero.
+ * These bytes are characters as such in UTF-8, and need no stats either.
+ * @param [in] p Bytes to check.
+ * @param [in] len Count of bytes.
+ */
+static size_t CountAsciiRun(const unsigned char *p, size_t len)
+{
+	size_t i = 0;
+#ifdef UNIFILE_SSE2
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+		__m128i special = _mm_or_si128(_mm_or_si128(
+			_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)), _mm_cmpeq_epi8(v, zero));
+		// non-ASCII bytes have high bit set already
+		unsigned mask = _mm_movemask_epi8(_mm_or_si128(v, special));
+		if (mask)
+			return i + LowestBit(mask);
+	}
+#endif
+	for (; i < len; ++i)
+	{
+		unsigned char ch = p[i];
+		if (ch >= 0x80 || ch == '\r' || ch == '\n' || ch == 0)
+			break;
+	}
+	return i;
+}
+
+/**
+ * @brief Append ASCII bytes to string as characters.
+ */
+static void AppendAscii(String &strBuffer, const unsigned char *p, size_t len)
+{
+	TCHAR *dst = AppendSpace(strBuffer, len);
+	size_t i = 0;
+#if defined(UNIFILE_SSE2) && defined(_UNICODE) && WCHAR_MAX == 0xFFFF
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+	}
+#endif
+	for (; i < len; ++i)
+		dst[i] = p[i];
+}
+
+#ifdef _UNICODE
+/**
+ * @brief Count leading UCS-2BE characters other than EOL or zero.
+ * @param [in] p Characters to check.
+ * @param [in] cch Count of characters.
+ */
+static size_t CountUcs2beRun(const unsigned char *p, size_t cch)
+{
+	size_t i = 0;
+#ifdef UNIFILE_SSE2
+	const __m128i cr = _mm_set1_epi16('\r' << 8);
+	const __m128i lf = _mm_set1_epi16('\n' << 8);
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= cch; i += 8)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * 2));
+		__m128i special = _mm_or_si128(_mm_or_si128(
+			_mm_cmpeq_epi16(v, cr), _mm_cmpeq_epi16(v, lf)), _mm_cmpeq_epi16(v, zero));
+		unsigned mask = _mm_movemask_epi8(special);
+		if (mask)
+			return i + LowestBit(mask) / 2;
+	}
+#endif
+	for (; i < cch; ++i)
+	{
+		unsigned ch = (p[i * 2] << 8) + p[i * 2 + 1];
+		if (ch == '\r' || ch == '\n' || ch == 0)
+			break;
+	}
+	return i;
 }
 
+/**
+ * @brief Append UCS-2BE characters to string.
+ */
+static void AppendUcs2be(String &strBuffer, const unsigned char *p, size_t cch)
+{
+	TCHAR *dst = AppendSpace(strBuffer, cch);
+	size_t i = 0;
+#if defined(UNIFILE_SSE2) && WCHAR_MAX == 0xFFFF
+	for (; i + 8 <= cch; i += 8)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * 2));
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+	}
+#endif
+	for (; i < cch; ++i)
+		dst[i] = static_cast<TCHAR>((p[i * 2] << 8) + p[i * 2 + 1]);
+}
+#endif
+
 /**
  * @brief Record occurrence of binary zero to stats
  */
@@ -586,6 +729,54 @@ bool UniMemFile::ReadString(String & line, String & eol, bool * lossy)
 
 	while (m_current - m_base + (m_charsize - 1) < m_filesize)
 	{
+		// Characters needing no conversion are appended a run at a time
+		if (m_unicoding == ucr::UTF8)
+		{
+			size_t cb = CountAsciiRun(m_current, static_cast<size_t>(m_filesize - (m_current - m_base)));
+			if (cb > 0)
+			{
+				AppendAscii(line, m_current, cb);
+				m_current += cb;
+				continue;
+			}
+#ifdef _UNICODE
+			// Multibyte characters need no temporary strings
+			int utf8len = ucr::Utf8len_fromLeadByte(*m_current);
+			if (utf8len >= 2 && utf8len <= 4 && m_current - m_base + utf8len <= m_filesize)
+			{
+				unsigned ch = ucr::GetUtf8Char(m_current);
+				if (ch >= 0x80 && ch < 0x110000)
+				{
+					TCHAR wch[2];
+					int cch = 1;
+					if (ch < 0x10000)
+						wch[0] = static_cast<TCHAR>(ch);
+					else
+					{
+						wch[0] = static_cast<TCHAR>((ch - 0x10000) / 0x400 + 0xd800);
+						wch[1] = static_cast<TCHAR>((ch % 0x400) + 0xdc00);
+						cch = 2;
+					}
+					Append(line, wch, cch);
+					m_current += utf8len;
+					continue;
+				}
+			}
+#endif
+		}
+#ifdef _UNICODE
+		else if (m_unicoding == ucr::UCS2BE)
+		{
+			size_t cch = CountUcs2beRun(m_current, static_cast<size_t>(m_filesize - (m_current - m_base)) / 2);
+			if (cch > 0)
+			{
+				AppendUcs2be(line, m_current, cch);
+				m_current += cch * 2;
+				continue;
+			}
+		}
+#endif
+
 		unsigned ch = 0;
 		int  utf8len = 0;
 		bool doneline = false;
@@ -0,0 +1,158 @@
+/**
+ * @file  Utf8Writer.cpp
+ *
+ * @brief Implementation of Utf8Writer class.
+ */
+
+#include "Utf8Writer.h"
+#include <cstring>
+#include "unicoder.h"
+
+/** @brief Size of the buffer, in bytes. */
+static const size_t BufferSize = 64 * 1024;
+
+/** @brief Bytes one character can take: "\\u001f" or "&quot;" or UTF-8. */
+static const size_t MaxCharBytes = 8;
+
+/**
+ * @brief Constructor.
+ * @param [in] stream Stream to write to.
+ * @param [in] bCrLf Write newlines as CR-LF?
+ */
+Utf8Writer::Utf8Writer(std::ostream &stream, bool bCrLf)
+: m_stream(stream)
+, m_bCrLf(bCrLf)
+, m_buffer(BufferSize)
+, m_used(0)
+{
+}
+
+/**
+ * @brief Destructor, writes the rest of the buffer.
+ */
+Utf8Writer::~Utf8Writer()
+{
+	Flush();
+}
+
+/**
+ * @brief Write text.
+ * @param [in] text Text to write, UTF-16 (or UTF-32 where TCHAR has 32 bits).
+ * @param [in] len Length of the text in TCHARs.
+ * @param [in] escape How special characters are escaped.
+ */
+void Utf8Writer::Write(const TCHAR *text, size_t len, Escape escape)
+{
+	for (size_t i = 0; i < len; ++i)
+	{
+		unsigned ch = static_cast<unsigned>(text[i]);
+		if (sizeof(TCHAR) == 2 && ch >= 0xd800 && ch < 0xe000)
+		{
+			const unsigned ch2 = (i + 1 < len) ? static_cast<unsigned>(text[i + 1]) : 0;
+			if (ch < 0xdc00 && ch2 >= 0xdc00 && ch2 < 0xe000)
+			{
+				ch = ((ch & 0x3ff) << 10) + (ch2 & 0x3ff) + 0x10000;
+				++i;
+			}
+			else
+				ch = 0xfffd; // Unpaired surrogate
+		}
+		Put(ch, escape);
+	}
+}
+
+/**
+ * @brief Write bytes as they are.
+ * @param [in] data Bytes to write, usually already UTF-8 or ASCII.
+ * @param [in] len Count of bytes.
+ */
+void Utf8Writer::WriteBytes(const char *data, size_t len)
+{
+	if (m_used + len > m_buffer.size())
+	{
+		Flush();
+		if (len > m_buffer.size())
+		{
+			m_stream.write(data, len);
+			return;
+		}
+	}
+	memcpy(&m_buffer[m_used], data, len);
+	m_used += len;
+}
+
+/**
+ * @brief Write buffered bytes to the stream.
+ * @return true if the stream has no errors.
+ */
+bool Utf8Writer::Flush()
+{
+	if (m_used > 0)
+	{
+		m_stream.write(&m_buffer[0], m_used);
+		m_used = 0;
+	}
+	m_stream.flush();
+	return !!m_stream;
+}
+
+/**
+ * @brief Convert one character into the buffer.
+ * @param [in] ch Unicode code point of the character.
+ * @param [in] escape How special characters are escaped.
+ */
+void Utf8Writer::Put(unsigned ch, Escape escape)
+{
+	if (m_used + MaxCharBytes > m_buffer.size())
+		Flush();
+	if (ch >= 0x80)
+	{
+		m_used += ucr::Ucs4_to_Utf8(ch, reinterpret_cast<unsigned char *>(&m_buffer[m_used]));
+		return;
+	}
+	switch (escape)
+	{
+	case ESCAPE_XML:
+		switch (ch)
+		{
+		case '&': PutAscii("&amp;"); return;
+		case '<': PutAscii("&lt;"); return;
+		case '>': PutAscii("&gt;"); return;
+		case '"': PutAscii("&quot;"); return;
+		case '\'': PutAscii("&#39;"); return;
+		}
+		break;
+	case ESCAPE_JSON:
+		switch (ch)
+		{
+		case '"': PutAscii("\\\""); return;
+		case '\\': PutAscii("\\\\"); return;
+		case '\n': PutAscii("\\n"); return;
+		case '\r': PutAscii("\\r"); return;
+		case '\t': PutAscii("\\t"); return;
+		}
+		if (ch < 0x20)
+		{
+			static const char hex[] = "0123456789abcdef";
+			const char esc[] = { '\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0xf], 0 };
+			PutAscii(esc);
+			return;
+		}
+		break;
+	default:
+		break;
+	}
+	if (ch == '\n' && m_bCrLf)
+		m_buffer[m_used++] = '\r';
+	m_buffer[m_used++] = static_cast<char>(ch);
+}
+
+/**
+ * @brief Copy ASCII text into the buffer, which has room for it.
+ * @param [in] text Zero-terminated text, at most MaxCharBytes long.
+ */
+void Utf8Writer::PutAscii(const char *text)
+{
+	while (*text)
+		m_buffer[m_used++] = *text++;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file  Utf8Writer.h
+ *
+ * @brief Declaration of Utf8Writer class.
+ */
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include "UnicodeString.h"
+
+/**
+ * @brief Buffered writer converting text to UTF-8.
+ *
+ * Text is converted straight into a buffer, which is written to the
+ * stream when it is full, so that writing many short strings does not
+ * allocate memory. Newlines can be written as CR-LF, and text can be
+ * escaped for XML/HTML or JSON while it is converted.
+ */
+class Utf8Writer
+{
+public:
+	/** @brief How special characters of written text are escaped. */
+	enum Escape
+	{
+		ESCAPE_NONE, /**< Text is written as it is */
+		ESCAPE_XML, /**< &, <, >, " and ' are written as entities */
+		ESCAPE_JSON, /**< Text is written as contents of a JSON string */
+	};
+
+	explicit Utf8Writer(std::ostream &stream, bool bCrLf = true);
+	~Utf8Writer();
+	void Write(const TCHAR *text, size_t len, Escape escape = ESCAPE_NONE);
+	void Write(const TCHAR *text) { Write(text, _tcslen(text)); }
+	void Write(const String &text, Escape escape = ESCAPE_NONE) { Write(text.data(), text.length(), escape); }
+	void WriteBytes(const char *data, size_t len);
+	bool Flush();
+
+private:
+	void Put(unsigned ch, Escape escape);
+	void PutAscii(const char *text);
+
+	std::ostream &m_stream; /**< Stream written to */
+	bool m_bCrLf; /**< Are newlines written as CR-LF? */
+	std::vector<char> m_buffer; /**< Converted text not yet written */
+	size_t m_used; /**< Count of bytes used in buffer */
+};
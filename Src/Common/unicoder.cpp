@@ -20,6 +20,10 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <cassert>
 #include <memory>
 #include <cstdint>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define UNICODER_SSE2
+#include <emmintrin.h>
+#endif
 #include <Poco/UnicodeConverter.h>
 #include "UnicodeString.h"
 #include "ExConverter.h"
@@ -1127,73 +1131,60 @@ std::string toThreadCP(const std::wstring& str)
  * @brief Check for invalid UTF-8 bytes in buffer.
  * This function checks if there are invalid UTF-8 bytes in the given buffer.
  * If such bytes are found, caller knows this buffer is not valid UTF-8 file.
+ * The buffer is checked in one pass, runs of ASCII bytes are skipped 16
+ * bytes at a time.
  * @param [in] pBuffer Pointer to begin of the buffer.
  * @param [in] size Size of the buffer in bytes.
- * @return true if invalid bytes found, false otherwise.
+ * @param [out] pbPureAscii If not NULL, gets true if the buffer has only
+ * ASCII bytes (and then true is returned, as for invalid UTF-8).
+ * @return true if invalid bytes found, or if there were no multibyte
+ * characters, false otherwise.
  */
-bool CheckForInvalidUtf8(const char *pBuffer, size_t size)
+bool CheckForInvalidUtf8(const char *pBuffer, size_t size, bool *pbPureAscii)
 {
-	unsigned char * pVal2 = (unsigned char *)pBuffer;
-	for (size_t j = 0; j < size; ++j)
-	{
-		if ((*pVal2 == 0xC0) || (*pVal2 == 0xC1) || (*pVal2 >= 0xF5))
-			return true;
-		pVal2++;
-	}
-	pVal2 = (unsigned char *)pBuffer;
+	const unsigned char *pVal = reinterpret_cast<const unsigned char *>(pBuffer);
 	bool bUTF8 = false;
-	for (size_t i = 0; i < size; ++i)
+	if (pbPureAscii)
+		*pbPureAscii = false;
+	size_t i = 0;
+	while (i < size)
 	{
-		if ((*pVal2 & 0x80) == 0x00)
-			;
-		else if ((*pVal2 & 0xE0) == 0xC0)
+#ifdef UNICODER_SSE2
+		while (i + 16 <= size &&
+			_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pVal + i))) == 0)
+			i += 16;
+		if (i >= size)
+			break;
+#endif
+		const unsigned char ch = pVal[i];
+		size_t nTrail;
+		if (ch < 0x80)
 		{
-			if (i >= size - 1)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			bUTF8 = true;
+			++i;
+			continue;
 		}
-		else if ((*pVal2 & 0xF0) == 0xE0)
+		else if (ch >= 0xC2 && ch <= 0xDF)
+			nTrail = 1;
+		else if ((ch & 0xF0) == 0xE0)
+			nTrail = 2;
+		else if (ch >= 0xF0 && ch <= 0xF4)
+			nTrail = 3;
+		else
+			return true; // 0xC0, 0xC1, 0xF5 or above, or trail byte
+		if (nTrail >= size - i)
+			return true;
+		for (size_t j = 1; j <= nTrail; ++j)
 		{
-			if (i >= size - 2)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
+			if ((pVal[i + j] & 0xC0) != 0x80)
 				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			bUTF8 = true;
 		}
-		else if ((*pVal2 & 0xF8) == 0xF0)
-		{
-			if (i >= size - 3)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			bUTF8 = true;
-		}
-		else
-			return true;
-		pVal2++;
+		i += nTrail + 1;
+		bUTF8 = true;
 	}
 	if (bUTF8)
 		return false;
+	if (pbPureAscii)
+		*pbPureAscii = true;
 	return true;
 }
 
@@ -1282,6 +1273,38 @@ bool EqualCodepages(int cp1, int cp2)
 			|| (NormalizeCodepage(cp1) == NormalizeCodepage(cp2));
 }
 
+/**
+ * @brief Check if bytes below 0x80 are ASCII characters in a codepage.
+ * 7-bit encodings like ISO-2022-JP, HZ and UTF-7 use escapes of ASCII
+ * bytes for other characters, and EBCDIC has other characters there.
+ */
+bool IsAsciiCompatibleCodepage(int codepage)
+{
+	switch (codepage)
+	{
+	case CP_UCS2LE:
+	case CP_UCS2BE:
+	case 50220: // ISO-2022-JP
+	case 50221: // ISO-2022-JP with 1 byte kana
+	case 50222: // ISO-2022-JP with SO/SI kana
+	case 50225: // ISO-2022-KR
+	case 50227: // ISO-2022 Simplified Chinese
+	case 50229: // ISO-2022 Traditional Chinese
+	case 52936: // HZ-GB2312
+	case 65000: // UTF-7
+	// EBCDIC
+	case 37: case 500: case 870: case 875: case 1026: case 1047:
+	case 1140: case 1141: case 1142: case 1143: case 1144: case 1145:
+	case 1146: case 1147: case 1148: case 1149:
+	case 20273: case 20277: case 20278: case 20280: case 20284: case 20285:
+	case 20290: case 20297: case 20420: case 20423: case 20424: case 20833:
+	case 20838: case 20871: case 20880: case 20905: case 20924: case 21025:
+		return false;
+	default:
+		return true;
+	}
+}
+
 int getDefaultCodepage()
 {
 	return f_nDefaultCodepage;
@@ -108,7 +108,7 @@ int CrossConvert(const char* src, unsigned srclen, char* dest, unsigned destsize
 String CrossConvertToStringA(const char* src, unsigned srclen, int cpin, int cpout, bool * lossy);
 #endif
 
-bool CheckForInvalidUtf8(const char *pBuffer, size_t size);
+bool CheckForInvalidUtf8(const char *pBuffer, size_t size, bool *pbPureAscii = nullptr);
 
 UNICODESET DetermineEncoding(const unsigned char *pBuffer, uint64_t size, bool * pBom);
 
@@ -116,5 +116,6 @@ int getDefaultCodepage();
 void setDefaultCodepage(int cp);
 
 bool EqualCodepages(int cp1, int cp2);
+bool IsAsciiCompatibleCodepage(int codepage);
 
 } // namespace ucr
@@ -13,19 +13,37 @@
 # include <unistd.h>
 #endif
 #include <fcntl.h>
+#include <Poco/DigestEngine.h>
 
 namespace CompareEngines
 {
 
 BinaryCompare::BinaryCompare()
 {
+	m_pDigestEngines[0] = m_pDigestEngines[1] = m_pDigestEngines[2] = nullptr;
 }
 
 BinaryCompare::~BinaryCompare()
 {
 }
 
-static int compare_files(const String& file1, const String& file2)
+/**
+ * @brief Set digest engines getting the data of the files as it is read.
+ * Files are read to their end only if they are identical.
+ * @param [in] engine1 Digest engine for the first file, or NULL.
+ * @param [in] engine2 Digest engine for the second file, or NULL.
+ * @param [in] engine3 Digest engine for the third file, or NULL.
+ */
+void BinaryCompare::SetDigestEngines(Poco::DigestEngine *engine1, Poco::DigestEngine *engine2,
+	Poco::DigestEngine *engine3)
+{
+	m_pDigestEngines[0] = engine1;
+	m_pDigestEngines[1] = engine2;
+	m_pDigestEngines[2] = engine3;
+}
+
+static int compare_files(const String& file1, const String& file2,
+	Poco::DigestEngine *engine1, Poco::DigestEngine *engine2)
 {
 	const size_t bufsize = 1024 * 256;
 	int code;
@@ -47,6 +65,10 @@ static int compare_files(const String& file1, const String& file2)
 					code = DIFFCODE::SAME;
 				break;
 			}
+			if (engine1)
+				engine1->update(buf1, size1);
+			if (engine2)
+				engine2->update(buf2, size2);
 			if (size1 != size2 || memcmp(buf1, buf2, size1) != 0)
 			{
 				code = DIFFCODE::DIFF;
@@ -76,15 +98,15 @@ int BinaryCompare::CompareFiles(const PathContext& files, const DIFFITEM &di) co
 	unsigned code = DIFFCODE::DIFF;
 	if (files.GetSize() == 2 && di.diffFileInfo[0].size == di.diffFileInfo[1].size)
 	{
-		code = compare_files(files[0], files[1]);
+		code = compare_files(files[0], files[1], m_pDigestEngines[0], m_pDigestEngines[1]);
 	}
 	else if (files.GetSize() == 3 && 
 		di.diffFileInfo[0].size == di.diffFileInfo[1].size &&
 		di.diffFileInfo[1].size == di.diffFileInfo[2].size)
 	{
-		code = compare_files(files[0], files[1]);
+		code = compare_files(files[0], files[1], m_pDigestEngines[0], m_pDigestEngines[1]);
 		if (code == DIFFCODE::SAME)
-			code = compare_files(files[1], files[2]);
+			code = compare_files(files[1], files[2], nullptr, m_pDigestEngines[2]);
 	}
 	return code;
 }
@@ -7,6 +7,7 @@
 
 struct DIFFITEM;
 class PathContext;
+namespace Poco { class DigestEngine; }
 
 namespace CompareEngines
 {
@@ -20,7 +21,12 @@ class BinaryCompare
 public:
 	BinaryCompare();
 	~BinaryCompare();
+	void SetDigestEngines(Poco::DigestEngine *engine1, Poco::DigestEngine *engine2,
+		Poco::DigestEngine *engine3 = nullptr);
 	int CompareFiles(const PathContext& files, const DIFFITEM &di) const;
+
+private:
+	Poco::DigestEngine * m_pDigestEngines[3]; /**< Get the data read, may be NULL. */
 };
 
 } // namespace CompareEngines
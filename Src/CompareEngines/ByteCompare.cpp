@@ -7,6 +7,15 @@
 #include "ByteCompare.h"
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define BYTECOMPARE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #ifdef _WIN32
 #include <io.h>
 #else
@@ -20,6 +29,7 @@
 #include "DiffContext.h"
 #include "diff.h"
 #include "ByteComparator.h"
+#include <Poco/DigestEngine.h>
 
 namespace CompareEngines
 {
@@ -27,7 +37,7 @@ namespace CompareEngines
 static const int KILO = 1024; // Kilo(byte)
 
 /** @brief Quick contents compare's file buffer size. */
-static const int WMCMPBUFF = 32 * KILO;
+static const int WMCMPBUFF = 1024 * KILO;
 
 static void CopyTextStats(const FileTextStats * stats, FileTextStats * myTextStats);
 
@@ -39,6 +49,7 @@ ByteCompare::ByteCompare()
 		, m_piAbortable(nullptr)
 		, m_inf(nullptr)
 {
+	m_pDigestEngines[0] = m_pDigestEngines[1] = nullptr;
 }
 
 /**
@@ -92,9 +103,224 @@ void ByteCompare::SetFileData(int items, file_data *data)
 	m_inf = data;
 }
 
+/**
+ * @brief Set digest engines getting the data of the files as it is read.
+ * Files are read to their end unless compare stops at the first difference.
+ * @param [in] engine1 Digest engine for the first file, or NULL.
+ * @param [in] engine2 Digest engine for the second file, or NULL.
+ */
+void ByteCompare::SetDigestEngines(Poco::DigestEngine *engine1, Poco::DigestEngine *engine2)
+{
+	m_pDigestEngines[0] = engine1;
+	m_pDigestEngines[1] = engine2;
+}
+
+/**
+ * @brief Read next part of a file, and give it to its digest engine.
+ * @param [in] i Index of the file.
+ * @param [out] buffer Buffer getting the data.
+ * @param [in] count Max count of bytes to read.
+ * @return Count of bytes read, or -1 if read failed.
+ */
+int ByteCompare::ReadData(int i, char *buffer, unsigned count)
+{
+	int rtn = read(m_inf[i].desc, buffer, count);
+	if (rtn > 0 && m_pDigestEngines[i])
+		m_pDigestEngines[i]->update(buffer, rtn);
+	return rtn;
+}
+
+
+/**
+ * @brief Return index of the lowest set bit of a nonzero mask.
+ */
+static inline unsigned LowestBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+#ifdef BYTECOMPARE_SSE2
+/**
+ * @brief Return count of set bits in a 16-bit mask.
+ */
+static inline unsigned BitCount16(unsigned mask)
+{
+	mask = mask - ((mask >> 1) & 0x5555);
+	mask = (mask & 0x3333) + ((mask >> 2) & 0x3333);
+	mask = (mask + (mask >> 4)) & 0x0F0F;
+	return (mask + (mask >> 8)) & 0x1F;
+}
+
+/**
+ * @brief Return mask of bytes in 16-byte block equal to given byte.
+ */
+static inline unsigned MatchMask(__m128i data, __m128i ch)
+{
+	return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(data, ch));
+}
+#endif
+
+/**
+ * @brief Find first differing byte of two buffers.
+ * @param [in] ptr0 First buffer.
+ * @param [in] ptr1 Second buffer.
+ * @param [in] len Count of bytes to compare.
+ * @return Count of identical bytes in the beginning of the buffers.
+ */
+static int FindMismatch(const char *ptr0, const char *ptr1, int len)
+{
+	int i = 0;
+#ifdef BYTECOMPARE_SSE2
+	// Identical data is by far the common case, so test 64 bytes at once
+	for (; i + 64 <= len; i += 64)
+	{
+		const __m128i *p0 = reinterpret_cast<const __m128i *>(ptr0 + i);
+		const __m128i *p1 = reinterpret_cast<const __m128i *>(ptr1 + i);
+		__m128i eq = _mm_and_si128(
+			_mm_and_si128(
+				_mm_cmpeq_epi8(_mm_loadu_si128(p0), _mm_loadu_si128(p1)),
+				_mm_cmpeq_epi8(_mm_loadu_si128(p0 + 1), _mm_loadu_si128(p1 + 1))),
+			_mm_and_si128(
+				_mm_cmpeq_epi8(_mm_loadu_si128(p0 + 2), _mm_loadu_si128(p1 + 2)),
+				_mm_cmpeq_epi8(_mm_loadu_si128(p0 + 3), _mm_loadu_si128(p1 + 3))));
+		if (_mm_movemask_epi8(eq) != 0xFFFF)
+			break;
+	}
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i data0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr0 + i));
+		__m128i data1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr1 + i));
+		unsigned mask = MatchMask(data0, data1) ^ 0xFFFF;
+		if (mask != 0)
+			return i + LowestBit(mask);
+	}
+#endif
+	while (i < len && ptr0[i] == ptr1[i])
+		++i;
+	return i;
+}
+
+/**
+ * @brief Find last line in buffer where ByteComparator can start compare.
+ * Line must start with a char other than whitespace or EOL, since
+ * ByteComparator skips whitespace and blank lines as runs.
+ * @return Offset of line start, or 0 if no such line is found.
+ */
+static int FindLineStart(const char *ptr, int len)
+{
+	for (int i = len - 1; i > 0; --i)
+	{
+		if (ptr[i - 1] == '\n' && ptr[i] != '\n' && ptr[i] != '\r' &&
+			ptr[i] != ' ' && ptr[i] != '\t')
+		{
+			return i;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Update EOL and zero-byte statistics from a buffer.
+ * CR is counted as MAC EOL when found, and changed to DOS EOL if next buffer
+ * starts with LF.
+ * @param [in,out] stats Statistics to update.
+ * @param [in,out] crflag Did previous buffer end to CR? Set for this buffer.
+ * @param [in] ptr Begin of buffer.
+ * @param [in] end End of buffer.
+ */
+static void CountTextStats(FileTextStats & stats, bool & crflag, const char *ptr, const char *end)
+{
+	if (ptr == end)
+		return;
+	if (crflag && *ptr == '\n')
+	{
+		--stats.ncrs;
+		++stats.ncrlfs;
+		++ptr;
+	}
+	crflag = (end[-1] == '\r');
+
+	unsigned ncrs = 0, nlfs = 0, ncrlfs = 0, nzeros = 0;
+	bool cr = false;
+#ifdef BYTECOMPARE_SSE2
+	const __m128i crs = _mm_set1_epi8('\r');
+	const __m128i lfs = _mm_set1_epi8('\n');
+	const __m128i zeros = _mm_setzero_si128();
+	unsigned prevcr = 0;
+	for (; end - ptr >= 16; ptr += 16)
+	{
+		__m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		unsigned maskcr = MatchMask(data, crs);
+		unsigned masklf = MatchMask(data, lfs);
+		unsigned maskzero = MatchMask(data, zeros);
+		if ((maskcr | masklf | maskzero) == 0)
+		{
+			prevcr = 0;
+			continue;
+		}
+		// LFs preceded by CR
+		unsigned maskcrlf = ((maskcr << 1) | prevcr) & masklf;
+		prevcr = maskcr >> 15;
+		ncrs += BitCount16(maskcr);
+		nlfs += BitCount16(masklf);
+		ncrlfs += BitCount16(maskcrlf);
+		nzeros += BitCount16(maskzero);
+	}
+	cr = (prevcr != 0);
+#endif
+	for (; ptr < end; ++ptr)
+	{
+		const char ch = *ptr;
+		if (ch == '\r')
+			++ncrs;
+		else if (ch == '\n')
+		{
+			++nlfs;
+			if (cr)
+				++ncrlfs;
+		}
+		else if (ch == 0)
+			++nzeros;
+		cr = (ch == '\r');
+	}
+	stats.ncrs += ncrs - ncrlfs;
+	stats.nlfs += nlfs - ncrlfs;
+	stats.ncrlfs += ncrlfs;
+	stats.nzeros += nzeros;
+}
+
+/**
+ * @brief Set text/binary flags of compare result from text statistics.
+ */
+static unsigned GetTextFlags(const FileTextStats stats[2])
+{
+	bool bBin0 = (stats[0].nzeros > 0);
+	bool bBin1 = (stats[1].nzeros > 0);
+
+	if (bBin0 && bBin1)
+		return DIFFCODE::BIN;
+	else if (bBin0)
+		return DIFFCODE::BINSIDE1;
+	else if (bBin1)
+		return DIFFCODE::BINSIDE2;
+	else
+		return DIFFCODE::TEXT;
+}
 
 /**
  * @brief Compare two specified files, byte-by-byte
+ *
+ * Files are read in large blocks, and identical data is skipped with block
+ * compares while EOL and zero-byte statistics are counted. When the files
+ * differ and whitespace, case or EOL differences are ignored, the
+ * ByteComparator compares the rest of the files starting from the line where
+ * the first difference is.
  * @param [in] bStopAfterFirstDiff Stop compare after we find first difference?
  * @param [in] piAbortable Interface allowing to abort compare
  * @return DIFFCODE
@@ -105,7 +331,9 @@ int ByteCompare::CompareFiles(FileLocation *location)
 	// Right now, we assume files are in 8-bit encoding
 	// because transform code converted any UCS-2 files to UTF-8
 	// We could compare directly in UCS-2LE here, as an optimization, in that case
-	char buff[2][WMCMPBUFF]; // buffered access to files
+	if (m_pBuffer == NULL)
+		m_pBuffer.reset(new char[2 * WMCMPBUFF]);
+	char *buff[2] = { &m_pBuffer[0], &m_pBuffer[WMCMPBUFF] }; // buffered access to files
 	int i;
 	unsigned diffcode = 0;
 
@@ -115,22 +343,133 @@ int ByteCompare::CompareFiles(FileLocation *location)
 	// buff[0] has bytes to process from buff[0][bfstart[0]] to buff[0][bfend[0]-1]
 
 	bool eof[2]; // if we've finished file
+	bool crflag[2]; // if counted data ends with CR
 
 	// initialize our buffer pointers and end of file flags
 	for (i = 0; i < 2; ++i)
 	{
 		bfstart[i] = bfend[i] = 0;
 		eof[i] = false;
+		crflag[i] = false;
+		m_textStats[i].clear();
+	}
+
+	// Unique files are compared to itself to get text statistics
+	if (m_inf[0].desc == m_inf[1].desc)
+	{
+		while (!eof[0])
+		{
+			if (m_piAbortable && m_piAbortable->ShouldAbort())
+				return DIFFCODE::CMPABORT;
+			int rtn = ReadData(0, buff[0], WMCMPBUFF);
+			if (rtn == -1)
+				return DIFFCODE::CMPERR;
+			if (rtn < WMCMPBUFF)
+				eof[0] = true;
+			CountTextStats(m_textStats[0], crflag[0], buff[0], buff[0] + rtn);
+		}
+		m_textStats[1] = m_textStats[0];
+		location[1] = location[0];
+		return GetTextFlags(m_textStats) | DIFFCODE::SAME;
+	}
+
+	const QuickCompareOptions *pOptions = m_pOptions.get();
+	const bool bIgnoreAny = pOptions->m_ignoreWhitespace != WHITESPACE_COMPARE_ALL ||
+		pOptions->m_bIgnoreCase || pOptions->m_bIgnoreBlankLines ||
+		pOptions->m_bIgnoreEOLDifference;
+
+	// Skip identical beginning of files with block compares. Both buffers
+	// hold data from same file offset, data before bfstart[] is identical
+	// and its statistics are counted.
+	while (true)
+	{
+		if (m_piAbortable && m_piAbortable->ShouldAbort())
+			return DIFFCODE::CMPABORT;
+
+		// move uncompared data to begin of buffers and fill them
+		const int start = (int) bfstart[0];
+		for (i = 0; i < 2; ++i)
+		{
+			if (start > 0)
+			{
+				memmove(buff[i], &buff[i][start], (size_t)(bfend[i] - start));
+				bfstart[i] = 0;
+				bfend[i] -= start;
+			}
+			if (!eof[i] && bfend[i] < WMCMPBUFF)
+			{
+				int space = WMCMPBUFF - (int) bfend[i];
+				int rtn = ReadData(i, &buff[i][bfend[i]], (unsigned)space);
+				if (rtn == -1)
+					return DIFFCODE::CMPERR;
+				if (rtn < space)
+					eof[i] = true;
+				bfend[i] += rtn;
+			}
+		}
+
+		const int len = (int) (std::min)(bfend[0], bfend[1]);
+		const int same = FindMismatch(buff[0], buff[1], len);
+		bool atEnd[2];
+		for (i = 0; i < 2; ++i)
+			atEnd[i] = eof[i] && bfend[i] == same;
+		const bool bFinished = atEnd[0] && atEnd[1];
+		const bool bDiffer = same < len || atEnd[0] != atEnd[1];
+
+		// With ignore options continue compare from begin of differing line
+		int commit = same;
+		if (bIgnoreAny && !bFinished)
+			commit = FindLineStart(buff[0], same);
+		CountTextStats(m_textStats[0], crflag[0], buff[0], buff[0] + commit);
+		m_textStats[1] = m_textStats[0];
+		crflag[1] = crflag[0];
+		bfstart[0] = bfstart[1] = commit;
+
+		if (bFinished)
+			return GetTextFlags(m_textStats) | DIFFCODE::SAME;
+		if (bIgnoreAny)
+		{
+			// Also a full buffer without any lines is left to ByteComparator
+			if (bDiffer || commit == 0)
+				break;
+			continue;
+		}
+		if (!bDiffer)
+			continue;
+
+		if (m_pOptions->m_bStopAfterFirstDiff)
+		{
+			// By bailing out here
+			// we leave our text statistics incomplete
+			return DIFFCODE::DIFF;
+		}
+		// Count statistics from rest of files
+		for (i = 0; i < 2; ++i)
+		{
+			CountTextStats(m_textStats[i], crflag[i], &buff[i][commit], &buff[i][bfend[i]]);
+			while (!eof[i])
+			{
+				if (m_piAbortable && m_piAbortable->ShouldAbort())
+					return DIFFCODE::CMPABORT;
+				int rtn = ReadData(i, buff[i], WMCMPBUFF);
+				if (rtn == -1)
+					return DIFFCODE::CMPERR;
+				if (rtn < WMCMPBUFF)
+					eof[i] = true;
+				CountTextStats(m_textStats[i], crflag[i], buff[i], buff[i] + rtn);
+			}
+		}
+		return GetTextFlags(m_textStats) | DIFFCODE::DIFF;
 	}
 
-	ByteComparator comparator(m_pOptions.get());
+	ByteComparator comparator(pOptions);
 
 	// Begin loop
 	// we handle the files in WMCMPBUFF sized buffers (variable buff[][])
 	// That is, we do one buffer full at a time
 	// or even less, as we process until one side buffer is empty, then reload that one
 	// and continue
-	while (!eof[0] || !eof[1])
+	while (true)
 	{
 		if (m_piAbortable && m_piAbortable->ShouldAbort())
 			return DIFFCODE::CMPABORT;
@@ -138,29 +477,20 @@ int ByteCompare::CompareFiles(FileLocation *location)
 		// load or update buffers as appropriate
 		for (i = 0; i < 2; ++i)
 		{
-			if (!eof[i] && bfstart[i] == sizeof(buff[i])/sizeof(buff[i][0]))
+			if (!eof[i] && bfstart[i] == WMCMPBUFF)
 			{
 				bfstart[i] = bfend[i] = 0;
 			}
-			if (!eof[i] && bfend[i] < sizeof(buff[i])/sizeof(buff[i][0]) - 1)
+			if (!eof[i] && bfend[i] < WMCMPBUFF - 1)
 			{
 				// Assume our blocks are in range of int
-				int space = sizeof(buff[i])/sizeof(buff[i][0]) - (int) bfend[i];
-				int rtn = read(m_inf[i].desc, &buff[i][bfend[i]], (unsigned)space);
+				int space = WMCMPBUFF - (int) bfend[i];
+				int rtn = ReadData(i, &buff[i][bfend[i]], (unsigned)space);
 				if (rtn == -1)
 					return DIFFCODE::CMPERR;
 				if (rtn < space)
 					eof[i] = true;
 				bfend[i] += rtn;
-				if (m_inf[0].desc == m_inf[1].desc)
-				{
-					bfstart[1] = bfstart[0];
-					bfend[1] = bfend[0];
-					eof[1] = eof[0];
-					location[1] = location[0];
-					memcpy(&buff[1][bfend[1] - rtn], &buff[0][bfend[0] - rtn], rtn);
-					break;
-				}
 			}
 		}
 		// where to start comparing right now
@@ -206,7 +536,7 @@ int ByteCompare::CompareFiles(FileLocation *location)
 			const int m = (int)(ptr0 - &buff[0][0]);
 			const int l = (int)(end0 - ptr0);
 			//move uncompared data to begin of buff0
-			memcpy(&buff[0][0], &buff[0][m], l);
+			memmove(&buff[0][0], &buff[0][m], l);
 			bfstart[0] = 0;
 			bfstart[1] += ptr1 - orig1;
 			bfend[0] = l;
@@ -216,7 +546,7 @@ int ByteCompare::CompareFiles(FileLocation *location)
 			const int m = (int)(ptr1 - &buff[1][0]);
 			const int l = (int)(end1 - ptr1);
 			//move uncompared data to begin of buff1
-			memcpy(&buff[1][0], &buff[1][m], l);
+			memmove(&buff[1][0], &buff[1][m], l);
 			bfstart[1] = 0;
 			bfstart[0] += ptr0 - orig0;
 			bfend[1] = l;
@@ -237,7 +567,7 @@ int ByteCompare::CompareFiles(FileLocation *location)
 					const int m = (int)(ptr0 - orig0);
 					const int l = (int)(end0 - ptr0);
 					//move uncompared data to begin of buff0
-					memcpy(&buff[0][0], &buff[0][m], l);
+					memmove(&buff[0][0], &buff[0][m], l);
 					bfstart[0] = 0;
 					bfend[0] += l;
 				}
@@ -246,7 +576,7 @@ int ByteCompare::CompareFiles(FileLocation *location)
 					const int m = (int)(ptr1 - orig1);
 					const int l = (int)(end1 - ptr1);
 					//move uncompared data to begin of buff1
-					memcpy(&buff[1][0], &buff[1][ m], l);
+					memmove(&buff[1][0], &buff[1][ m], l);
 					bfstart[1] = 0;
 					bfend[1] += l;
 				}
@@ -258,17 +588,7 @@ int ByteCompare::CompareFiles(FileLocation *location)
 		// then the result is reliable.
 		if (eof[0] && eof[1])
 		{
-			bool bBin0 = (m_textStats[0].nzeros > 0);
-			bool bBin1 = (m_textStats[1].nzeros > 0);
-
-			if (bBin0 && bBin1)
-				diffcode |= DIFFCODE::BIN;
-			else if (bBin0)
-				diffcode |= DIFFCODE::BINSIDE1;
-			else if (bBin1)
-				diffcode |= DIFFCODE::BINSIDE2;
-			else
-				diffcode |= DIFFCODE::TEXT;
+			diffcode |= GetTextFlags(m_textStats);
 
 			// If either unfinished, they differ
 			if (ptr0 != end0 || ptr1 != end1)
@@ -279,7 +599,6 @@ int ByteCompare::CompareFiles(FileLocation *location)
 				return diffcode | DIFFCODE::SAME;
 		}
 	}
-	return diffcode;
 }
 
 /**
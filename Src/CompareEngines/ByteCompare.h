@@ -13,13 +13,14 @@ class QuickCompareOptions;
 class IAbortable;
 struct FileLocation;
 struct file_data;
+namespace Poco { class DigestEngine; }
 
 namespace CompareEngines
 {
 
 /**
  * @brief A quick compare -compare method implementation class.
- * This compare method compares files in small blocks. Code assumes block size
+ * This compare method compares files in large blocks. Code assumes block size
  * is in range of 32-bit int-type.
  */
 class ByteCompare
@@ -32,14 +33,19 @@ public:
 	void SetAdditionalOptions(bool stopAfterFirstDiff);
 	void SetAbortable(const IAbortable * piAbortable);
 	void SetFileData(int items, file_data *data);
+	void SetDigestEngines(Poco::DigestEngine *engine1, Poco::DigestEngine *engine2);
 	int CompareFiles(FileLocation *location);
 	void GetTextStats(int side, FileTextStats *stats) const;
 
 private:
+	int ReadData(int i, char *buffer, unsigned count);
+
 	std::unique_ptr<QuickCompareOptions> m_pOptions; /**< Compare options for diffutils. */
 	IAbortable * m_piAbortable;
 	file_data * m_inf; /**< Compared files data (for diffutils). */
+	Poco::DigestEngine * m_pDigestEngines[2]; /**< Get the data read, may be NULL. */
 	FileTextStats m_textStats[2];
+	std::unique_ptr<char[]> m_pBuffer; /**< File buffers, reused between compares. */
 
 };
 
@@ -177,6 +177,7 @@ int DiffUtils::diffutils_compare_files()
 						options.bFilterCommentsLines = m_pOptions->m_filterCommentsLines;
 						options.bIgnoreCase = m_pOptions->m_bIgnoreCase;
 						options.bIgnoreEol = m_pOptions->m_bIgnoreEOLDifference;
+						options.nDiffAlgorithm = m_pOptions->m_diffAlgorithm;
 						m_pDiffWrapper->SetOptions(&options);
   						m_pDiffWrapper->PostFilter(thisob->line0, QtyLinesLeft+1, thisob->line1, QtyLinesRight+1, op, asLwrCaseExt);
 						if(op == OP_TRIVIAL)
@@ -281,13 +282,15 @@ bool DiffUtils::RegExpFilter(int StartPos, int EndPos, int FileNo) const
 
 	bool linesMatch = true; // set to false when non-matching line is found.
 	int line = StartPos;
+	std::string lineText; // reused for all lines to avoid allocations
 
 	while (line <= EndPos && linesMatch == true)
 	{
 		size_t len = files[FileNo].linbuf[line + 1] - files[FileNo].linbuf[line];
 		const char *string = files[FileNo].linbuf[line];
 		size_t stringlen = linelen(string, len);
-		if (!m_pFilterList->Match(std::string(string, stringlen), m_codepage))
+		lineText.assign(string, stringlen);
+		if (!m_pFilterList->Match(lineText, m_codepage))
 		{
 			linesMatch = false;
 		}
@@ -317,6 +320,12 @@ bool DiffUtils::Diff2Files(struct change ** diffs, int depth,
 {
 	bool bRet = true;
 	SE_Handler seh;
+	// diffutils options are thread-local, and this may be run in
+	// another thread than the one that set the compare options
+	m_pOptions->SetToDiffUtils();
+	// Folder compare runs a compare per processor already,
+	// so lines are hashed on this thread only
+	max_hash_threads = 1;
 	try
 	{
 		*diffs = diff_2_files(m_inf, depth, bin_status, bMovedBlocks, bin_file);
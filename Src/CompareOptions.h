@@ -24,6 +24,21 @@ enum WhitespaceIgnoreChoices
 	WHITESPACE_IGNORE_ALL,         /**< ignore whitespace altogether */
 };
 
+/**
+ * @brief Algorithms for finding the changed lines.
+ *
+ * The default Myers algorithm finds a minimal set of changes, but uses
+ * heuristics that can misalign changes in big files with many repeated
+ * lines. The histogram algorithm anchors the alignment on lines that are
+ * rare in the files, so repeated lines (blank lines, braces, log lines)
+ * don't decide the alignment.
+ */
+enum DiffAlgorithm
+{
+	DIFF_ALGORITHM_DEFAULT = 0,    /**< Myers algorithm of diffutils */
+	DIFF_ALGORITHM_HISTOGRAM,      /**< Histogram algorithm */
+};
+
 /**
  * @brief Patch styles.
  *
@@ -70,6 +85,7 @@ struct DIFFOPTIONS
 	bool bIgnoreBlankLines; /**< Ignore blank lines -option. */
 	bool bIgnoreEol; /**< Ignore EOL differences -option. */
 	bool bFilterCommentsLines; /**< Ignore Multiline comments differences -option. */
+	int nDiffAlgorithm; /**< Diff algorithm -option. */
 };
 
 /**
@@ -109,6 +125,7 @@ public:
 	enum DiffOutputType m_outputStyle; /**< Output style (for patch files) */
 	int m_contextLines; /**< Number of context lines (for patch files) */
 	bool m_filterCommentsLines;/**< Ignore Multiline comments differences.*/
+	enum DiffAlgorithm m_diffAlgorithm; /**< Algorithm for finding changed lines */
 };
 
 /**
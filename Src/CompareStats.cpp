@@ -20,6 +20,7 @@ CompareStats::CompareStats(int nDirs)
 , m_nComparedItems(0)
 , m_state(STATE_IDLE)
 , m_bCompareDone(false)
+, m_tdCompare(0)
 , m_nDirs(nDirs)
 , m_counts()
 {
@@ -110,6 +111,9 @@ void CompareStats::Reset()
 	m_nTotalItems = 0;
 	m_nComparedItems = 0;
 	m_bCompareDone = false;
+	m_tdCompare = 0;
+	m_nContentCacheHits = 0;
+	m_nContentCacheMisses = 0;
 }
 
 /** 
@@ -121,13 +125,33 @@ void CompareStats::SetCompareState(CompareStats::CMP_STATE state)
 	// New compare starting so reset ready status
 	if (state == STATE_START)
 		m_bCompareDone = false;
+	// Comparing items starts
+	if (state == STATE_COMPARE && m_state != STATE_COMPARE)
+		m_tsCompareStart.update();
 	// Compare ready
 	if (state == STATE_IDLE && m_state == STATE_COMPARE)
+	{
+		m_tdCompare = m_tsCompareStart.elapsed();
 		m_bCompareDone = true;
+	}
 
 	m_state = state;
 }
 
+/**
+ * @brief Return compare throughput.
+ * @return Items compared per second while comparing items, or during
+ * last compare if it is ready.
+ */
+int CompareStats::GetComparedItemsPerSecond() const
+{
+	Poco::Timestamp::TimeDiff td = (m_state == STATE_COMPARE) ?
+		m_tsCompareStart.elapsed() : m_tdCompare;
+	if (td <= 0)
+		return 0;
+	return static_cast<int>(m_nComparedItems * Poco::Timestamp::resolution() / td);
+}
+
 /** 
  * @brief Return current comparestate.
  */
@@ -8,6 +8,7 @@
 #define POCO_NO_UNWINDOWS 1
 #include <Poco/Mutex.h>
 #include <Poco/AtomicCounter.h>
+#include <Poco/Timestamp.h>
 #include <vector>
 #include <array>
 
@@ -85,6 +86,10 @@ public:
 	int GetCount(CompareStats::RESULT result) const;
 	int GetTotalItems() const;
 	int GetComparedItems() const { return m_nComparedItems; }
+	int GetComparedItemsPerSecond() const;
+	void AddContentCacheLookup(bool bHit) { if (bHit) ++m_nContentCacheHits; else ++m_nContentCacheMisses; }
+	int GetContentCacheHits() const { return m_nContentCacheHits.value(); }
+	int GetContentCacheMisses() const { return m_nContentCacheMisses.value(); }
 	const DIFFITEM *GetCurDiffItem();
 	void Reset();
 	void SetCompareState(CompareStats::CMP_STATE state);
@@ -102,6 +107,10 @@ private:
 	long m_nComparedItems; /**< Compared items so far */
 	CMP_STATE m_state; /**< State for compare (idle, collect, compare,..) */
 	bool m_bCompareDone; /**< Have we finished last compare? */
+	Poco::Timestamp m_tsCompareStart; /**< When comparing items started */
+	Poco::Timestamp::TimeDiff m_tdCompare; /**< Time comparing items took */
+	Poco::AtomicCounter m_nContentCacheHits; /**< Files found in content cache */
+	Poco::AtomicCounter m_nContentCacheMisses; /**< Files not found in content cache */
 	int m_nDirs; /**< number of directories to compare */
 	struct ThreadState
 	{
@@ -0,0 +1,226 @@
+/**
+ * @file  ContentCache.cpp
+ *
+ * @brief Implementation file for ContentCache class.
+ */
+
+#include "ContentCache.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <Poco/FileStream.h>
+#include <Poco/StringTokenizer.h>
+#include "TFile.h"
+#include "unicoder.h"
+
+using Poco::FastMutex;
+using Poco::Timestamp;
+using Poco::StringTokenizer;
+using ucr::toTString;
+using ucr::toUTF8;
+
+/** @brief First line of cache file, changed when format changes. */
+static const char CacheFileHeader[] = "WinMerge content cache 1";
+
+/** @brief Count of tab-separated fields in one cache file line. */
+static const size_t CacheFileFields = 14;
+
+/**
+ * @brief Files modified this recently (in microseconds) are not cached.
+ * A file can change again within the resolution of its modification time.
+ */
+static const Timestamp::TimeDiff RecentlyModified = 2 * Timestamp::resolution();
+
+/**
+ * @brief Constructor.
+ * @param [in] path Path of the cache file.
+ * @param [in] nMaxEntries Max count of entries to save.
+ */
+ContentCache::ContentCache(const String& path, size_t nMaxEntries)
+: m_path(path)
+, m_nMaxEntries(nMaxEntries)
+, m_now(Timestamp().epochMicroseconds())
+, m_bModified(false)
+{
+}
+
+/**
+ * @brief Read entries from the cache file.
+ * Invalid lines are skipped, file of other format is ignored.
+ * @return true if file was read, false if it does not exist or is invalid.
+ */
+bool ContentCache::Load()
+{
+	FastMutex::ScopedLock lock(m_mutex);
+	m_entries.clear();
+	m_bModified = false;
+	try
+	{
+		if (!TFile(m_path).exists())
+			return false;
+		Poco::FileInputStream in(toUTF8(m_path));
+		std::string line;
+		if (!std::getline(in, line) || line != CacheFileHeader)
+			return false;
+		while (std::getline(in, line))
+		{
+			StringTokenizer fields(line, "\t");
+			if (fields.count() != CacheFileFields)
+				continue;
+			Entry entry;
+			entry.size = _strtoi64(fields[1].c_str(), NULL, 10);
+			entry.mtime = _strtoi64(fields[2].c_str(), NULL, 10);
+			entry.options = strtoul(fields[3].c_str(), NULL, 10);
+			entry.digest = fields[4];
+			entry.stats.ncrs = strtoul(fields[5].c_str(), NULL, 10);
+			entry.stats.nlfs = strtoul(fields[6].c_str(), NULL, 10);
+			entry.stats.ncrlfs = strtoul(fields[7].c_str(), NULL, 10);
+			entry.stats.nzeros = strtoul(fields[8].c_str(), NULL, 10);
+			entry.encoding.m_unicoding = static_cast<ucr::UNICODESET>(atoi(fields[9].c_str()));
+			entry.encoding.m_codepage = atoi(fields[10].c_str());
+			entry.encoding.m_bom = (fields[11] == "1");
+			entry.bBinary = (fields[12] == "1");
+			entry.used = _strtoi64(fields[13].c_str(), NULL, 10);
+			m_entries[toTString(fields[0])] = entry;
+		}
+	}
+	catch (...)
+	{
+		m_entries.clear();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Write entries to the cache file.
+ * Only the most recently used entries are written if there are more
+ * entries than the size limit. The file is written to a temporary file
+ * first, so that an interrupted save does not leave a truncated cache.
+ * @return true if succeeded or nothing to save, false if error happened.
+ */
+bool ContentCache::Save()
+{
+	FastMutex::ScopedLock lock(m_mutex);
+	if (!m_bModified)
+		return true;
+
+	typedef std::map<String, Entry>::const_iterator EntryIter;
+	std::vector<EntryIter> entries;
+	entries.reserve(m_entries.size());
+	for (EntryIter it = m_entries.begin(); it != m_entries.end(); ++it)
+		entries.push_back(it);
+	if (entries.size() > m_nMaxEntries)
+	{
+		std::nth_element(entries.begin(), entries.begin() + m_nMaxEntries, entries.end(),
+			[](const EntryIter& a, const EntryIter& b) { return a->second.used > b->second.used; });
+		entries.resize(m_nMaxEntries);
+	}
+
+	String tmpPath = m_path + _T(".tmp");
+	try
+	{
+		{
+			Poco::FileOutputStream out(toUTF8(tmpPath));
+			out << CacheFileHeader << "\n";
+			for (std::vector<EntryIter>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+			{
+				const Entry& entry = (*it)->second;
+				out << toUTF8((*it)->first) << '\t'
+					<< entry.size << '\t'
+					<< entry.mtime << '\t'
+					<< entry.options << '\t'
+					<< entry.digest << '\t'
+					<< entry.stats.ncrs << '\t'
+					<< entry.stats.nlfs << '\t'
+					<< entry.stats.ncrlfs << '\t'
+					<< entry.stats.nzeros << '\t'
+					<< static_cast<int>(entry.encoding.m_unicoding) << '\t'
+					<< entry.encoding.m_codepage << '\t'
+					<< (entry.encoding.m_bom ? 1 : 0) << '\t'
+					<< (entry.bBinary ? 1 : 0) << '\t'
+					<< entry.used << "\n";
+			}
+			out.close();
+			if (!out.good())
+				return false;
+		}
+		TFile(tmpPath).renameTo(m_path);
+	}
+	catch (...)
+	{
+		return false;
+	}
+	m_bModified = false;
+	return true;
+}
+
+/**
+ * @brief Find valid cache entry of a file.
+ * @param [in] path Path of the file.
+ * @param [in] size Current size of the file.
+ * @param [in] mtime Current modification time of the file.
+ * @param [in] options Compare options the entry must be valid for.
+ * @param [out] entry Cached data of the file.
+ * @return true if valid entry was found.
+ */
+bool ContentCache::Lookup(const String& path, int64_t size, const Timestamp& mtime,
+		unsigned options, Entry& entry)
+{
+	FastMutex::ScopedLock lock(m_mutex);
+	std::map<String, Entry>::iterator it = m_entries.find(path);
+	if (it == m_entries.end())
+		return false;
+	Entry& cached = it->second;
+	if (cached.size != size || cached.mtime != mtime.epochMicroseconds() ||
+		cached.options != options)
+	{
+		return false;
+	}
+	cached.used = m_now;
+	m_bModified = true;
+	entry = cached;
+	return true;
+}
+
+/**
+ * @brief Add or replace cache entry of a file.
+ * @param [in] path Path of the file.
+ * @param [in,out] entry Data to cache, last use time is set.
+ */
+void ContentCache::Store(const String& path, Entry& entry)
+{
+	FastMutex::ScopedLock lock(m_mutex);
+	entry.used = m_now;
+	m_entries[path] = entry;
+	m_bModified = true;
+}
+
+/**
+ * @brief Check if file data can be cached.
+ * Files without modification time or modified just now are not cached,
+ * since a later change might not alter the modification time.
+ * @param [in] mtime Modification time of the file.
+ */
+bool ContentCache::IsCacheable(const Timestamp& mtime)
+{
+	return mtime.epochMicroseconds() != 0 && mtime.isElapsed(RecentlyModified);
+}
+
+/**
+ * @brief Get the digest of the data hashed.
+ * @return Digest as hex string.
+ */
+std::string ContentCache::Hasher::GetDigest()
+{
+	return Poco::DigestEngine::digestToHex(digest());
+}
+
+/**
+ * @brief Hash next part of file contents.
+ */
+void ContentCache::Hasher::updateImpl(const void* data, unsigned length)
+{
+	m_size += length;
+	Poco::SHA1Engine::updateImpl(data, length);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file  ContentCache.h
+ *
+ * @brief Declaration file for ContentCache class.
+ */
+#pragma once
+
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/Mutex.h>
+#include <Poco/SHA1Engine.h>
+#include <Poco/Timestamp.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include "UnicodeString.h"
+#include "FileTextStats.h"
+#include "FileTextEncoding.h"
+
+/**
+ * @brief Persistent cache of file content digests for folder compare.
+ *
+ * Folder compare stores a digest of compared files together with the text
+ * statistics and encoding found when comparing them. If a file has the same
+ * size and modification time in a later compare, its cached digest is used,
+ * and files with equal digests are identical without reading them again.
+ * Digests are computed from the data compare engines read, with Hasher.
+ *
+ * Entries are valid only for the compare options they were created with.
+ * Least recently used entries are dropped when the cache is saved with more
+ * entries than the size limit allows.
+ */
+class ContentCache
+{
+public:
+	/** @brief Cached data of one file. */
+	struct Entry
+	{
+		Entry() : size(0), mtime(0), options(0), bBinary(false), used(0) { }
+		int64_t size; /**< File size when digest was computed */
+		Poco::Timestamp::TimeVal mtime; /**< File modification time */
+		unsigned options; /**< Compare options the data is valid for */
+		std::string digest; /**< SHA-1 digest of file contents, as hex */
+		FileTextStats stats; /**< EOL and zero-byte statistics */
+		FileTextEncoding encoding; /**< Detected encoding */
+		bool bBinary; /**< Was file compared as binary? */
+		Poco::Timestamp::TimeVal used; /**< When entry was last used */
+	};
+
+	/**
+	 * @brief SHA-1 digest of file contents given to a compare engine.
+	 * Counts the bytes hashed, so that a digest of a file not read to its
+	 * end is not stored.
+	 */
+	class Hasher : public Poco::SHA1Engine
+	{
+	public:
+		Hasher() : m_size(0) { }
+		int64_t GetSize() const { return m_size; }
+		std::string GetDigest();
+	protected:
+		void updateImpl(const void* data, unsigned length);
+	private:
+		int64_t m_size; /**< Count of bytes hashed */
+	};
+
+	ContentCache(const String& path, size_t nMaxEntries);
+	bool Load();
+	bool Save();
+	bool Lookup(const String& path, int64_t size, const Poco::Timestamp& mtime,
+			unsigned options, Entry& entry);
+	void Store(const String& path, Entry& entry);
+
+	static bool IsCacheable(const Poco::Timestamp& mtime);
+
+private:
+	String m_path; /**< Path of cache file */
+	size_t m_nMaxEntries; /**< Max count of entries saved */
+	Poco::Timestamp::TimeVal m_now; /**< When cache was created */
+	Poco::FastMutex m_mutex; /**< Protects entries from compare threads */
+	std::map<String, Entry> m_entries; /**< Entries by file path */
+	bool m_bModified; /**< Have entries changed after loading? */
+};
@@ -53,6 +53,7 @@ CDiffContext::CDiffContext(const PathContext & paths, int compareMethod)
 , m_nCompMethod(compareMethod)
 , m_bIgnoreSmallTimeDiff(false)
 , m_pCompareStats(nullptr)
+, m_pContentCache(nullptr)
 , m_piAbortable(nullptr)
 , m_bStopAfterFirstDiff(false)
 , m_pFilterList(nullptr)
@@ -110,7 +111,7 @@ bool CDiffContext::UpdateInfoFromDiskHalf(DIFFITEM & di, int nIndex)
 	if (!dfi.Update(filepath))
 		return false;
 	UpdateVersion(di, nIndex);
-	dfi.encoding = GuessCodepageEncoding(filepath, m_iGuessEncodingType);
+	dfi.SetEncoding(GuessCodepageEncoding(filepath, m_iGuessEncodingType));
 	return true;
 }
 
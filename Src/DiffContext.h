@@ -19,6 +19,7 @@ class PrediffingInfo;
 class IDiffFilter;
 struct DIFFITEM;
 class CompareStats;
+class ContentCache;
 class IAbortable;
 class CDiffWrapper;
 class CompareOptions;
@@ -158,6 +159,7 @@ public:
 
 	bool m_bIgnoreSmallTimeDiff; /**< Ignore small timedifferences when comparing by date */
 	CompareStats *m_pCompareStats; /**< Pointer to compare statistics */
+	ContentCache *m_pContentCache; /**< Cache of file content digests, or NULL */
 
 	/**
 	 * Optimize compare by stopping after first difference.
@@ -13,12 +13,22 @@
 #include <sys/types.h>
 #include <unistd.h>
 #endif
+#include <algorithm>
+#include <climits>
+#include <cstdint>
 #include <memory>
 #include "DiffItem.h"
 #include "FileLocation.h"
 #include "diff.h"
 #include "FileTransform.h"
 #include "unicoder.h"
+#include "codepage_detect.h"
+
+/**
+ * @brief Min total size (in bytes) of files compared concurrently.
+ * Smaller files are compared faster than a thread is started.
+ */
+static const int64_t ConcurrentCompareSize = 256 * 1024;
 
 /**
  * @brief Simple initialization of DiffFileData
@@ -52,6 +62,117 @@ bool DiffFileData::OpenFiles(const String& szFilepath1, const String& szFilepath
 	return b;
 }
 
+/**
+ * @brief Open files, taking the first one from a file read for another compare.
+ * This lets 3-way compare read the middle file once for both of its pairs.
+ * The data is copied, because diffutils modifies its buffers in place, so
+ * this must be called before @p other is compared.
+ * @param [in] other Files opened and read with ReadFiles().
+ * @param [in] iOther Index of the file in @p other used as first file.
+ * @param [in] szFilepath2 Path of second file.
+ * @return true if succeeded.
+ * @note Opens both files from disk if the file in @p other was not read.
+ */
+bool DiffFileData::OpenFiles(const DiffFileData& other, int iOther, const String& szFilepath2)
+{
+	const file_data& inf = other.m_inf[iOther];
+	if (!inf.preloaded)
+		return OpenFiles(other.m_FileLocation[iOther].filepath, szFilepath2);
+
+	Reset();
+	m_FileLocation[0] = other.m_FileLocation[iOther];
+	m_FileLocation[1].setPath(szFilepath2);
+	// buffers belong to diffutils from now on, let it free them
+	m_used = true;
+	bool b = DoOpenBuffer(0, inf.buffer, inf.buffered_chars) && DoOpenFile(1);
+	if (!b)
+		Reset();
+	return b;
+}
+
+/**
+ * @brief Give diffutils in-memory texts instead of file descriptors.
+ * The texts must be in the form the diff-engine temp files would have
+ * (UTF-8 or 8-bit codepage, no BOM). They are copied, because diffutils
+ * modifies its buffers in place.
+ * @param [in] text1 Text of first side.
+ * @param [in] text2 Text of second side.
+ * @return true if buffers were allocated.
+ */
+bool DiffFileData::OpenBuffers(const std::string& text1, const std::string& text2)
+{
+	Reset();
+	// buffers belong to diffutils from now on, let it free them
+	m_used = true;
+	bool b = DoOpenBuffer(0, text1) && DoOpenBuffer(1, text2);
+	if (!b)
+		Reset();
+	return b;
+}
+
+/**
+ * @brief Read opened files completely to diffutils buffers.
+ * The files are read with one sequential read each, and diffutils uses
+ * the buffers instead of reading the files again. Only distinct regular
+ * files are read, other files are left for diffutils to handle.
+ * @return true if succeeded, false if a file could not be read.
+ * @note Must be called after OpenFiles().
+ */
+bool DiffFileData::ReadFiles()
+{
+	if (m_inf[0].desc == m_inf[1].desc)
+		return true;
+	for (int i = 0; i < 2; ++i)
+	{
+		if (!DoReadFile(i))
+		{
+			Reset();
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Try to deduce encoding of an opened file.
+ * Encoding is guessed from the buffer filled by ReadFiles(), or from the
+ * beginning of the file, which is then rewound for the compare engine.
+ * @param [in] i Index of the file.
+ * @param [in] guessEncodingType Try to guess codepage (not just unicode encoding).
+ * @param [out] pbPureAscii If not NULL, gets true if file has only ASCII bytes.
+ * @return Structure getting the encoding info.
+ * @note Must be called after OpenFiles().
+ */
+FileTextEncoding DiffFileData::GuessEncoding(int i, int guessEncodingType, bool *pbPureAscii)
+{
+	const String& filepath = m_FileLocation[i].filepath;
+	if (m_inf[i].preloaded)
+	{
+		return GuessCodepageEncoding(filepath, m_inf[i].buffer,
+			m_inf[i].buffered_chars, guessEncodingType, BufSize, pbPureAscii);
+	}
+	std::unique_ptr<char[]> buf(new char[BufSize]);
+	int len = read(m_inf[i].desc, buf.get(), BufSize);
+	if (len < 0 || lseek(m_inf[i].desc, 0, SEEK_SET) != 0)
+		len = 0;
+	return GuessCodepageEncoding(filepath, buf.get(), len, guessEncodingType, BufSize, pbPureAscii);
+}
+
+/**
+ * @brief Check if two opened pairs of files are worth comparing concurrently.
+ * @param [in] data1 First pair of files.
+ * @param [in] data2 Second pair of files.
+ * @return true if the files are large enough.
+ * @note Must be called after the files are opened.
+ */
+bool DiffFileData::IsWorthConcurrentCompare(const DiffFileData& data1, const DiffFileData& data2)
+{
+	int64_t size = 0;
+	for (int i = 0; i < 2; ++i)
+		size += data1.m_inf[i].stat.st_size + data2.m_inf[i].stat.st_size;
+	return size >= ConcurrentCompareSize;
+}
+
 /** @brief stash away true names for display, before opening files */
 void DiffFileData::SetDisplayFilepaths(const String& szTrueFilepath1, const String& szTrueFilepath2)
 {
@@ -67,47 +188,123 @@ bool DiffFileData::DoOpenFiles()
 
 	for (int i = 0; i < 2; ++i)
 	{
-		// Fill in 8-bit versions of names for diffutils (WinMerge doesn't use these)
-		// Actual paths are m_FileLocation[i].filepath
-		// but these are often temporary files
-		// Displayable (original) paths are m_sDisplayFilepath[i]
-		m_inf[i].name = strdup(ucr::toSystemCP(m_sDisplayFilepath[i]).c_str());
-		if (m_inf[i].name == NULL)
+		if (!DoOpenFile(i))
 			return false;
-
-		// Open up file descriptors
-		// Always use O_BINARY mode, to avoid terminating file read on ctrl-Z (DOS EOF)
-		// Also, WinMerge-modified diffutils handles all three major eol styles
-		if (m_inf[i].desc == 0)
+		
+		if (strutils::compare_nocase(m_FileLocation[0].filepath,
+				m_FileLocation[1].filepath) == 0)
 		{
+			m_inf[1].desc = m_inf[0].desc;
+		}
+	}
+
+	m_used = true;
+	return true;
+}
+
+/** @brief Open one file descriptor in the inf structure (return false if failure) */
+bool DiffFileData::DoOpenFile(int i)
+{
+	// Fill in 8-bit versions of names for diffutils (WinMerge doesn't use these)
+	// Actual paths are m_FileLocation[i].filepath
+	// but these are often temporary files
+	// Displayable (original) paths are m_sDisplayFilepath[i]
+	m_inf[i].name = strdup(ucr::toSystemCP(m_sDisplayFilepath[i]).c_str());
+	if (m_inf[i].name == NULL)
+		return false;
+
+	// Open up file descriptors
+	// Always use O_BINARY mode, to avoid terminating file read on ctrl-Z (DOS EOF)
+	// Also, WinMerge-modified diffutils handles all three major eol styles
+	if (m_inf[i].desc == 0)
+	{
 #ifdef _WIN32
-			m_inf[i].desc = _topen(m_FileLocation[i].filepath.c_str(),
-					O_RDONLY | O_BINARY, _S_IREAD);
+		m_inf[i].desc = _topen(m_FileLocation[i].filepath.c_str(),
+				O_RDONLY | O_BINARY, _S_IREAD);
 #else
-			m_inf[i].desc = open(m_FileLocation[i].filepath.c_str(), O_RDONLY);
+		m_inf[i].desc = open(m_FileLocation[i].filepath.c_str(), O_RDONLY);
 #endif
-		}
-		if (m_inf[i].desc < 0)
-			return false;
+	}
+	if (m_inf[i].desc < 0)
+		return false;
 
-		// Get file stats (diffutils uses these)
+	// Get file stats (diffutils uses these)
 #ifdef _WIN32
-		if (myfstat(m_inf[i].desc, &m_inf[i].stat) != 0)
+	if (myfstat(m_inf[i].desc, &m_inf[i].stat) != 0)
 #else
-		if (fstat(m_inf[i].desc, &m_inf[i].stat) != 0)
+	if (fstat(m_inf[i].desc, &m_inf[i].stat) != 0)
 #endif
+	{
+		return false;
+	}
+	return true;
+}
+
+/** @brief Fill one side of the inf structure from memory (return false if failure) */
+bool DiffFileData::DoOpenBuffer(int i, const std::string& text)
+{
+	return DoOpenBuffer(i, text.data(), text.size());
+}
+
+/** @brief Fill one side of the inf structure from memory (return false if failure) */
+bool DiffFileData::DoOpenBuffer(int i, const char *data, size_t size)
+{
+	m_inf[i].name = strdup(ucr::toSystemCP(m_sDisplayFilepath[i]).c_str());
+	if (m_inf[i].name == NULL)
+		return false;
+
+	// Leave room for an appended newline and the word sized sentinel
+	size_t bufsize = size + sizeof(unsigned) + 1;
+	m_inf[i].buffer = static_cast<char *>(malloc(bufsize));
+	if (m_inf[i].buffer == NULL)
+		return false;
+	memcpy(m_inf[i].buffer, data, size);
+	m_inf[i].bufsize = bufsize;
+	m_inf[i].buffered_chars = size;
+	m_inf[i].preloaded = 1;
+	m_inf[i].desc = -1;
+
+	// diffutils only looks at the type and size
+	m_inf[i].stat.st_mode = S_IFREG;
+	m_inf[i].stat.st_size = size;
+	return true;
+}
+
+/**
+ * @brief Read one opened file to the buffer of the inf structure.
+ * The buffer has room for appended newline and the word sized sentinel.
+ * Transcoding room for UCS-2/UCS-4 files is allocated by diffutils.
+ */
+bool DiffFileData::DoReadFile(int i)
+{
+	if (m_inf[i].desc < 0 || !S_ISREG(m_inf[i].stat.st_mode))
+		return true;
+
+	size_t size = static_cast<size_t>(m_inf[i].stat.st_size);
+	size_t bufsize = size + sizeof(unsigned) + 1;
+	char *buffer = static_cast<char *>(malloc(bufsize));
+	if (buffer == NULL)
+		return false;
+	size_t buffered = 0;
+	while (buffered < size)
+	{
+		unsigned count = static_cast<unsigned>((std::min)(size - buffered, static_cast<size_t>(INT_MAX)));
+		int rtn = read(m_inf[i].desc, buffer + buffered, count);
+		if (rtn < 0)
 		{
+			free(buffer);
 			return false;
 		}
-		
-		if (strutils::compare_nocase(m_FileLocation[0].filepath,
-				m_FileLocation[1].filepath) == 0)
-		{
-			m_inf[1].desc = m_inf[0].desc;
-		}
+		if (rtn == 0)
+			break;
+		buffered += rtn;
 	}
-
-	m_used = true;
+	close(m_inf[i].desc);
+	m_inf[i].desc = -1;
+	m_inf[i].buffer = buffer;
+	m_inf[i].bufsize = bufsize;
+	m_inf[i].buffered_chars = buffered;
+	m_inf[i].preloaded = 1;
 	return true;
 }
 
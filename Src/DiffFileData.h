@@ -7,6 +7,7 @@
  */
 #pragma once
 
+#include <string>
 #include "FileLocation.h"
 #include "FileTextStats.h"
 
@@ -29,10 +30,16 @@ struct DiffFileData
 	~DiffFileData();
 
 	bool OpenFiles(const String& szFilepath1, const String& szFilepath2);
+	bool OpenFiles(const DiffFileData& other, int iOther, const String& szFilepath2);
+	bool OpenBuffers(const std::string& text1, const std::string& text2);
+	bool ReadFiles();
+	FileTextEncoding GuessEncoding(int i, int guessEncodingType, bool *pbPureAscii = nullptr);
 	void Reset();
 	void Close() { Reset(); }
 	void SetDisplayFilepaths(const String& szTrueFilepath1, const String& szTrueFilepath2);
 
+	static bool IsWorthConcurrentCompare(const DiffFileData& data1, const DiffFileData& data2);
+
 	bool Filepath_Transform(bool bForceUTF8, const FileTextEncoding & encoding, const String & filepath, String & filepathTransformed,
 		const String& filteredFilenames, PrediffingInfo * infoPrediffer);
 
@@ -46,4 +53,8 @@ struct DiffFileData
 
 private:
 	bool DoOpenFiles();
+	bool DoOpenFile(int i);
+	bool DoOpenBuffer(int i, const std::string& text);
+	bool DoOpenBuffer(int i, const char *data, size_t size);
+	bool DoReadFile(int i);
 };
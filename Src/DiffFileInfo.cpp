@@ -22,14 +22,85 @@
 
 #include "DiffFileInfo.h"
 
+static const FileTextEncoding DefaultEncoding;
+static const FileTextStats DefaultTextStats;
+
+/**
+ * @brief Copy constructor.
+ */
+DiffFileInfo::DiffFileInfo(const DiffFileInfo& other)
+: DirItem(other)
+, m_pTextInfo(other.m_pTextInfo ? new TextInfo(*other.m_pTextInfo) : NULL)
+{
+}
+
+/**
+ * @brief Assignment operator.
+ */
+DiffFileInfo& DiffFileInfo::operator=(const DiffFileInfo& other)
+{
+	if (this != &other)
+	{
+		DirItem::operator=(other);
+		m_pTextInfo.reset(other.m_pTextInfo ? new TextInfo(*other.m_pTextInfo) : NULL);
+	}
+	return *this;
+}
+
+/**
+ * @brief Get the encoding of the file.
+ */
+const FileTextEncoding& DiffFileInfo::GetEncoding() const
+{
+	return m_pTextInfo ? m_pTextInfo->encoding : DefaultEncoding;
+}
+
+/**
+ * @brief Set the encoding of the file.
+ */
+void DiffFileInfo::SetEncoding(const FileTextEncoding& encoding)
+{
+	if (!m_pTextInfo && encoding.m_codepage == DefaultEncoding.m_codepage &&
+		encoding.m_unicoding == DefaultEncoding.m_unicoding && encoding.m_bom == DefaultEncoding.m_bom)
+		return;
+	AllocTextInfo()->encoding = encoding;
+}
+
+/**
+ * @brief Get EOL and zero-byte counts of the file.
+ */
+const FileTextStats& DiffFileInfo::GetTextStats() const
+{
+	return m_pTextInfo ? m_pTextInfo->textStats : DefaultTextStats;
+}
+
+/**
+ * @brief Set EOL and zero-byte counts of the file.
+ */
+void DiffFileInfo::SetTextStats(const FileTextStats& stats)
+{
+	if (!m_pTextInfo && stats.ncrs == 0 && stats.nlfs == 0 && stats.ncrlfs == 0 && stats.nzeros == 0)
+		return;
+	AllocTextInfo()->textStats = stats;
+}
+
+/**
+ * @brief Return the text information, allocating it if needed.
+ */
+DiffFileInfo::TextInfo *DiffFileInfo::AllocTextInfo()
+{
+	if (!m_pTextInfo)
+		m_pTextInfo.reset(new TextInfo);
+	return m_pTextInfo.get();
+}
+
 /**
  * @brief Clears FileInfo data.
  */
 void DiffFileInfo::ClearPartial()
 {
 	DirItem::ClearPartial();
-	encoding.Clear();
-	m_textStats.clear();
+	m_pTextInfo.reset();
 }
 
 /**
@@ -37,5 +108,5 @@ void DiffFileInfo::ClearPartial()
  */
 bool DiffFileInfo::IsEditableEncoding() const
 {
-	return encoding.m_bom == false;
+	return GetEncoding().m_bom == false;
 }
@@ -21,6 +21,7 @@
  */
 #pragma once
 
+#include <memory>
 #include "DirItem.h"
 #include "FileTextEncoding.h"
 #include "FileTextStats.h"
@@ -29,21 +30,36 @@
  * @brief Information for file.
  * This class expands DirItem class with encoding information and
  * text stats information.
+ *
+ * Encoding and text stats are allocated only when set to something else
+ * than their defaults, as most items of a large folder compare (folders,
+ * unique and skipped items) never get them.
  * @sa DirItem.
  */
 struct DiffFileInfo : public DirItem
 {
-// data
-	FileTextEncoding encoding; /**< unicode or codepage info */
-	FileTextStats m_textStats; /**< EOL, zero-byte etc counts */
-
-	// We could stash a pointer here to the parent DIFFITEM
-	// but, I ran into trouble with, I think, the DIFFITEM copy constructor
-
 // methods
 
 	DiffFileInfo() { }
+	DiffFileInfo(const DiffFileInfo& other);
+	DiffFileInfo& operator=(const DiffFileInfo& other);
+	const FileTextEncoding& GetEncoding() const;
+	void SetEncoding(const FileTextEncoding& encoding);
+	const FileTextStats& GetTextStats() const;
+	void SetTextStats(const FileTextStats& stats);
 	//void Clear();
 	void ClearPartial();
 	bool IsEditableEncoding() const;
+
+private:
+	/** @brief Text information of a compared file. */
+	struct TextInfo
+	{
+		FileTextEncoding encoding; /**< unicode or codepage info */
+		FileTextStats textStats; /**< EOL, zero-byte etc counts */
+	};
+
+	TextInfo *AllocTextInfo();
+
+	std::unique_ptr<TextInfo> m_pTextInfo; /**< Text information, NULL if default */
 };
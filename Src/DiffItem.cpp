@@ -9,12 +9,6 @@
 
 DIFFITEM DIFFITEM::emptyitem;
 
-/** @brief DIFFITEM's destructor */
-DIFFITEM::~DIFFITEM()
-{
-	RemoveChildren();
-}
-
 /** @brief Return path to left/right file, including all but file name */
 String DIFFITEM::getFilepath(int nIndex, const String &sRoot) const
 {
@@ -56,16 +50,6 @@ bool DIFFITEM::HasChildren() const
 	return p ? true : false;
 }
 
-void DIFFITEM::RemoveChildren()
-{
-	while (HasChildren())
-	{
-		DIFFITEM *p = static_cast<DIFFITEM *>(children.Flink);
-		p->RemoveSelf();
-		delete p;
-	}
-}
-
 void DIFFITEM::Swap(int idx1, int idx2)
 {
 	std::swap(diffFileInfo[idx1], diffFileInfo[idx2]);
@@ -184,6 +184,9 @@ public:
  * This class is for backend differences processing, presenting physical
  * files and folders. This class is not for GUI data like selection or
  * visibility statuses. So do not include any GUI-dependent data here. 
+ *
+ * Items are allocated and freed by DiffItemList, which also frees the
+ * children of an item.
  */
 struct DIFFITEM : ListEntry
 {
@@ -199,7 +202,6 @@ struct DIFFITEM : ListEntry
 	static DIFFITEM emptyitem; /**< singleton to represent a diffitem that doesn't have any data */
 
 	DIFFITEM() : parent(NULL), nidiffs(-1), nsdiffs(-1), customFlags1(0) { }
-	~DIFFITEM();
 
 	bool isEmpty() const { return this == &emptyitem; }
 	String getFilepath(int nIndex, const String &sRoot) const;
@@ -208,6 +210,5 @@ struct DIFFITEM : ListEntry
 	int GetDepth() const;
 	bool IsAncestor(const DIFFITEM *pdi) const;
 	bool HasChildren() const;
-	void RemoveChildren();
 	void Swap(int idx1, int idx2);
 };
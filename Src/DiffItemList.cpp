@@ -6,11 +6,14 @@
 
 #include "DiffItemList.h"
 #include <cassert>
+#include <new>
 
 /**
  * @brief Constructor
  */
 DiffItemList::DiffItemList()
+: m_nBlockUsed(0)
+, m_pFree(NULL)
 {
 }
 
@@ -29,7 +32,7 @@ DiffItemList::~DiffItemList()
  */
 DIFFITEM* DiffItemList::AddDiff(DIFFITEM *parent)
 {
-	DIFFITEM *p = new DIFFITEM;
+	DIFFITEM *p = NewItem();
 	if (parent)
 		parent->children.Append(p);
 	else
@@ -46,7 +49,18 @@ void DiffItemList::RemoveDiff(uintptr_t diffpos)
 {
 	DIFFITEM *p = reinterpret_cast<DIFFITEM *>(diffpos);
 	p->RemoveSelf();
-	delete p;
+	DeleteItem(p);
+}
+
+/**
+ * @brief Remove children of diffitem from structured DIFFITEM tree
+ * @param diffpos position of item whose children to remove
+ */
+void DiffItemList::RemoveChildren(uintptr_t diffpos)
+{
+	DIFFITEM *p = reinterpret_cast<DIFFITEM *>(diffpos);
+	while (p->HasChildren())
+		RemoveDiff((uintptr_t)p->children.Flink);
 }
 
 /**
@@ -56,6 +70,54 @@ void DiffItemList::RemoveAll()
 {
 	while (m_root.IsSibling(m_root.Flink))
 		RemoveDiff((uintptr_t)m_root.Flink);
+	// Items unlinked without removing them are freed with the blocks
+	for (size_t i = 0; i < m_blocks.size(); ++i)
+		::operator delete(m_blocks[i]);
+	m_blocks.clear();
+	m_nBlockUsed = 0;
+	m_pFree = NULL;
+}
+
+/**
+ * @brief Allocate and construct an item.
+ * Removed items are reused first, then the items of the last block.
+ */
+DIFFITEM *DiffItemList::NewItem()
+{
+	void *mem;
+	if (m_pFree)
+	{
+		mem = m_pFree;
+		m_pFree = m_pFree->next;
+	}
+	else
+	{
+		if (m_blocks.empty() || m_nBlockUsed == BlockItems)
+		{
+			m_blocks.push_back(static_cast<char *>(::operator new(BlockItems * sizeof(DIFFITEM))));
+			m_nBlockUsed = 0;
+		}
+		mem = m_blocks.back() + m_nBlockUsed++ * sizeof(DIFFITEM);
+	}
+	return new (mem) DIFFITEM;
+}
+
+/**
+ * @brief Destruct an unlinked item and its children, keeping their memory
+ * for reuse.
+ */
+void DiffItemList::DeleteItem(DIFFITEM *p)
+{
+	while (p->HasChildren())
+	{
+		DIFFITEM *child = static_cast<DIFFITEM *>(p->children.Flink);
+		child->RemoveSelf();
+		DeleteItem(child);
+	}
+	p->~DIFFITEM();
+	FreeItem *item = reinterpret_cast<FreeItem *>(p);
+	item->next = m_pFree;
+	m_pFree = item;
 }
 
 /**
@@ -7,6 +7,7 @@
 
 #include "DiffItem.h"
 #include <cstdint>
+#include <vector>
 
 /**
  * @brief List of DIFFITEMs in folder compare.
@@ -14,6 +15,11 @@
  * we have a linked list of DIFFITEMs. But there is a structure that follows
  * the actual folder structure. Each DIFFITEM can have a parent folder and
  * another list of child items. Parent DIFFITEM is always a folder item.
+ *
+ * Items are allocated from blocks of many items, so that a compare of
+ * millions of items doesn't allocate each of them separately. Removed
+ * items are reused by later additions, and the blocks are freed when
+ * all items are removed.
  */
 class DiffItemList
 {
@@ -23,6 +29,7 @@ public:
 	// add & remove differences
 	DIFFITEM *AddDiff(DIFFITEM *parent);
 	void RemoveDiff(uintptr_t diffpos);
+	void RemoveChildren(uintptr_t diffpos);
 	void RemoveAll();
 
 	// to iterate over all differences on list
@@ -44,6 +51,21 @@ public:
 
 protected:
 	ListEntry m_root; /**< Root of list of diffitems */
+
+private:
+	/** @brief Memory of a removed item, waiting to be reused. */
+	struct FreeItem
+	{
+		FreeItem *next;
+	};
+
+	DIFFITEM *NewItem();
+	void DeleteItem(DIFFITEM *p);
+
+	static const size_t BlockItems = 4096; /**< Count of items in a block */
+	std::vector<char *> m_blocks; /**< Blocks items are allocated from */
+	size_t m_nBlockUsed; /**< Count of items used in the last block */
+	FreeItem *m_pFree; /**< List of removed items */
 };
 
 /**
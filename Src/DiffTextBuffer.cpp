@@ -21,6 +21,7 @@
 #include "FileTextEncoding.h"
 #include "codepage_detect.h"
 #include "TFile.h"
+#include "LoadProgress.h"
 
 using Poco::Exception;
 
@@ -32,6 +33,9 @@ static bool IsTextFileStylePure(const UniMemFile::txtstats & stats);
 static void EscapeControlChars(String &s);
 static CRLFSTYLE GetTextFileStyle(const UniMemFile::txtstats & stats);
 
+/** @brief Count of lines loaded between progress reports, a power of two. */
+static const UINT ProgressLineInterval = 4096;
+
 /**
  * @brief Check if file has only one EOL type.
  * @param [in] stats File's text stats.
@@ -133,6 +137,7 @@ CDiffTextBuffer::CDiffTextBuffer(CMergeDoc * pDoc, int pane)
 , m_nThisPane(pane)
 , m_unpackerSubcode(0)
 , m_bMixedEOL(false)
+, m_bRevisionsRestored(false)
 {
 }
 
@@ -277,16 +282,20 @@ bool CDiffTextBuffer::IsInitialized() const
  * @param [in] nCrlfStyle EOL style used
  * @param [in] encoding Encoding used
  * @param [out] sError Error message returned
+ * @param [in] pProgress Progress to add the bytes read to, or NULL
  * @return FRESULT_OK when loading succeed or (list in files.h):
  * - FRESULT_OK_IMPURE : load OK, but the EOL are of different types
  * - FRESULT_ERROR_UNPACK : plugin failed to unpack
  * - FRESULT_ERROR : loading failed, sError contains error message
  * - FRESULT_BINARY : file is binary file
  * @note If this method fails, it calls InitNew so the CDiffTextBuffer is in a valid state
+ * @note Buffers of other panes may load at the same time when @p infoUnpacker
+ * runs no plugin, so this must not show any UI nor change shared state.
  */
 int CDiffTextBuffer::LoadFromFile(LPCTSTR pszFileNameInit,
 		PackingInfo * infoUnpacker, LPCTSTR sToFindUnpacker, bool & readOnly,
-		CRLFSTYLE nCrlfStyle, const FileTextEncoding & encoding, CString &sError)
+		CRLFSTYLE nCrlfStyle, const FileTextEncoding & encoding, CString &sError,
+		LoadProgress * pProgress /*= NULL*/)
 {
 	ASSERT(!m_bInit);
 	ASSERT(m_aLines.size() == 0);
@@ -366,6 +375,9 @@ int CDiffTextBuffer::LoadFromFile(LPCTSTR pszFileNameInit,
 		
 		// preveol must be initialized for empty files
 		preveol = _T("\n");
+
+		// bytes read reported to pProgress so far
+		int64_t progressPos = 0;
 		
 		do {
 			bool lossy = false;
@@ -389,15 +401,24 @@ int CDiffTextBuffer::LoadFromFile(LPCTSTR pszFileNameInit,
 				m_aLines.resize(arraysize);
 			}
 
-			sline += eol; // TODO: opportunity for optimization, as CString append is terrible
 			if (lossy)
 			{
 				// TODO: Should record lossy status of line
 			}
-			AppendLine(lineno, sline.c_str(), static_cast<int>(sline.length()));
+			SetLoadedLine(lineno, sline.c_str(), static_cast<int>(sline.length()),
+				eol.c_str(), static_cast<int>(eol.length()));
 			++lineno;
 			preveol = eol;
+
+			if (pProgress && (lineno & (ProgressLineInterval - 1)) == 0)
+			{
+				int64_t pos = pufile->GetPosition();
+				pProgress->AddLoaded(pos - progressPos);
+				progressPos = pos;
+			}
 		} while (!done);
+		if (pProgress)
+			pProgress->AddLoaded(pufile->GetPosition() - progressPos);
 
 		// fix array size (due to our manual exponential growth
 		m_aLines.resize(lineno);
@@ -665,6 +686,86 @@ int CDiffTextBuffer::SaveToFile (const String& pszFileName,
 		return SAVE_FAILED;
 }
 
+/**
+ * @brief Renders buffer for the diff-engine without writing a temp file.
+ *
+ * Produces the same bytes SaveToFile() writes for a diff-engine temp file
+ * after CMergeDoc has switched Unicode buffers to UTF-8: lines without
+ * ghosts, control characters escaped and no BOM.
+ * @param [out] text Receives the encoded text.
+ * @param [in] bForceUTF8 Encode as UTF-8 even if the buffer is 8-bit.
+ * @param [in] nStartLine First line to render.
+ * @param [in] nLines Number of lines to render, -1 for rest of the buffer.
+ */
+void CDiffTextBuffer::SaveToMemory(std::string & text, bool bForceUTF8,
+		int nStartLine /*= 0*/, int nLines /*= -1*/)
+{
+	ASSERT (m_bInit);
+
+	if (nLines == -1)
+		nLines = static_cast<int>(m_aLines.size() - nStartLine);
+
+	CRLFSTYLE nCrlfStyle = CRLF_STYLE_AUTOMATIC;
+	if (!GetOptionsMgr()->GetBool(OPT_ALLOW_MIXED_EOL))
+		nCrlfStyle = GetCRLFMode();
+
+	ucr::UNICODESET unicoding = ucr::NONE;
+	int codepage = m_encoding.m_codepage;
+	if (m_encoding.m_unicoding != ucr::NONE || bForceUTF8)
+	{
+		unicoding = ucr::UTF8;
+		codepage = ucr::CP_UTF_8;
+	}
+	ucr::UNICODESET unicodingInternal = ucr::NONE;
+	int codepageInternal = 0;
+	ucr::getInternalEncoding(&unicodingInternal, &codepageInternal);
+
+	text.clear();
+
+	// Lines are collected into chunks, so converting codepage
+	// is done for many lines at a time
+	const size_t chunkSize = 64 * 1024;
+	String sChunk;
+	sChunk.reserve(chunkSize + 256);
+	ucr::buffer converted(chunkSize * 3);
+	auto flushChunk = [&]()
+	{
+		if (sChunk.empty())
+			return;
+		ucr::convert(unicodingInternal, codepageInternal,
+			reinterpret_cast<const unsigned char *>(sChunk.c_str()),
+			sChunk.length() * sizeof(TCHAR), unicoding, codepage, &converted);
+		text.append(reinterpret_cast<const char *>(converted.ptr), converted.size);
+		sChunk.resize(0);
+	};
+
+	String sLine;
+	String sEol = GetStringEol(nCrlfStyle);
+	int lastRealLine = ApparentLastRealLine();
+	for (int line = nStartLine; line < nStartLine + nLines; ++line)
+	{
+		if (GetLineFlags(line) & LF_GHOST)
+			continue;
+
+		sLine.assign(GetLineChars(line), GetLineLength(line));
+		EscapeControlChars(sLine);
+		sChunk += sLine;
+
+		// last real line is never EOL terminated
+		if (line == lastRealLine || lastRealLine == -1)
+			break;
+
+		if (nCrlfStyle == CRLF_STYLE_AUTOMATIC || nCrlfStyle == CRLF_STYLE_MIXED)
+			sChunk += GetLineEol(line);
+		else
+			sChunk += sEol;
+
+		if (sChunk.length() >= chunkSize)
+			flushChunk();
+	}
+	flushChunk();
+}
+
 /// Replace line (removing any eol, and only including one if in strText)
 void CDiffTextBuffer::ReplaceFullLines(CDiffTextBuffer& dbuf, CDiffTextBuffer& sbuf, CCrystalTextView * pSource, int nLineBegin, int nLineEnd, int nAction /*=CE_ACTION_UNKNOWN*/)
 {
@@ -707,3 +808,49 @@ DeleteText2(CCrystalTextView * pSource, int nStartLine, int nStartChar,
 	}
 	return CGhostTextBuffer::DeleteText2(pSource, nStartLine, nStartChar, nEndLine, nEndChar, nAction, bHistory);
 }
+
+/**
+ * @brief Restore line revision numbers saved for undo.
+ * Remember the restore so that the next rescan cannot trust revision
+ * numbers to locate the edited lines.
+ */
+void CDiffTextBuffer::
+RestoreRevisionNumbers(int nStartLine, CDWordArray *paSavedRevisionNumbers)
+{
+	CGhostTextBuffer::RestoreRevisionNumbers(nStartLine, paSavedRevisionNumbers);
+	m_bRevisionsRestored = true;
+}
+
+/**
+ * @brief Find the range of real lines edited after given revision.
+ * @param [in] dwRevision Revision number to compare line revisions against.
+ * @param [out] nFirst First edited real line.
+ * @param [out] nLast Last edited real line.
+ * @param [out] nRealLines Count of real lines in the buffer.
+ * @return true if some line was edited after the revision.
+ * @note An edited ghost line marks the real lines around it as edited.
+ */
+bool CDiffTextBuffer::GetEditedRealLines(DWORD dwRevision, int & nFirst,
+		int & nLast, int & nRealLines) const
+{
+	nFirst = -1;
+	nLast = -1;
+	int nRealLine = 0;
+	const int nLineCount = GetLineCount();
+	for (int nLine = 0; nLine < nLineCount; ++nLine)
+	{
+		const LineInfo & li = m_aLines[nLine];
+		const bool bGhost = (li.m_dwFlags & LF_GHOST) != 0;
+		if (li.m_dwRevisionNumber > dwRevision)
+		{
+			const int nEditFirst = (bGhost && nRealLine > 0) ? nRealLine - 1 : nRealLine;
+			if (nFirst < 0 || nEditFirst < nFirst)
+				nFirst = nEditFirst;
+			nLast = nRealLine;
+		}
+		if (!bGhost)
+			++nRealLine;
+	}
+	nRealLines = nRealLine;
+	return nFirst >= 0;
+}
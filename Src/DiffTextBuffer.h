@@ -5,11 +5,13 @@
  */
 #pragma once
 
+#include <string>
 #include "GhostTextBuffer.h"
 #include "FileTextEncoding.h"
 
 class CMergedoc;
 class PackingInfo;
+class LoadProgress;
 
 /**
  * @brief Specialized buffer to save file data
@@ -24,6 +26,7 @@ private :
 	String m_strTempPath; /**< Temporary files folder. */
 	int m_unpackerSubcode; /**< Plugin information. */
 	bool m_bMixedEOL; /**< EOL style of this buffer is mixed? */
+	bool m_bRevisionsRestored; /**< Undo restored old line revision numbers? */
 
 	/** 
 	 * @brief Unicode encoding from ucr::UNICODESET.
@@ -51,10 +54,13 @@ public :
 
 	int LoadFromFile(LPCTSTR pszFileName, PackingInfo * infoUnpacker,
 		LPCTSTR filteredFilenames, bool & readOnly, CRLFSTYLE nCrlfStyle,
-		const FileTextEncoding & encoding, CString &sError);
+		const FileTextEncoding & encoding, CString &sError,
+		LoadProgress * pProgress = NULL);
 	int SaveToFile (const String& pszFileName, bool bTempFile, String & sError,
 		PackingInfo * infoUnpacker = NULL, CRLFSTYLE nCrlfStyle = CRLF_STYLE_AUTOMATIC,
 		bool bClearModifiedFlag = TRUE, int nStartLine = 0, int nLines = -1);
+	void SaveToMemory(std::string & text, bool bForceUTF8,
+		int nStartLine = 0, int nLines = -1);
 	ucr::UNICODESET getUnicoding() const { return m_encoding.m_unicoding; }
 	void setUnicoding(ucr::UNICODESET value) { m_encoding.m_unicoding = value; }
 	int getCodepage() const { return m_encoding.m_codepage; }
@@ -79,4 +85,8 @@ public :
 	virtual bool DeleteText2 (CCrystalTextView * pSource, int nStartLine,
 		int nStartPos, int nEndLine, int nEndPos,
 		int nAction = CE_ACTION_UNKNOWN, bool bHistory =true);
+	virtual void RestoreRevisionNumbers(int nStartLine, CDWordArray *paSavedRevisionNumbers);
+	bool GetEditedRealLines(DWORD dwRevision, int & nFirst, int & nLast, int & nRealLines) const;
+	bool AreRevisionsRestored() const { return m_bRevisionsRestored; }
+	void ClearRevisionsRestored() { m_bRevisionsRestored = false; }
 };
@@ -31,6 +31,7 @@
 #include "DiffItemList.h"
 #include "PathContext.h"
 #include "CompareStats.h"
+#include "ContentCache.h"
 #include "IAbortable.h"
 
 using Poco::Thread;
@@ -203,6 +204,9 @@ static void DiffThreadCompare(void *pParam)
 
 	myStruct->context->m_pCompareStats->SetCompareState(CompareStats::STATE_IDLE);
 
+	if (myStruct->context->m_pContentCache)
+		myStruct->context->m_pContentCache->Save();
+
 	// Send message to UI to update
 	myStruct->nThreadState = CDiffThread::THREAD_COMPLETED;
 	int event = CDiffThread::EVENT_COMPARE_COMPLETED;
@@ -57,6 +57,7 @@
 #include "TFile.h"
 #include "Exceptions.h"
 #include "MergeApp.h"
+#include "ParallelInvoke.h"
 
 using Poco::Debugger;
 using Poco::format;
@@ -87,6 +88,8 @@ CDiffWrapper::CDiffWrapper()
 , m_bPathsAreTemp(false)
 , m_pFilterList(nullptr)
 , m_bPluginsEnabled(false)
+, m_pInMemoryTexts(nullptr)
+, m_pPatchStream(nullptr)
 , m_status()
 {
 	// character that ends a line.  Currently this is always `\n'
@@ -128,6 +131,22 @@ void CDiffWrapper::SetCreatePatchFile(const String &filename)
 		m_sPatchFile = filename;
 		strutils::replace(m_sPatchFile, _T("/"), _T("\\"));
 	}
+	m_pPatchStream = NULL;
+}
+
+/**
+ * @brief Enables/disables patch creation into an open stream.
+ * Patches are printed to @p stream instead of being appended to a patch
+ * file, so that patches of several files can be printed concurrently by
+ * CDiffWrapper instances on different threads. When @p stream is NULL,
+ * patches are disabled.
+ * @param [in] stream Stream to print patches to, or NULL.
+ */
+void CDiffWrapper::SetCreatePatchStream(FILE *stream)
+{
+	m_bCreatePatchFile = (stream != NULL);
+	m_sPatchFile.clear();
+	m_pPatchStream = stream;
 }
 
 /**
@@ -678,8 +697,24 @@ void CDiffWrapper::SetAlternativePaths(const PathContext &altPaths)
 	m_alternativePaths = altPaths;
 }
 
+/**
+ * @brief Check if files can be compared from in-memory texts.
+ * Prediffer plugins work on files, so texts can be given to diff-engine
+ * directly only when no prediffer is going to be run.
+ * @return true if SetInMemoryTexts() can be used for next RunFileDiff().
+ */
+bool CDiffWrapper::CanDiffInMemory() const
+{
+	if (!m_bPluginsEnabled)
+		return true;
+	return m_infoPrediffer && !m_infoPrediffer->bToBeScanned &&
+		m_infoPrediffer->pluginName.empty();
+}
+
 /**
  * @brief Runs diff-engine.
+ * If in-memory texts were set with SetInMemoryTexts(), those are compared
+ * and paths are used only for display names.
  */
 bool CDiffWrapper::RunFileDiff()
 {
@@ -697,9 +732,12 @@ bool CDiffWrapper::RunFileDiff()
 	if (m_bUseDiffList)
 		m_nDiffs = m_pDiffList->GetSize();
 
+	const std::string *pTexts = m_pInMemoryTexts;
+	assert(!pTexts || CanDiffInMemory());
+
 	for (file = 0; file < files.GetSize(); file++)
 	{
-		if (m_bPluginsEnabled)
+		if (m_bPluginsEnabled && !pTexts)
 		{
 			// Do the preprocessing now, overwrite the temp files
 			// NOTE: FileTransform_UCS2ToUTF8() may create new temp
@@ -737,7 +775,10 @@ bool CDiffWrapper::RunFileDiff()
 	{
 		diffdata.SetDisplayFilepaths(files[0], files[1]); // store true names for diff utils patch file
 		// This opens & fstats both files (if it succeeds)
-		if (!diffdata.OpenFiles(strFileTemp[0], strFileTemp[1]))
+		bool bOpened = pTexts ?
+			diffdata.OpenBuffers(pTexts[0], pTexts[1]) :
+			diffdata.OpenFiles(strFileTemp[0], strFileTemp[1]);
+		if (!bOpened)
 		{
 			return false;
 		}
@@ -771,19 +812,34 @@ bool CDiffWrapper::RunFileDiff()
 		diffdata10.SetDisplayFilepaths(files[1], files[0]); // store true names for diff utils patch file
 		diffdata12.SetDisplayFilepaths(files[1], files[2]); // store true names for diff utils patch file
 
-		if (!diffdata10.OpenFiles(strFileTemp[1], strFileTemp[0]))
+		// The middle file is read once, both pairs are compared with copies of it
+		bool bOpened = pTexts ?
+			diffdata10.OpenBuffers(pTexts[1], pTexts[0]) :
+			diffdata10.OpenFiles(strFileTemp[1], strFileTemp[0]) && diffdata10.ReadFiles();
+		if (!bOpened)
 		{
 			return false;
 		}
 
-		bRet = Diff2Files(&script10, &diffdata10, &bin_flag10, NULL);
-
-		if (!diffdata12.OpenFiles(strFileTemp[1], strFileTemp[2]))
+		bOpened = pTexts ?
+			diffdata12.OpenBuffers(pTexts[1], pTexts[2]) :
+			diffdata12.OpenFiles(diffdata10, 0, strFileTemp[2]);
+		if (!bOpened)
 		{
 			return false;
 		}
 
-		bRet = Diff2Files(&script12, &diffdata12, &bin_flag12, NULL);
+		bool bRet10 = true, bRet12 = true;
+		ParallelInvoke(
+			[&]()
+			{
+				// diffutils options are thread-local
+				m_options.SetToDiffUtils();
+				bRet12 = Diff2Files(&script12, &diffdata12, &bin_flag12, NULL);
+			},
+			[&]() { bRet10 = Diff2Files(&script10, &diffdata10, &bin_flag10, NULL); },
+			DiffFileData::IsWorthConcurrentCompare(diffdata10, diffdata12));
+		bRet = bRet10 && bRet12;
 	}
 
 	// First determine what happened during comparison
@@ -1160,13 +1216,15 @@ bool CDiffWrapper::RegExpFilter(int StartPos, int EndPos, int FileNo) const
 
 	bool linesMatch = true; // set to false when non-matching line is found.
 	int line = StartPos;
+	std::string lineText; // reused for all lines to avoid allocations
 
 	while (line <= EndPos && linesMatch == true)
 	{
 		size_t len = files[FileNo].linbuf[line + 1] - files[FileNo].linbuf[line];
 		const char *string = files[FileNo].linbuf[line];
 		size_t stringlen = linelen(string, len);
-		if (!m_pFilterList->Match(std::string(string, stringlen), m_codepage))
+		lineText.assign(string, stringlen);
+		if (!m_pFilterList->Match(lineText, m_codepage))
 
 		{
 			linesMatch = false;
@@ -1441,10 +1499,18 @@ CDiffWrapper::LoadWinMergeDiffsFromDiffUtilsScript3(
 		Comp02Functor(inf10, inf12), (m_pFilterList && m_pFilterList->HasRegExps()));
 }
 
-void CDiffWrapper::WritePatchFileHeader(enum output_style output_style, bool bAppendFiles)
+/**
+ * @brief Open the patch file, or use the stream set for patches, as the
+ * diffutils output.
+ * @param [in] bAppendFiles Append to an existing patch file?
+ * @return true if there is an output.
+ */
+bool CDiffWrapper::OpenPatchFile(bool bAppendFiles)
 {
 	outfile = NULL;
-	if (!m_sPatchFile.empty())
+	if (m_pPatchStream)
+		outfile = m_pPatchStream;
+	else if (!m_sPatchFile.empty())
 	{
 		const TCHAR *mode = (bAppendFiles ? _T("a+") : _T("w+"));
 		outfile = _tfopen(m_sPatchFile.c_str(), mode);
@@ -1453,8 +1519,28 @@ void CDiffWrapper::WritePatchFileHeader(enum output_style output_style, bool bAp
 	if (!outfile)
 	{
 		m_status.bPatchFileFailed = true;
-		return;
+		return false;
 	}
+	return true;
+}
+
+/**
+ * @brief Close the diffutils output opened by OpenPatchFile().
+ * The stream set for patches is left open.
+ */
+void CDiffWrapper::ClosePatchFile()
+{
+	if (outfile != m_pPatchStream)
+		fclose(outfile);
+	else if (ferror(outfile))
+		m_status.bPatchFileFailed = true;
+	outfile = NULL;
+}
+
+void CDiffWrapper::WritePatchFileHeader(enum output_style output_style, bool bAppendFiles)
+{
+	if (!OpenPatchFile(bAppendFiles))
+		return;
 
 	// Output patchfile
 	switch (output_style)
@@ -1473,23 +1559,13 @@ void CDiffWrapper::WritePatchFileHeader(enum output_style output_style, bool bAp
 		break;
 	}
 	
-	fclose(outfile);
-	outfile = NULL;
+	ClosePatchFile();
 }
 
 void CDiffWrapper::WritePatchFileTerminator(enum output_style output_style)
 {
-	outfile = NULL;
-	if (!m_sPatchFile.empty())
-	{
-		outfile = _tfopen(m_sPatchFile.c_str(), _T("a+"));
-	}
-
-	if (!outfile)
-	{
-		m_status.bPatchFileFailed = true;
+	if (!OpenPatchFile(true))
 		return;
-	}
 
 	// Output patchfile
 	switch (output_style)
@@ -1508,8 +1584,7 @@ void CDiffWrapper::WritePatchFileTerminator(enum output_style output_style)
 		break;
 	}
 	
-	fclose(outfile);
-	outfile = NULL;
+	ClosePatchFile();
 }
 
 /**
@@ -1551,18 +1626,8 @@ void CDiffWrapper::WritePatchFile(struct change * script, file_data * inf)
 		assert(false);
 	}
 
-	outfile = NULL;
-	if (!m_sPatchFile.empty())
-	{
-		const TCHAR *mode = (m_bAppendFiles ? _T("a+") : _T("w+"));
-		outfile = _tfopen(m_sPatchFile.c_str(), mode);
-	}
-
-	if (!outfile)
-	{
-		m_status.bPatchFileFailed = true;
+	if (!OpenPatchFile(m_bAppendFiles))
 		return;
-	}
 
 	// Print "command line"
 	if (m_bAddCmdLine && output_style != OUTPUT_HTML)
@@ -1620,8 +1685,7 @@ void CDiffWrapper::WritePatchFile(struct change * script, file_data * inf)
 		print_html_diff_terminator();
 	}
 	
-	fclose(outfile);
-	outfile = NULL;
+	ClosePatchFile();
 
 	free((void *)inf_patch[0].name);
 	free((void *)inf_patch[1].name);
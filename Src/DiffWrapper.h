@@ -24,6 +24,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include "diff.h"
 #include "FileLocation.h"
 #include "PathContext.h"
@@ -168,6 +169,7 @@ public:
 	CDiffWrapper();
 	~CDiffWrapper();
 	void SetCreatePatchFile(const String &filename);
+	void SetCreatePatchStream(FILE *stream);
 	void SetCreateDiffList(DiffList *diffList);
 	void SetDiffList(DiffList *diffList);
 	void GetOptions(DIFFOPTIONS *options) const;
@@ -182,6 +184,8 @@ public:
 	void SetPaths(const PathContext &files, bool tempPaths);
 	void SetAlternativePaths(const PathContext &altPaths);
 	void SetCodepage(int codepage) { m_codepage = codepage; }
+	void SetInMemoryTexts(const std::string *pTexts) { m_pInMemoryTexts = pTexts; }
+	bool CanDiffInMemory() const;
 	bool RunFileDiff();
 	void GetDiffStatus(DIFFSTATUS *status) const;
 	void AddDiffRange(DiffList *pDiffList, unsigned begin0, unsigned end0, unsigned begin1, unsigned end1, OP_TYPE op);
@@ -211,6 +215,8 @@ protected:
 		int * bin_status, int * bin_file) const;
 	void LoadWinMergeDiffsFromDiffUtilsScript(struct change * script, const file_data * inf);
 	void WritePatchFile(struct change * script, file_data * inf);
+	bool OpenPatchFile(bool bAppendFiles);
+	void ClosePatchFile();
 public:
 	void LoadWinMergeDiffsFromDiffUtilsScript3(
 		struct change * script10, struct change * script12,
@@ -227,6 +233,7 @@ private:
 	PathContext m_originalFile; /**< file's original (NON-TEMP) path. */
 
 	String m_sPatchFile; /**< Full path to created patch file. */
+	FILE *m_pPatchStream; /**< Open stream patches are written to, or NULL */
 	bool m_bPathsAreTemp; /**< Are compared paths temporary? */
 	/// prediffer info are stored only for MergeDoc
 	std::unique_ptr<PrediffingInfo> m_infoPrediffer;
@@ -242,4 +249,5 @@ private:
 	std::unique_ptr<MovedLines> m_pMovedLines[3];
 	const FilterCommentsManager* m_pFilterCommentsManager; /**< Comments filtering manager */
 	bool m_bPluginsEnabled; /**< Are plugins enabled? */
+	const std::string *m_pInMemoryTexts; /**< Texts to diff instead of files, or NULL */
 };
@@ -717,7 +717,7 @@ IntToIntMap CountCodepages(const InputIterator& begin, const InputIterator& end,
 		for (int i = 0; i < ctxt.GetCompareDirs(); ++i)
 		{
 			if (di.diffcode.diffcode != 0 && di.diffcode.exists(i))
-				map.Increment(di.diffFileInfo[i].encoding.m_codepage);
+				map.Increment(di.diffFileInfo[i].GetEncoding().m_codepage);
 		}
 	}
 	return map;
@@ -739,7 +739,9 @@ void ApplyCodepage(const InputIterator& begin, const InputIterator& end, CDiffCo
 			// Does it exist on left? (ie, right or both)
 			if (affect[i] && di.diffcode.exists(i) && di.diffFileInfo[i].IsEditableEncoding())
 			{
-				di.diffFileInfo[i].encoding.SetCodepage(nCodepage);
+				FileTextEncoding encoding = di.diffFileInfo[i].GetEncoding();
+				encoding.SetCodepage(nCodepage);
+				di.diffFileInfo[i].SetEncoding(encoding);
 			}
 		}
 	}
@@ -10,60 +10,38 @@
 #include "UnicodeString.h"
 #include "PathContext.h"
 #include "DirReportTypes.h"
-
-struct IListCtrl;
+#include "DirCmpReportGenerator.h"
 
 /**
  * @brief This class creates directory compare reports.
  *
- * This class creates a directory compare report. To make things easier
- * we read data from view's listview. Reading from listview avoids
- * re-formatting data and complex GUI for selecting what info to show in
- * reports. Downside is we only have data that is visible in GUI.
- *
- * @todo We should read DIFFITEMs from CDirDoc and format data to better
- * fit for reporting. Duplicating formatting and sorting code should be
- * avoided.
+ * This class asks where the report is written to and in which format,
+ * and writes it with DirCmpReportGenerator. Items are read from the
+ * compare results and formatted like the folder compare view formats
+ * them, in the order the view shows them.
  */
-
-struct IFileCmpReport
-{
-	virtual bool operator()(REPORT_TYPE nReportType, IListCtrl *pList, int nIndex, const String &sDestDir, String &sLinkPath) = 0;
-};
-
 class DirCmpReport
 {
 public:
 
 	explicit DirCmpReport(const std::vector<String>& colRegKeys);
-	void SetList(IListCtrl *pList);
+	void SetItems(const DiffItemList *pList, const DirViewListModel *pModel, const IDirCmpReportColumns *pColumns);
 	void SetRootPaths(const PathContext &paths);
 	void SetReportFile(const String& sReportFile) { m_sReportFile = sReportFile; }
-	void SetColumns(int columns);
 	void SetFileCmpReport(IFileCmpReport *pFileCmpReport);
 	bool GenerateReport(String &errStr);
 
 protected:
-	void GenerateReport(REPORT_TYPE nReportType);
-	void WriteString(const String&);
-	void GenerateHeader();
-	void GenerateContent();
-	void GenerateHTMLHeader();
-	void GenerateHTMLHeaderBodyPortion();
-	void GenerateXmlHeader();
-	void GenerateXmlHtmlContent(bool xml);
-	void GenerateHTMLFooter();
-	void GenerateXmlFooter();
+	bool GenerateReportFile(REPORT_TYPE nReportType, const String& sReportFile, bool bIncludeFileCmpReport);
+	bool CopyToClipboard(REPORT_TYPE nReportType);
 
 private:
-	IListCtrl * m_pList; /**< Pointer to UI-list */
+	const DiffItemList *m_pList; /**< Compared items */
+	const DirViewListModel *m_pModel; /**< Rows of the view */
+	const IDirCmpReportColumns *m_pColumns; /**< Columns of the view */
 	PathContext m_rootPaths; /**< Root paths, printed to report */
 	String m_sTitle; /**< Report title, built from root paths */
 	String m_sReportFile;
-	int m_nColumns; /**< Columns in UI */
-	String m_sSeparator; /**< Column separator for report */
-	CFile *m_pFile; /**< File to write report to */
 	const std::vector<String>& m_colRegKeys; /**< Key names for currently displayed columns */
 	IFileCmpReport *m_pFileCmpReport;
-	bool m_bIncludeFileCmpReport;
 };
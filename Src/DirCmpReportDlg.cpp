@@ -80,6 +80,10 @@ static ReportTypeInfo f_types[] = {
 		"Simple XML",
 		"XML Files (*.xml)|*.xml|All Files (*.*)|*.*||"
 	},
+	{ REPORT_TYPE_JSONLINES,
+		"JSON lines",
+		"JSON Lines Files (*.jsonl)|*.jsonl|All Files (*.*)|*.*||"
+	},
 };
 
 void DirCmpReportDlg::LoadSettings()
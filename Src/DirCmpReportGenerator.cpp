@@ -0,0 +1,418 @@
+/**
+ * @file  DirCmpReportGenerator.cpp
+ *
+ * @brief Implementation file for DirCmpReportGenerator
+ *
+ */
+
+#include "DirCmpReportGenerator.h"
+#include <algorithm>
+#include <sstream>
+#include <Poco/Base64Encoder.h>
+#include "DiffItemList.h"
+#include "DirViewListModel.h"
+#include "Utf8Writer.h"
+
+/**
+ * @brief Write beginning tag.
+ * @param [in] writer Writer to write to.
+ * @param [in] elName Name of element.
+ */
+static void WriteBeginEl(Utf8Writer &writer, const String& elName)
+{
+	writer.Write(_T("<"));
+	writer.Write(elName);
+	writer.Write(_T(">"));
+}
+
+/**
+ * @brief Write ending tag.
+ * @param [in] writer Writer to write to.
+ * @param [in] elName Name of element.
+ */
+static void WriteEndEl(Utf8Writer &writer, const String& elName)
+{
+	writer.Write(_T("</"));
+	writer.Write(elName);
+	writer.Write(_T(">"));
+}
+
+/**
+ * @brief Constructor.
+ * @param [in] list Compared items.
+ * @param [in] model Model of the folder compare list, telling which items
+ *  are reported.
+ * @param [in] columns Columns of the report.
+ * @param [in] colRegKeys Key names of the columns, used as names of XML
+ *  elements and JSON members.
+ */
+DirCmpReportGenerator::DirCmpReportGenerator(const DiffItemList &list, const DirViewListModel &model,
+		const IDirCmpReportColumns &columns, const std::vector<String> &colRegKeys)
+: m_list(list)
+, m_model(model)
+, m_columns(columns)
+, m_colRegKeys(colRegKeys)
+, m_bDisplayOrder(true)
+, m_pFileCmpReport(NULL)
+, m_pWriter(NULL)
+{
+}
+
+/**
+ * @brief Set texts printed at the start of the report.
+ */
+void DirCmpReportGenerator::SetHeader(const String &sTitle, const String &sLeftRoot, const String &sRightRoot, const String &sTime)
+{
+	m_sTitle = sTitle;
+	m_sLeftRoot = sLeftRoot;
+	m_sRightRoot = sRightRoot;
+	m_sTime = sTime;
+}
+
+/**
+ * @brief Set file compare reporter functor, for linking file compare
+ * reports from HTML reports.
+ * @param [in] pFileCmpReport Reporter, or NULL for no links.
+ * @param [in] sDestDir Folder the file compare reports are written to.
+ * @param [in] sRelDestDir The same folder, relative to the report.
+ */
+void DirCmpReportGenerator::SetFileCmpReport(IFileCmpReport *pFileCmpReport, const String &sDestDir, const String &sRelDestDir)
+{
+	m_pFileCmpReport = pFileCmpReport;
+	m_sDestDir = sDestDir;
+	m_sRelDestDir = sRelDestDir;
+}
+
+/**
+ * @brief Call a function for each reported item.
+ * @param [in] func Called with the position, the item and its indent level.
+ */
+template<class Func>
+void DirCmpReportGenerator::ForEachItem(Func func) const
+{
+	const DiffItemList &list = m_list;
+	DirViewListModel::RowFunc rowFunc = [&list, &func](uintptr_t diffpos, int level)
+		{
+			func(diffpos, list.GetDiffAt(diffpos), level);
+		};
+	if (m_bDisplayOrder)
+		m_model.ForEachRow(rowFunc);
+	else
+		m_model.WalkItems(m_list, rowFunc);
+}
+
+/**
+ * @brief Generate report of given type.
+ * @param [in] nReportType Type of report.
+ * @param [in] writer Writer the report is written to.
+ */
+void DirCmpReportGenerator::Generate(REPORT_TYPE nReportType, Utf8Writer &writer)
+{
+	m_pWriter = &writer;
+	switch (nReportType)
+	{
+	case REPORT_TYPE_SIMPLEHTML:
+		GenerateHTMLHeader();
+		GenerateXmlHtmlContent(false);
+		GenerateHTMLFooter();
+		break;
+	case REPORT_TYPE_SIMPLEXML:
+		GenerateXmlHeader();
+		GenerateXmlHtmlContent(true);
+		GenerateXmlFooter();
+		break;
+	case REPORT_TYPE_COMMALIST:
+		GenerateHeader(_T(","));
+		GenerateContent(_T(","));
+		break;
+	case REPORT_TYPE_TABLIST:
+		GenerateHeader(_T("\t"));
+		GenerateContent(_T("\t"));
+		break;
+	case REPORT_TYPE_JSONLINES:
+		GenerateJsonLinesContent();
+		break;
+	}
+	m_pWriter = NULL;
+}
+
+/**
+ * @brief Generate the table of a simple html report, without html and
+ * body tags, for the CF_HTML clipboard format.
+ * @param [in] writer Writer the report is written to.
+ */
+void DirCmpReportGenerator::GenerateHTMLFragment(Utf8Writer &writer)
+{
+	m_pWriter = &writer;
+	GenerateHTMLHeaderBodyPortion();
+	GenerateXmlHtmlContent(false);
+	m_pWriter = NULL;
+}
+
+/**
+ * @brief Generate header-data for report.
+ */
+void DirCmpReportGenerator::GenerateHeader(const TCHAR *separator)
+{
+	m_pWriter->Write(m_sTitle);
+	m_pWriter->Write(_T("\n"));
+	m_pWriter->Write(m_sTime);
+	m_pWriter->Write(_T("\n"));
+	const int nColumns = m_columns.GetColumnCount();
+	for (int currCol = 0; currCol < nColumns; currCol++)
+	{
+		m_pWriter->Write(m_columns.GetColumnName(currCol));
+		// Add col-separator, but not after last column
+		if (currCol < nColumns - 1)
+			m_pWriter->Write(separator);
+	}
+}
+
+/**
+ * @brief Generate report content (compared items).
+ * Values having the separator, quotes or newlines are quoted.
+ */
+void DirCmpReportGenerator::GenerateContent(const TCHAR *separator)
+{
+	const int nColumns = m_columns.GetColumnCount();
+	const String quoted = String(_T("\"\n")) + separator;
+	ForEachItem([&](uintptr_t, const DIFFITEM &di, int)
+	{
+		m_pWriter->Write(_T("\n"));
+		for (int currCol = 0; currCol < nColumns; currCol++)
+		{
+			String value = m_columns.GetItemText(di, currCol);
+			if (value.find_first_of(quoted) != String::npos)
+			{
+				strutils::replace(value, _T("\""), _T("\"\""));
+				m_pWriter->Write(_T("\""));
+				m_pWriter->Write(value);
+				m_pWriter->Write(_T("\""));
+			}
+			else
+				m_pWriter->Write(value);
+
+			// Add col-separator, but not after last column
+			if (currCol < nColumns - 1)
+				m_pWriter->Write(separator);
+		}
+	});
+}
+
+/**
+ * @brief Generate simple html report header.
+ */
+void DirCmpReportGenerator::GenerateHTMLHeader()
+{
+	m_pWriter->Write(_T("<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01 Transitional//EN\"\n")
+		_T("\t\"http://www.w3.org/TR/html4/loose.dtd\">\n")
+		_T("<html>\n<head>\n")
+		_T("\t<meta http-equiv=\"Content-Type\" content=\"text/html; charset=UTF-8\">\n")
+		_T("\t<title>"));
+	m_pWriter->Write(m_sTitle, Utf8Writer::ESCAPE_XML);
+	m_pWriter->Write(_T("</title>\n"));
+	m_pWriter->Write(_T("\t<style type=\"text/css\">\n\t<!--\n"));
+	m_pWriter->Write(_T("\t\tbody {\n"));
+	m_pWriter->Write(_T("\t\t\tfont-family: sans-serif;\n"));
+	m_pWriter->Write(_T("\t\t\tfont-size: smaller;\n"));
+	m_pWriter->Write(_T("\t\t}\n"));
+	m_pWriter->Write(_T("\t\ttable {\n"));
+	m_pWriter->Write(_T("\t\t\tborder-collapse: collapse;\n"));
+	m_pWriter->Write(_T("\t\t\tborder: 1px solid gray;\n"));
+	m_pWriter->Write(_T("\t\t}\n"));
+	m_pWriter->Write(_T("\t\tth,td {\n"));
+	m_pWriter->Write(_T("\t\t\tpadding: 3px;\n"));
+	m_pWriter->Write(_T("\t\t\ttext-align: left;\n"));
+	m_pWriter->Write(_T("\t\t\tvertical-align: middle;\n"));
+	m_pWriter->Write(_T("\t\t\tborder: 1px solid gray;\n"));
+	m_pWriter->Write(_T("\t\t}\n"));
+	m_pWriter->Write(_T("\t\tth {\n"));
+	m_pWriter->Write(_T("\t\t\tcolor: white;\n"));
+	m_pWriter->Write(_T("\t\t\tbackground: blue;\n"));
+	m_pWriter->Write(_T("\t\t\tpadding: 4px 4px;\n"));
+	m_pWriter->Write(_T("\t\t\tbackground: linear-gradient(mediumblue, darkblue);\n"));
+	m_pWriter->Write(_T("\t\t}\n"));
+	m_pWriter->Write(_T("\t\t.border {\n"));
+	m_pWriter->Write(_T("\t\t\tdisplay: table;\n"));
+	m_pWriter->Write(_T("\t\t\tborder-radius: 3px;\n"));
+	m_pWriter->Write(_T("\t\t\tborder: 1px #a0a0a0 solid;\n"));
+	m_pWriter->Write(_T("\t\t\tbox-shadow: 1px 1px 2px rgba(0, 0, 0, 0.15)\n"));
+	m_pWriter->Write(_T("\t\t\toverflow: hidden;\n"));
+	m_pWriter->Write(_T("\t\t}\n"));
+
+	// Styles are written only for the icons and indents in use
+	std::vector<bool> usedIcon(m_columns.GetIconCount());
+	int maxIndent = 0;
+	ForEachItem([&](uintptr_t, const DIFFITEM &di, int level)
+	{
+		const int icon = m_columns.GetIconIndex(di);
+		if (icon >= 0 && icon < static_cast<int>(usedIcon.size()))
+			usedIcon[icon] = true;
+		maxIndent = (std::max)(level, maxIndent);
+	});
+	for (int i = 0; i < static_cast<int>(usedIcon.size()); ++i)
+	{
+		if (usedIcon[i])
+		{
+			std::ostringstream stream;
+			Poco::Base64Encoder enc(stream);
+			enc.rdbuf()->setLineLength(0);
+			enc << m_columns.GetIconPNGData(i);
+			enc.close();
+			const std::string data = stream.str();
+			m_pWriter->Write(strutils::format(_T("\t\t.icon%d { background-image: url('data:image/png;base64,"), i));
+			m_pWriter->WriteBytes(data.c_str(), data.length());
+			m_pWriter->Write(_T("'); background-repeat: no-repeat; background-size: 16px 16px; }\n"));
+		}
+	}
+	for (int i = 0; i < maxIndent + 1; ++i)
+		m_pWriter->Write(strutils::format(_T("\t\t.indent%d { padding-left: %dpx; background-position: %dpx center; }\n"), i, 2 * 2 + 16 + 8 * i, 2 + 8 * i));
+	m_pWriter->Write(_T("\t-->\n\t</style>\n"));
+	m_pWriter->Write(_T("</head>\n<body>\n"));
+	GenerateHTMLHeaderBodyPortion();
+}
+
+/**
+ * @brief Generate body portion of simple html report header (w/o body tag).
+ */
+void DirCmpReportGenerator::GenerateHTMLHeaderBodyPortion()
+{
+	m_pWriter->Write(_T("<h2>"));
+	m_pWriter->Write(m_sTitle, Utf8Writer::ESCAPE_XML);
+	m_pWriter->Write(_T("</h2>\n<p>"));
+	m_pWriter->Write(m_sTime, Utf8Writer::ESCAPE_XML);
+	m_pWriter->Write(_T("</p>\n"));
+	m_pWriter->Write(_T("<div class=\"border\">\n<table border=\"1\">\n<tr>\n"));
+
+	const int nColumns = m_columns.GetColumnCount();
+	for (int currCol = 0; currCol < nColumns; currCol++)
+	{
+		m_pWriter->Write(_T("<th>"));
+		m_pWriter->Write(m_columns.GetColumnName(currCol), Utf8Writer::ESCAPE_XML);
+		m_pWriter->Write(_T("</th>"));
+	}
+	m_pWriter->Write(_T("</tr>\n"));
+}
+
+/**
+ * @brief Generate simple xml report header.
+ */
+void DirCmpReportGenerator::GenerateXmlHeader()
+{
+	m_pWriter->Write(_T("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"));
+	m_pWriter->Write(_T("<WinMergeDiffReport version=\"1\">\n"));
+	m_pWriter->Write(_T("<left>"));
+	m_pWriter->Write(m_sLeftRoot, Utf8Writer::ESCAPE_XML);
+	m_pWriter->Write(_T("</left>\n<right>"));
+	m_pWriter->Write(m_sRightRoot, Utf8Writer::ESCAPE_XML);
+	m_pWriter->Write(_T("</right>\n<time>"));
+	m_pWriter->Write(m_sTime, Utf8Writer::ESCAPE_XML);
+	m_pWriter->Write(_T("</time>\n"));
+
+	// Add column headers
+	m_pWriter->Write(_T("<column_name>"));
+	const int nColumns = m_columns.GetColumnCount();
+	for (int currCol = 0; currCol < nColumns; currCol++)
+	{
+		WriteBeginEl(*m_pWriter, m_colRegKeys[currCol]);
+		m_pWriter->Write(m_columns.GetColumnName(currCol), Utf8Writer::ESCAPE_XML);
+		WriteEndEl(*m_pWriter, m_colRegKeys[currCol]);
+	}
+	m_pWriter->Write(_T("</column_name>\n"));
+}
+
+/**
+ * @brief Generate simple html or xml report content.
+ */
+void DirCmpReportGenerator::GenerateXmlHtmlContent(bool xml)
+{
+	const int nColumns = m_columns.GetColumnCount();
+	String sLinkPath;
+
+	// Report:Detail. All currently displayed columns will be added
+	ForEachItem([&](uintptr_t diffpos, const DIFFITEM &di, int level)
+	{
+		sLinkPath.clear();
+		if (!xml && m_pFileCmpReport)
+			(*m_pFileCmpReport)(REPORT_TYPE_SIMPLEHTML, diffpos, m_sDestDir, sLinkPath);
+
+		if (xml)
+			m_pWriter->Write(_T("<filediff>"));
+		else
+		{
+			const int color = m_columns.GetBackColor(di);
+			m_pWriter->Write(strutils::format(_T("<tr style='background-color: #%02x%02x%02x'>"),
+				color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff));
+		}
+		for (int currCol = 0; currCol < nColumns; currCol++)
+		{
+			if (xml)
+				WriteBeginEl(*m_pWriter, m_colRegKeys[currCol]);
+			else if (currCol == 0)
+				m_pWriter->Write(strutils::format(_T("<td class=\"icon%d indent%d\">"), m_columns.GetIconIndex(di), level));
+			else
+				m_pWriter->Write(_T("<td>"));
+			if (currCol == 0 && !sLinkPath.empty())
+			{
+				m_pWriter->Write(_T("<a href=\""));
+				m_pWriter->Write(m_sRelDestDir, Utf8Writer::ESCAPE_XML);
+				m_pWriter->Write(_T("/"));
+				m_pWriter->Write(sLinkPath, Utf8Writer::ESCAPE_XML);
+				m_pWriter->Write(_T("\">"));
+				m_pWriter->Write(m_columns.GetItemText(di, currCol), Utf8Writer::ESCAPE_XML);
+				m_pWriter->Write(_T("</a>"));
+			}
+			else
+			{
+				m_pWriter->Write(m_columns.GetItemText(di, currCol), Utf8Writer::ESCAPE_XML);
+			}
+			if (xml)
+				WriteEndEl(*m_pWriter, m_colRegKeys[currCol]);
+			else
+				m_pWriter->Write(_T("</td>"));
+		}
+		m_pWriter->Write(xml ? _T("</filediff>\n") : _T("</tr>\n"));
+	});
+	if (!xml)
+		m_pWriter->Write(_T("</table>\n</div>\n"));
+}
+
+/**
+ * @brief Generate simple html report footer.
+ */
+void DirCmpReportGenerator::GenerateHTMLFooter()
+{
+	m_pWriter->Write(_T("</body>\n</html>\n"));
+}
+
+/**
+ * @brief Generate simple xml report footer.
+ */
+void DirCmpReportGenerator::GenerateXmlFooter()
+{
+	m_pWriter->Write(_T("</WinMergeDiffReport>\n"));
+}
+
+/**
+ * @brief Generate JSON lines report: one JSON object for each item, having
+ * the column values as strings named by the column keys.
+ */
+void DirCmpReportGenerator::GenerateJsonLinesContent()
+{
+	const int nColumns = m_columns.GetColumnCount();
+	ForEachItem([&](uintptr_t, const DIFFITEM &di, int)
+	{
+		m_pWriter->Write(_T("{"));
+		for (int currCol = 0; currCol < nColumns; currCol++)
+		{
+			if (currCol > 0)
+				m_pWriter->Write(_T(","));
+			m_pWriter->Write(_T("\""));
+			m_pWriter->Write(m_colRegKeys[currCol], Utf8Writer::ESCAPE_JSON);
+			m_pWriter->Write(_T("\":\""));
+			m_pWriter->Write(m_columns.GetItemText(di, currCol), Utf8Writer::ESCAPE_JSON);
+			m_pWriter->Write(_T("\""));
+		}
+		m_pWriter->Write(_T("}\n"));
+	});
+}
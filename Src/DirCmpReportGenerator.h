@@ -0,0 +1,88 @@
+/**
+ * @file  DirCmpReportGenerator.h
+ *
+ * @brief Declaration file for DirCmpReportGenerator.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "UnicodeString.h"
+#include "DirReportTypes.h"
+
+struct DIFFITEM;
+class DiffItemList;
+class DirViewListModel;
+class Utf8Writer;
+
+/**
+ * @brief Creates the file compare report of an item, linked from the
+ * folder compare report.
+ */
+struct IFileCmpReport
+{
+	virtual bool operator()(REPORT_TYPE nReportType, uintptr_t diffpos, const String &sDestDir, String &sLinkPath) = 0;
+};
+
+/**
+ * @brief Gives the columns of a folder compare report and their values.
+ */
+struct IDirCmpReportColumns
+{
+	virtual int GetColumnCount() const = 0;
+	virtual String GetColumnName(int col) const = 0;
+	virtual String GetItemText(const DIFFITEM &di, int col) const = 0;
+	virtual int GetBackColor(const DIFFITEM &di) const = 0;
+	virtual int GetIconIndex(const DIFFITEM &di) const = 0;
+	virtual int GetIconCount() const = 0;
+	virtual std::string GetIconPNGData(int iconIndex) const = 0;
+};
+
+/**
+ * @brief This class writes folder compare reports.
+ *
+ * Items are read from the compare results, and the rows to report are
+ * told by the model of the folder compare list: either its rows, in the
+ * order they are shown, or all items the list would show, in compare
+ * order. Column values are formatted one cell at a time and streamed to
+ * a writer, so reports of any size are written in constant memory and
+ * without the GUI list.
+ */
+class DirCmpReportGenerator
+{
+public:
+	DirCmpReportGenerator(const DiffItemList &list, const DirViewListModel &model,
+		const IDirCmpReportColumns &columns, const std::vector<String> &colRegKeys);
+	void SetDisplayOrder(bool bDisplayOrder) { m_bDisplayOrder = bDisplayOrder; }
+	void SetHeader(const String &sTitle, const String &sLeftRoot, const String &sRightRoot, const String &sTime);
+	void SetFileCmpReport(IFileCmpReport *pFileCmpReport, const String &sDestDir, const String &sRelDestDir);
+	void Generate(REPORT_TYPE nReportType, Utf8Writer &writer);
+	void GenerateHTMLFragment(Utf8Writer &writer);
+
+private:
+	template<class Func> void ForEachItem(Func func) const;
+	void GenerateHeader(const TCHAR *separator);
+	void GenerateContent(const TCHAR *separator);
+	void GenerateHTMLHeader();
+	void GenerateHTMLHeaderBodyPortion();
+	void GenerateXmlHeader();
+	void GenerateXmlHtmlContent(bool xml);
+	void GenerateHTMLFooter();
+	void GenerateXmlFooter();
+	void GenerateJsonLinesContent();
+
+	const DiffItemList &m_list; /**< Compared items */
+	const DirViewListModel &m_model; /**< Tells which items are reported */
+	const IDirCmpReportColumns &m_columns; /**< Columns of the report */
+	const std::vector<String> &m_colRegKeys; /**< Key names for the columns */
+	bool m_bDisplayOrder; /**< Report rows of the model in display order? */
+	String m_sTitle; /**< Report title */
+	String m_sLeftRoot; /**< Left root path, printed to report */
+	String m_sRightRoot; /**< Right root path, printed to report */
+	String m_sTime; /**< Report time, printed to report */
+	IFileCmpReport *m_pFileCmpReport; /**< Creates linked file compare reports */
+	String m_sDestDir; /**< Folder of file compare reports */
+	String m_sRelDestDir; /**< Folder of file compare reports, relative to report */
+	Utf8Writer *m_pWriter; /**< Writer of report being generated */
+};
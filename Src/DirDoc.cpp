@@ -34,11 +34,13 @@
 #include "CompareOptions.h"
 #include "UnicodeString.h"
 #include "CompareStats.h"
+#include "ContentCache.h"
 #include "FilterList.h"
 #include "DirView.h"
 #include "DirFrame.h"
 #include "MainFrm.h"
 #include "paths.h"
+#include "Environment.h"
 #include "7zCommon.h"
 #include "OptionsDef.h"
 #include "OptionsMgr.h"
@@ -59,6 +61,9 @@ using boost::end;
 
 int CDirDoc::m_nDirsTemp = 2;
 
+/** @brief Name of content cache file in temp folder. */
+static const TCHAR ContentCacheFileName[] = _T("WinMergeContentCache.txt");
+
 /////////////////////////////////////////////////////////////////////////////
 // CDirDoc
 
@@ -71,6 +76,7 @@ CDirDoc::CDirDoc()
 : m_pCtxt(nullptr)
 , m_pDirView(nullptr)
 , m_pCompareStats(nullptr)
+, m_pContentCache(nullptr)
 , m_bMarkedRescan(FALSE)
 , m_pTempPathContext(nullptr)
 {
@@ -255,6 +261,18 @@ void CDirDoc::Rescan()
 	m_pCtxt->m_bIgnoreCodepage = GetOptionsMgr()->GetBool(OPT_CMP_IGNORE_CODEPAGE);
 	m_pCtxt->m_pCompareStats = m_pCompareStats.get();
 
+	// Reload content cache, other folder compares may have updated it
+	if (GetOptionsMgr()->GetBool(OPT_CMP_CONTENT_CACHE))
+	{
+		m_pContentCache.reset(new ContentCache(
+			paths::ConcatPath(env::GetTemporaryPath(), ContentCacheFileName),
+			GetOptionsMgr()->GetInt(OPT_CMP_CONTENT_CACHE_LIMIT)));
+		m_pContentCache->Load();
+	}
+	else
+		m_pContentCache.reset();
+	m_pCtxt->m_pContentCache = m_pContentCache.get();
+
 	// Set total items count since we don't collect items
 	if (m_bMarkedRescan)
 		m_pCompareStats->IncreaseTotalItems(m_pDirView->GetSelectedCount());
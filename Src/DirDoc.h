@@ -37,6 +37,7 @@ class DirDocFilterGlobal;
 class DirDocFilterByExtension;
 class CustomStatusCursor;
 class CTempPathContext;
+class ContentCache;
 struct FileActionItem;
 
 /////////////////////////////////////////////////////////////////////////////
@@ -134,6 +135,7 @@ private:
 	std::unique_ptr<CDiffContext> m_pCtxt; /**< Pointer to diff-data */
 	CDirView *m_pDirView; /**< Pointer to GUI */
 	std::unique_ptr<CompareStats> m_pCompareStats; /**< Compare statistics */
+	std::unique_ptr<ContentCache> m_pContentCache; /**< File content digests of earlier compares */
 	MergeDocPtrList m_MergeDocs; /**< List of file compares opened from this compare */
 	bool m_bRO[3]; /**< Is left/middle/right side read-only */
 	String m_strDesc[3]; /**< Left/middle/right side desription text */
@@ -9,4 +9,5 @@ typedef enum
 	REPORT_TYPE_TABLIST, /**< Tab-separated list */
 	REPORT_TYPE_SIMPLEHTML, /**< Simple html table */
 	REPORT_TYPE_SIMPLEXML, /**< Simple xml */
+	REPORT_TYPE_JSONLINES, /**< JSON object for each item, one per line */
 } REPORT_TYPE;
@@ -8,16 +8,17 @@
 #include <cassert>
 #include <memory>
 #include <cstdint>
+#include <deque>
+#include <iterator>
+#include <vector>
+#include <algorithm>
 #define POCO_NO_UNWINDOWS 1
 #include <Poco/Semaphore.h>
-#include <Poco/Notification.h>
-#include <Poco/NotificationQueue.h>
 #include <Poco/Environment.h>
 #include <Poco/ThreadPool.h>
-#include <Poco/Thread.h>
 #include <Poco/Runnable.h>
 #include <Poco/Mutex.h>
-#include <Poco/AutoPtr.h>
+#include <Poco/Condition.h>
 #include <Poco/Stopwatch.h>
 #include <Poco/Format.h>
 #include "DiffThread.h"
@@ -36,14 +37,12 @@
 #include "OptionsDef.h"
 #include "OptionsMgr.h"
 
-using Poco::NotificationQueue;
-using Poco::Notification;
-using Poco::AutoPtr;
-using Poco::Thread;
 using Poco::ThreadPool;
 using Poco::Runnable;
 using Poco::Environment;
 using Poco::Stopwatch;
+using Poco::FastMutex;
+using Poco::Condition;
 
 // Static functions (ie, functions only used locally)
 void CompareDiffItem(DIFFITEM &di, CDiffContext * pCtxt);
@@ -54,61 +53,369 @@ static DIFFITEM *AddToList(const String& sLeftDir, const String& sRightDir, cons
 static DIFFITEM *AddToList(const String& sLeftDir, const String& sMiddleDir, const String& sRightDir, const DirItem * lent, const DirItem * ment, const DirItem * rent,
 	unsigned code, DiffFuncStruct *myStruct, DIFFITEM *parent);
 static void UpdateDiffItem(DIFFITEM & di, bool & bExists, CDiffContext *pCtxt);
-static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, uintptr_t parentdiffpos);
+class CompareScheduler;
+static int CompareItems(CompareScheduler& scheduler, DiffFuncStruct *myStruct, uintptr_t parentdiffpos);
 
-class WorkNotification: public Poco::Notification
+/**
+ * @brief Contents of one folder of one side.
+ */
+struct DirListing
 {
-public:
-	WorkNotification(DIFFITEM& di, NotificationQueue& queueResult): m_di(di), m_queueResult(queueResult) {}
-	DIFFITEM& data() const { return m_di; }
-	NotificationQueue& queueResult() const { return m_queueResult; }
-private:
-	DIFFITEM& m_di;
-	NotificationQueue& m_queueResult;
+	enum State { QUEUED, LOADING, LOADED };
+	explicit DirListing(const String& sDir): m_sDir(sDir), m_state(QUEUED) {}
+	String m_sDir; /**< Folder to list */
+	DirItemArray m_dirs; /**< Subfolders, sorted */
+	DirItemArray m_files; /**< Files, sorted */
+	State m_state;
 };
 
-class WorkCompletedNotification: public Poco::Notification
+typedef std::shared_ptr<DirListing> DirListingPtr;
+
+/**
+ * @brief Loads folder listings ahead of the collect thread.
+ *
+ * The collect thread requests listings of all sides of all subfolders it
+ * is going to walk into. Worker threads take the most recent requests
+ * first, as the collect thread walks depth-first and needs them sooner.
+ * When the collect thread needs a listing no worker has started yet, it
+ * takes the request back from the queue and loads it itself.
+ */
+class DirListingLoader: public Runnable
 {
 public:
-	explicit WorkCompletedNotification(DIFFITEM& di): m_di(di) {}
-	DIFFITEM& data() const { return m_di; }
+	DirListingLoader(int nworkers, bool casesensitive);
+	~DirListingLoader();
+	void Request(const std::vector<DirListingPtr>& listings);
+	void Wait(const DirListingPtr& listing);
+	void run();
+
 private:
-	DIFFITEM& m_di;
+	void Load(DirListing& listing);
+
+	ThreadPool m_threadPool;
+	FastMutex m_mutex;
+	Condition m_condition; /**< Signaled when requests are added or loaded */
+	std::deque<DirListingPtr> m_queue; /**< Requests not yet started */
+	bool m_casesensitive;
+	bool m_bStop;
 };
 
-class DiffWorker: public Runnable
+DirListingLoader::DirListingLoader(int nworkers, bool casesensitive)
+: m_threadPool((std::max)(nworkers, 1), (std::max)(nworkers, 1))
+, m_casesensitive(casesensitive)
+, m_bStop(false)
 {
-public:
-	DiffWorker(NotificationQueue& queue, CDiffContext *pCtxt, int id):
-	  m_queue(queue), m_pCtxt(pCtxt), m_id(id) {}
+	for (int i = 0; i < nworkers; ++i)
+		m_threadPool.start(*this);
+}
 
-	void run()
+DirListingLoader::~DirListingLoader()
+{
+	{
+		FastMutex::ScopedLock lock(m_mutex);
+		m_bStop = true;
+		m_queue.clear();
+		m_condition.broadcast();
+	}
+	m_threadPool.joinAll();
+}
+
+/**
+ * @brief Queue listings to be loaded.
+ * First listing of @p listings is taken first by workers.
+ */
+void DirListingLoader::Request(const std::vector<DirListingPtr>& listings)
+{
+	FastMutex::ScopedLock lock(m_mutex);
+	m_queue.insert(m_queue.end(), listings.rbegin(), listings.rend());
+	m_condition.broadcast();
+}
+
+/**
+ * @brief Wait until listing is loaded, loading it in this thread
+ * if no worker has started it.
+ */
+void DirListingLoader::Wait(const DirListingPtr& listing)
+{
 	{
-		// keep the scripts alive during the Rescan
-		// when we exit the thread, we delete this and release the scripts
-		CAssureScriptsForThread scriptsForRescan;
+		FastMutex::ScopedLock lock(m_mutex);
+		if (listing->m_state == DirListing::QUEUED)
+		{
+			std::deque<DirListingPtr>::reverse_iterator it =
+				std::find(m_queue.rbegin(), m_queue.rend(), listing);
+			if (it != m_queue.rend())
+				m_queue.erase(std::next(it).base());
+			listing->m_state = DirListing::LOADING;
+		}
+		else
+		{
+			while (listing->m_state != DirListing::LOADED)
+				m_condition.wait(m_mutex);
+			return;
+		}
+	}
+	Load(*listing);
+}
 
-		AutoPtr<Notification> pNf(m_queue.waitDequeueNotification());
-		while (pNf)
+/**
+ * @brief Worker thread function, loads queued listings until stopped.
+ */
+void DirListingLoader::run()
+{
+	for (;;)
+	{
+		DirListingPtr listing;
 		{
-			WorkNotification* pWorkNf = dynamic_cast<WorkNotification*>(pNf.get());
-			if (pWorkNf) {
-				m_pCtxt->m_pCompareStats->BeginCompare(&pWorkNf->data(), m_id);
-				if (!m_pCtxt->ShouldAbort())
-					CompareDiffItem(pWorkNf->data(), m_pCtxt);
-				pWorkNf->queueResult().enqueueNotification(new WorkCompletedNotification(pWorkNf->data()));
-			}
-			pNf = m_queue.waitDequeueNotification();
+			FastMutex::ScopedLock lock(m_mutex);
+			while (m_queue.empty() && !m_bStop)
+				m_condition.wait(m_mutex);
+			if (m_bStop)
+				return;
+			listing = m_queue.back();
+			m_queue.pop_back();
+			listing->m_state = DirListing::LOADING;
 		}
+		Load(*listing);
 	}
+}
+
+void DirListingLoader::Load(DirListing& listing)
+{
+	LoadAndSortFiles(listing.m_sDir, &listing.m_dirs, &listing.m_files, m_casesensitive);
+	FastMutex::ScopedLock lock(m_mutex);
+	listing.m_state = DirListing::LOADED;
+	m_condition.broadcast();
+}
+
+/**
+ * @brief Folder found by merging folder lists of all sides.
+ */
+struct DirScanSubdir
+{
+	unsigned nDiffCode;
+	const DirItem *ent[3]; /**< Folder items, NULL for missing sides */
+	String newsubdir[3]; /**< Subfolder paths under root paths */
+	DirListingPtr listings[3]; /**< Listings, if walked into */
+};
+
+static int GetItems(const PathContext &paths, const String subdir[],
+		DirListingPtr listings[], DirListingLoader& loader,
+		DiffFuncStruct *myStruct,
+		bool casesensitive, int depth, DIFFITEM *parent,
+		bool bUniques);
+
+/**
+ * @brief Items of one folder level handed to compare workers.
+ */
+struct CompareLevel
+{
+	CompareLevel(): nPending(0), nDiffs(0) {}
+	int nPending; /**< Items handed to workers but not compared yet */
+	int nDiffs; /**< Compared items counted as differences */
+};
+
+/**
+ * @brief One item to compare, and the folder level it belongs to.
+ */
+struct CompareWork
+{
+	DIFFITEM *pdi;
+	CompareLevel *pLevel;
+};
+
+typedef std::vector<CompareWork> CompareBatch;
+
+/**
+ * @brief Hands items to compare workers in batches.
+ *
+ * Items are collected into batches on the compare thread and a whole batch
+ * is queued (and later completed) under one lock, so workers do not contend
+ * per item. Items existing on all sides go to a separate lane which workers
+ * empty first. A batch is handed over when it is full, when the compare
+ * thread is about to wait for the collect thread, and before waiting for
+ * a folder level to complete.
+ */
+class CompareScheduler
+{
+public:
+	CompareScheduler(CDiffContext *pCtxt, int nworkers);
+	~CompareScheduler();
+	void Add(DIFFITEM& di, CompareLevel& level, bool bUrgent);
+	void Flush();
+	int Wait(CompareLevel& level);
 
 private:
-	NotificationQueue& m_queue;
+	class Worker: public Runnable
+	{
+	public:
+		Worker(CompareScheduler& scheduler, int id): m_scheduler(scheduler), m_id(id) {}
+		void run() { m_scheduler.Run(m_id); }
+	private:
+		CompareScheduler& m_scheduler;
+		int m_id;
+	};
+
+	void Run(int id);
+	void Complete(const CompareBatch& batch);
+
+	enum { LANE_URGENT, LANE_NORMAL, LANE_COUNT };
+	static const size_t BatchSize = 32; /**< Max items in a batch */
+
 	CDiffContext *m_pCtxt;
-	int m_id;
+	ThreadPool m_threadPool;
+	std::vector<std::shared_ptr<Worker> > m_workers;
+	FastMutex m_mutex;
+	Condition m_workQueued; /**< Signaled when batches are queued or stopping */
+	Condition m_workCompleted; /**< Signaled when batches are completed */
+	std::deque<CompareBatch> m_queue[LANE_COUNT]; /**< Batches not started */
+	CompareBatch m_pending[LANE_COUNT]; /**< Batches being filled */
+	bool m_bStop;
 };
 
-typedef std::shared_ptr<DiffWorker> DiffWorkerPtr;
+CompareScheduler::CompareScheduler(CDiffContext *pCtxt, int nworkers)
+: m_pCtxt(pCtxt)
+, m_threadPool(nworkers, nworkers)
+, m_bStop(false)
+{
+	pCtxt->m_pCompareStats->SetCompareThreadCount(nworkers);
+	for (int i = 0; i < nworkers; ++i)
+	{
+		m_workers.push_back(std::shared_ptr<Worker>(new Worker(*this, i)));
+		m_threadPool.start(*m_workers[i]);
+	}
+}
+
+CompareScheduler::~CompareScheduler()
+{
+	Flush();
+	{
+		FastMutex::ScopedLock lock(m_mutex);
+		m_bStop = true;
+		m_workQueued.broadcast();
+	}
+	m_threadPool.joinAll();
+}
+
+/**
+ * @brief Add item to be compared.
+ * @param [in] di Item to compare.
+ * @param [in] level Folder level the item belongs to.
+ * @param [in] bUrgent Compare before items not urgent.
+ */
+void CompareScheduler::Add(DIFFITEM& di, CompareLevel& level, bool bUrgent)
+{
+	CompareBatch& batch = m_pending[bUrgent ? LANE_URGENT : LANE_NORMAL];
+	CompareWork work = { &di, &level };
+	batch.push_back(work);
+	if (batch.size() >= BatchSize)
+		Flush();
+}
+
+/**
+ * @brief Hand batches being filled to workers.
+ */
+void CompareScheduler::Flush()
+{
+	if (m_pending[LANE_URGENT].empty() && m_pending[LANE_NORMAL].empty())
+		return;
+	FastMutex::ScopedLock lock(m_mutex);
+	for (int lane = 0; lane < LANE_COUNT; ++lane)
+	{
+		if (m_pending[lane].empty())
+			continue;
+		for (CompareBatch::const_iterator it = m_pending[lane].begin(); it != m_pending[lane].end(); ++it)
+			++it->pLevel->nPending;
+		m_queue[lane].push_back(CompareBatch());
+		m_queue[lane].back().swap(m_pending[lane]);
+		m_pending[lane].reserve(BatchSize);
+	}
+	m_workQueued.broadcast();
+}
+
+/**
+ * @brief Wait until all items added for a folder level are compared.
+ * @param [in] level Folder level.
+ * @return Number of compared items counted as differences.
+ */
+int CompareScheduler::Wait(CompareLevel& level)
+{
+	Flush();
+	FastMutex::ScopedLock lock(m_mutex);
+	while (level.nPending > 0)
+		m_workCompleted.wait(m_mutex);
+	return level.nDiffs;
+}
+
+/**
+ * @brief Worker thread function, compares queued batches until stopped.
+ * @param [in] id Index of the worker.
+ */
+void CompareScheduler::Run(int id)
+{
+	// keep the scripts alive during the Rescan
+	// when we exit the thread, we delete this and release the scripts
+	CAssureScriptsForThread scriptsForRescan;
+
+	CompareBatch batch;
+	for (;;)
+	{
+		{
+			FastMutex::ScopedLock lock(m_mutex);
+			while (m_queue[LANE_URGENT].empty() && m_queue[LANE_NORMAL].empty() && !m_bStop)
+				m_workQueued.wait(m_mutex);
+			std::deque<CompareBatch>& queue = m_queue[m_queue[LANE_URGENT].empty() ? LANE_NORMAL : LANE_URGENT];
+			if (queue.empty())
+				return;
+			batch.swap(queue.front());
+			queue.pop_front();
+		}
+		for (CompareBatch::const_iterator it = batch.begin(); it != batch.end(); ++it)
+		{
+			m_pCtxt->m_pCompareStats->BeginCompare(it->pdi, id);
+			if (!m_pCtxt->ShouldAbort())
+				CompareDiffItem(*it->pdi, m_pCtxt);
+		}
+		Complete(batch);
+		batch.clear();
+	}
+}
+
+/**
+ * @brief Count results of compared batch to their folder levels.
+ */
+void CompareScheduler::Complete(const CompareBatch& batch)
+{
+	const int nDirs = m_pCtxt->GetCompareDirs();
+	FastMutex::ScopedLock lock(m_mutex);
+	for (CompareBatch::const_iterator it = batch.begin(); it != batch.end(); ++it)
+	{
+		const DIFFITEM &di = *it->pdi;
+		bool existsalldirs = ((nDirs == 2 && di.diffcode.isSideBoth()) || (nDirs == 3 && di.diffcode.isSideAll()));
+		if (di.diffcode.isResultDiff() ||
+			(!existsalldirs && !di.diffcode.isResultFiltered()))
+			++it->pLevel->nDiffs;
+		--it->pLevel->nPending;
+	}
+	m_workCompleted.broadcast();
+}
+
+/**
+ * @brief Request listings of all sides of a subfolder.
+ * @param [in] paths Root paths of compare
+ * @param [in] subdir Subfolders under root paths, empty for roots
+ * @param [out] listings Requested listings
+ * @param [in,out] requests Listings to be queued to loader
+ */
+static void RequestListings(const PathContext &paths, const String subdir[],
+		DirListingPtr listings[], std::vector<DirListingPtr>& requests)
+{
+	for (int nIndex = 0; nIndex < paths.GetSize(); nIndex++)
+	{
+		String sDir = subdir[0].empty() ? paths[nIndex] : paths::ConcatPath(paths[nIndex], subdir[nIndex]);
+		listings[nIndex].reset(new DirListing(sDir));
+		requests.push_back(listings[nIndex]);
+	}
+}
 
 /**
  * @brief Collect file- and folder-names to list.
@@ -120,12 +427,13 @@ typedef std::shared_ptr<DiffWorker> DiffWorkerPtr;
  *   contain into list.
  *
  * Items are tested against file filters in this function.
+ *
+ * Folders are listed by a pool of threads (OPT_CMP_COLLECT_THREADS) ahead
+ * of the walk, but items are added to the list in the same depth-first
+ * sorted order as when walking in one thread.
  * 
  * @param [in] paths Root paths of compare
- * @param [in] leftsubdir Left side subdirectory under root path
- * @param [in] bLeftUniq Is left-side folder unique folder?
- * @param [in] rightsubdir Right side subdirectory under root path
- * @param [in] bRightUniq Is right-side folder unique folder?
+ * @param [in] subdir Subdirectories under root paths
  * @param [in] myStruct Compare-related data, like context etc.
  * @param [in] casesensitive Is filename compare casesensitive?
  * @param [in] depth Levels of subdirectories to scan, -1 scans all
@@ -137,28 +445,58 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		DiffFuncStruct *myStruct,
 		bool casesensitive, int depth, DIFFITEM *parent,
 		bool bUniques)
+{
+	int nworkers = 0;
+	if (depth != 0)
+	{
+		nworkers = GetOptionsMgr()->GetInt(OPT_CMP_COLLECT_THREADS);
+		if (nworkers <= 0)
+		{
+			nworkers += Environment::processorCount();
+			if (nworkers <= 0)
+				nworkers = 1;
+		}
+	}
+	DirListingLoader loader(nworkers, casesensitive);
+	DirListingPtr listings[3];
+	std::vector<DirListingPtr> requests;
+	RequestListings(paths, subdir, listings, requests);
+	loader.Request(requests);
+	return GetItems(paths, subdir, listings, loader, myStruct,
+		casesensitive, depth, parent, bUniques);
+}
+
+/**
+ * @brief Collect items of one folder level, see DirScan_GetItems().
+ * @param [in] listings Requested listings of the folder level
+ * @param [in] loader Loader of folder listings
+ */
+static int GetItems(const PathContext &paths, const String subdir[],
+		DirListingPtr listings[], DirListingLoader& loader,
+		DiffFuncStruct *myStruct,
+		bool casesensitive, int depth, DIFFITEM *parent,
+		bool bUniques)
 {
 	static const TCHAR backslash[] = _T("\\");
 	int nDirs = paths.GetSize();
 	CDiffContext *pCtxt = myStruct->context;
-	String sDir[3];
 	String subprefix[3];
 
 	int nIndex;
-	std::copy(paths.begin(), paths.end(), sDir);
-
 	if (!subdir[0].empty())
 	{
 		for (nIndex = 0; nIndex < paths.GetSize(); nIndex++)
-		{
-			sDir[nIndex] = paths::ConcatPath(sDir[nIndex], subdir[nIndex]);
 			subprefix[nIndex] = subdir[nIndex] + backslash;
-		}
 	}
 
 	DirItemArray dirs[3], files[3];
 	for (nIndex = 0; nIndex < nDirs; nIndex++)
-		LoadAndSortFiles(sDir[nIndex], &dirs[nIndex], &files[nIndex], casesensitive);
+	{
+		loader.Wait(listings[nIndex]);
+		dirs[nIndex].swap(listings[nIndex]->m_dirs);
+		files[nIndex].swap(listings[nIndex]->m_files);
+		listings[nIndex].reset();
+	}
 
 	// Allow user to abort scanning
 	if (pCtxt->ShouldAbort())
@@ -173,6 +511,10 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 	if (nIndex == nDirs)
 		return 0;
 
+	// Merge folder lists first, so listings of subfolders to walk into
+	// can be requested before walking into the first one
+	std::vector<DirScanSubdir> subdirs;
+	std::vector<DirListingPtr> requests;
 	DirItemArray::size_type i=0, j=0, k=0;
 	while (1)
 	{
@@ -271,58 +613,20 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 				nDiffCode |= DIFFCODE::SKIPPED;
 		}
 
-		// add to list
-		if (!depth)
-		{
-			if (nDirs < 3)
-				AddToList(subdir[0], subdir[1], 
-					(nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : NULL, 
-					(nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : NULL,
-					nDiffCode, myStruct, parent);
-			else
-				AddToList(subdir[0], subdir[1], subdir[2], 
-					(nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : NULL,
-					(nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : NULL,
-					(nDiffCode & DIFFCODE::THIRD ) ? &dirs[2][k] : NULL,
-					nDiffCode, myStruct, parent);
-		}
-		else
-		{
-			// Recursive compare
-			if (nDirs < 3)
-			{
-				DIFFITEM *me = AddToList(subdir[0], subdir[1], 
-					(nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : NULL, 
-					(nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : NULL,
-					nDiffCode, myStruct, parent);
-				if ((nDiffCode & DIFFCODE::SKIPPED) == 0 && ((nDiffCode & DIFFCODE::SIDEFLAGS) == DIFFCODE::BOTH || bUniques))
-				{
-					// Scan recursively all subdirectories too, we are not adding folders
-					String newsubdir[3] = {leftnewsub, rightnewsub};
-					int result = DirScan_GetItems(paths, newsubdir, myStruct, casesensitive,
-							depth - 1, me, bUniques);
-					if (result == -1)
-						return -1;
-				}
-			}
-			else
-			{
-				DIFFITEM *me = AddToList(subdir[0], subdir[1], subdir[2], 
-					(nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : NULL,
-					(nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : NULL,
-					(nDiffCode & DIFFCODE::THIRD ) ? &dirs[2][k] : NULL,
-					nDiffCode, myStruct, parent);
-				if ((nDiffCode & DIFFCODE::SKIPPED) == 0 && ((nDiffCode & DIFFCODE::SIDEFLAGS) == DIFFCODE::ALL || bUniques))
-				{
-					// Scan recursively all subdirectories too, we are not adding folders
-					String newsubdir[3] = {leftnewsub, middlenewsub, rightnewsub};
-					int result = DirScan_GetItems(paths, newsubdir, myStruct, casesensitive,
-							depth - 1, me, bUniques);
-					if (result == -1)
-						return -1;
-				}
-			}
-		}
+		DirScanSubdir sub;
+		sub.nDiffCode = nDiffCode;
+		sub.ent[0] = (nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : NULL;
+		sub.ent[1] = (nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : NULL;
+		sub.ent[2] = (nDirs > 2 && (nDiffCode & DIFFCODE::THIRD)) ? &dirs[2][k] : NULL;
+		sub.newsubdir[0] = leftnewsub;
+		sub.newsubdir[1] = (nDirs < 3) ? rightnewsub : middlenewsub;
+		sub.newsubdir[2] = (nDirs < 3) ? String() : rightnewsub;
+		// Scan recursively all subdirectories too, we are not adding folders
+		if (depth && (nDiffCode & DIFFCODE::SKIPPED) == 0 &&
+			((nDiffCode & DIFFCODE::SIDEFLAGS) == (nDirs < 3 ? DIFFCODE::BOTH : DIFFCODE::ALL) || bUniques))
+			RequestListings(paths, sub.newsubdir, sub.listings, requests);
+		subdirs.push_back(sub);
+
 		if (nDiffCode & DIFFCODE::FIRST)
 			i++;
 		if (nDiffCode & DIFFCODE::SECOND)
@@ -330,6 +634,30 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		if (nDiffCode & DIFFCODE::THIRD)
 			k++;
 	}
+	loader.Request(requests);
+
+	// add to list
+	for (std::vector<DirScanSubdir>::iterator it = subdirs.begin(); it != subdirs.end(); ++it)
+	{
+		if (pCtxt->ShouldAbort())
+			return -1;
+
+		DIFFITEM *me;
+		if (nDirs < 3)
+			me = AddToList(subdir[0], subdir[1], it->ent[0], it->ent[1],
+				it->nDiffCode, myStruct, parent);
+		else
+			me = AddToList(subdir[0], subdir[1], subdir[2], it->ent[0], it->ent[1], it->ent[2],
+				it->nDiffCode, myStruct, parent);
+		if (it->listings[0])
+		{
+			// Recursive compare
+			int result = GetItems(paths, it->newsubdir, it->listings, loader, myStruct,
+					casesensitive, depth - 1, me, bUniques);
+			if (result == -1)
+				return -1;
+		}
+	}
 	// Handle files
 	// i points to current file in left list (files[0])
 	// j points to current file in right list (files[1])
@@ -466,32 +794,16 @@ int DirScan_CompareItems(DiffFuncStruct *myStruct, uintptr_t parentdiffpos)
 		}
 	}
 
-	ThreadPool threadPool(nworkers, nworkers);
-	std::vector<DiffWorkerPtr> workers;
-	NotificationQueue queue;
-	myStruct->context->m_pCompareStats->SetCompareThreadCount(nworkers);
-	for (unsigned i = 0; i < nworkers; ++i)
-	{
-		workers.push_back(DiffWorkerPtr(new DiffWorker(queue, myStruct->context, i)));
-		threadPool.start(*workers[i]);
-	}
-
-	int res = CompareItems(queue, myStruct, parentdiffpos);
-
-	Thread::sleep(100);
-	queue.wakeUpAll();
-	threadPool.joinAll();
-
-	return res;
+	CompareScheduler scheduler(myStruct->context, nworkers);
+	return CompareItems(scheduler, myStruct, parentdiffpos);
 }
 
-static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, uintptr_t parentdiffpos)
+static int CompareItems(CompareScheduler& scheduler, DiffFuncStruct *myStruct, uintptr_t parentdiffpos)
 {
-	NotificationQueue queueResult;
 	Stopwatch stopwatch;
 	CDiffContext *pCtxt = myStruct->context;
+	CompareLevel level;
 	int res = 0;
-	int count = 0;
 	if (!parentdiffpos)
 		myStruct->pSemaphore->wait();
 	stopwatch.start();
@@ -507,14 +819,19 @@ static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, uint
 			myStruct->m_listeners.notify(myStruct, event);
 			stopwatch.restart();
 		}
-		myStruct->pSemaphore->wait();
+		// Don't keep workers waiting for a partial batch while collecting
+		if (!myStruct->pSemaphore->tryWait(0))
+		{
+			scheduler.Flush();
+			myStruct->pSemaphore->wait();
+		}
 		uintptr_t curpos = pos;
 		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
 		bool existsalldirs = ((pCtxt->GetCompareDirs() == 2 && di.diffcode.isSideBoth()) || (pCtxt->GetCompareDirs() == 3 && di.diffcode.isSideAll()));
 		if (di.diffcode.isDirectory() && pCtxt->m_bRecursive)
 		{
 			di.diffcode.diffcode &= ~(DIFFCODE::DIFF | DIFFCODE::SAME);
-			int ndiff = CompareItems(queue, myStruct, curpos);
+			int ndiff = CompareItems(scheduler, myStruct, curpos);
 			if (ndiff > 0)
 			{
 				if (existsalldirs)
@@ -527,30 +844,12 @@ static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, uint
 					di.diffcode.diffcode |= DIFFCODE::SAME;
 			}
 		}
-		if (existsalldirs)
-			queue.enqueueUrgentNotification(new WorkNotification(di, queueResult));
-		else
-			queue.enqueueNotification(new WorkNotification(di, queueResult));
-		++count;
+		scheduler.Add(di, level, existsalldirs);
 		pos = curpos;
 		pCtxt->GetNextSiblingDiffRefPosition(pos);
 	}
 
-	while (count > 0)
-	{
-		AutoPtr<Notification> pNf(queueResult.waitDequeueNotification());
-		if (!pNf)
-			break;
-		WorkCompletedNotification* pWorkCompletedNf = dynamic_cast<WorkCompletedNotification*>(pNf.get());
-		if (pWorkCompletedNf) {
-			DIFFITEM &di = pWorkCompletedNf->data();
-			bool existsalldirs = ((pCtxt->GetCompareDirs() == 2 && di.diffcode.isSideBoth()) || (pCtxt->GetCompareDirs() == 3 && di.diffcode.isSideAll()));
-			if (di.diffcode.isResultDiff() ||
-				(!existsalldirs && !di.diffcode.isResultFiltered()))
-				res++;
-		}
-		--count;
-	}
+	res += scheduler.Wait(level);
 
 	return pCtxt->ShouldAbort() ? -1 : res;
 }
@@ -654,7 +953,7 @@ int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, uintptr_t parentdiffpos)
 		{
 			if (di.diffcode.isScanNeeded() && !di.diffcode.isResultFiltered())
 			{
-				di.RemoveChildren();
+				pCtxt->RemoveChildren(curpos);
 				di.diffcode.diffcode &= ~DIFFCODE::NEEDSCAN;
 
 				bool casesensitive = false;
@@ -798,8 +1097,8 @@ static void StoreDiffData(DIFFITEM &di, CDiffContext * pCtxt,
 			// Set text statistics
 			if (di.diffcode.exists(i))
 			{
-				di.diffFileInfo[i].m_textStats = pCmpData->m_diffFileData.m_textStats[i];
-				di.diffFileInfo[i].encoding = pCmpData->m_diffFileData.m_FileLocation[i].encoding;
+				di.diffFileInfo[i].SetTextStats(pCmpData->m_diffFileData.m_textStats[i]);
+				di.diffFileInfo[i].SetEncoding(pCmpData->m_diffFileData.m_FileLocation[i].encoding);
 			}
 		}
 	}
@@ -48,6 +48,7 @@
 #include "DirCmpReport.h"
 #include "DirCompProgressBar.h"
 #include "CompareStatisticsDlg.h"
+#include "CompareStats.h"
 #include "LoadSaveCodepageDlg.h"
 #include "ConfirmFolderCopyDlg.h"
 #include "DirColsDlg.h"
@@ -61,6 +62,7 @@
 #include "PatchTool.h"
 #include <numeric>
 #include <functional>
+#include <unordered_set>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -89,6 +91,27 @@ const UINT MiddleCmdFirst = LeftCmdLast + 1;
 const UINT MiddleCmdLast = MiddleCmdFirst + (RightCmdLast - LeftCmdFirst) / 3;
 const UINT RightCmdFirst = MiddleCmdLast + 1;
 
+/**
+ * @brief List control interface of the folder compare list.
+ * The list is a virtual list, so the keys of its rows are in the model.
+ */
+class DirViewListCtrlImpl : public IListCtrlImpl
+{
+public:
+	DirViewListCtrlImpl(HWND hwndListCtrl, const DirViewListModel &model)
+		: IListCtrlImpl(hwndListCtrl), m_model(model)
+	{
+	}
+
+	void *GetItemData(int row) const
+	{
+		return reinterpret_cast<void *>(m_model.GetDiffPos(row));
+	}
+
+private:
+	const DirViewListModel &m_model;
+};
+
 /////////////////////////////////////////////////////////////////////////////
 // CDirView
 
@@ -116,11 +139,14 @@ CDirView::CDirView()
 		, m_hCurrentMenu(nullptr)
 		, m_pSavedTreeState(nullptr)
 		, m_pColItems(nullptr)
+		, m_pListModel(new DirViewListModel())
+		, m_nSpecialItemImage(DIFFIMG_DIRUP)
 {
 	m_dwDefaultStyle &= ~LVS_TYPEMASK;
 	// Show selection all the time, so user can see current item even when
 	// focus is elsewhere (ie, on file edit window)
-	m_dwDefaultStyle |= LVS_REPORT | LVS_SHOWSELALWAYS | LVS_EDITLABELS;
+	// Rows are given by m_pListModel, the list doesn't store them
+	m_dwDefaultStyle |= LVS_REPORT | LVS_SHOWSELALWAYS | LVS_EDITLABELS | LVS_OWNERDATA;
 
 	m_bTreeMode =  GetOptionsMgr()->GetBool(OPT_TREE_MODE);
 	m_bExpandSubdirs = GetOptionsMgr()->GetBool(OPT_DIRVIEW_EXPAND_SUBDIRS);
@@ -369,7 +395,7 @@ void CDirView::OnInitialUpdate()
 	const int iconCY = iconCX;
 	CListView::OnInitialUpdate();
 	m_pList = &GetListCtrl();
-	m_pIList.reset(new IListCtrlImpl(m_pList->m_hWnd));
+	m_pIList.reset(new DirViewListCtrlImpl(m_pList->m_hWnd, *m_pListModel));
 	GetDocument()->SetDirView(this);
 	m_pColItems.reset(new DirViewColItems(GetDocument()->m_nDirs));
 
@@ -411,6 +437,8 @@ void CDirView::OnInitialUpdate()
 	for (auto id : icon_ids)
 		VERIFY(-1 != m_imageList.Add((HICON)LoadImage(AfxGetInstanceHandle(), MAKEINTRESOURCE(id), IMAGE_ICON, iconCX, iconCY, 0)));
 	m_pList->SetImageList(&m_imageList, LVSIL_SMALL);
+	// Expanded/collapsed state icons are given with the texts
+	m_pList->SetCallbackMask(LVIS_STATEIMAGEMASK);
 
 	// Load the icons used for the list view (expanded/collapsed state icons)
 	VERIFY(m_imageState.Create(iconCX, iconCY, ILC_COLOR32 | ILC_MASK, 15, 1));
@@ -495,55 +523,6 @@ void CDirView::ReloadColumns()
 	SetColAlignments();
 }
 
-/**
- * @brief Redisplay items in subfolder
- * @param [in] diffpos First item position in subfolder.
- * @param [in] level Indent level
- * @param [in,out] index Index of the item to be inserted.
- * @param [in,out] alldiffs Number of different items
- */
-void CDirView::RedisplayChildren(uintptr_t diffpos, int level, UINT &index, int &alldiffs)
-{
-	CDirDoc *pDoc = GetDocument();
-	const CDiffContext &ctxt = GetDiffContext();
-	while (diffpos)
-	{
-		uintptr_t curdiffpos = diffpos;
-		const DIFFITEM &di = ctxt.GetNextSiblingDiffPosition(diffpos);
-
-		if (di.diffcode.isResultDiff() || (!di.diffcode.existAll(pDoc->m_nDirs) && !di.diffcode.isResultFiltered()))
-			++alldiffs;
-
-		bool bShowable = IsShowable(ctxt, di, m_dirfilter);
-		if (bShowable)
-		{
-			if (m_bTreeMode)
-			{
-				AddNewItem(index, curdiffpos, I_IMAGECALLBACK, level);
-				index++;
-				if (di.HasChildren())
-				{
-					m_pList->SetItemState(index - 1, INDEXTOSTATEIMAGEMASK((di.customFlags1 & ViewCustomFlags::EXPANDED) ? 2 : 1), LVIS_STATEIMAGEMASK);
-					if (di.customFlags1 & ViewCustomFlags::EXPANDED)
-						RedisplayChildren(ctxt.GetFirstChildDiffPosition(curdiffpos), level + 1, index, alldiffs);
-				}
-			}
-			else
-			{
-				if (!ctxt.m_bRecursive || !di.diffcode.isDirectory() || !di.diffcode.existAll(pDoc->m_nDirs))
-				{
-					AddNewItem(index, curdiffpos, I_IMAGECALLBACK, 0);
-					index++;
-				}
-				if (di.HasChildren())
-				{
-					RedisplayChildren(ctxt.GetFirstChildDiffPosition(curdiffpos), level + 1, index, alldiffs);
-				}
-			}
-		}
-	}
-}
-
 /**
  * @brief Redisplay folder compare view.
  * This function clears folder compare view and then adds
@@ -555,7 +534,6 @@ void CDirView::Redisplay()
 	const CDiffContext &ctxt = GetDiffContext();
 	PathContext pathsParent;
 
-	UINT cnt = 0;
 	// Disable redrawing while adding new items
 	SetRedraw(FALSE);
 
@@ -567,12 +545,17 @@ void CDirView::Redisplay()
 	if (!ctxt.m_bRecursive ||
 		CheckAllowUpwardDirectory(ctxt, pDoc->m_pTempPathContext, pathsParent) == AllowUpwardDirectory::ParentIsTempPath)
 	{
-		cnt += AddSpecialItems();
+		AddSpecialItems();
 	}
 
+	m_pListModel->SetMode(m_bTreeMode, ctxt.m_bRecursive, pDoc->m_nDirs);
+	m_pListModel->SetPredicates(
+		[this](const DIFFITEM &di) { return IsShowable(GetDiffContext(), di, m_dirfilter); },
+		[](const DIFFITEM &di) { return (di.customFlags1 & ViewCustomFlags::EXPANDED) != 0; });
 	int alldiffs = 0;
 	uintptr_t diffpos = ctxt.GetFirstDiffPosition();
-	RedisplayChildren(diffpos, 0, cnt, alldiffs);
+	m_pListModel->InsertChildren(ctxt, m_pListModel->GetRowCount(), diffpos, 0, alldiffs);
+	m_pList->SetItemCountEx(m_pListModel->GetRowCount(), LVSICF_NOSCROLL);
 	if (pDoc->m_diffThread.GetThreadState() == CDiffThread::THREAD_COMPLETED)
 		GetParentFrame()->SetLastCompareResult(alldiffs);
 	SortColumnsAppropriately();
@@ -1022,9 +1005,16 @@ void CDirView::SortColumnsAppropriately()
 
 	bool bSortAscending = GetOptionsMgr()->GetBool(OPT_DIRVIEW_SORT_ASCENDING);
 	m_ctlSortHeader.SetSortImage(m_pColItems->ColLogToPhys(sortCol), bSortAscending);
-	//sort using static CompareFunc comparison function
-	CompareState cs(&GetDiffContext(), m_pColItems.get(), sortCol, bSortAscending, m_bTreeMode);
-	GetListCtrl().SortItems(cs.CompareFunc, reinterpret_cast<DWORD_PTR>(&cs));
+
+	std::vector<uintptr_t> selected;
+	uintptr_t focused;
+	SaveSelection(selected, focused);
+	const CDiffContext *pCtxt = &GetDiffContext();
+	const DirViewColItems *pColItems = m_pColItems.get();
+	m_pListModel->Sort(*pCtxt,
+		[pCtxt, pColItems, sortCol](const DIFFITEM &di, DirSortKey &key) { pColItems->ColGetSortKey(pCtxt, sortCol, di, key); },
+		bSortAscending);
+	RestoreSelection(selected, focused);
 
 	m_bNeedSearchLastDiffItem = true;
 	m_bNeedSearchFirstDiffItem = true;
@@ -1135,17 +1125,12 @@ void CDirView::CollapseSubdir(int sel)
 	m_pList->SetRedraw(FALSE);	// Turn off updating (better performance)
 
 	dip.customFlags1 &= ~ViewCustomFlags::EXPANDED;
-	m_pList->SetItemState(sel, INDEXTOSTATEIMAGEMASK(1), LVIS_STATEIMAGEMASK);
 
-	int count = m_pList->GetItemCount();
-	for (int i = sel + 1; i < count; i++)
-	{
-		const DIFFITEM& di = GetDiffItem(i);
-		if (!di.IsAncestor(&dip))
-			break;
-		m_pList->DeleteItem(i--);
-		count--;
-	}
+	std::vector<uintptr_t> selected;
+	uintptr_t focused;
+	SaveSelection(selected, focused);
+	m_pListModel->RemoveChildRows(sel);
+	RestoreSelection(selected, focused);
 
 	m_pList->SetRedraw(TRUE);	// Turn updating back on
 }
@@ -1161,17 +1146,19 @@ void CDirView::ExpandSubdir(int sel, bool bRecursive)
 		return;
 
 	m_pList->SetRedraw(FALSE);	// Turn off updating (better performance)
-	m_pList->SetItemState(sel, INDEXTOSTATEIMAGEMASK(2), LVIS_STATEIMAGEMASK);
 
 	CDiffContext &ctxt = GetDiffContext();
 	dip.customFlags1 |= ViewCustomFlags::EXPANDED;
 	if (bRecursive)
 		ExpandSubdirs(ctxt, dip);
 
+	std::vector<uintptr_t> selected;
+	uintptr_t focused;
+	SaveSelection(selected, focused);
 	uintptr_t diffpos = ctxt.GetFirstChildDiffPosition(GetItemKey(sel));
-	UINT indext = sel + 1;
-	int alldiffs;
-	RedisplayChildren(diffpos, dip.GetDepth() + 1, indext, alldiffs);
+	int alldiffs = 0;
+	m_pListModel->InsertChildren(ctxt, sel + 1, diffpos, dip.GetDepth() + 1, alldiffs);
+	RestoreSelection(selected, focused);
 
 	SortColumnsAppropriately();
 
@@ -1383,7 +1370,7 @@ void CDirView::OpenSelection(SELECTIONTYPE selectionType /*= SELECTIONTYPE_NORMA
 		for (int nIndex = 0; nIndex < paths.GetSize(); nIndex++)
 		{
 			fileloc[nIndex].setPath(paths[nIndex]);
-			fileloc[nIndex].encoding = pdi[nIndex]->diffFileInfo[nPane[nIndex]].encoding;
+			fileloc[nIndex].encoding = pdi[nIndex]->diffFileInfo[nPane[nIndex]].GetEncoding();
 		}
 		GetMainFrame()->ShowAutoMergeDoc(pDoc, paths.GetSize(), fileloc,
 			dwFlags, strDesc, _T(""), infoUnpacker);
@@ -1512,7 +1499,7 @@ void CDirView::OnUpdateCtxtDirCopyBothDiffsOnlyTo(CCmdUI* pCmdUI)
  */
 uintptr_t CDirView::GetItemKey(int idx) const
 {
-	return (uintptr_t) m_pList->GetItemData(idx);
+	return m_pListModel->GetDiffPos(idx);
 }
 
 // SetItemKey & GetItemKey encapsulate how the display list items
@@ -1553,6 +1540,7 @@ void CDirView::DeleteItem(int sel)
 {
 	if (m_bTreeMode)
 		CollapseSubdir(sel);
+	m_pListModel->RemoveRow(sel);
 	m_pList->DeleteItem(sel);
 }
 
@@ -1560,20 +1548,102 @@ void CDirView::DeleteAllDisplayItems()
 {
 	// item data are just positions (diffposes)
 	// that is, they contain no memory needing to be freed
+	m_pListModel->Clear();
 	m_pList->DeleteAllItems();
 }
 
 /**
  * @brief Given key, get index of item which has it stored.
- * This function searches from list in UI.
+ * This function searches from rows of the list.
  */
 int CDirView::GetItemIndex(uintptr_t key)
 {
-	LVFINDINFO findInfo;
+	return m_pListModel->FindRow(key);
+}
+
+/**
+ * @brief Get the keys of selected and focused items.
+ * Rows of the list keep their selection when rows are inserted, removed
+ * or sorted, so the items must be selected again after that.
+ * @param [out] selected Keys of selected items.
+ * @param [out] focused Key of focused item, 0 if none.
+ */
+void CDirView::SaveSelection(std::vector<uintptr_t> &selected, uintptr_t &focused) const
+{
+	selected.clear();
+	for (int sel = m_pList->GetNextItem(-1, LVNI_SELECTED); sel != -1; sel = m_pList->GetNextItem(sel, LVNI_SELECTED))
+		selected.push_back(GetItemKey(sel));
+	int sel = m_pList->GetNextItem(-1, LVNI_FOCUSED);
+	focused = (sel != -1) ? GetItemKey(sel) : 0;
+}
+
+/**
+ * @brief Update the list for the rows of the model and select items again.
+ * @param [in] selected Keys of items to select.
+ * @param [in] focused Key of item to focus, 0 if none.
+ */
+void CDirView::RestoreSelection(const std::vector<uintptr_t> &selected, uintptr_t focused)
+{
+	m_pList->SetItemCountEx(m_pListModel->GetRowCount(), LVSICF_NOSCROLL);
+	m_pList->SetItemState(-1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+	if (!selected.empty() || focused)
+	{
+		std::unordered_set<uintptr_t> keys(selected.begin(), selected.end());
+		const int count = m_pListModel->GetRowCount();
+		for (int i = 0; i < count; i++)
+		{
+			uintptr_t key = m_pListModel->GetDiffPos(i);
+			UINT state = 0;
+			if (keys.find(key) != keys.end())
+				state |= LVIS_SELECTED;
+			if (key == focused)
+				state |= LVIS_FOCUSED;
+			if (state)
+				m_pList->SetItemState(i, state, state);
+		}
+	}
+	m_pList->Invalidate();
+}
 
-	findInfo.flags = LVFI_PARAM;  // Search for itemdata
-	findInfo.lParam = (LPARAM)key;
-	return m_pList->FindItem(&findInfo);
+/**
+ * @brief Find a row by the text of its first column.
+ * The list asks for this when the user types the start of a name.
+ * @param [in] pFindItem What to find, and the row to start from.
+ * @return Index of the row, or -1 if not found.
+ */
+int CDirView::FindItemByText(const NMLVFINDITEM *pFindItem)
+{
+	const LVFINDINFO &findInfo = pFindItem->lvfi;
+	if (!(findInfo.flags & (LVFI_STRING | LVFI_PARTIAL)) || !findInfo.psz)
+		return -1;
+	const size_t len = _tcslen(findInfo.psz);
+	const int count = m_pListModel->GetRowCount();
+	const int col = m_pColItems->ColPhysToLog(0);
+	const bool bHasDiffs = GetDocument()->HasDiffs();
+	const CDiffContext *pCtxt = bHasDiffs ? &GetDiffContext() : nullptr;
+	int start = pFindItem->iStart;
+	if (start < 0 || start >= count)
+		start = 0;
+	for (int n = 0; n < count; n++)
+	{
+		int i = start + n;
+		if (i >= count)
+		{
+			if (!(findInfo.flags & LVFI_WRAP))
+				break;
+			i -= count;
+		}
+		uintptr_t key = m_pListModel->GetDiffPos(i);
+		String text;
+		if (key == SPECIAL_ITEM_POS)
+			text = m_pColItems->IsColName(col) ? _T("..") : _T("");
+		else if (pCtxt)
+			text = m_pColItems->ColGetTextToDisplay(pCtxt, col, pCtxt->GetDiffAt(key));
+		if ((findInfo.flags & LVFI_PARTIAL) ? _tcsnicmp(text.c_str(), findInfo.psz, len) == 0 :
+			_tcsicmp(text.c_str(), findInfo.psz) == 0)
+			return i;
+	}
+	return -1;
 }
 
 /**
@@ -2175,9 +2245,15 @@ LRESULT CDirView::OnUpdateUIMessage(WPARAM wParam, LPARAM lParam)
 
 		// If compare took more than TimeToSignalCompare seconds, notify user
 		clock_t elapsed = clock() - m_compareStart;
-		GetParentFrame()->SetMessageText(
-			strutils::format(_("Elapsed time: %ld ms").c_str(), elapsed).c_str()
-		);
+		const CompareStats *pCompareStats = pDoc->GetCompareStats();
+		String sMessage = strutils::format(_("Elapsed time: %ld ms").c_str(), elapsed) +
+			_T(" (") + strutils::format(_("%d items/s").c_str(), pCompareStats->GetComparedItemsPerSecond()) + _T(")");
+		if (pCompareStats->GetContentCacheHits() + pCompareStats->GetContentCacheMisses() > 0)
+		{
+			sMessage += _T(" (") + strutils::format(_("Content cache: %d hits, %d misses").c_str(),
+				pCompareStats->GetContentCacheHits(), pCompareStats->GetContentCacheMisses()) + _T(")");
+		}
+		GetParentFrame()->SetMessageText(sMessage.c_str());
 		if (elapsed > TimeToSignalCompare * CLOCKS_PER_SEC)
 			MessageBeep(IDOK);
 		GetMainFrame()->StartFlashing();
@@ -2228,6 +2304,9 @@ BOOL CDirView::OnChildNotify(UINT uMsg, WPARAM wParam, LPARAM lParam, LRESULT* p
 		case LVN_GETDISPINFO:
 			ReflectGetdispinfo((NMLVDISPINFO *)lParam);
 			return TRUE;
+		case LVN_ODFINDITEM:
+			*pResult = FindItemByText((NMLVFINDITEM *)lParam);
+			return TRUE;
 		case LVN_GETINFOTIPW:
 		case LVN_GETINFOTIPA:
 			return TRUE;
@@ -2474,14 +2553,15 @@ void CDirView::GetCurrentColRegKeys(std::vector<String>& colKeys)
 struct FileCmpReport: public IFileCmpReport
 {
 	explicit FileCmpReport(CDirView *pDirView) : m_pDirView(pDirView) {}
-	bool operator()(REPORT_TYPE nReportType, IListCtrl *pList, int nIndex, const String &sDestDir, String &sLinkPath)
+	bool operator()(REPORT_TYPE nReportType, uintptr_t diffpos, const String &sDestDir, String &sLinkPath)
 	{
 		const CDiffContext& ctxt = m_pDirView->GetDiffContext();
-		const DIFFITEM &di = m_pDirView->GetDiffItem(nIndex);
+		const DIFFITEM &di = ctxt.GetDiffAt(diffpos);
+		int nIndex = m_pDirView->GetItemIndex(diffpos);
 		
 		String sLinkFullPath = paths::ConcatPath(ctxt.GetLeftPath(), di.diffFileInfo[0].GetFile());
 
-		if (di.diffcode.isDirectory() || !IsItemNavigableDiff(ctxt, di) || IsArchiveFile(sLinkFullPath))
+		if (nIndex < 0 || di.diffcode.isDirectory() || !IsItemNavigableDiff(ctxt, di) || IsArchiveFile(sLinkFullPath))
 		{
 			sLinkPath.clear();
 			return false;
@@ -2519,6 +2599,48 @@ private:
 	CDirView *m_pDirView;
 };
 
+/**
+ * @brief Columns of folder compare reports, formatted like the view
+ * formats them.
+ */
+struct DirViewReportColumns: public IDirCmpReportColumns
+{
+	explicit DirViewReportColumns(const CDirView *pDirView) : m_pDirView(pDirView) {}
+	int GetColumnCount() const
+	{
+		return m_pDirView->m_pColItems->GetDispColCount();
+	}
+	String GetColumnName(int col) const
+	{
+		return m_pDirView->m_pColItems->GetColDisplayName(m_pDirView->m_pColItems->ColPhysToLog(col));
+	}
+	String GetItemText(const DIFFITEM &di, int col) const
+	{
+		return m_pDirView->m_pColItems->ColGetTextToDisplay(&m_pDirView->GetDiffContext(), m_pDirView->m_pColItems->ColPhysToLog(col), di);
+	}
+	int GetBackColor(const DIFFITEM &di) const
+	{
+		COLORREF clrBk, clrText;
+		m_pDirView->GetColors(di, clrBk, clrText);
+		return clrBk;
+	}
+	int GetIconIndex(const DIFFITEM &di) const
+	{
+		return GetColImage(m_pDirView->GetDiffContext(), di);
+	}
+	int GetIconCount() const
+	{
+		return m_pDirView->m_pIList->GetIconCount();
+	}
+	std::string GetIconPNGData(int iconIndex) const
+	{
+		return m_pDirView->m_pIList->GetIconPNGData(iconIndex);
+	}
+private:
+	DirViewReportColumns();
+	const CDirView *m_pDirView;
+};
+
 /**
  * @brief Generate report from dir compare results.
  */
@@ -2534,8 +2656,8 @@ void CDirView::OnToolsGenerateReport()
 
 	DirCmpReport report(colKeys);
 	FileCmpReport freport(this);
-	IListCtrlImpl list(m_pList->m_hWnd);
-	report.SetList(&list);
+	DirViewReportColumns columns(this);
+	report.SetItems(&ctxt, m_pListModel.get(), &columns);
 	PathContext paths = ctxt.GetNormalizedPaths();
 
 	// If inside archive, convert paths
@@ -2546,7 +2668,6 @@ void CDirView::OnToolsGenerateReport()
 	}
 
 	report.SetRootPaths(paths);
-	report.SetColumns(m_pColItems->GetDispColCount());
 	report.SetFileCmpReport(&freport);
 	report.SetReportFile(pDoc->GetReportFile());
 	String errStr;
@@ -2657,7 +2778,8 @@ int CDirView::AddSpecialItems()
  */
 void CDirView::AddParentFolderItem(bool bEnable)
 {
-	AddNewItem(0, SPECIAL_ITEM_POS, bEnable ? DIFFIMG_DIRUP : DIFFIMG_DIRUP_DISABLE, 0);
+	m_nSpecialItemImage = bEnable ? DIFFIMG_DIRUP : DIFFIMG_DIRUP_DISABLE;
+	m_pListModel->AddSpecialItem();
 }
 
 template <int flag>
@@ -3566,8 +3688,14 @@ void CDirView::OnBnClickedComparisonStop()
  */
 void CDirView::GetColors (int nRow, int nCol, COLORREF& clrBk, COLORREF& clrText) const
 {
-	const DIFFITEM& di = GetDiffItem (nRow);
+	GetColors(GetDiffItem(nRow), clrBk, clrText);
+}
 
+/**
+ * @brief Get colors of an item, depending on difference status
+ */
+void CDirView::GetColors (const DIFFITEM& di, COLORREF& clrBk, COLORREF& clrText) const
+{
 	if (di.isEmpty())
 	{
 		clrText = ::GetSysColor (COLOR_WINDOWTEXT);
@@ -3618,9 +3746,10 @@ void CDirView::OnSearch()
 				if (!ufile.OpenReadOnly(paths[i]))
 					continue;
 
-				ufile.SetUnicoding(di.diffFileInfo[i].encoding.m_unicoding);
-				ufile.SetBom(di.diffFileInfo[i].encoding.m_bom);
-				ufile.SetCodepage(di.diffFileInfo[i].encoding.m_codepage);
+				const FileTextEncoding& encoding = di.diffFileInfo[i].GetEncoding();
+				ufile.SetUnicoding(encoding.m_unicoding);
+				ufile.SetBom(encoding.m_bom);
+				ufile.SetCodepage(encoding.m_codepage);
 
 				ufile.ReadBom();
 
@@ -3723,49 +3852,6 @@ void CDirView::SetColAlignments()
 	}
 }
 
-CDirView::CompareState::CompareState(const CDiffContext *pCtxt, const DirViewColItems *pColItems, int sortCol, bool bSortAscending, bool bTreeMode)
-: pCtxt(pCtxt)
-, pColItems(pColItems)
-, sortCol(sortCol)
-, bSortAscending(bSortAscending)
-, bTreeMode(bTreeMode)
-{
-}
-
-/// Compare two specified rows during a sort operation (windows callback)
-int CALLBACK CDirView::CompareState::CompareFunc(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
-{
-	CompareState *pThis = reinterpret_cast<CompareState*>(lParamSort);
-	// Sort special items always first in dir view
-	if (lParam1 == -1)
-		return -1;
-	if (lParam2 == -1)
-		return 1;
-
-	uintptr_t diffposl = (uintptr_t)lParam1;
-	uintptr_t diffposr = (uintptr_t)lParam2;
-	const DIFFITEM &ldi = pThis->pCtxt->GetDiffAt(diffposl);
-	const DIFFITEM &rdi = pThis->pCtxt->GetDiffAt(diffposr);
-	// compare 'left' and 'right' parameters as appropriate
-	int retVal = pThis->pColItems->ColSort(pThis->pCtxt, pThis->sortCol, ldi, rdi, pThis->bTreeMode);
-	// return compare result, considering sort direction
-	return pThis->bSortAscending ? retVal : -retVal;
-}
-
-/// Add new item to list view
-int CDirView::AddNewItem(int i, uintptr_t diffpos, int iImage, int iIndent)
-{
-	LV_ITEM lvItem;
-	lvItem.mask = LVIF_TEXT | LVIF_PARAM | LVIF_IMAGE | LVIF_INDENT;
-	lvItem.iItem = i;
-	lvItem.iIndent = iIndent;
-	lvItem.iSubItem = 0;
-	lvItem.pszText = LPSTR_TEXTCALLBACK;
-	lvItem.lParam = (LPARAM)diffpos;
-	lvItem.iImage = iImage;
-	return GetListCtrl().InsertItem(&lvItem);
-}
-
 /**
  * @brief Update listview display of details for specified row
  * @note Customising shownd data should be done here
@@ -3802,18 +3888,31 @@ void CDirView::ReflectGetdispinfo(NMLVDISPINFO *pParam)
 	int nIdx = pParam->item.iItem;
 	int i = m_pColItems->ColPhysToLog(pParam->item.iSubItem);
 	uintptr_t key = GetItemKey(nIdx);
+	if (pParam->item.mask & LVIF_INDENT)
+	{
+		pParam->item.iIndent = m_pListModel->GetLevel(nIdx);
+	}
 	if (key == SPECIAL_ITEM_POS)
 	{
 		if (m_pColItems->IsColName(i))
 		{
 			pParam->item.pszText = _T("..");
 		}
+		if (pParam->item.mask & LVIF_IMAGE)
+		{
+			pParam->item.iImage = m_nSpecialItemImage;
+		}
 		return;
 	}
 	if (!GetDocument()->HasDiffs())
 		return;
 	const CDiffContext &ctxt = GetDiffContext();
 	const DIFFITEM &di = ctxt.GetDiffAt(key);
+	if ((pParam->item.mask & LVIF_STATE) && m_bTreeMode && di.HasChildren())
+	{
+		pParam->item.state = INDEXTOSTATEIMAGEMASK((di.customFlags1 & ViewCustomFlags::EXPANDED) ? 2 : 1);
+		pParam->item.stateMask = LVIS_STATEIMAGEMASK;
+	}
 	if (pParam->item.mask & LVIF_TEXT)
 	{
 		String s = m_pColItems->ColGetTextToDisplay(&ctxt, i, di);
@@ -33,6 +33,7 @@
 #include "UnicodeString.h"
 #include "DirItemIterator.h"
 #include "DirActions.h"
+#include "DirViewListModel.h"
 
 class FileActionScript;
 
@@ -55,11 +56,6 @@ class DirViewColItems;
 class DirItemEnumerator;
 struct IListCtrl;
 
-/**
- * @brief Position value for special items (..) in directory compare view.
- */
-const uintptr_t SPECIAL_ITEM_POS = (uintptr_t) - 1L;
-
 /** Default column width in directory compare */
 const UINT DefColumnWidth = 150;
 
@@ -70,13 +66,14 @@ const UINT DefColumnWidth = 150;
  * folder or file, commonly called as 'item') in one line. User can select
  * visible columns, re-order columns, sort by column etc.
  *
- * Actual data is stored in CDiffContext in CDirDoc. Dircompare items and
- * CDiffContext items are linked by storing POSITION of CDiffContext item
- * as CDirView listitem key.
+ * Actual data is stored in CDiffContext in CDirDoc. The list is a virtual
+ * list: DirViewListModel has the POSITION of the CDiffContext item shown
+ * in each row, which is the CDirView listitem key.
  */
 class CDirView : public CListView
 {
 	friend struct FileCmpReport;
+	friend struct DirViewReportColumns;
 	friend DirItemEnumerator;
 protected:
 	CDirView();           // protected constructor used by dynamic creation
@@ -96,7 +93,6 @@ public:
 
 	void StartCompare(CompareStats *pCompareStats);
 	void Redisplay();
-	void RedisplayChildren(uintptr_t diffpos, int level, UINT &index, int &alldiffs);
 	void UpdateResources();
 	void LoadColumnHeaderItems();
 	uintptr_t GetItemKey(int idx) const;
@@ -154,24 +150,13 @@ private:
 public:
 	void UpdateColumnNames();
 	void SetColAlignments();
-	// class CompareState is used to pass parameters to the PFNLVCOMPARE callback function.
-	class CompareState
-	{
-	private:
-		const DirViewColItems *const pColItems;
-		const CDiffContext *const pCtxt;
-		const int sortCol;
-		const bool bSortAscending;
-		const bool bTreeMode;
-	public:
-		CompareState(const CDiffContext *pCtxt, const DirViewColItems *pColItems, int sortCol, bool bSortAscending, bool bTreeMode);
-		static int CALLBACK CompareFunc(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
-	} friend;
 	void UpdateDiffItemStatus(UINT nIdx);
 private:
 	void InitiateSort();
 	void NameColumn(const char* idname, int subitem);
-	int AddNewItem(int i, uintptr_t diffpos, int iImage, int iIndent);
+	void SaveSelection(std::vector<uintptr_t> &selected, uintptr_t &focused) const;
+	void RestoreSelection(const std::vector<uintptr_t> &selected, uintptr_t focused);
+	int FindItemByText(const NMLVFINDITEM *pFindItem);
 // End DirViewCols.cpp
 
 private:
@@ -205,6 +190,8 @@ protected:
 	CImageList m_imageState;
 	CListCtrl *m_pList;
 	std::unique_ptr<IListCtrl> m_pIList;
+	std::unique_ptr<DirViewListModel> m_pListModel; /**< Rows shown in the list */
+	int m_nSpecialItemImage; /**< Image of the special item (..) */
 	bool m_bEscCloses; /**< Cached value for option for ESC closing window */
 	bool m_bExpandSubdirs;
 	CFont m_font; /**< User-selected font */
@@ -408,6 +395,7 @@ private:
 	void CollapseSubdir(int sel);
 	void ExpandSubdir(int sel, bool bRecursive = false);
 	void GetColors(int nRow, int nCol, COLORREF& clrBk, COLORREF& clrText) const;
+	void GetColors(const DIFFITEM& di, COLORREF& clrBk, COLORREF& clrText) const;
 public:
 	DirItemIterator Begin() const { return DirItemIterator(m_pIList.get()); }
 	DirItemIterator End() const { return DirItemIterator(); }
@@ -12,6 +12,7 @@
 #include "UnicodeString.h"
 #include "DiffItem.h"
 #include "DiffContext.h"
+#include "DirViewListModel.h"
 #include "locality.h"
 #include "paths.h"
 #include "MergeApp.h"
@@ -95,14 +96,6 @@ const char *COLDESC_NSDIFFS     = N_("Number of differences in file. This number
 const char *COLDESC_BINARY      = N_("Shows an asterisk (*) if the file is binary.");
 }
 
-/**
- * @brief Function to compare two int64_t's for a sort
- */
-static int cmp64(int64_t i1, int64_t i2)
-{
-	if (i1==i2) return 0;
-	return i1>i2 ? 1 : -1;
-}
 /**
  * @brief Convert int64_t to int sign
  */
@@ -113,21 +106,17 @@ static int sign64(int64_t val)
   return 0;
 }
 /**
- * @brief Function to compare two diffcodes for a sort
+ * @brief Function to get the sort key of a diffcode
+ * Different items come before same items, and folders before files.
  * @todo How shall we order diff statuses?
  */
-static unsigned cmpdiffcode(unsigned diffcode1, unsigned diffcode2)
+static int64_t diffcodekey(unsigned diffcode)
 {
 	// Lower priority of the same items (FIXME:)
-	if (((diffcode1 & DIFFCODE::COMPAREFLAGS) == DIFFCODE::SAME) && ((diffcode2 & DIFFCODE::COMPAREFLAGS) != DIFFCODE::SAME))
-		return -1;
-	if (((diffcode1 & DIFFCODE::COMPAREFLAGS) != DIFFCODE::SAME) && ((diffcode2 & DIFFCODE::COMPAREFLAGS) == DIFFCODE::SAME))
-		return 1;
-	if ((diffcode1 & DIFFCODE::DIR) && !(diffcode2 & DIFFCODE::DIR))
-		return 1;
-	if (!(diffcode1 & DIFFCODE::DIR) && (diffcode2 & DIFFCODE::DIR))
-		return -1;
-	return diffcode1-diffcode2;	
+	int64_t key = ((diffcode & DIFFCODE::COMPAREFLAGS) == DIFFCODE::SAME) ? 0 : 1;
+	key = (key << 1) | ((diffcode & DIFFCODE::DIR) ? 1 : 0);
+	key = (key << 32) | diffcode;
+	return -key;
 }
 /**
  * @brief Function to compare two doubles for a sort
@@ -610,7 +599,7 @@ static String ColAttrGet(const CDiffContext *, const void *p)
 static String ColEncodingGet(const CDiffContext *, const void *p)
 {
 	const DiffFileInfo &r = *static_cast<const DiffFileInfo *>(p);
-	return r.encoding.GetName();
+	return r.GetEncoding().GetName();
 }
 
 /**
@@ -623,7 +612,7 @@ static String GetEOLType(const CDiffContext *, const void *p, int index)
 {
 	const DIFFITEM &di = *static_cast<const DIFFITEM *>(p);
 	const DiffFileInfo & dfi = di.diffFileInfo[index];
-	const FileTextStats &stats = dfi.m_textStats;
+	const FileTextStats &stats = dfi.GetTextStats();
 
 	if (stats.ncrlfs == 0 && stats.ncrs == 0 && stats.nlfs == 0)
 	{
@@ -692,202 +681,158 @@ static String ColREOLTypeGet(const CDiffContext * pCtxt, const void *p)
  */
 
 /**
- * @name Functions to sort each type of column info.
+ * @name Functions to get sort keys of each type of column info.
  * These functions are used to sort information in folder compare GUI. Each
- * column info (type) has its own function to compare the data. Each
- * function receives three parameters:
+ * column info (type) has its own function to get the key the data is
+ * sorted by. Each function receives three parameters:
  * - pointer to compare context
- * - two parameters for data to compare (type varies)
- * Return value is -1, 0, or 1, where 0 means datas are identical.
+ * - parameter for data to get the key of (type varies)
+ * - key to set, keys are ordered by their number first and their text next
  */
 /* @{ */
 /**
- * @brief Compare file names.
+ * @brief Get sort key of file name, folders come first.
  * @param [in] pCtxt Pointer to compare context.
- * @param [in] p Pointer to DIFFITEM having first name to compare.
- * @param [in] q Pointer to DIFFITEM having second name to compare.
- * @return Compare result.
+ * @param [in] p Pointer to DIFFITEM having name.
+ * @param [out] key Sort key.
  */
-static int ColFileNameSort(const CDiffContext *pCtxt, const void *p, const void *q)
+static void ColFileNameSort(const CDiffContext *pCtxt, const void *p, DirSortKey &key)
 {
-	const DIFFITEM &ldi = *static_cast<const DIFFITEM *>(p);
-	const DIFFITEM &rdi = *static_cast<const DIFFITEM *>(q);
-	if (ldi.diffcode.isDirectory() && !rdi.diffcode.isDirectory())
-		return -1;
-	if (!ldi.diffcode.isDirectory() && rdi.diffcode.isDirectory())
-		return 1;
-	return strutils::compare_nocase(ColFileNameGet<boost::flyweight<String> >(pCtxt, p), ColFileNameGet<boost::flyweight<String> >(pCtxt, q));
+	const DIFFITEM &di = *static_cast<const DIFFITEM *>(p);
+	key.number = di.diffcode.isDirectory() ? 0 : 1;
+	key.text = ColFileNameGet<String>(pCtxt, p);
 }
 
 /**
- * @brief Compare file name extensions.
+ * @brief Get sort key of file name extension, folders come first.
  * @param [in] pCtxt Pointer to compare context.
- * @param [in] p First file name extension to compare.
- * @param [in] q Second file name extension to compare.
- * @return Compare result.
+ * @param [in] p Pointer to DIFFITEM having file name extension.
+ * @param [out] key Sort key.
  */
-static int ColExtSort(const CDiffContext *pCtxt, const void *p, const void *q)
+static void ColExtSort(const CDiffContext *pCtxt, const void *p, DirSortKey &key)
 {
-	const DIFFITEM &ldi = *static_cast<const DIFFITEM *>(p);
-	const DIFFITEM &rdi = *static_cast<const DIFFITEM *>(q);
-	if (ldi.diffcode.isDirectory() && !rdi.diffcode.isDirectory())
-		return -1;
-	if (!ldi.diffcode.isDirectory() && rdi.diffcode.isDirectory())
-		return 1;
-	return strutils::compare_nocase(ColExtGet(pCtxt, p), ColExtGet(pCtxt, q));
+	const DIFFITEM &di = *static_cast<const DIFFITEM *>(p);
+	key.number = di.diffcode.isDirectory() ? 0 : 1;
+	key.text = ColExtGet(pCtxt, p);
 }
 
 /**
- * @brief Compare folder names.
+ * @brief Get sort key of folder name.
  * @param [in] pCtxt Pointer to compare context.
- * @param [in] p Pointer to DIFFITEM having first folder name to compare.
- * @param [in] q Pointer to DIFFITEM having second folder name to compare.
- * @return Compare result.
+ * @param [in] p Pointer to DIFFITEM having folder name.
+ * @param [out] key Sort key.
  */
-static int ColPathSort(const CDiffContext *pCtxt, const void *p, const void *q)
+static void ColPathSort(const CDiffContext *pCtxt, const void *p, DirSortKey &key)
 {
-	return strutils::compare_nocase(ColPathGet(pCtxt, p), ColPathGet(pCtxt, q));
+	key.text = ColPathGet(pCtxt, p);
 }
 
 /**
- * @brief Compare compare results.
- * @param [in] p Pointer to DIFFITEM having first result to compare.
- * @param [in] q Pointer to DIFFITEM having second result to compare.
- * @return Compare result.
+ * @brief Get sort key of compare result.
+ * @param [in] p Pointer to DIFFITEM having result.
+ * @param [out] key Sort key.
  */
-static int ColStatusSort(const CDiffContext *, const void *p, const void *q)
+static void ColStatusSort(const CDiffContext *, const void *p, DirSortKey &key)
 {
-	const DIFFITEM &ldi = *static_cast<const DIFFITEM *>(p);
-	const DIFFITEM &rdi = *static_cast<const DIFFITEM *>(q);
-	return cmpdiffcode(rdi.diffcode.diffcode, ldi.diffcode.diffcode);
+	const DIFFITEM &di = *static_cast<const DIFFITEM *>(p);
+	key.number = diffcodekey(di.diffcode.diffcode);
 }
 
 /**
- * @brief Compare file times.
- * @param [in] p First time to compare.
- * @param [in] q Second time to compare.
- * @return Compare result.
+ * @brief Get sort key of file time.
+ * @param [in] p Time.
+ * @param [out] key Sort key.
  */
-static int ColTimeSort(const CDiffContext *, const void *p, const void *q)
+static void ColTimeSort(const CDiffContext *, const void *p, DirSortKey &key)
 {
-	const int64_t &r = *static_cast<const int64_t*>(p);
-	const int64_t &s = *static_cast<const int64_t*>(q);
-	return cmp64(r, s);
+	key.number = *static_cast<const int64_t*>(p);
 }
 
 /**
- * @brief Compare file sizes.
- * @param [in] p First size to compare.
- * @param [in] q Second size to compare.
- * @return Compare result.
+ * @brief Get sort key of file size.
+ * @param [in] p Size.
+ * @param [out] key Sort key.
  */
-static int ColSizeSort(const CDiffContext *, const void *p, const void *q)
+static void ColSizeSort(const CDiffContext *, const void *p, DirSortKey &key)
 {
-	const int64_t &r = *static_cast<const int64_t*>(p);
-	const int64_t &s = *static_cast<const int64_t*>(q);
-	return cmp64(r, s);
+	key.number = *static_cast<const int64_t*>(p);
 }
 
 /**
- * @brief Compare difference counts.
- * @param [in] p First count to compare.
- * @param [in] q Second count to compare.
- * @return Compare result.
+ * @brief Get sort key of difference count.
+ * @param [in] p Count.
+ * @param [out] key Sort key.
  */
-static int ColDiffsSort(const CDiffContext *, const void *p, const void *q)
+static void ColDiffsSort(const CDiffContext *, const void *p, DirSortKey &key)
 {
-	const int &r = *static_cast<const int*>(p);
-	const int &s = *static_cast<const int*>(q);
-	return r - s;
+	key.number = *static_cast<const int*>(p);
 }
 
 /**
- * @brief Compare newer/older statuses.
+ * @brief Get sort key of newer/older status.
  * @param [in] pCtxt Pointer to compare context.
- * @param [in] p Pointer to DIFFITEM having first status to compare.
- * @param [in] q Pointer to DIFFITEM having second status to compare.
- * @return Compare result.
+ * @param [in] p Pointer to DIFFITEM having status.
+ * @param [out] key Sort key.
  */
-static int ColNewerSort(const CDiffContext *pCtxt, const void *p, const void *q)
+static void ColNewerSort(const CDiffContext *pCtxt, const void *p, DirSortKey &key)
 {
-	return ColNewerGet(pCtxt, p) == ColNewerGet(pCtxt, q);
+	key.text = ColNewerGet(pCtxt, p);
 }
 
 /**
- * @brief Compare left-side file versions.
+ * @brief Get sort key of left-side file version.
  * @param [in] pCtxt Pointer to compare context.
- * @param [in] p Pointer to DIFFITEM having first version to compare.
- * @param [in] q Pointer to DIFFITEM having second version to compare.
- * @return Compare result.
+ * @param [in] p Pointer to DIFFITEM having version.
+ * @param [out] key Sort key.
  */
-static int ColLversionSort(const CDiffContext *pCtxt, const void *p, const void *q)
+static void ColLversionSort(const CDiffContext *pCtxt, const void *p, DirSortKey &key)
 {
-	return ColLversionGet(pCtxt, p) == ColLversionGet(pCtxt, q);
+	key.text = ColLversionGet(pCtxt, p);
 }
 
 /**
- * @brief Compare right-side file versions.
+ * @brief Get sort key of right-side file version.
  * @param [in] pCtxt Pointer to compare context.
- * @param [in] p Pointer to DIFFITEM having first version to compare.
- * @param [in] q Pointer to DIFFITEM having second version to compare.
- * @return Compare result.
+ * @param [in] p Pointer to DIFFITEM having version.
+ * @param [out] key Sort key.
  */
-static int ColRversionSort(const CDiffContext *pCtxt, const void *p, const void *q)
+static void ColRversionSort(const CDiffContext *pCtxt, const void *p, DirSortKey &key)
 {
-	return ColRversionGet(pCtxt, p) == ColRversionGet(pCtxt, q);
+	key.text = ColRversionGet(pCtxt, p);
 }
 
 /**
- * @brief Compare binary statuses.
- * This function returns a comparison of binary results.
- * @param [in] p Pointer to DIFFITEM having first status to compare.
- * @param [in] q Pointer to DIFFITEM having second status to compare.
- * @return Compare result:
- * - if both items are text files or binary files: 0
- * - if left is text and right is binary: -1
- * - if left is binary and right is text: 1
+ * @brief Get sort key of binary status, text files come first.
+ * @param [in] p Pointer to DIFFITEM having status.
+ * @param [out] key Sort key.
  */
-static int ColBinSort(const CDiffContext *, const void *p, const void *q)
+static void ColBinSort(const CDiffContext *, const void *p, DirSortKey &key)
 {
-	const DIFFITEM &ldi = *static_cast<const DIFFITEM *>(p);
-	const DIFFITEM &rdi = *static_cast<const DIFFITEM *>(q);
-	const bool i = ldi.diffcode.isBin();
-	const bool j = rdi.diffcode.isBin();
-
-	if (!i && !j)
-		return 0;
-	else if (i && !j)
-		return 1;
-	else if (!i && j)
-		return -1;
-	else
-		return 0;
+	const DIFFITEM &di = *static_cast<const DIFFITEM *>(p);
+	key.number = di.diffcode.isBin() ? 1 : 0;
 }
 
 /**
- * @brief Compare file flags.
- * @param [in] p Pointer to first flag structure to compare.
- * @param [in] q Pointer to second flag structure to compare.
- * @return Compare result.
+ * @brief Get sort key of file flags.
+ * @param [in] p Pointer to flag structure.
+ * @param [out] key Sort key.
  */
-static int ColAttrSort(const CDiffContext *, const void *p, const void *q)
+static void ColAttrSort(const CDiffContext *, const void *p, DirSortKey &key)
 {
 	const FileFlags &r = *static_cast<const FileFlags *>(p);
-	const FileFlags &s = *static_cast<const FileFlags *>(q);
-	return r.ToString() == s.ToString();
+	key.text = r.ToString();
 }
 
 /**
- * @brief Compare file encodings.
- * @param [in] p Pointer to first structure to compare.
- * @param [in] q Pointer to second structure to compare.
- * @return Compare result.
+ * @brief Get sort key of file encoding.
+ * @param [in] p Pointer to file information.
+ * @param [out] key Sort key.
  */
-static int ColEncodingSort(const CDiffContext *, const void *p, const void *q)
+static void ColEncodingSort(const CDiffContext *, const void *p, DirSortKey &key)
 {
 	const DiffFileInfo &r = *static_cast<const DiffFileInfo *>(p);
-	const DiffFileInfo &s = *static_cast<const DiffFileInfo *>(q);
-	return FileTextEncoding::Collate(r.encoding, s.encoding);
+	const FileTextEncoding &encoding = r.GetEncoding();
+	key.number = (static_cast<int64_t>(encoding.m_unicoding) << 32) + encoding.m_codepage;
 }
 /* @} */
 
@@ -900,7 +845,7 @@ static int ColEncodingSort(const CDiffContext *, const void *p, const void *q)
  *  - name resource ID: column's name shown in header
  *  - description resource ID: columns description text
  *  - custom function for getting column data
- *  - custom function for sorting column data
+ *  - custom function for getting sort key of column data
  *  - parameter for custom functions: DIFFITEM (if NULL) or one of its fields
  *  - default column order number, -1 if not shown by default
  *  - ascending (TRUE) or descending (FALSE) default sort order
@@ -966,9 +911,9 @@ static DirColInfo f_cols3[] =
 	{ _T("Rencoding"), COLHDR_RENCODING, COLDESC_RENCODING, &ColEncodingGet, &ColEncodingSort, FIELD_OFFSET(DIFFITEM, diffFileInfo[2]), -1, true, DirColInfo::ALIGN_LEFT },
 	{ _T("Snsdiffs"), COLHDR_NSDIFFS, COLDESC_NSDIFFS, ColDiffsGet, ColDiffsSort, FIELD_OFFSET(DIFFITEM, nsdiffs), -1, false, DirColInfo::ALIGN_RIGHT },
 	{ _T("Snidiffs"), COLHDR_NIDIFFS, COLDESC_NIDIFFS, ColDiffsGet, ColDiffsSort, FIELD_OFFSET(DIFFITEM, nidiffs), -1, false, DirColInfo::ALIGN_RIGHT },
-	{ _T("Leoltype"), COLHDR_LEOL_TYPE, COLDESC_LEOL_TYPE, &ColLEOLTypeGet, &ColAttrSort, 0, -1, true, DirColInfo::ALIGN_LEFT },
-	{ _T("Meoltype"), COLHDR_MEOL_TYPE, COLDESC_MEOL_TYPE, &ColMEOLTypeGet, &ColAttrSort, 0, -1, true, DirColInfo::ALIGN_LEFT },
-	{ _T("Reoltype"), COLHDR_REOL_TYPE, COLDESC_REOL_TYPE, &ColREOLTypeGet, &ColAttrSort, 0, -1, true, DirColInfo::ALIGN_LEFT },
+	{ _T("Leoltype"), COLHDR_LEOL_TYPE, COLDESC_LEOL_TYPE, &ColLEOLTypeGet, 0, 0, -1, true, DirColInfo::ALIGN_LEFT },
+	{ _T("Meoltype"), COLHDR_MEOL_TYPE, COLDESC_MEOL_TYPE, &ColMEOLTypeGet, 0, 0, -1, true, DirColInfo::ALIGN_LEFT },
+	{ _T("Reoltype"), COLHDR_REOL_TYPE, COLDESC_REOL_TYPE, &ColREOLTypeGet, 0, 0, -1, true, DirColInfo::ALIGN_LEFT },
 };
 
 /**
@@ -1241,68 +1186,33 @@ DirViewColItems::ColGetTextToDisplay(const CDiffContext *pCtxt, int col,
 
 
 /**
- * @brief Sort two items on specified column.
- * This function determines order of two items in specified column. Order
- * is determined by column-specific functions.
+ * @brief Get the key an item is sorted by in specified column.
+ * Keys are given by column-specific functions. Columns having no such
+ * function are sorted by the text shown.
  * @param [in] pCtxt Compare context.
  * @param [in] col Column number to sort.
- * @param [in] ldi Left difference item data.
- * @param [in] rdi Right difference item data.
- * @return Order of items.
+ * @param [in] di Difference item data.
+ * @param [out] key Sort key of the item.
  */
-int
-DirViewColItems::ColSort(const CDiffContext *pCtxt, int col, const DIFFITEM & ldi,
-		const DIFFITEM & rdi, bool bTreeMode) const
+void
+DirViewColItems::ColGetSortKey(const CDiffContext *pCtxt, int col, const DIFFITEM & di, DirSortKey &key) const
 {
-	// Custom properties have custom sort functions
 	const DirColInfo * pColInfo = GetDirColInfo(col);
 	if (!pColInfo)
 	{
 		assert(0); // fix caller, should not ask for nonexistent columns
-		return 0;
-	}
-	size_t offset = pColInfo->offset;
-	const void * arg1;
-	const void * arg2;
-	if (bTreeMode)
-	{
-		int lLevel = ldi.GetDepth();
-		int rLevel = rdi.GetDepth();
-		const DIFFITEM *lcur = &ldi, *rcur = &rdi;
-		if (lLevel < rLevel)
-		{
-			for (; lLevel != rLevel; rLevel--)
-				rcur = rcur->parent;
-		}
-		else if (rLevel < lLevel)
-		{
-			for (; lLevel != rLevel; lLevel--)
-				lcur = lcur->parent;
-		}
-		while (lcur->parent != rcur->parent)
-		{
-			lcur = lcur->parent;
-			rcur = rcur->parent;
-		}
-		arg1 = reinterpret_cast<const char *>(lcur) + offset;
-		arg2 = reinterpret_cast<const char *>(rcur) + offset;
-	}
-	else
-	{
-		arg1 = reinterpret_cast<const char *>(&ldi) + offset;
-		arg2 = reinterpret_cast<const char *>(&rdi) + offset;
+		return;
 	}
+	const void * arg = reinterpret_cast<const char *>(&di) + pColInfo->offset;
 	if (ColSortFncPtrType fnc = pColInfo->sortfnc)
 	{
-		return (*fnc)(pCtxt, arg1, arg2);
+		(*fnc)(pCtxt, arg, key);
+		return;
 	}
 	if (ColGetFncPtrType fnc = pColInfo->getfnc)
 	{
-		String p = (*fnc)(pCtxt, arg1);
-		String q = (*fnc)(pCtxt, arg2);
-		return strutils::compare_nocase(p, q);
+		key.text = (*fnc)(pCtxt, arg);
 	}
-	return 0;
 }
 
 void DirViewColItems::SetColumnOrdering(const int colorder[])
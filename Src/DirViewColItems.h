@@ -12,11 +12,12 @@
 #include <sstream>
 
 struct DIFFITEM;
+struct DirSortKey;
 class CDiffContext;
 
 // DirViewColItems typedefs
 typedef String (*ColGetFncPtrType)(const CDiffContext *, const void *);
-typedef int (*ColSortFncPtrType)(const CDiffContext *, const void *, const void *);
+typedef void (*ColSortFncPtrType)(const CDiffContext *, const void *, DirSortKey &);
 
 
 /**
@@ -35,7 +36,7 @@ struct DirColInfo
 	const char *idName; /**< Displayed name, ID of string resource */
 	const char *idDesc; /**< Description, ID of string resource */
 	ColGetFncPtrType getfnc; /**< Handler giving display string */
-	ColSortFncPtrType sortfnc; /**< Handler for sorting this column */
+	ColSortFncPtrType sortfnc; /**< Handler giving sort key */
 	size_t offset;
 	int physicalIndex; /**< Current physical index, -1 if not displayed */
 	bool defSortUp; /**< Does column start with ascending sort (most do) */
@@ -66,7 +67,7 @@ public:
 	int	GetColCount() const;
 	int GetDispColCount() const { return m_dispcols; }
 	String ColGetTextToDisplay(const CDiffContext *pCtxt, int col, const DIFFITEM & di) const;
-	int ColSort(const CDiffContext *pCtxt, int col, const DIFFITEM & ldi, const DIFFITEM &rdi, bool bTreeMode) const;
+	void ColGetSortKey(const CDiffContext *pCtxt, int col, const DIFFITEM & di, DirSortKey &key) const;
 
 	int ColPhysToLog(int i) const { return m_invcolorder[i]; }
 	int ColLogToPhys(int i) const { return m_colorder[i]; } /**< -1 if not displayed */
@@ -0,0 +1,324 @@
+/**
+ *  @file DirViewListModel.cpp
+ *
+ *  @brief Implementation of DirViewListModel
+ */
+
+#include "DirViewListModel.h"
+#include <algorithm>
+#include <unordered_map>
+#include "DiffItemList.h"
+
+/**
+ * @brief Constructor.
+ */
+DirViewListModel::DirViewListModel()
+: m_bTreeMode(false)
+, m_bRecursive(false)
+, m_nDirs(2)
+{
+}
+
+/**
+ * @brief Set how items are shown.
+ * @param [in] bTreeMode Are folders shown as a tree?
+ * @param [in] bRecursive Was the compare recursive? Folders existing on all
+ *  sides are not shown in flat mode of recursive compares.
+ * @param [in] nDirs Count of compared folders.
+ */
+void DirViewListModel::SetMode(bool bTreeMode, bool bRecursive, int nDirs)
+{
+	m_bTreeMode = bTreeMode;
+	m_bRecursive = bRecursive;
+	m_nDirs = nDirs;
+}
+
+/**
+ * @brief Set functions telling which items are shown.
+ * @param [in] isShowable Is item shown with current filters? All items are
+ *  shown if empty.
+ * @param [in] isExpanded Is folder expanded in tree mode? No folder is
+ *  expanded if empty.
+ */
+void DirViewListModel::SetPredicates(ItemPredicate isShowable, ItemPredicate isExpanded)
+{
+	m_isShowable = isShowable;
+	m_isExpanded = isExpanded;
+}
+
+/**
+ * @brief Remove all rows.
+ */
+void DirViewListModel::Clear()
+{
+	std::vector<Row>().swap(m_rows);
+}
+
+/**
+ * @brief Add the special item (..) as the first row.
+ */
+void DirViewListModel::AddSpecialItem()
+{
+	Row row = { SPECIAL_ITEM_POS, 0 };
+	m_rows.insert(m_rows.begin(), row);
+}
+
+/**
+ * @brief Insert rows for items and their shown children.
+ * @param [in] list List of compared items.
+ * @param [in] row Index of the first row to insert.
+ * @param [in] diffpos First item to insert, its siblings follow it.
+ * @param [in] level Indent level of the items.
+ * @param [in,out] alldiffs Incremented for each different item walked.
+ * @return Count of rows inserted.
+ */
+int DirViewListModel::InsertChildren(const DiffItemList &list, int row, uintptr_t diffpos, int level, int &alldiffs)
+{
+	const bool bAppend = (row == GetRowCount());
+	std::vector<Row> rows;
+	std::vector<Row> &dest = bAppend ? m_rows : rows;
+	WalkChildren(list, diffpos, level, [&dest](uintptr_t pos, int lvl)
+		{
+			Row r = { pos, lvl };
+			dest.push_back(r);
+		}, alldiffs);
+	if (bAppend)
+		return GetRowCount() - row;
+	m_rows.insert(m_rows.begin() + row, rows.begin(), rows.end());
+	return static_cast<int>(rows.size());
+}
+
+/**
+ * @brief Walk items and their shown children.
+ * @param [in] list List of compared items.
+ * @param [in] diffpos First item to walk, its siblings follow it.
+ * @param [in] level Indent level of the items.
+ * @param [in] func Called for each item which is shown, in the order of
+ *  the rows before sorting.
+ * @param [in,out] alldiffs Incremented for each different item walked.
+ */
+void DirViewListModel::WalkChildren(const DiffItemList &list, uintptr_t diffpos, int level, const RowFunc &func, int &alldiffs) const
+{
+	while (diffpos)
+	{
+		uintptr_t curdiffpos = diffpos;
+		const DIFFITEM &di = list.GetNextSiblingDiffPosition(diffpos);
+
+		if (di.diffcode.isResultDiff() || (!di.diffcode.existAll(m_nDirs) && !di.diffcode.isResultFiltered()))
+			++alldiffs;
+
+		if (m_isShowable && !m_isShowable(di))
+			continue;
+		if (m_bTreeMode)
+		{
+			func(curdiffpos, level);
+			if (di.HasChildren() && m_isExpanded && m_isExpanded(di))
+				WalkChildren(list, list.GetFirstChildDiffPosition(curdiffpos), level + 1, func, alldiffs);
+		}
+		else
+		{
+			if (!m_bRecursive || !di.diffcode.isDirectory() || !di.diffcode.existAll(m_nDirs))
+				func(curdiffpos, 0);
+			if (di.HasChildren())
+				WalkChildren(list, list.GetFirstChildDiffPosition(curdiffpos), level + 1, func, alldiffs);
+		}
+	}
+}
+
+/**
+ * @brief Remove the rows of the children of a folder.
+ * @param [in] row Index of the row of the folder.
+ * @return Count of rows removed, they followed the folder.
+ */
+int DirViewListModel::RemoveChildRows(int row)
+{
+	const int level = m_rows[row].level;
+	size_t end = row + 1;
+	while (end < m_rows.size() && m_rows[end].level > level)
+		++end;
+	m_rows.erase(m_rows.begin() + row + 1, m_rows.begin() + end);
+	return static_cast<int>(end - row - 1);
+}
+
+/**
+ * @brief Remove one row.
+ * @param [in] row Index of the row.
+ */
+void DirViewListModel::RemoveRow(int row)
+{
+	m_rows.erase(m_rows.begin() + row);
+}
+
+/**
+ * @brief Sort the rows.
+ * The special item stays first. In tree mode, children are sorted among
+ * themselves and stay after their parent folder. Rows having equal keys
+ * keep their order.
+ * @param [in] list List of compared items.
+ * @param [in] getKey Function giving the sort key of an item.
+ * @param [in] bAscending Sort in ascending order?
+ */
+void DirViewListModel::Sort(const DiffItemList &list, const SortKeyFunc &getKey, bool bAscending)
+{
+	size_t first = 0;
+	while (first < m_rows.size() && m_rows[first].diffpos == SPECIAL_ITEM_POS)
+		++first;
+	const int count = static_cast<int>(m_rows.size() - first);
+	if (count < 2)
+		return;
+
+	// Get the key of each row once. Equal texts are stored once, and
+	// are then replaced by their rank among all texts.
+	std::vector<int64_t> numbers(count);
+	std::vector<int> ranks(count);
+	{
+		std::unordered_map<String, int> textIndex;
+		std::vector<const String *> texts;
+		DirSortKey key;
+		for (int i = 0; i < count; ++i)
+		{
+			key.number = 0;
+			key.text.clear();
+			getKey(list.GetDiffAt(m_rows[first + i].diffpos), key);
+			numbers[i] = key.number;
+			std::pair<std::unordered_map<String, int>::iterator, bool> result =
+				textIndex.insert(std::make_pair(std::move(key.text), static_cast<int>(texts.size())));
+			if (result.second)
+				texts.push_back(&result.first->first);
+			ranks[i] = result.first->second;
+		}
+
+		std::vector<int> order(texts.size());
+		for (size_t j = 0; j < order.size(); ++j)
+			order[j] = static_cast<int>(j);
+		std::sort(order.begin(), order.end(), [&texts](int a, int b)
+			{ return strutils::compare_nocase(*texts[a], *texts[b]) < 0; });
+		std::vector<int> textRanks(texts.size());
+		int rank = 0;
+		for (size_t j = 0; j < order.size(); ++j)
+		{
+			if (j > 0 && strutils::compare_nocase(*texts[order[j - 1]], *texts[order[j]]) != 0)
+				++rank;
+			textRanks[order[j]] = rank;
+		}
+		for (int i = 0; i < count; ++i)
+			ranks[i] = textRanks[ranks[i]];
+	}
+
+	std::vector<int> order(count);
+	for (int i = 0; i < count; ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&numbers, &ranks, bAscending](int a, int b)
+		{
+			if (numbers[a] != numbers[b])
+				return bAscending ? numbers[a] < numbers[b] : numbers[a] > numbers[b];
+			return bAscending ? ranks[a] < ranks[b] : ranks[a] > ranks[b];
+		});
+
+	// Find the parent row of each row, -1 for top level rows. Rows of
+	// children follow the row of their folder and have a greater level.
+	std::vector<int> parents(count);
+	std::vector<int> path;
+	for (int i = 0; i < count; ++i)
+	{
+		const int level = m_rows[first + i].level;
+		while (!path.empty() && m_rows[first + path.back()].level >= level)
+			path.pop_back();
+		parents[i] = path.empty() ? -1 : path.back();
+		path.push_back(i);
+	}
+
+	// Children of each row in sorted order, the top level rows first
+	std::vector<int> childStart(count + 2, 0);
+	for (int i = 0; i < count; ++i)
+		++childStart[parents[i] + 2];
+	for (int i = 2; i < count + 2; ++i)
+		childStart[i] += childStart[i - 1];
+	std::vector<int> children(count);
+	for (int i = 0; i < count; ++i)
+		children[childStart[parents[order[i]] + 1]++] = order[i];
+
+	// Now childStart[p + 1] is the end of the children of row p and
+	// childStart[p] is their start. Emit the rows depth first.
+	std::vector<Row> rows(m_rows.begin(), m_rows.begin() + first);
+	rows.reserve(m_rows.size());
+	std::vector<int> pending;
+	for (int k = childStart[0]; k-- > 0; )
+		pending.push_back(children[k]);
+	while (!pending.empty())
+	{
+		const int i = pending.back();
+		pending.pop_back();
+		rows.push_back(m_rows[first + i]);
+		for (int k = childStart[i + 1]; k-- > childStart[i]; )
+			pending.push_back(children[k]);
+	}
+	m_rows.swap(rows);
+}
+
+/**
+ * @brief Get the position of the item in a row.
+ * @param [in] row Index of the row.
+ * @return Position of the item, SPECIAL_ITEM_POS for the special item,
+ *  or 0 if there is no such row.
+ */
+uintptr_t DirViewListModel::GetDiffPos(int row) const
+{
+	if (row < 0 || row >= GetRowCount())
+		return 0;
+	return m_rows[row].diffpos;
+}
+
+/**
+ * @brief Get the indent level of a row.
+ * @param [in] row Index of the row.
+ */
+int DirViewListModel::GetLevel(int row) const
+{
+	if (row < 0 || row >= GetRowCount())
+		return 0;
+	return m_rows[row].level;
+}
+
+/**
+ * @brief Find the row of an item.
+ * @param [in] diffpos Position of the item.
+ * @return Index of the row, or -1 if the item is not shown.
+ */
+int DirViewListModel::FindRow(uintptr_t diffpos) const
+{
+	for (size_t i = 0; i < m_rows.size(); ++i)
+	{
+		if (m_rows[i].diffpos == diffpos)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+/**
+ * @brief Call a function for the item in each row, in display order.
+ * The special item is skipped.
+ * @param [in] func Called with the position and the indent level of items.
+ */
+void DirViewListModel::ForEachRow(const RowFunc &func) const
+{
+	for (size_t i = 0; i < m_rows.size(); ++i)
+	{
+		if (m_rows[i].diffpos != SPECIAL_ITEM_POS)
+			func(m_rows[i].diffpos, m_rows[i].level);
+	}
+}
+
+/**
+ * @brief Call a function for each item that would be shown, without
+ * building rows.
+ * Items are walked in compare order, like the rows before sorting, so that
+ * all items can be visited in constant memory.
+ * @param [in] list List of compared items.
+ * @param [in] func Called with the position and the indent level of items.
+ */
+void DirViewListModel::WalkItems(const DiffItemList &list, const RowFunc &func) const
+{
+	int alldiffs = 0;
+	WalkChildren(list, list.GetFirstDiffPosition(), 0, func, alldiffs);
+}
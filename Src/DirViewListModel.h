@@ -0,0 +1,87 @@
+/**
+ *  @file DirViewListModel.h
+ *
+ *  @brief Declaration of DirViewListModel
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "UnicodeString.h"
+
+struct DIFFITEM;
+class DiffItemList;
+
+/**
+ * @brief Position value for special items (..) in directory compare view.
+ */
+const uintptr_t SPECIAL_ITEM_POS = (uintptr_t) - 1L;
+
+/**
+ * @brief Sort key of an item in one column.
+ * Keys are ordered by the number first and by the text, compared
+ * case-insensitively, next.
+ */
+struct DirSortKey
+{
+	int64_t number; /**< Compared first */
+	String text; /**< Compared if numbers are equal */
+};
+
+/**
+ * @brief Rows shown in the folder compare list.
+ *
+ * The folder compare list is a virtual list, which asks the view for the
+ * texts of the rows it draws. This class holds what the list shows: the
+ * position of the item and its indent level in each row. Rows are built
+ * by walking the compare tree once, and parts of them are removed and
+ * inserted when folders are collapsed and expanded in tree mode.
+ *
+ * Sorting computes the key of each row once, and the texts of the keys
+ * are ranked once, so that the rows are then sorted by comparing numbers
+ * only. In tree mode children are sorted among themselves and follow
+ * their parent folder.
+ */
+class DirViewListModel
+{
+public:
+	typedef std::function<bool(const DIFFITEM &)> ItemPredicate;
+	typedef std::function<void(const DIFFITEM &, DirSortKey &)> SortKeyFunc;
+	typedef std::function<void(uintptr_t diffpos, int level)> RowFunc;
+
+	DirViewListModel();
+	void SetMode(bool bTreeMode, bool bRecursive, int nDirs);
+	void SetPredicates(ItemPredicate isShowable, ItemPredicate isExpanded);
+
+	void Clear();
+	void AddSpecialItem();
+	int InsertChildren(const DiffItemList &list, int row, uintptr_t diffpos, int level, int &alldiffs);
+	int RemoveChildRows(int row);
+	void RemoveRow(int row);
+	void Sort(const DiffItemList &list, const SortKeyFunc &getKey, bool bAscending);
+
+	int GetRowCount() const { return static_cast<int>(m_rows.size()); }
+	uintptr_t GetDiffPos(int row) const;
+	int GetLevel(int row) const;
+	int FindRow(uintptr_t diffpos) const;
+	void ForEachRow(const RowFunc &func) const;
+	void WalkItems(const DiffItemList &list, const RowFunc &func) const;
+
+private:
+	/** @brief Item shown in a row. */
+	struct Row
+	{
+		uintptr_t diffpos; /**< Position of the item, or SPECIAL_ITEM_POS */
+		int level; /**< Indent level, 0 in flat mode */
+	};
+
+	void WalkChildren(const DiffItemList &list, uintptr_t diffpos, int level, const RowFunc &func, int &alldiffs) const;
+
+	std::vector<Row> m_rows; /**< Rows in display order */
+	bool m_bTreeMode; /**< Are folders shown as a tree? */
+	bool m_bRecursive; /**< Was the compare recursive? */
+	int m_nDirs; /**< Count of compared folders */
+	ItemPredicate m_isShowable; /**< Is item shown with current filters? */
+	ItemPredicate m_isExpanded; /**< Is folder expanded in tree mode? */
+};
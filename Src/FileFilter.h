@@ -26,6 +26,7 @@
 #define POCO_NO_UNWINDOWS 1
 #include <Poco/RegularExpression.h>
 #include "UnicodeString.h"
+#include "FileNameMatcher.h"
 
 /**
  * @brief FileFilter rule.
@@ -66,6 +67,8 @@ struct FileFilter
 	String fullpath;		/**< Full path to filter file */
 	std::vector<FileFilterElementPtr> filefilters; /**< List of rules for files */
 	std::vector<FileFilterElementPtr> dirfilters;  /**< List of rules for directories */
+	FileNameMatcher filematcher; /**< Rules for files, compiled for matching */
+	FileNameMatcher dirmatcher; /**< Rules for directories, compiled for matching */
 	FileFilter() : default_include(true) { }
 	~FileFilter();
 	
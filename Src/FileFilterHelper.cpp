@@ -22,7 +22,7 @@
 
 #include "FileFilterHelper.h"
 #include "UnicodeString.h"
-#include "FilterList.h"
+#include "FileNameMatcher.h"
 #include "DirItem.h"
 #include "FileFilterMgr.h"
 #include "paths.h"
@@ -177,7 +177,7 @@ void FileFilterHelper::UseMask(bool bUseMask)
 	{
 		if (m_pMaskFilter == NULL)
 		{
-			m_pMaskFilter.reset(new FilterList);
+			m_pMaskFilter.reset(new FileNameMatcher(FileNameMatcher::MASK));
 		}
 	}
 	else
@@ -197,12 +197,14 @@ void FileFilterHelper::SetMask(const String& strMask)
 		throw "Filter mask tried to set when masks disabled!";
 	}
 	m_sMask = strMask;
-	String regExp = ParseExtensions(strMask);
-
-	std::string regexp_str = ucr::toUTF8(regExp);
-
-	m_pMaskFilter->RemoveAllFilters();
-	m_pMaskFilter->AddRegExp(regexp_str);
+	vector<String> masks;
+	bool bMatchAll = ParseExtensions(strMask, masks);
+
+	m_pMaskFilter->Clear();
+	for (vector<String>::const_iterator it = masks.begin(); it != masks.end(); ++it)
+		m_pMaskFilter->AddMask(*it);
+	if (bMatchAll)
+		m_pMaskFilter->AddMask(_T("*"));
 }
 
 /**
@@ -220,15 +222,9 @@ bool FileFilterHelper::includeFile(const String& szFileName) const
 			throw "Use mask set, but no filter rules for mask!";
 		}
 
-		// preprend a backslash if there is none
-		String strFileName = strutils::makelower(szFileName);
-		if (strFileName.empty() || strFileName[0] != '\\')
-			strFileName = _T("\\") + strFileName;
-		// append a point if there is no extension
-		if (strFileName.find('.') == String::npos)
-			strFileName = strFileName + _T(".");
-
-		return m_pMaskFilter->Match(ucr::toUTF8(strFileName));
+		// The matcher compares in lower case, with a backslash prepended
+		// if there is none and a point appended if there is no extension
+		return m_pMaskFilter->Match(szFileName);
 	}
 	else
 	{
@@ -276,18 +272,20 @@ void FileFilterHelper::LoadFileFilterDirPattern(const String& dir, const String&
 }
 
 /** 
- * @brief Convert user-given extension list to valid regular expression.
- * @param [in] Extension list/mask to convert to regular expression.
- * @return Regular expression that matches extension list.
+ * @brief Split user-given extension list to masks.
+ * @param [in] extensions Extension list/mask to split.
+ * @param [out] masks Masks of the list (e.g. *.cpp).
+ * @return true if the list matches everything: it has no masks, or it ends
+ *  with a separator, which used to add an empty alternative to the regular
+ *  expression the list was converted to.
  */
-String FileFilterHelper::ParseExtensions(const String &extensions) const
+bool FileFilterHelper::ParseExtensions(const String &extensions, vector<String>& masks) const
 {
-	String strParsed;
-	String strPattern;
 	String ext(extensions);
-	bool bFilterAdded = false;
 	static const TCHAR pszSeps[] = _T(" ;|,:");
 
+	masks.clear();
+	String::size_type lastSep = ext.find_last_of(pszSeps);
 	ext += _T(";"); // Add one separator char to end
 	size_t pos = ext.find_first_of(pszSeps);
 	
@@ -296,39 +294,13 @@ String FileFilterHelper::ParseExtensions(const String &extensions) const
 		String token = ext.substr(0, pos); // Get first extension
 		ext = ext.substr(pos + 1); // Remove extension + separator
 		
-		// Only "*." or "*.something" allowed, other ignored
 		if (token.length() >= 1)
-		{
-			bFilterAdded = true;
-			String strRegex = token;
-			strutils::replace(strRegex, _T("."), _T("\\."));
-			strutils::replace(strRegex, _T("?"), _T("."));
-			strutils::replace(strRegex, _T("("), _T("\\("));
-			strutils::replace(strRegex, _T(")"), _T("\\)"));
-			strutils::replace(strRegex, _T("["), _T("\\["));
-			strutils::replace(strRegex, _T("]"), _T("\\]"));
-			strutils::replace(strRegex, _T("$"), _T("\\$"));
-			strutils::replace(strRegex, _T("*"), _T(".*"));
-			strRegex += _T("$");
-			strPattern += _T("(^|\\\\)") + strRegex;
-		}
-		else
-			bFilterAdded = false;
+			masks.push_back(token);
 
 		pos = ext.find_first_of(pszSeps); 
-		if (bFilterAdded && pos != String::npos && extensions.length() > 1)
-			strPattern += _T("|");
 	}
 
-	if (strPattern.empty())
-		strParsed = _T(".*"); // Match everything
-	else
-	{
-
-		strPattern = strutils::makelower(strPattern);
-		strParsed = strPattern; //+ _T("$");
-	}
-	return strParsed;
+	return masks.empty() || (lastSep != String::npos && lastSep == extensions.length() - 1);
 }
 
 /** 
@@ -27,7 +27,7 @@
 #include "DirItem.h"
 
 class FileFilterMgr;
-class FilterList;
+class FileNameMatcher;
 struct FileFilter;
 
 /**
@@ -147,10 +147,10 @@ public:
 	bool includeDir(const String& szDirName) const;
 
 protected:
-	String ParseExtensions(const String &extensions) const;
+	bool ParseExtensions(const String &extensions, std::vector<String>& masks) const;
 
 private:
-	std::unique_ptr<FilterList> m_pMaskFilter;       /*< Filter for filemasks (*.cpp) */
+	std::unique_ptr<FileNameMatcher> m_pMaskFilter;       /*< Filter for filemasks (*.cpp) */
 	FileFilter * m_currentFilter;     /*< Currently selected filefilter */
 	std::unique_ptr<FileFilterMgr> m_fileFilterMgr;  /*< Associated FileFilterMgr */
 	String m_sFileFilterPath;        /*< Path to current filter */
@@ -35,7 +35,7 @@ using Poco::Glob;
 using Poco::icompare;
 using Poco::RegularExpression;
 
-static void AddFilterPattern(vector<FileFilterElementPtr> *filterList, String & str);
+static void AddFilterPattern(vector<FileFilterElementPtr> *filterList, FileNameMatcher *matcher, String & str);
 
 /**
  * @brief Destructor, frees all filters.
@@ -134,9 +134,10 @@ void FileFilterMgr::DeleteAllFilters()
  * @brief Add a single pattern (if nonempty & valid) to a pattern list.
  *
  * @param [in] filterList List where pattern is added.
+ * @param [in] matcher Matcher where pattern is added.
  * @param [in] str Temporary variable (ie, it may be altered)
  */
-static void AddFilterPattern(vector<FileFilterElementPtr> *filterList, String & str)
+static void AddFilterPattern(vector<FileFilterElementPtr> *filterList, FileNameMatcher *matcher, String & str)
 {
 	const String& commentLeader = _T("##"); // Starts comment
 	str = strutils::trim_ws_begin(str);
@@ -163,6 +164,7 @@ static void AddFilterPattern(vector<FileFilterElementPtr> *filterList, String &
 	try
 	{
 		filterList->push_back(FileFilterElementPtr(new FileFilterElement(regexString, re_opts)));
+		matcher->AddRegExp(regexString);
 	}
 	catch (...)
 	{
@@ -235,13 +237,13 @@ FileFilter * FileFilterMgr::LoadFilterFile(const String& szFilepath, int & error
 		{
 			// file filter
 			String str = sLine.substr(2);
-			AddFilterPattern(&pfilter->filefilters, str);
+			AddFilterPattern(&pfilter->filefilters, &pfilter->filematcher, str);
 		}
 		else if (0 == sLine.compare(0, 2, _T("d:"), 2))
 		{
 			// directory filter
 			String str = sLine.substr(2);
-			AddFilterPattern(&pfilter->dirfilters, str);
+			AddFilterPattern(&pfilter->dirfilters, &pfilter->dirmatcher, str);
 		}
 	} while (bLinesLeft);
 
@@ -317,7 +319,7 @@ bool FileFilterMgr::TestFileNameAgainstFilter(const FileFilter * pFilter,
 {
 	if (!pFilter)
 		return true;
-	if (TestAgainstRegList(&pFilter->filefilters, szFileName))
+	if (pFilter->filematcher.Match(szFileName))
 		return !pFilter->default_include;
 	return pFilter->default_include;
 }
@@ -338,7 +340,7 @@ bool FileFilterMgr::TestDirNameAgainstFilter(const FileFilter * pFilter,
 {
 	if (!pFilter)
 		return true;
-	if (TestAgainstRegList(&pFilter->dirfilters, szDirName))
+	if (pFilter->dirmatcher.Match(szDirName))
 		return !pFilter->default_include;
 	return pFilter->default_include;
 }
@@ -0,0 +1,356 @@
+/**
+ * @file  FileNameMatcher.cpp
+ *
+ * @brief Implementation file for FileNameMatcher class.
+ */
+
+#include "FileNameMatcher.h"
+#include <cstring>
+#include "unicoder.h"
+
+using Poco::RegularExpression;
+
+/**
+ * @brief Constructor.
+ * @param [in] syntax Syntax of the rules to add.
+ */
+FileNameMatcher::FileNameMatcher(Syntax syntax)
+: m_syntax(syntax)
+, m_bInvalid(false)
+{
+	Clear();
+}
+
+/**
+ * @brief Destructor.
+ */
+FileNameMatcher::~FileNameMatcher()
+{
+}
+
+/**
+ * @brief Remove all rules.
+ */
+void FileNameMatcher::Clear()
+{
+	Node root = { 0, -1, -1, false, false };
+	m_nodes.assign(1, root);
+	m_globs.clear();
+	m_regexps.clear();
+	m_bInvalid = false;
+}
+
+/**
+ * @brief Add a rule of a filter file.
+ * The rule is matched case-insensitively, like the rules of filter files
+ * are. Rules consisting of literal text and a trailing $ (and optionally a
+ * leading ^) are added to the trie, others are compiled.
+ * @param [in] regularExpression Regular expression in UTF-8.
+ * @throw Poco::RegularExpressionException if the expression is invalid.
+ */
+void FileNameMatcher::AddRegExp(const std::string& regularExpression)
+{
+	String literal;
+	bool bWhole;
+	if (ParseLiteral(regularExpression, literal, bWhole))
+		AddSuffix(literal, bWhole);
+	else
+		m_regexps.push_back(std::unique_ptr<RegularExpression>(new RegularExpression(
+			regularExpression, RegularExpression::RE_CASELESS | RegularExpression::RE_UTF8)));
+}
+
+/**
+ * @brief Add a file mask.
+ * In a mask, * matches any text and ? any character. Masks without
+ * wildcards and masks with only a leading * are added to the trie, masks
+ * with other wildcards are matched as glob patterns. The few masks having
+ * characters with a special meaning in regular expressions (like + and \)
+ * are converted to regular expressions as they always have been.
+ * If such a mask is invalid, nothing matches anymore, like when the
+ * masks were compiled to one regular expression.
+ * @param [in] mask Mask to add, empty masks are ignored.
+ */
+void FileNameMatcher::AddMask(const String& mask)
+{
+	String lower;
+	for (String::const_iterator it = mask.begin(); it != mask.end(); ++it)
+		lower += Fold(*it);
+	if (lower.empty())
+		return;
+
+	if (lower.find_first_of(_T("\\^+{}")) != String::npos)
+	{
+		String regexp = _T("(^|\\\\)");
+		for (String::const_iterator it = lower.begin(); it != lower.end(); ++it)
+		{
+			switch (*it)
+			{
+			case '.': case '(': case ')': case '[': case ']': case '$':
+				regexp += '\\';
+				regexp += *it;
+				break;
+			case '?':
+				regexp += '.';
+				break;
+			case '*':
+				regexp += _T(".*");
+				break;
+			default:
+				regexp += *it;
+				break;
+			}
+		}
+		regexp += '$';
+		try
+		{
+			m_regexps.push_back(std::unique_ptr<RegularExpression>(new RegularExpression(
+				ucr::toUTF8(regexp), RegularExpression::RE_UTF8)));
+		}
+		catch (...)
+		{
+			m_bInvalid = true;
+		}
+	}
+	else if (lower.find_first_of(_T("*?")) == String::npos)
+	{
+		AddSuffix(_T("\\") + lower, false);
+		AddSuffix(lower, true);
+	}
+	else if (lower[0] == '*' && lower.find_first_of(_T("*?"), 1) == String::npos)
+		AddSuffix(lower.substr(1), false);
+	else
+		m_globs.push_back(lower);
+}
+
+/**
+ * @brief Check if any rule matches a name.
+ * @param [in] name File or directory name to test.
+ * @return true if a rule matches.
+ */
+bool FileNameMatcher::Match(const String& name) const
+{
+	if (m_bInvalid)
+		return false;
+
+	Text text = { name.c_str(), name.length(), false, false };
+	if (m_syntax == MASK)
+	{
+		text.bPrefix = name.empty() || name[0] != '\\';
+		text.bSuffix = name.find('.') == String::npos;
+	}
+
+	if (MatchSuffixes(text))
+		return true;
+
+	for (std::vector<String>::const_iterator it = m_globs.begin(); it != m_globs.end(); ++it)
+	{
+		if (MatchGlob(*it, text, 0))
+			return true;
+		// A leading * matches at the start whenever it matches after a backslash
+		if ((*it)[0] == '*')
+			continue;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			if (text[i] == '\\' && MatchGlob(*it, text, i + 1))
+				return true;
+		}
+	}
+
+	if (m_regexps.empty())
+		return false;
+
+	std::string compString;
+	if (m_syntax == MASK)
+	{
+		String str;
+		str.reserve(text.size());
+		for (size_t i = 0; i < text.size(); ++i)
+			str += Fold(text[i]);
+		ucr::toUTF8(str, compString);
+	}
+	else
+		ucr::toUTF8(name, compString);
+	for (size_t i = 0; i < m_regexps.size(); ++i)
+	{
+		RegularExpression::Match match;
+		try
+		{
+			if (m_regexps[i]->match(compString, 0, match) > 0)
+				return true;
+		}
+		catch (...)
+		{
+			// TODO:
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Fold a character of a name or rule to the case the rules compare.
+ */
+TCHAR FileNameMatcher::Fold(TCHAR c) const
+{
+	if (m_syntax == MASK)
+		return static_cast<TCHAR>(_totlower(c));
+	// PCRE folds only the single other case of a character, so a rule
+	// character in ASCII matches only the ASCII letters of both cases
+	return (c >= 'A' && c <= 'Z') ? static_cast<TCHAR>(c - 'A' + 'a') : c;
+}
+
+/**
+ * @brief Add a suffix to the trie.
+ * @param [in] suffix Suffix, already folded.
+ * @param [in] bWhole If true the name must equal the suffix.
+ */
+void FileNameMatcher::AddSuffix(const String& suffix, bool bWhole)
+{
+	int node = 0;
+	for (size_t i = suffix.length(); i-- > 0; )
+	{
+		TCHAR c = suffix[i];
+		int next = m_nodes[node].child;
+		while (next >= 0 && m_nodes[next].ch != c)
+			next = m_nodes[next].sibling;
+		if (next < 0)
+		{
+			Node child = { c, -1, m_nodes[node].child, false, false };
+			next = static_cast<int>(m_nodes.size());
+			m_nodes.push_back(child);
+			m_nodes[node].child = next;
+		}
+		node = next;
+	}
+	if (bWhole)
+		m_nodes[node].bWhole = true;
+	else
+		m_nodes[node].bSuffix = true;
+}
+
+/**
+ * @brief Check if a suffix in the trie matches a name.
+ * The trie is walked from the end of the name towards its start.
+ */
+bool FileNameMatcher::MatchSuffixes(const Text& text) const
+{
+	const Node *node = &m_nodes[0];
+	if (node->bSuffix || (node->bWhole && text.size() == 0))
+		return true;
+	for (size_t i = text.size(); i-- > 0; )
+	{
+		TCHAR c = Fold(text[i]);
+		int next = node->child;
+		while (next >= 0 && m_nodes[next].ch != c)
+			next = m_nodes[next].sibling;
+		if (next < 0)
+			return false;
+		node = &m_nodes[next];
+		if (node->bSuffix || (node->bWhole && i == 0))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Check if a glob pattern matches the end of a name.
+ * When a character after a * doesn't match, the * is made to match one
+ * more character; earlier *s never need to match more, so the time is
+ * bounded by the product of the lengths.
+ * @param [in] glob Glob pattern, already folded.
+ * @param [in] text Name to test.
+ * @param [in] start Index where the pattern must start matching.
+ */
+bool FileNameMatcher::MatchGlob(const String& glob, const Text& text, size_t start) const
+{
+	const size_t n = text.size();
+	const size_t m = glob.length();
+	size_t p = 0, t = start;
+	size_t starP = String::npos, starT = 0;
+	while (t < n)
+	{
+		if (p < m && glob[p] == '*')
+		{
+			starP = p++;
+			starT = t;
+		}
+		else if (p < m && glob[p] == '?')
+		{
+			t += CharLength(text, t);
+			++p;
+		}
+		else if (p < m && glob[p] == Fold(text[t]))
+		{
+			++t;
+			++p;
+		}
+		else if (starP != String::npos)
+		{
+			starT += CharLength(text, starT);
+			t = starT;
+			p = starP + 1;
+		}
+		else
+			return false;
+	}
+	while (p < m && glob[p] == '*')
+		++p;
+	return p == m;
+}
+
+/**
+ * @brief Get the count of code units of the character at an index.
+ * Regular expressions match UTF-8, where a surrogate pair of UTF-16 is
+ * one character.
+ */
+size_t FileNameMatcher::CharLength(const Text& text, size_t i)
+{
+	unsigned c = static_cast<unsigned>(text[i]);
+	if (c >= 0xD800 && c <= 0xDBFF && i + 1 < text.size())
+	{
+		unsigned c2 = static_cast<unsigned>(text[i + 1]);
+		if (c2 >= 0xDC00 && c2 <= 0xDFFF)
+			return 2;
+	}
+	return 1;
+}
+
+/**
+ * @brief Parse a rule consisting of literal text followed by $.
+ * Letters are folded to lower case. Rules with characters outside ASCII
+ * are not parsed, as PCRE may fold them differently.
+ * @param [in] regularExpression Regular expression in UTF-8.
+ * @param [out] literal Literal text of the rule.
+ * @param [out] bWhole true if the rule starts with ^.
+ * @return true if the rule is literal text followed by $.
+ */
+bool FileNameMatcher::ParseLiteral(const std::string& regularExpression, String& literal, bool& bWhole)
+{
+	size_t i = 0;
+	size_t n = regularExpression.length();
+	bWhole = n > 0 && regularExpression[0] == '^';
+	if (bWhole)
+		i = 1;
+	if (n == i || regularExpression[n - 1] != '$')
+		return false;
+	--n;
+	literal.clear();
+	while (i < n)
+	{
+		unsigned char c = static_cast<unsigned char>(regularExpression[i++]);
+		if (c == '\\')
+		{
+			// A backslash makes other characters than letters and digits literal
+			if (i == n)
+				return false;
+			c = static_cast<unsigned char>(regularExpression[i++]);
+			if (c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
+				return false;
+		}
+		else if (c >= 0x80 || c == 0 || strchr(".^$|?*+()[]{}", c) != NULL)
+			return false;
+		if (c >= 'A' && c <= 'Z')
+			c = static_cast<unsigned char>(c - 'A' + 'a');
+		literal += static_cast<TCHAR>(c);
+	}
+	return true;
+}
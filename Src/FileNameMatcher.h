@@ -0,0 +1,99 @@
+/**
+ * @file  FileNameMatcher.h
+ *
+ * @brief Declaration file for FileNameMatcher class.
+ */
+#pragma once
+
+#include <vector>
+#include <memory>
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/RegularExpression.h>
+#include "UnicodeString.h"
+
+/**
+ * @brief Matches file and directory names against a compiled set of rules.
+ *
+ * The rules are either the regular expressions of a filter file or the
+ * masks (*.cpp etc) of a mask list, and a name matches if any rule matches.
+ * The rules are compiled once to:
+ * - a trie of the reversed literal suffixes, which covers extension masks
+ *   (*.cpp) and filter rules like \.obj$ and \\CVS$; one walk from the end
+ *   of the name checks all of them,
+ * - a list of glob patterns for other masks with * and ? only,
+ * - a list of regular expressions for everything else.
+ * Only the last needs the name converted to UTF-8; the others read the
+ * name as it is given, without allocating memory.
+ *
+ * Filter file rules are matched like PCRE matches them with RE_CASELESS
+ * and RE_UTF8. Masks are matched like the regular expression
+ * (^|\\)mask$ matches the name in lower case, with a backslash prepended
+ * if there is none and a dot appended if there is no extension.
+ * File names can't contain line breaks, so the special meaning of $ and .
+ * for them is not replicated.
+ */
+class FileNameMatcher
+{
+public:
+	/** @brief Syntax of the rules of a matcher. */
+	enum Syntax
+	{
+		REGEXP, /**< Regular expressions of filter files */
+		MASK, /**< File masks */
+	};
+
+	explicit FileNameMatcher(Syntax syntax = REGEXP);
+	~FileNameMatcher();
+
+	void Clear();
+	void AddRegExp(const std::string& regularExpression);
+	void AddMask(const String& mask);
+	bool Match(const String& name) const;
+
+private:
+	/** @brief Node of the trie of reversed suffixes. */
+	struct Node
+	{
+		TCHAR ch; /**< Character leading to the node */
+		int child; /**< First child, or -1 */
+		int sibling; /**< Next child of the parent, or -1 */
+		bool bSuffix; /**< Name ending with the path to the node matches */
+		bool bWhole; /**< Name equal to the path to the node matches */
+	};
+
+	/** @brief Name as the rules see it. */
+	struct Text
+	{
+		const TCHAR *name;
+		size_t length;
+		bool bPrefix; /**< Backslash prepended? */
+		bool bSuffix; /**< Dot appended? */
+		size_t size() const { return length + bPrefix + bSuffix; }
+		TCHAR operator[](size_t i) const
+		{
+			if (bPrefix)
+			{
+				if (i == 0)
+					return '\\';
+				--i;
+			}
+			return i < length ? name[i] : '.';
+		}
+	};
+
+	TCHAR Fold(TCHAR c) const;
+	void AddSuffix(const String& suffix, bool bWhole);
+	bool MatchSuffixes(const Text& text) const;
+	bool MatchGlob(const String& glob, const Text& text, size_t start) const;
+	static bool ParseLiteral(const std::string& regularExpression, String& literal, bool& bWhole);
+	static size_t CharLength(const Text& text, size_t i);
+
+	FileNameMatcher(const FileNameMatcher&);
+	FileNameMatcher& operator=(const FileNameMatcher&);
+
+	Syntax m_syntax; /**< Syntax of the rules */
+	bool m_bInvalid; /**< An invalid rule was added, nothing matches */
+	std::vector<Node> m_nodes; /**< Trie of reversed suffixes, root first */
+	std::vector<String> m_globs; /**< Masks matched as glob patterns */
+	std::vector<std::unique_ptr<Poco::RegularExpression>> m_regexps; /**< Other rules */
+};
@@ -5,17 +5,21 @@
  */
 
 #include "FilterList.h"
+#include <cctype>
+#include <cstring>
 #include <vector>
 #include <Poco/RegularExpression.h>
 #include "unicoder.h"
 
 using Poco::RegularExpression;
+using Poco::FastMutex;
 
 /** 
  * @brief Constructor.
  */
  FilterList::FilterList()
-: m_lastMatchExpression(NULL)
+: m_bCompiled(true)
+, m_lastMatchExpression(NULL)
 {
 }
 
@@ -27,10 +31,12 @@ FilterList::~FilterList()
 	RemoveAllFilters();
 }
 
-/** 
+/**
  * @brief Add new regular expression to the list.
  * This function adds new regular expression to the list of expressions.
  * The regular expression is compiled and studied for better performance.
+ * The list is sorted for matching when it is matched next, so that adding
+ * many expressions doesn't sort it again for each.
  * @param [in] regularExpression Regular expression string.
  * @param [in] encoding Expression encoding.
  */
@@ -43,7 +49,9 @@ void FilterList::AddRegExp(const std::string& regularExpression)
 	catch (...)
 	{
 		// TODO:
+		return;
 	}
+	m_bCompiled = false;
 }
 
 /** 
@@ -52,6 +60,12 @@ void FilterList::AddRegExp(const std::string& regularExpression)
 void FilterList::RemoveAllFilters()
 {
 	m_list.clear();
+	m_anchored.reset();
+	m_anchoredList.clear();
+	m_otherList.clear();
+	m_literals.Clear();
+	m_lastMatchExpression = NULL;
+	m_bCompiled = true;
 }
 
 /** 
@@ -74,51 +88,414 @@ bool FilterList::HasRegExps() const
  */
 bool FilterList::Match(const std::string& string, int codepage/*=CP_UTF8*/)
 {
-	bool retval = false;
-	const size_t count = m_list.size();
+	if (!m_bCompiled)
+		Compile();
+	if (codepage == ucr::CP_UTF_8)
+		return MatchUTF8(string);
 
 	// convert string into UTF-8
 	ucr::buffer buf(string.length() * 2);
+	ucr::convert(ucr::NONE, codepage, reinterpret_cast<const unsigned char *>(string.c_str()), 
+			string.length(), ucr::UTF8, ucr::CP_UTF_8, &buf);
+	if (buf.size == 0)
+		return MatchUTF8(string);
+	return MatchUTF8(std::string(reinterpret_cast<const char *>(buf.ptr), buf.size));
+}
+
+/** 
+ * @brief Returns the last matched expression (if any).
+ * This function returns the regular expression string that matched last.
+ * @return Last matched expression, or NULL in case no matches yet.
+ */
+const char * FilterList::GetLastMatchExpression() const
+{
+	return m_lastMatchExpression ? m_lastMatchExpression->c_str() : NULL;
+}
+
+/**
+ * @brief Check if expression keeps its meaning as a part of an alternation.
+ * Expressions are combined as (?:expr1)|(?:expr2)|... which changes the
+ * numbers of capturing groups, and lets some constructs see past the end
+ * of one expression. Such expressions are matched separately.
+ * @param [in] regularExpression Regular expression string.
+ * @return true if the expression can be combined with others.
+ */
+bool FilterList::CanCombine(const std::string& regularExpression)
+{
+	// Backreferences, subroutine calls and recursion, named groups (names
+	// must be unique), \Q (may quote the closing parenthesis), comments of
+	// extended mode and leading (*VERB)s
+	static const RegularExpression uncombinable(
+		"\\\\[1-9gkQ]|\\(\\?[-+]?[0-9R&]|\\(\\?P?<[A-Za-z_]|\\(\\?'|\\(\\?P[>=]|\\(\\?[a-zA-Z]*x|^\\(\\*");
+	RegularExpression::Match match;
+	return uncombinable.match(regularExpression, 0, match) == 0;
+}
 
-	if (codepage != ucr::CP_UTF_8)
-			ucr::convert(ucr::NONE, codepage, reinterpret_cast<const unsigned char *>(string.c_str()), 
-					string.length(), ucr::UTF8, ucr::CP_UTF_8, &buf);
+/**
+ * @brief Find end of a character class.
+ * @param [in] re Regular expression string.
+ * @param [in] i Index of the opening bracket.
+ * @return Index after the closing bracket, or npos if there is none.
+ */
+static size_t SkipClass(const std::string& re, size_t i)
+{
+	++i;
+	if (i < re.length() && re[i] == '^')
+		++i;
+	// A closing bracket first in the class is a literal
+	if (i < re.length() && re[i] == ']')
+		++i;
+	while (i < re.length() && re[i] != ']')
+	{
+		if (re[i] == '\\')
+			++i;
+		else if (re[i] == '[' && i + 1 < re.length() && re[i + 1] == ':')
+		{
+			size_t end = re.find(":]", i + 2);
+			if (end != std::string::npos)
+				i = end + 1;
+		}
+		++i;
+	}
+	return i < re.length() ? i + 1 : std::string::npos;
+}
 
-	unsigned i = 0;
-	while (i < count && retval == false)
+/**
+ * @brief Find end of a group.
+ * @param [in] re Regular expression string.
+ * @param [in] i Index of the opening parenthesis.
+ * @return Index after the closing parenthesis, or npos if there is none.
+ */
+static size_t SkipGroup(const std::string& re, size_t i)
+{
+	int depth = 0;
+	while (i < re.length())
 	{
-		const filter_item_ptr& item = m_list[i];
-		int result = 0;
+		switch (re[i])
+		{
+		case '\\':
+			i += 2;
+			continue;
+		case '[':
+			i = SkipClass(re, i);
+			if (i == std::string::npos)
+				return i;
+			continue;
+		case '(':
+			++depth;
+			break;
+		case ')':
+			if (--depth == 0)
+				return i + 1;
+			break;
+		}
+		++i;
+	}
+	return std::string::npos;
+}
+
+/**
+ * @brief Check if a quantifier starts at given index.
+ * @param [in] re Regular expression string.
+ * @param [in] i Index to check.
+ * @return Length of the quantifier, or 0 if there is none.
+ */
+static size_t QuantifierLength(const std::string& re, size_t i)
+{
+	size_t len = 0;
+	if (i >= re.length())
+		return 0;
+	if (re[i] == '?' || re[i] == '*' || re[i] == '+')
+		len = 1;
+	else if (re[i] == '{')
+	{
+		// {n}, {n,} or {n,m}, other braces are literals
+		static const RegularExpression quantifier("^\\{[0-9]+(,[0-9]*)?\\}");
 		RegularExpression::Match match;
-		try
+		if (quantifier.match(re.substr(i, 32), 0, match) == 0)
+			return 0;
+		len = match.length;
+	}
+	else
+		return 0;
+	// Lazy or possessive quantifier
+	if (i + len < re.length() && (re[i + len] == '?' || re[i + len] == '+'))
+		++len;
+	return len;
+}
+
+/**
+ * @brief Check if expression can match only at the start of the string.
+ * @param [in] regularExpression Regular expression string.
+ * @return true if the expression starts with ^ or \A, possibly after
+ *  option settings, and has no alternatives at the top level.
+ */
+bool FilterList::IsAnchored(const std::string& regularExpression)
+{
+	const std::string& re = regularExpression;
+	size_t i = 0;
+	// Option settings like (?i)
+	while (re.compare(i, 2, "(?") == 0)
+	{
+		size_t j = i + 2;
+		while (j < re.length() && (isalpha(static_cast<unsigned char>(re[j])) || re[j] == '-'))
+			++j;
+		if (j >= re.length() || re[j] != ')')
+			break;
+		i = j + 1;
+	}
+	if (re.compare(i, 1, "^") != 0 && re.compare(i, 2, "\\A") != 0)
+		return false;
+	while (i < re.length())
+	{
+		switch (re[i])
 		{
-			if (buf.size > 0)
-				result = item->regexp.match(std::string(reinterpret_cast<const char *>(buf.ptr), buf.size), 0, match);
+		case '\\':
+			i += 2;
+			continue;
+		case '[':
+			i = SkipClass(re, i);
+			break;
+		case '(':
+			i = SkipGroup(re, i);
+			break;
+		case '|':
+			return false;
+		default:
+			++i;
+			break;
+		}
+		if (i == std::string::npos)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Find literal text that all matches of an expression contain.
+ * The expression is parsed conservatively: its longest run of literal
+ * characters at the top level is returned, without characters made
+ * optional by quantifiers. Groups and classes end runs.
+ * @param [in] regularExpression Regular expression string.
+ * @return The literal text, or empty string if none was found, or if the
+ *  expression has alternatives at the top level or is case-insensitive.
+ */
+std::string FilterList::GetRequiredLiteral(const std::string& regularExpression)
+{
+	const std::string& re = regularExpression;
+	// Case-insensitive and extended mode expressions are not parsed
+	static const RegularExpression unparsed("\\(\\?[a-zA-Z-]*[ix]");
+	RegularExpression::Match match;
+	if (unparsed.match(re, 0, match) > 0)
+		return "";
+
+	std::string best, run;
+	size_t i = 0;
+	while (i < re.length())
+	{
+		size_t atom = run.length(); // Where last atom starts in run
+		bool literal = false;
+		unsigned char c = static_cast<unsigned char>(re[i]);
+		switch (c)
+		{
+		case '\\':
+			if (i + 1 >= re.length())
+				return "";
+			c = static_cast<unsigned char>(re[i + 1]);
+			if (isalnum(c))
+			{
+				// Character types and assertions end runs, escapes
+				// with arguments are not parsed
+				if (strchr("dDwWsSbBAzZGhHvVRX", c) == NULL)
+					return "";
+			}
 			else
-				result = item->regexp.match(string, 0, match);
+			{
+				run += static_cast<char>(c);
+				literal = true;
+			}
+			i += 2;
+			break;
+		case '[':
+			i = SkipClass(re, i);
+			break;
+		case '(':
+			i = SkipGroup(re, i);
+			break;
+		case ')':
+		case '|':
+			return "";
+		case '.':
+		case '^':
+		case '$':
+			++i;
+			break;
+		default:
+			if (QuantifierLength(re, i) > 0)
+				return ""; // quantifier without atom
+			// Copy UTF-8 sequences whole, quantifiers apply to them
+			do
+			{
+				run += re[i++];
+			} while (i < re.length() && (re[i] & 0xC0) == 0x80);
+			literal = true;
+			break;
 		}
-		catch (...)
+		if (i == std::string::npos)
+			return "";
+
+		size_t qlen = QuantifierLength(re, i);
+		if (qlen > 0)
 		{
-			// TODO:
+			// The atom may be absent or repeated: it's kept only if
+			// required, and the run ends after it
+			if (literal && (re[i] == '?' || re[i] == '*' || re.compare(i, 2, "{0") == 0))
+				run.erase(atom);
+			literal = false;
+			i += qlen;
 		}
-		if (result > 0)
+		if (run.length() > best.length())
+			best = run;
+		if (!literal)
+			run.clear();
+	}
+	return best;
+}
+
+/**
+ * @brief Sort expressions for fast matching.
+ * Combinable expressions anchored to the start are compiled to one
+ * alternation, and required literals of the other expressions are added to
+ * the literal matcher. If the alternation can't be compiled, all
+ * expressions are tried one by one.
+ */
+void FilterList::Compile()
+{
+	FastMutex::ScopedLock lock(m_compileMutex);
+	if (m_bCompiled)
+		return;
+	std::string pattern;
+	m_anchored.reset();
+	m_anchoredList.clear();
+	m_otherList.clear();
+	m_literals.Clear();
+	for (std::vector<filter_item_ptr>::const_iterator it = m_list.begin(); it != m_list.end(); ++it)
+	{
+		const std::string& re = (*it)->filterAsString;
+		if (IsAnchored(re) && CanCombine(re))
 		{
-			m_lastMatchExpression = &item->filterAsString;
-			retval = true;
+			if (!pattern.empty())
+				pattern += '|';
+			pattern += "(?:" + re + ")";
+			m_anchoredList.push_back(*it);
 		}
 		else
-			++i;
+		{
+			(*it)->requiredLiteral = GetRequiredLiteral(re);
+			m_otherList.push_back(*it);
+		}
 	}
 
-	return retval;
+	if (!pattern.empty())
+	{
+		try
+		{
+			m_anchored.reset(new RegularExpression(pattern, RegularExpression::RE_UTF8));
+		}
+		catch (...)
+		{
+			for (std::vector<filter_item_ptr>::const_iterator it = m_anchoredList.begin(); it != m_anchoredList.end(); ++it)
+				(*it)->requiredLiteral = GetRequiredLiteral((*it)->filterAsString);
+			m_otherList.insert(m_otherList.begin(), m_anchoredList.begin(), m_anchoredList.end());
+			m_anchoredList.clear();
+		}
+	}
+
+	for (size_t i = 0; i < m_otherList.size(); ++i)
+		m_literals.Add(m_otherList[i]->requiredLiteral, static_cast<int>(i));
+	m_literals.Build();
+	m_bCompiled = true;
 }
 
-/** 
- * @brief Returns the last matched expression (if any).
- * This function returns the regular expression string that matched last.
- * @return Last matched expression, or NULL in case no matches yet.
+/**
+ * @brief Match string against one expression.
+ * @param [in] item Expression to match.
+ * @param [in] string UTF-8 string to match.
+ * @return true if the expression did match the string.
  */
-const char * FilterList::GetLastMatchExpression() const
+bool FilterList::MatchItem(const filter_item_ptr& item, const std::string& string)
+{
+	int result = 0;
+	RegularExpression::Match match;
+	try
+	{
+		result = item->regexp.match(string, 0, match);
+	}
+	catch (...)
+	{
+		// TODO:
+	}
+	if (result > 0)
+	{
+		m_lastMatchExpression = &item->filterAsString;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Match UTF-8 string against list of expressions.
+ * The anchored expressions are tried at once, and if they match, one by one
+ * to find the matching one. Then the other expressions are tried in the
+ * list order, skipping the ones whose required literal is not in the
+ * string.
+ * @param [in] string UTF-8 string to match.
+ * @return true if any of the expressions did match the string.
+ */
+bool FilterList::MatchUTF8(const std::string& string)
 {
-	return m_lastMatchExpression->c_str();
+	if (m_anchored)
+	{
+		int result = 0;
+		RegularExpression::Match match;
+		try
+		{
+			result = m_anchored->match(string, 0, match);
+		}
+		catch (...)
+		{
+			// Let the expressions be matched one by one
+			result = 1;
+		}
+		if (result > 0)
+		{
+			for (size_t i = 0; i < m_anchoredList.size(); ++i)
+			{
+				if (MatchItem(m_anchoredList[i], string))
+					return true;
+			}
+		}
+	}
+
+	if (m_otherList.empty())
+		return false;
+
+	// Expressions whose literal is found, allocated only if any is found
+	std::vector<char> found;
+	m_literals.FindAll(string.data(), string.length(), [&](int id)
+	{
+		if (found.empty())
+			found.resize(m_otherList.size());
+		found[id] = 1;
+	});
+	for (size_t i = 0; i < m_otherList.size(); ++i)
+	{
+		const filter_item_ptr& item = m_otherList[i];
+		if ((item->requiredLiteral.empty() || (!found.empty() && found[i])) &&
+			MatchItem(item, string))
+		{
+			return true;
+		}
+	}
+	return false;
 }
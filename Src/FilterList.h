@@ -7,8 +7,11 @@
 
 #include <vector>
 #include <memory>
+#include <atomic>
 #include <Poco/RegularExpression.h>
+#include <Poco/Mutex.h>
 #include "unicoder.h"
+#include "MultiStringMatcher.h"
 
 /**
  * @brief Container for one filtering rule / compiled expression.
@@ -20,6 +23,7 @@ struct filter_item
 {
 	std::string filterAsString; /** Original regular expression string */
 	Poco::RegularExpression regexp; /**< Compiled regular expression */
+	std::string requiredLiteral; /**< Text contained in all matches, or empty */
 	filter_item(const std::string &filter, int reOpts) : filterAsString(filter), regexp(filter, reOpts) {}
 };
 
@@ -30,6 +34,13 @@ typedef std::shared_ptr<filter_item> filter_item_ptr;
  * This class holds a list of regular expressions for matching strings.
  * The class also provides simple function for matching and remembers the
  * last matched expression.
+ *
+ * Expressions anchored to the start of the string are also compiled to one
+ * alternation, which is tried at the start only. Other expressions are only
+ * tried if the string contains the literal text all their matches contain;
+ * the literals of all expressions are found with one scan of the string.
+ * The list is sorted this way when it is matched first after expressions
+ * were added.
  */
 class FilterList
 {
@@ -43,8 +54,22 @@ public:
 	bool Match(const std::string& string, int codepage = ucr::CP_UTF_8);
 	const char * GetLastMatchExpression() const;
 
+	static bool CanCombine(const std::string& regularExpression);
+	static bool IsAnchored(const std::string& regularExpression);
+	static std::string GetRequiredLiteral(const std::string& regularExpression);
+
 private:
+	void Compile();
+	bool MatchUTF8(const std::string& string);
+	bool MatchItem(const filter_item_ptr& item, const std::string& string);
+
 	std::vector <filter_item_ptr> m_list;
+	std::unique_ptr<Poco::RegularExpression> m_anchored; /**< Alternation of m_anchoredList */
+	std::vector <filter_item_ptr> m_anchoredList; /**< Expressions anchored to start */
+	std::vector <filter_item_ptr> m_otherList; /**< Expressions tried one by one */
+	MultiStringMatcher m_literals; /**< Required literals of m_otherList, by index */
+	std::atomic<bool> m_bCompiled; /**< Are expressions sorted for matching? */
+	Poco::FastMutex m_compileMutex; /**< Folder compare threads share the list */
 	const std::string *m_lastMatchExpression;
 
 };
@@ -19,16 +19,29 @@
 #include "BinaryCompare.h"
 #include "TimeSizeCompare.h"
 #include "TFile.h"
+#include "ContentCache.h"
+#include "CompareStats.h"
+#include "ParallelInvoke.h"
 
 using CompareEngines::ByteCompare;
 using CompareEngines::BinaryCompare;
 using CompareEngines::TimeSizeCompare;
 
 static void GetComparePaths(CDiffContext * pCtxt, const DIFFITEM &di, PathContext & files);
+static bool CanUseContentCache(const CDiffContext * pCtxt, const DIFFITEM &di);
+static unsigned GetContentCacheOptions(const CDiffContext * pCtxt, int nCompMethod);
+static bool LookupContentCache(CDiffContext * pCtxt, const DIFFITEM &di, const PathContext & files,
+		unsigned options, ContentCache::Entry entries[], bool bCached[]);
+static void StoreContentCache(CDiffContext * pCtxt, const DIFFITEM &di, ContentCache::Hasher hashers[],
+		const PathContext & files, unsigned options, unsigned code, const FileTextStats stats[], const FileLocation location[],
+		const bool bCached[]);
+static bool IsPluginUsed(const PluginForFile * info);
 
 FolderCmp::FolderCmp()
 : m_pDiffUtilsEngine(nullptr)
+, m_pDiffUtilsEngine12(nullptr)
 , m_pByteCompare(nullptr)
+, m_pByteCompare12(nullptr)
 , m_pBinaryCompare(nullptr)
 , m_pTimeSizeCompare(nullptr)
 , m_ndiffs(CDiffContext::DIFFS_UNKNOWN)
@@ -74,6 +87,15 @@ int FolderCmp::prepAndCompareFiles(CDiffContext * pCtxt, DIFFITEM &di)
 		for (nIndex = 0; nIndex < nDirs; nIndex++)
 			m_diffFileData.m_textStats[nIndex].clear();
 
+		// If either file is larger than limit compare files by quick contents
+		// This allows us to (faster) compare big binary files
+		if (nCompMethod == CMP_CONTENT && 
+			(di.diffFileInfo[0].size > pCtxt->m_nQuickCompareLimit ||
+			di.diffFileInfo[1].size > pCtxt->m_nQuickCompareLimit))
+		{
+			nCompMethod = CMP_QUICK_CONTENT;
+		}
+
 		PathContext files;
 		GetComparePaths(pCtxt, di, files);
 		struct change *script = NULL;
@@ -100,8 +122,40 @@ int FolderCmp::prepAndCompareFiles(CDiffContext * pCtxt, DIFFITEM &di)
 			pCtxt->FetchPluginInfos(filteredFilenames, &infoUnpacker,
 					&infoPrediffer);
 
+		// Files with same contents as in an earlier compare need not be read
+		const bool bUseCache = CanUseContentCache(pCtxt, di) &&
+			!IsPluginUsed(infoUnpacker) && !IsPluginUsed(infoPrediffer);
+		const unsigned cacheOptions = GetContentCacheOptions(pCtxt, nCompMethod);
+		ContentCache::Entry cached[3];
+		bool bCached[3] = { false, false, false };
+		ContentCache::Hasher hashers[3];
+		if (bUseCache && LookupContentCache(pCtxt, di, files, cacheOptions, cached, bCached) &&
+			(pCtxt->m_bIgnoreCodepage || std::equal(cached + 1, cached + nDirs, cached,
+				[](const ContentCache::Entry& a, const ContentCache::Entry& b) { return a.encoding == b.encoding; })))
+		{
+			for (nIndex = 0; nIndex < nDirs; nIndex++)
+			{
+				m_diffFileData.m_textStats[nIndex] = cached[nIndex].stats;
+				m_diffFileData.m_FileLocation[nIndex].encoding = cached[nIndex].encoding;
+			}
+			if (nCompMethod == CMP_CONTENT)
+			{
+				m_ndiffs = 0;
+				m_ntrivialdiffs = 0;
+			}
+			else
+			{
+				m_ndiffs = CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE;
+				m_ntrivialdiffs = CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE;
+			}
+			return DIFFCODE::FILE | DIFFCODE::SAME |
+				(cached[0].bBinary ? DIFFCODE::BIN : DIFFCODE::TEXT);
+		}
+
 		FileTextEncoding encoding[3];
 		bool bForceUTF8 = pCtxt->GetCompareOptions(nCompMethod)->m_bIgnoreCase;
+		bool bOpened = false;
+		bool bPureAscii[3] = {false, false, false};
 
 		for (nIndex = 0; nIndex < nDirs; nIndex++)
 		{
@@ -122,8 +176,33 @@ int FolderCmp::prepAndCompareFiles(CDiffContext * pCtxt, DIFFITEM &di)
 			// As we keep handles open on unpacked files, Transform() may not delete them.
 			// Unpacked files will be deleted at end of this function.
 			filepathTransformed[nIndex] = filepathUnpacked[nIndex];
+		}
+
+		// Unless a prediffer transforms files, open them only once and guess
+		// encodings from the data read for compare
+		if (files.GetSize() == 2 && !IsPluginUsed(infoPrediffer))
+		{
+			m_diffFileData.SetDisplayFilepaths(files[0], files[1]); // store true names for diff utils patch file
+			if (!m_diffFileData.OpenFiles(filepathTransformed[0], filepathTransformed[1]))
+				goto exitPrepAndCompare;
+			// Files compared by contents are small enough to read at once
+			if (nCompMethod == CMP_CONTENT && !m_diffFileData.ReadFiles())
+				goto exitPrepAndCompare;
+			for (nIndex = 0; nIndex < nDirs && bUseCache; nIndex++)
+			{
+				const file_data & inf = m_diffFileData.m_inf[nIndex];
+				if (inf.preloaded)
+					hashers[nIndex].update(inf.buffer, static_cast<unsigned>(inf.buffered_chars));
+			}
+			bOpened = true;
+		}
 
-			encoding[nIndex] = GuessCodepageEncoding(filepathTransformed[nIndex], pCtxt->m_iGuessEncodingType);
+		for (nIndex = 0; nIndex < nDirs; nIndex++)
+		{
+			if (bOpened)
+				encoding[nIndex] = m_diffFileData.GuessEncoding(nIndex, pCtxt->m_iGuessEncodingType, &bPureAscii[nIndex]);
+			else
+				encoding[nIndex] = GuessCodepageEncoding(filepathTransformed[nIndex], pCtxt->m_iGuessEncodingType, BufSize, &bPureAscii[nIndex]);
 			m_diffFileData.m_FileLocation[nIndex].encoding = encoding[nIndex];
 		}
 
@@ -133,7 +212,11 @@ int FolderCmp::prepAndCompareFiles(CDiffContext * pCtxt, DIFFITEM &di)
 		for (nIndex = 0; nIndex < nDirs; nIndex++)
 		{
 		// Invoke prediff'ing plugins
-			if (infoPrediffer && !m_diffFileData.Filepath_Transform(bForceUTF8, encoding[nIndex], filepathUnpacked[nIndex], filepathTransformed[nIndex], filteredFilenames, infoPrediffer))
+			// ASCII files are already UTF-8, so they are not converted unless a plugin is run
+			// or their codepage gives other characters to ASCII bytes
+			bool bConvertUTF8 = bForceUTF8 && !(bPureAscii[nIndex] && !IsPluginUsed(infoPrediffer) &&
+				ucr::IsAsciiCompatibleCodepage(encoding[nIndex].m_codepage));
+			if (infoPrediffer && !m_diffFileData.Filepath_Transform(bConvertUTF8, encoding[nIndex], filepathUnpacked[nIndex], filepathTransformed[nIndex], filteredFilenames, infoPrediffer))
 				goto exitPrepAndCompare;
 		}
 
@@ -147,10 +230,17 @@ int FolderCmp::prepAndCompareFiles(CDiffContext * pCtxt, DIFFITEM &di)
 
 		if (files.GetSize() == 2)
 		{
-			m_diffFileData.SetDisplayFilepaths(files[0], files[1]); // store true names for diff utils patch file
-			// This opens & fstats both files (if it succeeds)
-			if (!m_diffFileData.OpenFiles(filepathTransformed[0], filepathTransformed[1]))
-				goto exitPrepAndCompare;
+			// Files converted to UTF-8 for compare must be opened again
+			if (filepathTransformed[0] != filepathUnpacked[0] ||
+				filepathTransformed[1] != filepathUnpacked[1])
+				bOpened = false;
+			if (!bOpened)
+			{
+				m_diffFileData.SetDisplayFilepaths(files[0], files[1]); // store true names for diff utils patch file
+				// This opens & fstats both files (if it succeeds)
+				if (!m_diffFileData.OpenFiles(filepathTransformed[0], filepathTransformed[1]))
+					goto exitPrepAndCompare;
+			}
 		}
 		else
 		{
@@ -160,20 +250,18 @@ int FolderCmp::prepAndCompareFiles(CDiffContext * pCtxt, DIFFITEM &di)
 			if (!diffdata10.m_diffFileData.OpenFiles(filepathTransformed[1], filepathTransformed[0]))
 				goto exitPrepAndCompare;
 
-
-			if (!diffdata12.m_diffFileData.OpenFiles(filepathTransformed[1], filepathTransformed[2]))
+			if (nCompMethod == CMP_CONTENT)
+			{
+				// Read the middle file once, both pairs are compared with copies of it
+				if (!diffdata10.m_diffFileData.ReadFiles())
+					goto exitPrepAndCompare;
+				if (!diffdata12.m_diffFileData.OpenFiles(diffdata10.m_diffFileData, 0, filepathTransformed[2]))
+					goto exitPrepAndCompare;
+			}
+			else if (!diffdata12.m_diffFileData.OpenFiles(filepathTransformed[1], filepathTransformed[2]))
 				goto exitPrepAndCompare;
 		}
 
-		// If either file is larger than limit compare files by quick contents
-		// This allows us to (faster) compare big binary files
-		if (nCompMethod == CMP_CONTENT && 
-			(di.diffFileInfo[0].size > pCtxt->m_nQuickCompareLimit ||
-			di.diffFileInfo[1].size > pCtxt->m_nQuickCompareLimit))
-		{
-			nCompMethod = CMP_QUICK_CONTENT;
-		}
-
 		if (nCompMethod == CMP_CONTENT)
 		{
 			if (files.GetSize() == 2)
@@ -209,31 +297,42 @@ int FolderCmp::prepAndCompareFiles(CDiffContext * pCtxt, DIFFITEM &di)
 			}
 			else
 			{
+				// Each pair has its own engine, so that both can be compared at once
 				if (m_pDiffUtilsEngine == NULL)
 					m_pDiffUtilsEngine.reset(new CompareEngines::DiffUtils());
-				m_pDiffUtilsEngine->SetCodepage(codepage);
-				bool success = m_pDiffUtilsEngine->SetCompareOptions(
-						*pCtxt->GetCompareOptions(CMP_CONTENT));
+				if (m_pDiffUtilsEngine12 == NULL)
+					m_pDiffUtilsEngine12.reset(new CompareEngines::DiffUtils());
+				CompareEngines::DiffUtils * engines[2] = { m_pDiffUtilsEngine.get(), m_pDiffUtilsEngine12.get() };
+				bool success = true;
+				for (int i = 0; i < 2 && success; ++i)
+				{
+					engines[i]->SetCodepage(codepage);
+					success = engines[i]->SetCompareOptions(
+							*pCtxt->GetCompareOptions(CMP_CONTENT));
+				}
 				if (success)
 				{
-					if (pCtxt->m_pFilterList != NULL)
-						m_pDiffUtilsEngine->SetFilterList(pCtxt->m_pFilterList.get());
-					else
-						m_pDiffUtilsEngine->ClearFilterList();
-					m_pDiffUtilsEngine->SetFilterCommentsManager(pCtxt->m_pFilterCommentsManager);
+					for (int i = 0; i < 2; ++i)
+					{
+						if (pCtxt->m_pFilterList != NULL)
+							engines[i]->SetFilterList(pCtxt->m_pFilterList.get());
+						else
+							engines[i]->ClearFilterList();
+						engines[i]->SetFilterCommentsManager(pCtxt->m_pFilterCommentsManager);
+					}
 
-					bool bRet;
 					int bin_flag10 = 0, bin_flag12 = 0;
 
 					m_pDiffUtilsEngine->SetFileData(2, diffdata10.m_diffFileData.m_inf);
-					bRet = m_pDiffUtilsEngine->Diff2Files(&script10, 0, &bin_flag10, false, NULL);
+					m_pDiffUtilsEngine12->SetFileData(2, diffdata12.m_diffFileData.m_inf);
+					ParallelInvoke(
+						[&]() { m_pDiffUtilsEngine12->Diff2Files(&script12, 0, &bin_flag12, false, NULL); },
+						[&]() { m_pDiffUtilsEngine->Diff2Files(&script10, 0, &bin_flag10, false, NULL); },
+						DiffFileData::IsWorthConcurrentCompare(diffdata10.m_diffFileData, diffdata12.m_diffFileData));
 					m_pDiffUtilsEngine->GetTextStats(0, &m_diffFileData.m_textStats[1]);
 					m_pDiffUtilsEngine->GetTextStats(1, &m_diffFileData.m_textStats[0]);
-
-					m_pDiffUtilsEngine->SetFileData(2, diffdata12.m_diffFileData.m_inf);
-					bRet = m_pDiffUtilsEngine->Diff2Files(&script12, 0, &bin_flag12, false, NULL);
-					m_pDiffUtilsEngine->GetTextStats(0, &m_diffFileData.m_textStats[1]);
-					m_pDiffUtilsEngine->GetTextStats(1, &m_diffFileData.m_textStats[2]);
+					m_pDiffUtilsEngine12->GetTextStats(0, &m_diffFileData.m_textStats[1]);
+					m_pDiffUtilsEngine12->GetTextStats(1, &m_diffFileData.m_textStats[2]);
 
 					code = DIFFCODE::FILE;
 
@@ -288,6 +387,11 @@ int FolderCmp::prepAndCompareFiles(CDiffContext * pCtxt, DIFFITEM &di)
 					m_pByteCompare->SetAdditionalOptions(pCtxt->m_bStopAfterFirstDiff);
 					m_pByteCompare->SetAbortable(pCtxt->GetAbortable());
 					m_pByteCompare->SetFileData(2, m_diffFileData.m_inf);
+					// Files converted to UTF-8 don't give digests of the files
+					if (bUseCache && bOpened)
+						m_pByteCompare->SetDigestEngines(&hashers[0], &hashers[1]);
+					else
+						m_pByteCompare->SetDigestEngines(nullptr, nullptr);
 	
 					// use our own byte-by-byte compare
 					code = m_pByteCompare->CompareFiles(m_diffFileData.m_FileLocation);
@@ -305,34 +409,42 @@ int FolderCmp::prepAndCompareFiles(CDiffContext * pCtxt, DIFFITEM &di)
 			}
 			else
 			{
+				// Each pair has its own engine, so that both can be compared at once
 				if (m_pByteCompare == NULL)
 					m_pByteCompare.reset(new ByteCompare());
-				bool success = m_pByteCompare->SetCompareOptions(
-					*pCtxt->GetCompareOptions(CMP_QUICK_CONTENT));
+				if (m_pByteCompare12 == NULL)
+					m_pByteCompare12.reset(new ByteCompare());
+				ByteCompare * engines[2] = { m_pByteCompare.get(), m_pByteCompare12.get() };
+				bool success = true;
+				for (int i = 0; i < 2 && success; ++i)
+				{
+					success = engines[i]->SetCompareOptions(
+						*pCtxt->GetCompareOptions(CMP_QUICK_CONTENT));
+				}
 	
 				if (success)
 				{
-					/* r */
-					m_pByteCompare->SetAdditionalOptions(pCtxt->m_bStopAfterFirstDiff);
-					m_pByteCompare->SetAbortable(pCtxt->GetAbortable());
+					for (int i = 0; i < 2; ++i)
+					{
+						engines[i]->SetAdditionalOptions(pCtxt->m_bStopAfterFirstDiff);
+						engines[i]->SetAbortable(pCtxt->GetAbortable());
+						engines[i]->SetDigestEngines(nullptr, nullptr);
+					}
 
-					// 10
 					m_pByteCompare->SetFileData(2, diffdata10.m_diffFileData.m_inf);
+					m_pByteCompare12->SetFileData(2, diffdata12.m_diffFileData.m_inf);
 	
 					// use our own byte-by-byte compare
-					int code10 = m_pByteCompare->CompareFiles(diffdata10.m_diffFileData.m_FileLocation);
+					int code10 = 0, code12 = 0;
+					ParallelInvoke(
+						[&]() { code12 = m_pByteCompare12->CompareFiles(diffdata12.m_diffFileData.m_FileLocation); },
+						[&]() { code10 = m_pByteCompare->CompareFiles(diffdata10.m_diffFileData.m_FileLocation); },
+						DiffFileData::IsWorthConcurrentCompare(diffdata10.m_diffFileData, diffdata12.m_diffFileData));
 	
 					m_pByteCompare->GetTextStats(0, &m_diffFileData.m_textStats[1]);
 					m_pByteCompare->GetTextStats(1, &m_diffFileData.m_textStats[0]);
-
-					// 12
-					m_pByteCompare->SetFileData(2, diffdata12.m_diffFileData.m_inf);
-	
-					// use our own byte-by-byte compare
-					int code12 = m_pByteCompare->CompareFiles(diffdata12.m_diffFileData.m_FileLocation);
-	
-					m_pByteCompare->GetTextStats(0, &m_diffFileData.m_textStats[1]);
-					m_pByteCompare->GetTextStats(1, &m_diffFileData.m_textStats[2]);
+					m_pByteCompare12->GetTextStats(0, &m_diffFileData.m_textStats[1]);
+					m_pByteCompare12->GetTextStats(1, &m_diffFileData.m_textStats[2]);
 
 					code = DIFFCODE::FILE;
 					if (DIFFCODE::isResultError(code10) || DIFFCODE::isResultError(code12))
@@ -378,6 +490,16 @@ exitPrepAndCompare:
 		    (code & DIFFCODE::COMPAREFLAGS) == DIFFCODE::SAME &&
 		    !std::equal(encoding + 1, encoding + nDirs, encoding))
 			code = (code & ~DIFFCODE::COMPAREFLAGS) | DIFFCODE::DIFF;
+
+		// Text statistics are known only for two files compared to the end
+		if (bUseCache && nDirs == 2 &&
+			!DIFFCODE::isResultError(code) && !DIFFCODE::isResultAbort(code) &&
+			!(nCompMethod == CMP_QUICK_CONTENT && pCtxt->m_bStopAfterFirstDiff &&
+			  (code & DIFFCODE::COMPAREFLAGS) == DIFFCODE::DIFF))
+		{
+			StoreContentCache(pCtxt, di, hashers, files, cacheOptions, code,
+				m_diffFileData.m_textStats, m_diffFileData.m_FileLocation, bCached);
+		}
 	}
 	else if (nCompMethod == CMP_BINARY_CONTENT)
 	{
@@ -386,7 +508,27 @@ exitPrepAndCompare:
 
 		PathContext files;
 		GetComparePaths(pCtxt, di, files);
+
+		const bool bUseCache = CanUseContentCache(pCtxt, di);
+		const unsigned cacheOptions = GetContentCacheOptions(pCtxt, nCompMethod);
+		ContentCache::Entry cached[3];
+		bool bCached[3] = { false, false, false };
+		if (bUseCache && LookupContentCache(pCtxt, di, files, cacheOptions, cached, bCached))
+			return DIFFCODE::SAME;
+
+		ContentCache::Hasher hashers[3];
+		if (bUseCache)
+			m_pBinaryCompare->SetDigestEngines(&hashers[0], &hashers[1], &hashers[2]);
+		else
+			m_pBinaryCompare->SetDigestEngines(nullptr, nullptr, nullptr);
 		code = m_pBinaryCompare->CompareFiles(files, di);
+
+		if (bUseCache && !DIFFCODE::isResultError(code))
+		{
+			FileTextStats stats[3];
+			StoreContentCache(pCtxt, di, hashers, files, cacheOptions, code,
+				stats, m_diffFileData.m_FileLocation, bCached);
+		}
 	}
 	else if (nCompMethod == CMP_DATE || nCompMethod == CMP_DATE_SIZE || nCompMethod == CMP_SIZE)
 	{
@@ -432,3 +574,105 @@ void GetComparePaths(CDiffContext * pCtxt, const DIFFITEM &di, PathContext & fil
 		}
 	}
 }
+
+/**
+ * @brief Check if content cache can be used for files of DIFFITEM.
+ * Only files existing on all sides and having same size can have same
+ * contents.
+ */
+static bool CanUseContentCache(const CDiffContext * pCtxt, const DIFFITEM &di)
+{
+	if (pCtxt->m_pContentCache == NULL)
+		return false;
+	for (int nIndex = 0; nIndex < pCtxt->GetCompareDirs(); nIndex++)
+	{
+		if (!di.diffcode.exists(nIndex) ||
+			di.diffFileInfo[nIndex].size != di.diffFileInfo[0].size)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Get value for options content cache entries depend on.
+ * Text statistics and encodings depend on compare method and encoding
+ * detection, identical contents do not depend on compare options.
+ */
+static unsigned GetContentCacheOptions(const CDiffContext * pCtxt, int nCompMethod)
+{
+	return static_cast<unsigned>(nCompMethod) * 31 +
+		static_cast<unsigned>(pCtxt->m_iGuessEncodingType);
+}
+
+/**
+ * @brief Find compared files from content cache.
+ * @param [in] pCtxt Compare context.
+ * @param [in] di Compared files.
+ * @param [in] files Paths of compared files.
+ * @param [in] options Options cache entries must be valid for.
+ * @param [out] entries Cached data of files.
+ * @param [out] bCached Were files found from cache?
+ * @return true if all files were found and have identical contents.
+ */
+static bool LookupContentCache(CDiffContext * pCtxt, const DIFFITEM &di, const PathContext & files,
+		unsigned options, ContentCache::Entry entries[], bool bCached[])
+{
+	bool bSame = true;
+	for (int nIndex = 0; nIndex < pCtxt->GetCompareDirs(); nIndex++)
+	{
+		const DiffFileInfo & info = di.diffFileInfo[nIndex];
+		bCached[nIndex] = pCtxt->m_pContentCache->Lookup(files[nIndex],
+			info.size, info.mtime, options, entries[nIndex]);
+		pCtxt->m_pCompareStats->AddContentCacheLookup(bCached[nIndex]);
+		if (!bCached[nIndex] || entries[nIndex].digest != entries[0].digest)
+			bSame = false;
+	}
+	return bSame;
+}
+
+/**
+ * @brief Add compared files not found from content cache to it.
+ * Digests are computed from the data read for compare, so files not read
+ * to their end are not added.
+ * @param [in] pCtxt Compare context.
+ * @param [in] di Compared files.
+ * @param [in] hashers Data read from compared files.
+ * @param [in] files Paths of compared files.
+ * @param [in] options Options cache entries are valid for.
+ * @param [in] code Result of compare.
+ * @param [in] stats Text statistics of compared files.
+ * @param [in] location Encodings of compared files.
+ * @param [in] bCached Were files found from cache?
+ */
+static void StoreContentCache(CDiffContext * pCtxt, const DIFFITEM &di, ContentCache::Hasher hashers[],
+		const PathContext & files, unsigned options, unsigned code, const FileTextStats stats[],
+		const FileLocation location[], const bool bCached[])
+{
+	const unsigned textflags = code & DIFFCODE::TEXTFLAGS;
+	for (int nIndex = 0; nIndex < pCtxt->GetCompareDirs(); nIndex++)
+	{
+		const DiffFileInfo & info = di.diffFileInfo[nIndex];
+		if (bCached[nIndex] || !ContentCache::IsCacheable(info.mtime) ||
+			hashers[nIndex].GetSize() != static_cast<int64_t>(info.size))
+			continue;
+		ContentCache::Entry entry;
+		entry.digest = hashers[nIndex].GetDigest();
+		entry.size = info.size;
+		entry.mtime = info.mtime.epochMicroseconds();
+		entry.options = options;
+		entry.stats = stats[nIndex];
+		entry.encoding = location[nIndex].encoding;
+		entry.bBinary = textflags == DIFFCODE::BIN ||
+			(textflags == DIFFCODE::BINSIDE1 && nIndex == 0) ||
+			(textflags == DIFFCODE::BINSIDE2 && nIndex == 1);
+		pCtxt->m_pContentCache->Store(files[nIndex], entry);
+	}
+}
+
+/**
+ * @brief Check if unpacker or prediffer plugin may transform files.
+ */
+static bool IsPluginUsed(const PluginForFile * info)
+{
+	return info && (info->bToBeScanned || !info->pluginName.empty());
+}
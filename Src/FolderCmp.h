@@ -51,7 +51,9 @@ public:
 
 private:
 	std::unique_ptr<CompareEngines::DiffUtils> m_pDiffUtilsEngine;
+	std::unique_ptr<CompareEngines::DiffUtils> m_pDiffUtilsEngine12; /**< Engine for second pair of 3-way compare */
 	std::unique_ptr<CompareEngines::ByteCompare> m_pByteCompare;
+	std::unique_ptr<CompareEngines::ByteCompare> m_pByteCompare12; /**< Engine for second pair of 3-way compare */
 	std::unique_ptr<CompareEngines::BinaryCompare> m_pBinaryCompare;
 	std::unique_ptr<CompareEngines::TimeSizeCompare> m_pTimeSizeCompare;
 };
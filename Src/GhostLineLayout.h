@@ -0,0 +1,188 @@
+/**
+ * @file  GhostLineLayout.h
+ *
+ * @brief Declaration of function templates laying out lines of the merge
+ * buffers with ghost lines, and hiding lines out of the diff context.
+ */
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "DiffList.h"
+#include "MergeLineFlags.h"
+
+/**
+ * @brief Insert ghost lines in the line arrays of the panes so that the
+ * diffs line up, and set the WinMerge flags of the diff lines.
+ *
+ * The new line arrays are built in a single forward pass over the diffs,
+ * with one allocation per pane; lines are copied, not reallocated. This
+ * sets dbegin, dend and blank of each diff in @p diffList.
+ *
+ * Matched lines after the last diff are not synchronized, so the panes may
+ * have a different count of lines afterwards (see
+ * CMergeDoc::PrimeTextBuffers()).
+ *
+ * @param [in,out] diffList Diffs, in the order of the lines.
+ * @param [in] nFiles Count of panes.
+ * @param [in,out] aLines Line arrays of the panes. @p Line must have a
+ *  m_dwFlags member and copy shallowly.
+ * @param [in] ghost Line copied to each ghost line. It must not own its
+ *  text, as all ghost lines share it.
+ * @param [in] ghostFlag Flag of ghost lines.
+ * @param [in] invisibleFlag Flag of hidden lines, cleared on diff lines.
+ * @return Count of trivial diffs.
+ */
+template <class Line>
+int LayOutGhostLines(DiffList& diffList, int nFiles, std::vector<Line> *aLines[],
+	const Line& ghost, unsigned long ghostFlag, unsigned long invisibleFlag)
+{
+	std::vector<DiffRangeInfo>& diffs = diffList.GetDiffRangeInfoVector();
+	int extras[3] = {0};
+	diffList.GetExtraLinesCounts(nFiles, extras);
+
+	std::vector<Line> newLines[3];
+	int pos[3] = {0}; // next line to copy from the old arrays
+	int file;
+	for (file = 0; file < nFiles; file++)
+		newLines[file].reserve(aLines[file]->size() + extras[file]);
+
+	int nTrivialDiffs = 0;
+	for (std::vector<DiffRangeInfo>::iterator it = diffs.begin(); it != diffs.end(); ++it)
+	{
+		DIFFRANGE& curDiff = *it;
+
+		// copy matched lines before curDiff
+		for (file = 0; file < nFiles; file++)
+		{
+			newLines[file].insert(newLines[file].end(),
+				aLines[file]->begin() + pos[file], aLines[file]->begin() + curDiff.begin[file]);
+			pos[file] = curDiff.begin[file];
+		}
+		// Matched lines should really match...
+		assert(nFiles < 2 || newLines[0].size() == newLines[1].size());
+
+		int nline[3] = {0};
+		int nmaxline = 0;
+		for (file = 0; file < nFiles; file++)
+		{
+			nline[file] = curDiff.end[file] - curDiff.begin[file] + 1; // #lines in diff on left/middle/right
+			nmaxline = (std::max)(nmaxline, nline[file]);
+		}
+
+		bool bFlagLines = false;
+		switch (curDiff.op)
+		{
+		case OP_TRIVIAL:
+			++nTrivialDiffs;
+			// fall through and handle as diff
+		case OP_DIFF:
+		case OP_1STONLY:
+		case OP_2NDONLY:
+		case OP_3RDONLY:
+			bFlagLines = true;
+			break;
+		}
+
+		curDiff.dbegin = static_cast<int>(newLines[0].size());
+		if (bFlagLines)
+			curDiff.dend = curDiff.dbegin + nmaxline - 1;
+
+		// copy unmatched lines, add ghost lines, and set flags
+		for (file = 0; file < nFiles; file++)
+		{
+			unsigned long snpFlag = 0;
+			if ((file == 0 && curDiff.op == OP_3RDONLY) || (file == 2 && curDiff.op == OP_1STONLY))
+				snpFlag = LF_SNP;
+
+			std::vector<Line>& lines = newLines[file];
+			size_t first = lines.size();
+			lines.insert(lines.end(),
+				aLines[file]->begin() + curDiff.begin[file], aLines[file]->begin() + curDiff.end[file] + 1);
+			pos[file] = curDiff.end[file] + 1;
+			if (bFlagLines)
+			{
+				unsigned long dflag = ((curDiff.op == OP_TRIVIAL) ? LF_TRIVIAL : LF_DIFF) | snpFlag;
+				for (size_t i = first; i < lines.size(); i++)
+					lines[i].m_dwFlags = (lines[i].m_dwFlags | dflag) & ~invisibleFlag;
+			}
+
+			int nextra = nmaxline - nline[file];
+			if (nextra > 0)
+			{
+				// ghost lines opposite to trivial lines are ghost and trivial
+				Line li = ghost;
+				li.m_dwFlags = ghostFlag | snpFlag;
+				if (curDiff.op == OP_TRIVIAL)
+					li.m_dwFlags |= LF_TRIVIAL;
+				lines.insert(lines.end(), nextra, li);
+			}
+			if (bFlagLines)
+				curDiff.blank[file] = (nextra > 0) ? curDiff.dend + 1 - nextra : -1;
+		}
+	}
+
+	// copy matched lines after the last diff
+	for (file = 0; file < nFiles; file++)
+	{
+		newLines[file].insert(newLines[file].end(), aLines[file]->begin() + pos[file], aLines[file]->end());
+		aLines[file]->swap(newLines[file]);
+	}
+	return nTrivialDiffs;
+}
+
+/**
+ * @brief Hide lines further than @p nContext lines from diff lines, and
+ * show the others.
+ *
+ * Diff lines are those having one of @p diffFlags in the first pane. Only
+ * lines existing in all panes are changed. As CMergeDoc::HideLines() always
+ * did, the last line is hidden unless it is a diff line itself or comes
+ * before a diff line.
+ *
+ * @param [in] nFiles Count of panes.
+ * @param [in,out] aLines Line arrays of the panes.
+ * @param [in] nContext Count of lines shown before and after diff lines.
+ * @param [in] diffFlags Flags of diff lines.
+ * @param [in] invisibleFlag Flag of hidden lines.
+ */
+template <class Line>
+void HideLinesOutOfContext(int nFiles, std::vector<Line> *aLines[], int nContext,
+	unsigned long diffFlags, unsigned long invisibleFlag)
+{
+	int nLineCount = 0x7fffffff;
+	int file;
+	for (file = 0; file < nFiles; file++)
+		nLineCount = (std::min)(nLineCount, static_cast<int>(aLines[file]->size()));
+	const std::vector<Line>& lines0 = *aLines[0];
+
+	// Backward: show diff lines and the context before them, hide the rest
+	int nNextDiff = -1;
+	for (int nLine = nLineCount - 1; nLine >= 0; nLine--)
+	{
+		if (lines0[nLine].m_dwFlags & diffFlags)
+			nNextDiff = nLine;
+		bool bVisible = nNextDiff >= 0 && nNextDiff - nLine <= nContext;
+		for (file = 0; file < nFiles; file++)
+		{
+			if (bVisible)
+				(*aLines[file])[nLine].m_dwFlags &= ~invisibleFlag;
+			else
+				(*aLines[file])[nLine].m_dwFlags |= invisibleFlag;
+		}
+	}
+
+	// Forward: show the context after diff lines
+	int nPrevDiff = -1;
+	for (int nLine = 0; nLine < nLineCount - 1; nLine++)
+	{
+		if (lines0[nLine].m_dwFlags & diffFlags)
+			nPrevDiff = nLine;
+		else if (nPrevDiff >= 0 && nLine - nPrevDiff <= nContext)
+		{
+			for (file = 0; file < nFiles; file++)
+				(*aLines[file])[nLine].m_dwFlags &= ~invisibleFlag;
+		}
+	}
+}
@@ -51,6 +51,7 @@
 #include "OptionsMgr.h"
 #include "OptionsDiffOptions.h"
 #include "MergeLineFlags.h"
+#include "GhostLineLayout.h"
 #include "FileOrFolderSelect.h"
 #include "LineFiltersList.h"
 #include "TempFile.h"
@@ -64,6 +65,8 @@
 #include "7zCommon.h"
 #include "PatchTool.h"
 #include "charsets.h"
+#include "LoadProgress.h"
+#include "ParallelInvoke.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -74,6 +77,9 @@ using std::swap;
 /** @brief Max len of path in caption. */
 static const UINT CAPTION_PATH_MAX = 50;
 
+/** @brief Milliseconds between updates of the progress of loading files. */
+static const long LoadProgressInterval = 100;
+
 int CMergeDoc::m_nBuffersTemp = 2;
 
 /** @brief EOL types */
@@ -140,6 +146,7 @@ CMergeDoc::CMergeDoc()
 , m_pEncodingErrorBar(nullptr)
 , m_bHasSyncPoints(false)
 , m_bAutoMerged(false)
+, m_bRescanStateValid(false)
 {
 	DIFFOPTIONS options = {0};
 
@@ -340,8 +347,10 @@ static void SaveBuffForDiff(CDiffTextBuffer & buf, const String& filepath, bool
  * error happened
  * If this code is OK, Rescan has detached the views temporarily
  * (positions of cursors have been lost)
- * @note Rescan() ALWAYS compares temp files. Actual user files are not
- * touched by Rescan().
+ * @note Rescan() compares in-memory copies of the buffers, or temp files
+ * when prediffer plugins need them. Actual user files are not
+ * touched by Rescan(). After edits, only the region around the edited
+ * lines is compared again when possible.
  * @sa CDiffWrapper::RunFileDiff()
  */
 int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
@@ -362,14 +371,10 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 
 	ClearWordDiffCache();
 
+	String sFilterList;
 	if (GetOptionsMgr()->GetBool(OPT_LINEFILTER_ENABLED))
-	{
-		m_diffWrapper.SetFilterList(theApp.m_pLineFilters->GetAsString());
-	}
-	else
-	{
-		m_diffWrapper.SetFilterList(_T(""));
-	}
+		sFilterList = theApp.m_pLineFilters->GetAsString();
+	m_diffWrapper.SetFilterList(sFilterList);
 	m_diffWrapper.SetFilterCommentsManager(theApp.m_pFilterCommentsManager.get());
 
 	for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
@@ -384,6 +389,11 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 	}
 	m_LastRescan = COleDateTime::GetCurrentTime();
 
+	// Prediffer plugins work on files, otherwise buffers are diffed in memory
+	m_diffWrapper.EnablePlugins(GetOptionsMgr()->GetBool(OPT_PLUGINS_ENABLED));
+	bool bInMemory = GetOptionsMgr()->GetBool(OPT_CMP_INMEMORY_RESCAN) &&
+		m_diffWrapper.CanDiffInMemory();
+
 	LPCTSTR tnames[] = {_T("t0_wmdoc"), _T("t1_wmdoc"), _T("t2_wmdoc")};
 	for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
 	{
@@ -399,6 +409,9 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 			}
 		}
 
+		if (bInMemory)
+			continue;
+
 		String temp = m_tempFiles[nBuffer].GetPath();
 		if (temp.empty())
 		{
@@ -423,19 +436,12 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 	else
 		bForceUTF8 = true;
 
-	// Clear diff list
-	m_diffList.Clear();
 	m_nCurDiff = -1;
-	// Clear moved lines lists
-	if (m_diffWrapper.GetDetectMovedBlocks())
-	{
-		for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
-			m_diffWrapper.GetMovedLines(nBuffer)->Clear();
-	}
 
 	// Set paths for diffing and run diff
-	m_diffWrapper.EnablePlugins(GetOptionsMgr()->GetBool(OPT_PLUGINS_ENABLED));
-	if (m_nBuffers < 3)
+	if (bInMemory)
+		m_diffWrapper.SetPaths(m_filePaths, false);
+	else if (m_nBuffers < 3)
 		m_diffWrapper.SetPaths(PathContext(m_tempFiles[0].GetPath(), m_tempFiles[1].GetPath()), true);
 	else
 		m_diffWrapper.SetPaths(PathContext(m_tempFiles[0].GetPath(), m_tempFiles[1].GetPath(), m_tempFiles[2].GetPath()), true);
@@ -445,14 +451,42 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 			CP_UTF8 : m_ptBuf[0]->m_encoding.m_codepage);
 
 	DIFFSTATUS status;
+	std::string texts[3];
+	m_diffWrapper.SetInMemoryTexts(bInMemory ? texts : NULL);
+	WMPROFILE(bInMemory ? _T("CMergeDoc::Rescan (in memory)") : _T("CMergeDoc::Rescan (temp files)"));
+
+	// Compare only the edited region if the previous diff list can be reused
+	bool bIncremental = bInMemory && !bBinary &&
+		CanRescanIncrementally(diffOptions, sFilterList, bForceUTF8) &&
+		RescanEditedRegion(texts, bForceUTF8, status);
+	if (!bIncremental)
+	{
+		// Clear diff list
+		m_diffList.Clear();
+		// Clear moved lines lists
+		if (m_diffWrapper.GetDetectMovedBlocks())
+		{
+			for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
+				m_diffWrapper.GetMovedLines(nBuffer)->Clear();
+		}
+	}
 
-	if (!HasSyncPoints())
+	if (bIncremental)
+	{
+		diffSuccess = true;
+	}
+	else if (!HasSyncPoints())
 	{
 		// Save text buffer to file
 		for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
 		{
-			m_ptBuf[nBuffer]->SetTempPath(tempPath);
-			SaveBuffForDiff(*m_ptBuf[nBuffer], m_tempFiles[nBuffer].GetPath(), bForceUTF8);
+			if (bInMemory)
+				m_ptBuf[nBuffer]->SaveToMemory(texts[nBuffer], bForceUTF8);
+			else
+			{
+				m_ptBuf[nBuffer]->SetTempPath(tempPath);
+				SaveBuffForDiff(*m_ptBuf[nBuffer], m_tempFiles[nBuffer].GetPath(), bForceUTF8);
+			}
 		}
 
 		m_diffWrapper.SetCreateDiffList(&m_diffList);
@@ -474,9 +508,15 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 			for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
 			{
 				nLines[nBuffer] = (i >= syncpoints.size()) ? -1 : syncpoints[i][nBuffer] - nStartLine[nBuffer];
-				m_ptBuf[nBuffer]->SetTempPath(tempPath);
-				SaveBuffForDiff(*m_ptBuf[nBuffer], m_tempFiles[nBuffer].GetPath(), bForceUTF8,
-					nStartLine[nBuffer], nLines[nBuffer]);
+				if (bInMemory)
+					m_ptBuf[nBuffer]->SaveToMemory(texts[nBuffer], bForceUTF8,
+						nStartLine[nBuffer], nLines[nBuffer]);
+				else
+				{
+					m_ptBuf[nBuffer]->SetTempPath(tempPath);
+					SaveBuffForDiff(*m_ptBuf[nBuffer], m_tempFiles[nBuffer].GetPath(), bForceUTF8,
+						nStartLine[nBuffer], nLines[nBuffer]);
+				}
 			}
 			DiffList templist;
 			templist.Clear();
@@ -497,6 +537,7 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 		}
 		m_diffWrapper.SetCreateDiffList(&m_diffList);
 	}
+	m_diffWrapper.SetInMemoryTexts(NULL);
 
 	// If comparing whitespaces and
 	// other file has EOL before EOF and other not...
@@ -515,6 +556,7 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 
 	// set identical/diff result as recorded by diffutils
 	identical = status.Identical;
+	InvalidateRescanState();
 
 	// Determine errors and binary file compares
 	if (!diffSuccess)
@@ -576,6 +618,7 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 
 			m_bEditAfterRescan[nBuffer] = false;
 		}
+		StoreRescanState(diffOptions, sFilterList, bForceUTF8);
 	}
 
 	if (!GetOptionsMgr()->GetBool(OPT_CMP_IGNORE_CODEPAGE) &&
@@ -1926,132 +1969,16 @@ void CMergeDoc::OnUpdateDiffContext(CCmdUI* pCmdUI)
 void CMergeDoc::PrimeTextBuffers()
 {
 	SetCurrentDiff(-1);
-	m_nTrivialDiffs = 0;
-	int nDiff;
-	int nDiffCount = m_diffList.GetSize();
 	int file;
 
-	// walk the diff list and calculate numbers of extra lines to add
-	int extras[3]={0};   // extra lines added to each view
-	m_diffList.GetExtraLinesCounts(m_nBuffers, extras);
-
-	// resize m_aLines once for each view
-	UINT lcount[3] = {0};
-	UINT lcountnew[3] = {0};
-	
+	// lay out all lines and ghost lines in one pass over the diffs
+	static const TCHAR szEmpty[] = _T("");
+	LineInfo ghost;
+	ghost.CreateShared(szEmpty, 0);
+	std::vector<LineInfo> *aLines[3] = {NULL};
 	for (file = 0; file < m_nBuffers; file++)
-	{
-		lcount[file] = m_ptBuf[file]->GetLineCount();
-		lcountnew[file] = lcount[file] + extras[file];
-		m_ptBuf[file]->m_aLines.resize(lcountnew[file]);
-	}
-// this ASSERT may be false because of empty last line (see function's note)
-//	ASSERT(lcount0new == lcount1new);
-
-	// walk the diff list backward, move existing lines to proper place,
-	// add ghost lines, and set flags
-	for (nDiff = nDiffCount - 1; nDiff >= 0; nDiff --)
-	{
-		DIFFRANGE curDiff;
-		VERIFY(m_diffList.GetDiff(nDiff, curDiff));
-
-		// move matched lines after curDiff
-		int nline[3] = { 0 };
-		for (file = 0; file < m_nBuffers; file++)
-			nline[file] = lcount[file] - curDiff.end[file] - 1; // #lines on left/middle/right after current diff
-		// Matched lines should really match...
-		// But matched lines after last diff may differ because of empty last line (see function's note)
-		if (nDiff < nDiffCount - 1)
-			ASSERT(nline[0] == nline[1]);
-
-		int nmaxline = 0;
-		for (file = 0; file < m_nBuffers; file++)
-		{
-			// Move all lines after current diff down as far as needed
-			// for any ghost lines we're about to insert
-			m_ptBuf[file]->MoveLine(curDiff.end[file]+1, lcount[file]-1, lcountnew[file]-nline[file]);
-			lcountnew[file] -= nline[file];
-			lcount[file] -= nline[file];
-			// move unmatched lines and add ghost lines
-			nline[file] = curDiff.end[file] - curDiff.begin[file] + 1; // #lines in diff on left/middle/right
-			nmaxline = max(nmaxline, nline[file]);
-		}
-
-		for (file = 0; file < m_nBuffers; file++)
-		{
-			m_ptBuf[file]->MoveLine(curDiff.begin[file], curDiff.end[file], lcountnew[file]-nmaxline);
-			int nextra = nmaxline - nline[file];
-			if (nextra > 0)
-			{
-				m_ptBuf[file]->SetEmptyLine(lcountnew[file] - nextra, nextra);
-				DWORD dflag = LF_GHOST;
-				if ((file == 0 && curDiff.op == OP_3RDONLY) || (file == 2 && curDiff.op == OP_1STONLY))
-					dflag |= LF_SNP;
-				for (int i = 1; i <= nextra; i++)
-					m_ptBuf[file]->SetLineFlag(lcountnew[file]-i, dflag, true, false, false);
-			}
-			lcountnew[file] -= nmaxline;
-
-			lcount[file] -= nline[file];
-
-		}
-		// set dbegin, dend, blank, and line flags
-		curDiff.dbegin = lcountnew[0];
-
-		switch (curDiff.op)
-		{
-		case OP_TRIVIAL:
-			++m_nTrivialDiffs;
-			// fall through and handle as diff
-		case OP_DIFF:
-		case OP_1STONLY:
-		case OP_2NDONLY:
-		case OP_3RDONLY:
-			// set curdiff
-			{
-				curDiff.dend = lcountnew[0]+nmaxline-1;
-				for (file = 0; file < m_nBuffers; file++)
-				{
-					curDiff.blank[file] = -1;
-					int nextra = nmaxline - nline[file];
-					if (nmaxline > nline[file])
-					{
-						// more lines on left, ghost lines on right side
-						curDiff.blank[file] = curDiff.dend + 1 - nextra;
-					}
-				}
-			}
-			// flag lines
-			{
-				for (file = 0; file < m_nBuffers; file++)
-				{
-					// left side
-					int i;
-					for (i = curDiff.dbegin; i <= curDiff.dend; i++)
-					{
-						if (curDiff.blank[file] == -1 || (int)i < curDiff.blank[file])
-						{
-							// set diff or trivial flag
-							DWORD dflag = (curDiff.op == OP_TRIVIAL) ? LF_TRIVIAL : LF_DIFF;
-							if ((file == 0 && curDiff.op == OP_3RDONLY) || (file == 2 && curDiff.op == OP_1STONLY))
-								dflag |= LF_SNP;
-							m_ptBuf[file]->SetLineFlag(i, dflag, true, false, false);
-m_ptBuf[file]->SetLineFlag(i, LF_INVISIBLE, false, false, false);
-						}
-						else
-						{
-							// ghost lines are already inserted (and flagged)
-							// ghost lines opposite to trivial lines are ghost and trivial
-							if (curDiff.op == OP_TRIVIAL)
-								m_ptBuf[file]->SetLineFlag(i, LF_TRIVIAL, true, false, false);
-						}
-					}
-				}
-			}
-			break;
-		}           // switch (curDiff.op)
-		VERIFY(m_diffList.SetDiff(nDiff, curDiff));
-	}             // for (nDiff = nDiffCount; nDiff-- > 0; )
+		aLines[file] = &m_ptBuf[file]->m_aLines;
+	m_nTrivialDiffs = LayOutGhostLines(m_diffList, m_nBuffers, aLines, ghost, LF_GHOST, LF_INVISIBLE);
 
 	m_diffList.ConstructSignificantChain();
 
@@ -2107,7 +2034,6 @@ CMergeDoc::FileChange CMergeDoc::IsFileChangedOnDisk(LPCTSTR szPath, DiffFileInf
 
 void CMergeDoc::HideLines()
 {
-	int nLine;
 	int file;
 
 	if (m_nDiffContext < 0)
@@ -2117,48 +2043,10 @@ void CMergeDoc::HideLines()
 		return;
 	}
 
-	int nLineCount = 0x7fffffff;
+	std::vector<LineInfo> *aLines[3] = {NULL};
 	for (file = 0; file < m_nBuffers; file++)
-	{
-		if (nLineCount > m_ptBuf[file]->GetLineCount())
-			nLineCount = m_ptBuf[file]->GetLineCount();
-	}
-
-	for (nLine =  0; nLine < nLineCount;)
-	{
-		if (!(m_ptBuf[0]->GetLineFlags(nLine) & (LF_DIFF | LF_GHOST)))
-		{
-			for (file = 0; file < m_nBuffers; file++)
-				m_ptBuf[file]->SetLineFlag(nLine, LF_INVISIBLE, true, false, false);
-			nLine++;
-		}
-		else
-		{
-			int nLine2 = (nLine - m_nDiffContext < 0) ? 0 : (nLine - m_nDiffContext);
-			for (; nLine2 < nLine; nLine2++)
-			{
-				for (file = 0; file < m_nBuffers; file++)
-					m_ptBuf[file]->SetLineFlag(nLine2, LF_INVISIBLE, false, false, false);
-			}
-		
-			for (; nLine < nLineCount; nLine++)
-			{
-				if (!(m_ptBuf[0]->GetLineFlags(nLine) & (LF_DIFF | LF_GHOST)))
-					break;
-				for (file = 0; file < m_nBuffers; file++)
-					m_ptBuf[file]->SetLineFlag(nLine, LF_INVISIBLE, false, false, false);
-			}
-
-			int nLineEnd2 = (nLine + m_nDiffContext >= nLineCount) ? nLineCount-1 : (nLine + m_nDiffContext);
-			for (; nLine < nLineEnd2; nLine++)
-			{
-				for (file = 0; file < m_nBuffers; file++)
-					m_ptBuf[file]->SetLineFlag(nLine, LF_INVISIBLE, false, false, false);
-				if (m_ptBuf[0]->GetLineFlags(nLine) & (LF_DIFF | LF_GHOST))
-					nLineEnd2 = (nLine + 1 + m_nDiffContext >= nLineCount) ? nLineCount-1 : (nLine + 1 + m_nDiffContext);
-			}
-		}
-	}
+		aLines[file] = &m_ptBuf[file]->m_aLines;
+	HideLinesOutOfContext(m_nBuffers, aLines, m_nDiffContext, LF_DIFF | LF_GHOST, LF_INVISIBLE);
 
 	for (file = 0; file < m_nBuffers; file++)
 		m_pView[file]->SetEnableHideLines(true);
@@ -2358,29 +2246,45 @@ bool CMergeDoc::CloseNow()
 }
 
 /**
- * @brief Loads file to buffer and shows load-errors
+ * @brief Loads file to buffer
  * @param [in] sFileName File to open
  * @param [in] nBuffer Index (0-based) of buffer to load
  * @param [out] readOnly whether file is read-only
  * @param [in] encoding encoding used
+ * @param [out] sOpenError Error from the system if the file could not be opened
+ * @param [in] pProgress Progress to add the bytes read to, or NULL
  * @return Tells if files were loaded successfully
+ * @note Buffers of all panes may load at the same time, so errors are
+ * shown afterwards by ShowLoadResult().
  * @sa CMergeDoc::OpenDocs()
  **/
-int CMergeDoc::LoadFile(CString sFileName, int nBuffer, bool & readOnly, const FileTextEncoding & encoding)
+int CMergeDoc::LoadFile(CString sFileName, int nBuffer, bool & readOnly, const FileTextEncoding & encoding,
+		CString & sOpenError, LoadProgress * pProgress /*= NULL*/)
 {
-	String sError;
-	DWORD retVal = FileLoadResult::FRESULT_ERROR;
-
 	CDiffTextBuffer *pBuf = m_ptBuf[nBuffer].get();
-	m_filePaths[nBuffer] = sFileName;
 
 	CRLFSTYLE nCrlfStyle = CRLF_STYLE_AUTOMATIC;
-	CString sOpenError;
-	retVal = pBuf->LoadFromFile(sFileName, m_pInfoUnpacker.get(),
-		m_strBothFilenames.c_str(), readOnly, nCrlfStyle, encoding, sOpenError);
+	sOpenError.Empty();
+
+	// if CMergeDoc::CDiffTextBuffer::LoadFromFile fails,
+	// it leaves the pBuf in a valid (but empty) state via a call to InitNew
+	return pBuf->LoadFromFile(sFileName, m_pInfoUnpacker.get(),
+		m_strBothFilenames.c_str(), readOnly, nCrlfStyle, encoding, sOpenError, pProgress);
+}
 
-	// if CMergeDoc::CDiffTextBuffer::LoadFromFile failed,
-	// it left the pBuf in a valid (but empty) state via a call to InitNew
+/**
+ * @brief Handles the result of loading a file and shows load-errors
+ * @param [in] sFileName File loaded
+ * @param [in] nBuffer Index (0-based) of buffer loaded
+ * @param [in,out] retVal Result of loading, made OK if the file was loaded
+ *  with multiple EOL types
+ * @param [in] sOpenError Error from the system if the file could not be opened
+ * @sa CMergeDoc::LoadFile()
+ **/
+void CMergeDoc::ShowLoadResult(const String& sFileName, int nBuffer, DWORD & retVal, const CString & sOpenError)
+{
+	String sError;
+	CDiffTextBuffer *pBuf = m_ptBuf[nBuffer].get();
 
 	if (FileLoadResult::IsOkImpure(retVal))
 	{
@@ -2398,17 +2302,16 @@ int CMergeDoc::LoadFile(CString sFileName, int nBuffer, bool & readOnly, const F
 	{
 		// Error from Unifile/system
 		if (!sOpenError.IsEmpty())
-			sError = strutils::format_string2(_("Cannot open file\n%1\n\n%2"), (LPCTSTR)sFileName, (LPCTSTR)sOpenError);
+			sError = strutils::format_string2(_("Cannot open file\n%1\n\n%2"), sFileName, (LPCTSTR)sOpenError);
 		else
-			sError = strutils::format_string1(_("File not found: %1"), (LPCTSTR)sFileName);
+			sError = strutils::format_string1(_("File not found: %1"), sFileName);
 		AfxMessageBox(sError.c_str(), MB_OK | MB_ICONSTOP | MB_MODELESS);
 	}
 	else if (FileLoadResult::IsErrorUnpack(retVal))
 	{
-		sError = strutils::format_string1(_("File not unpacked: %1"), (LPCTSTR)sFileName);
+		sError = strutils::format_string1(_("File not unpacked: %1"), sFileName);
 		AfxMessageBox(sError.c_str(), MB_OK | MB_ICONSTOP | MB_MODELESS);
 	}
-	return retVal;
 }
 
 /**
@@ -2442,18 +2345,13 @@ void CMergeDoc::SanityCheckCodepage(FileLocation & fileinfo)
 }
 
 /**
- * @brief Loads one file from disk and updates file infos.
+ * @brief Updates file infos and buffer type before loading one file.
  * @param [in] index Index of file in internal buffers.
  * @param [in] filename File's name.
- * @param [in] readOnly Is file read-only?
- * @param [in] encoding File's encoding.
- * @return One of FileLoadResult values.
+ * @param [in] strDesc File's description.
  */
-DWORD CMergeDoc::LoadOneFile(int index, String filename, bool readOnly, const String& strDesc, 
-		const FileTextEncoding & encoding)
+void CMergeDoc::InitFileInfo(int index, const String& filename, const String& strDesc)
 {
-	DWORD loadSuccess = FileLoadResult::FRESULT_ERROR;;
-	
 	m_strDesc[index] = strDesc;
 	if (!filename.empty())
 	{
@@ -2463,18 +2361,46 @@ DWORD CMergeDoc::LoadOneFile(int index, String filename, bool readOnly, const St
 			m_nBufferType[index] = BUFFER_NORMAL_NAMED;
 		m_pSaveFileInfo[index]->Update(filename);
 		m_pRescanFileInfo[index]->Update(filename);
+		m_filePaths[index] = filename;
+	}
+	else
+	{
+		m_nBufferType[index] = BUFFER_UNNAMED;
+	}
+}
 
-		loadSuccess = LoadFile(filename.c_str(), index, readOnly, encoding);
+/**
+ * @brief Loads one file from disk.
+ * Files of all panes may load at the same time, so this shows no UI and
+ * reads no options; OpenDocs() shows the results afterwards.
+ * @param [in] index Index of file in internal buffers.
+ * @param [in] filename File's name.
+ * @param [in] readOnly Is file read-only?
+ * @param [in] encoding File's encoding.
+ * @param [in] iGuessEncodingType Codepage detection used when loading
+ *  with @p encoding is lossy.
+ * @param [out] sOpenError Error from the system if the file could not be opened.
+ * @param [in] pProgress Progress to add the bytes read to, or NULL.
+ * @return One of FileLoadResult values.
+ */
+DWORD CMergeDoc::LoadOneFile(int index, const String& filename, bool readOnly,
+		const FileTextEncoding & encoding, int iGuessEncodingType, CString & sOpenError,
+		LoadProgress * pProgress)
+{
+	DWORD loadSuccess = FileLoadResult::FRESULT_ERROR;;
+	
+	if (!filename.empty())
+	{
+		loadSuccess = LoadFile(filename.c_str(), index, readOnly, encoding, sOpenError, pProgress);
 		if (FileLoadResult::IsLossy(loadSuccess))
 		{
 			m_ptBuf[index]->FreeAll();
 			loadSuccess = LoadFile(filename.c_str(), index, readOnly,
-				GuessCodepageEncoding(filename, GetOptionsMgr()->GetInt(OPT_CP_DETECT), -1));
+				GuessCodepageEncoding(filename, iGuessEncodingType, -1), sOpenError, pProgress);
 		}
 	}
 	else
 	{
-		m_nBufferType[index] = BUFFER_UNNAMED;
 		m_ptBuf[index]->InitNew();
 		m_ptBuf[index]->m_encoding = encoding;
 		loadSuccess = FileLoadResult::FRESULT_OK;
@@ -2502,10 +2428,6 @@ bool CMergeDoc::OpenDocs(int nFiles, const FileLocation ifileloc[],
 
 	std::copy_n(ifileloc, 3, fileloc);
 
-	// Filter out invalid codepages, or editor will display all blank
-	for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
-		SanityCheckCodepage(fileloc[nBuffer]);
-
 	// clear undo stack
 	undoTgt.clear();
 	curUndo = undoTgt.begin();
@@ -2530,12 +2452,47 @@ bool CMergeDoc::OpenDocs(int nFiles, const FileLocation ifileloc[],
 	m_strBothFilenames.erase(m_strBothFilenames.length() - 1);
 
 	// Load files
-	DWORD nSuccess[3];
+	InvalidateRescanState();
+	LoadProgress progress;
 	for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
 	{
-		nSuccess[nBuffer] = LoadOneFile(nBuffer, fileloc[nBuffer].filepath, bRO[nBuffer], strDesc ? strDesc[nBuffer] : _T(""),
-			fileloc[nBuffer].encoding);
+		InitFileInfo(nBuffer, fileloc[nBuffer].filepath, strDesc ? strDesc[nBuffer] : _T(""));
+		int64_t size = static_cast<int64_t>(m_pRescanFileInfo[nBuffer]->size);
+		if (!fileloc[nBuffer].filepath.empty() && size > 0)
+			progress.AddTotal(size);
 	}
+	const int iGuessEncodingType = GetOptionsMgr()->GetInt(OPT_CP_DETECT);
+	DWORD nSuccess[3];
+	CString sOpenError[3];
+	auto loadFile = [&](int nBuffer)
+	{
+		// Filter out invalid codepages, or editor will display all blank
+		SanityCheckCodepage(fileloc[nBuffer]);
+		nSuccess[nBuffer] = LoadOneFile(nBuffer, fileloc[nBuffer].filepath, bRO[nBuffer],
+			fileloc[nBuffer].encoding, iGuessEncodingType, sOpenError[nBuffer], &progress);
+	};
+	// Files are loaded at the same time unless an unpacker plugin may run,
+	// as plugins must run in this thread and the first file may choose the
+	// unpacker for the others
+	if (m_nBuffers > 1 && m_pInfoUnpacker->bToBeScanned == PLUGIN_MANUAL &&
+		m_pInfoUnpacker->pluginName.empty() && !m_pInfoUnpacker->pufile)
+	{
+		CMainFrame *pMainFrame = GetMainFrame();
+		ParallelInvokeEach(m_nBuffers, loadFile, [&]()
+			{
+				String sMessage = strutils::format(_("Loading files... %d%%").c_str(), progress.GetPercent());
+				pMainFrame->SetMessageText(sMessage.c_str());
+			}, LoadProgressInterval);
+		pMainFrame->SetMessageText(AFX_IDS_IDLEMESSAGE);
+	}
+	else
+	{
+		for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
+			loadFile(nBuffer);
+	}
+	// Show errors in the order of the panes
+	for (nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
+		ShowLoadResult(fileloc[nBuffer].filepath, nBuffer, nSuccess[nBuffer], sOpenError[nBuffer]);
 	const bool bFiltersEnabled = GetOptionsMgr()->GetBool(OPT_PLUGINS_ENABLED);
 
 	// scratchpad : we don't call LoadFile, so
@@ -2966,6 +2923,7 @@ void CMergeDoc::SwapFiles()
 	std::swap(m_pRescanFileInfo[0], m_pRescanFileInfo[m_nBuffers - 1]);
 	std::swap(m_nBufferType[0], m_nBufferType[m_nBuffers - 1]);
 	std::swap(m_bEditAfterRescan[0], m_bEditAfterRescan[m_nBuffers - 1]);
+	InvalidateRescanState();
 	std::swap(m_strDesc[0], m_strDesc[m_nBuffers - 1]);
 	m_strDesc[0].swap(m_strDesc[1]);
 
@@ -143,6 +143,7 @@ class PrediffingInfo;
 class CChildFrame;
 class CDirDoc;
 class CEncodingErrorBar;
+class LoadProgress;
 
 /**
  * @brief Document class for merging two files
@@ -188,7 +189,9 @@ public:
 	void UpdateResources();
 	bool OpenDocs(int nFiles, const FileLocation fileloc[],
 		const bool bRO[], const String strDesc[], int nPane = -1, int nLineIndex = -1);
-	int LoadFile(CString sFileName, int nBuffer, bool & readOnly, const FileTextEncoding & encoding);
+	int LoadFile(CString sFileName, int nBuffer, bool & readOnly, const FileTextEncoding & encoding,
+		CString & sOpenError, LoadProgress * pProgress = NULL);
+	void ShowLoadResult(const String& sFileName, int nBuffer, DWORD & retVal, const CString & sOpenError);
 	void ChangeFile(int nBuffer, const String& path);
 	void RescanIfNeeded(float timeOutInSecond);
 	int Rescan(bool &bBinary, IDENTLEVEL &identical, bool bForced = false);
@@ -258,6 +261,22 @@ public:
 	bool DoFileEncodingDialog();
 // End MergeDocEncoding.cpp
 
+// Implementation in MergeDocIncrementalRescan.cpp
+private:
+	bool CanRescanIncrementally(const DIFFOPTIONS & diffOptions,
+		const String & sFilterList, bool bForceUTF8) const;
+	bool RescanEditedRegion(std::string texts[], bool bForceUTF8, DIFFSTATUS & status);
+	void StoreRescanState(const DIFFOPTIONS & diffOptions,
+		const String & sFilterList, bool bForceUTF8);
+	void InvalidateRescanState() { m_bRescanStateValid = false; }
+	bool m_bRescanStateValid; /**< Is the state of the last rescan usable? */
+	DWORD m_dwRescanRevision[3]; /**< Buffer revisions at last rescan */
+	int m_nRescanRealLines[3]; /**< Real line counts at last rescan */
+	DIFFOPTIONS m_rescanDiffOptions; /**< Diff options of last rescan */
+	String m_sRescanFilterList; /**< Line filters of last rescan */
+	bool m_bRescanForceUTF8; /**< Were buffers diffed as UTF-8 at last rescan? */
+// End MergeDocIncrementalRescan.cpp
+
 // Implementation
 public:
 	FileChange IsFileChangedOnDisk(LPCTSTR szPath, DiffFileInfo &dfi,
@@ -296,7 +315,9 @@ private:
 	bool GetByteColoringOption() const;
 	bool IsValidCodepageForMergeEditor(unsigned cp) const;
 	void SanityCheckCodepage(FileLocation & fileinfo);
-	DWORD LoadOneFile(int index, String filename, bool readOnly, const String& strDesc, const FileTextEncoding & encoding);
+	void InitFileInfo(int index, const String& filename, const String& strDesc);
+	DWORD LoadOneFile(int index, const String& filename, bool readOnly, const FileTextEncoding & encoding,
+		int iGuessEncodingType, CString & sOpenError, LoadProgress * pProgress);
 
 // Implementation data
 protected:
@@ -0,0 +1,170 @@
+/**
+ * @file  MergeDocIncrementalRescan.cpp
+ *
+ * @brief Implementation file for rescanning only the edited region of
+ * the merge document.
+ *
+ * After an edit, most of the diff list of the previous rescan is still
+ * valid. The edited lines are found from line revision numbers, the
+ * unchanged lines around them are used as anchors, and only the text
+ * between the anchors is compared again. The new diffs are spliced into
+ * the old diff list.
+ */
+
+#include "StdAfx.h"
+#include "MergeDoc.h"
+#include <climits>
+#include "DiffTextBuffer.h"
+#include "RescanRegion.h"
+#include "OptionsMgr.h"
+#include "OptionsDef.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+/**
+ * @brief Check if diffs of some lines of two files are the diffs these
+ * lines have when whole files are compared.
+ * Multiline comment filtering looks for comment starts and ends outside
+ * the compared lines, so a comment block crossing the edge of the lines
+ * would be filtered differently.
+ * @param [in] options Diffutils options.
+ * @return true if lines can be compared without the rest of the files.
+ */
+static bool CanDiffLinesInWindow(const DIFFOPTIONS & options)
+{
+	return !options.bFilterCommentsLines;
+}
+
+/**
+ * @brief Check if the previous diff list can be updated instead of
+ * rescanning whole buffers.
+ * @param [in] diffOptions Diff options of this rescan.
+ * @param [in] sFilterList Line filters of this rescan.
+ * @param [in] bForceUTF8 Are buffers diffed as UTF-8?
+ * @return true if edited region can be rescanned alone.
+ */
+bool CMergeDoc::CanRescanIncrementally(const DIFFOPTIONS & diffOptions,
+		const String & sFilterList, bool bForceUTF8) const
+{
+	if (!GetOptionsMgr()->GetBool(OPT_CMP_INCREMENTAL_RESCAN))
+		return false;
+	if (!m_bRescanStateValid || m_nBuffers != 2 || HasSyncPoints())
+		return false;
+	// Moved blocks and matched similar lines depend on whole diff list
+	if (m_diffWrapper.GetDetectMovedBlocks() ||
+		GetOptionsMgr()->GetBool(OPT_CMP_MATCH_SIMILAR_LINES))
+		return false;
+	// Comment blocks may start or end outside the edited region
+	if (!CanDiffLinesInWindow(diffOptions))
+		return false;
+	if (!m_bEditAfterRescan[0] && !m_bEditAfterRescan[1])
+		return false;
+
+	if (diffOptions.nIgnoreWhitespace != m_rescanDiffOptions.nIgnoreWhitespace ||
+		diffOptions.bIgnoreCase != m_rescanDiffOptions.bIgnoreCase ||
+		diffOptions.bIgnoreBlankLines != m_rescanDiffOptions.bIgnoreBlankLines ||
+		diffOptions.bIgnoreEol != m_rescanDiffOptions.bIgnoreEol ||
+		diffOptions.bFilterCommentsLines != m_rescanDiffOptions.bFilterCommentsLines ||
+		diffOptions.nDiffAlgorithm != m_rescanDiffOptions.nDiffAlgorithm)
+		return false;
+	if (sFilterList != m_sRescanFilterList || bForceUTF8 != m_bRescanForceUTF8)
+		return false;
+
+	for (int nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
+	{
+		// Undo puts back old revision numbers, reload resets them
+		if (m_ptBuf[nBuffer]->AreRevisionsRestored() ||
+			m_ptBuf[nBuffer]->m_dwCurrentRevisionNumber < m_dwRescanRevision[nBuffer])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Compare the edited region again and update the diff list.
+ * @sa RescanRegion
+ *
+ * @param [in] texts Buffers for the in-memory texts given to diffutils.
+ * @param [in] bForceUTF8 Are buffers diffed as UTF-8?
+ * @param [out] status Diff status of the updated diff list.
+ * @return true if diff list was updated, false if a full rescan is needed.
+ * @note Called before prepareForRescan(), so buffers still have ghost
+ * lines of the previous rescan.
+ */
+bool CMergeDoc::RescanEditedRegion(std::string texts[], bool bForceUTF8, DIFFSTATUS & status)
+{
+	int nFirst[2], nLast[2], nRealLines[2], nDelta[2];
+	bool bEdited = false;
+	int nBuffer;
+	for (nBuffer = 0; nBuffer < 2; nBuffer++)
+	{
+		bool bBufferEdited = m_ptBuf[nBuffer]->GetEditedRealLines(
+			m_dwRescanRevision[nBuffer], nFirst[nBuffer], nLast[nBuffer], nRealLines[nBuffer]);
+		nDelta[nBuffer] = nRealLines[nBuffer] - m_nRescanRealLines[nBuffer];
+		if (bBufferEdited)
+		{
+			bEdited = true;
+			// Edited range in line numbers of previous rescan
+			nLast[nBuffer] -= nDelta[nBuffer];
+		}
+		else if (nDelta[nBuffer] != 0)
+			return false;
+		else
+		{
+			nFirst[nBuffer] = INT_MAX;
+			nLast[nBuffer] = -1;
+		}
+	}
+	if (!bEdited)
+		return false;
+
+	RescanRegion region;
+	if (!region.Find(m_diffList, m_nRescanRealLines, nFirst, nLast))
+		return false;
+
+	// Compare text between anchors
+	for (nBuffer = 0; nBuffer < 2; nBuffer++)
+	{
+		int nStartLine = m_ptBuf[nBuffer]->ComputeApparentLine(region.nStart[nBuffer]);
+		int nLines = region.bToEOF ? -1 :
+			m_ptBuf[nBuffer]->ComputeApparentLine(region.nEnd[nBuffer] + nDelta[nBuffer]) - nStartLine;
+		m_ptBuf[nBuffer]->SaveToMemory(texts[nBuffer], bForceUTF8, nStartLine, nLines);
+	}
+
+	DiffList templist;
+	m_diffWrapper.SetCreateDiffList(&templist);
+	bool bSuccess = m_diffWrapper.RunFileDiff();
+	m_diffWrapper.SetCreateDiffList(&m_diffList);
+	DIFFSTATUS status_part;
+	m_diffWrapper.GetDiffStatus(&status_part);
+	if (!bSuccess || status_part.bBinaries)
+		return false;
+
+	region.Splice(m_diffList, templist, status_part, nDelta, status);
+	return true;
+}
+
+/**
+ * @brief Remember revisions and options of a successful rescan.
+ * @param [in] diffOptions Diff options of the rescan.
+ * @param [in] sFilterList Line filters of the rescan.
+ * @param [in] bForceUTF8 Were buffers diffed as UTF-8?
+ */
+void CMergeDoc::StoreRescanState(const DIFFOPTIONS & diffOptions,
+		const String & sFilterList, bool bForceUTF8)
+{
+	for (int nBuffer = 0; nBuffer < m_nBuffers; nBuffer++)
+	{
+		int nFirst, nLast;
+		m_dwRescanRevision[nBuffer] = m_ptBuf[nBuffer]->m_dwCurrentRevisionNumber;
+		m_ptBuf[nBuffer]->GetEditedRealLines(m_dwRescanRevision[nBuffer],
+			nFirst, nLast, m_nRescanRealLines[nBuffer]);
+		m_ptBuf[nBuffer]->ClearRevisionsRestored();
+	}
+	m_rescanDiffOptions = diffOptions;
+	m_sRescanFilterList = sFilterList;
+	m_bRescanForceUTF8 = bForceUTF8;
+	m_bRescanStateValid = true;
+}
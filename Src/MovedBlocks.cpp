@@ -20,70 +20,85 @@
  * @brief Moved block detection code.
  */
 
-#include <map>
+#include <vector>
 #include <cassert>
 #include "diff.h"
 
-class IntSet
-{
-public:
-	void Add(int val) { m_map[val] = 1; }
-	void Remove(int val) { m_map.erase(val); }
-	size_t count() const { return m_map.size(); }
-	bool isPresent(int val) const { m_map.find(val) != m_map.end(); }
-	int getSingle() const { return m_map.begin()->first; }
-private:
-	std::map<int, int> m_map;
-};
-
 /** 
- * @brief  Set of equivalent lines
+ * @brief  Sets of equivalent changed lines
+ * The equivalency codes of diffutils are dense, so the group of a line is
+ * found by indexing an array with its code. A group keeps only the count
+ * and the sum of the line numbers still in it per side: the line number
+ * is needed only when it is the single one left.
  * This uses diffutils line numbers, which are counted from the prefix
  */
-struct EqGroup
-{
-	IntSet m_lines0; // equivalent lines on side#0
-	IntSet m_lines1; // equivalent lines on side#1
-
-	bool isPerfectMatch() const { return m_lines0.count()==1 && m_lines1.count()==1; }
-};
-
-
-/** @brief  Maps equivalency code to equivalency group */
-class CodeToGroupMap
+class EqGroupTable
 {
 public:
-	std::map<int, EqGroup *> m_map;
-	/** @brief Add a line to the appropriate equivalency group */
-	void Add(int lineno, int eqcode, int nside)
+	explicit EqGroupTable(const struct file_data fd[]);
+
+	/** @brief Add a changed line to the group of its equivalency code */
+	void Add(int lineno, int nside)
 	{
-		EqGroup *pgroup = find(eqcode);
-		if (pgroup == NULL)
+		int &group = m_groupOf[m_fd[nside].equivs[lineno]];
+		if (group < 0)
 		{
-			pgroup = new EqGroup;
-			m_map[eqcode] = pgroup;
+			EqGroup newgroup = { { 0, 0 }, { 0, 0 } };
+			group = static_cast<int>(m_groups.size());
+			m_groups.push_back(newgroup);
 		}
-		if (nside)
-			pgroup->m_lines1.Add(lineno);
-		else
-			pgroup->m_lines0.Add(lineno);
+		m_groups[group].count[nside]++;
+		m_groups[group].sum[nside] += lineno;
+		m_present[nside][lineno] = true;
 	}
 
-	/** @brief Return the appropriate equivalency group */
-	EqGroup * find(int eqcode)
+	/** @brief Remove a line from its group, if it is in one */
+	void Remove(int lineno, int nside)
 	{
-		std::map<int, EqGroup *>::const_iterator it = m_map.find(eqcode);
-		return it != m_map.end() ? it->second : NULL;
+		if (lineno < 0 || lineno >= static_cast<int>(m_present[nside].size()) || !m_present[nside][lineno])
+			return;
+		EqGroup &group = m_groups[m_groupOf[m_fd[nside].equivs[lineno]]];
+		group.count[nside]--;
+		group.sum[nside] -= lineno;
+		m_present[nside][lineno] = false;
 	}
 
-	~CodeToGroupMap()
+	/** @brief Return the group of the equivalency code of a line, or -1 */
+	int find(int lineno, int nside) const
 	{
-		std::map<int, EqGroup *>::const_iterator pos = m_map.begin();
-		while (pos != m_map.end())
-			delete pos++->second;
+		if (lineno < 0 || lineno >= m_fd[nside].buffered_lines)
+			return -1;
+		int eqcode = m_fd[nside].equivs[lineno];
+		if (eqcode < 0 || eqcode >= static_cast<int>(m_groupOf.size()))
+			return -1;
+		return m_groupOf[eqcode];
 	}
+
+	bool isPerfectMatch(int group) const { return m_groups[group].count[0]==1 && m_groups[group].count[1]==1; }
+	/** @brief Return the single line left on a side of a group */
+	int getSingle(int group, int nside) const { return static_cast<int>(m_groups[group].sum[nside]); }
+
+private:
+	struct EqGroup
+	{
+		int count[2]; // count of lines on each side
+		long long sum[2]; // sum of the line numbers on each side
+	};
+
+	const struct file_data *m_fd;
+	std::vector<int> m_groupOf; // group of each equivalency code, -1 if no changed line has it
+	std::vector<EqGroup> m_groups;
+	std::vector<bool> m_present[2]; // is the line in its group?
 };
 
+EqGroupTable::EqGroupTable(const struct file_data fd[])
+: m_fd(fd)
+, m_groupOf(fd[0].equiv_max, -1)
+{
+	m_present[0].resize(fd[0].buffered_lines);
+	m_present[1].resize(fd[1].buffered_lines);
+}
+
 /*
  WinMerge moved block code
  This is called by diffutils code, by diff_2_files routine (in ANALYZE.C)
@@ -96,8 +111,8 @@ public:
 */
 extern "C" void moved_block_analysis(struct change ** pscript, struct file_data fd[])
 {
-	// Hash all altered lines
-	CodeToGroupMap map;
+	// Group all altered lines
+	EqGroupTable map(fd);
 
 	struct change * script = *pscript;
 	struct change *p,*e;
@@ -106,9 +121,9 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 		p = e->link;
 		int i=0;
 		for (i=e->line0; i-(e->line0) < (e->deleted); ++i)
-			map.Add(i, fd[0].equivs[i], 0);
+			map.Add(i, 0);
 		for (i=e->line1; i-(e->line1) < (e->inserted); ++i)
-			map.Add(i, fd[1].equivs[i], 1);
+			map.Add(i, 1);
 	}
 
 
@@ -119,24 +134,24 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 	{
 		// scan down block for a match
 		p = e->link;
-		EqGroup * pgroup = 0;
+		int group = -1;
 		int i=0;
 		for (i=e->line0; i-(e->line0) < (e->deleted); ++i)
 		{
-			EqGroup * tempgroup = map.find(fd[0].equivs[i]);
-			if (tempgroup->isPerfectMatch())
+			int tempgroup = map.find(i, 0);
+			if (map.isPerfectMatch(tempgroup))
 			{
-				pgroup = tempgroup;
+				group = tempgroup;
 				break;
 			}
 		}
 
 		// if no match, go to next diff block
-		if (!pgroup)
+		if (group < 0)
 			continue;
 
 		// found a match
-		int j = pgroup->m_lines1.getSingle();
+		int j = map.getSingle(group, 1);
 		// Ok, now our moved block is the single line i,j
 
 		// extend moved block upward as far as possible
@@ -144,12 +159,10 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 		int j1 = j-1;
 		for ( ; i1>=e->line0; --i1, --j1)
 		{
-			EqGroup * pgroup0 = map.find(fd[0].equivs[i1]);
-			EqGroup * pgroup1 = map.find(fd[1].equivs[j1]);
-			if (pgroup0 != pgroup1)
+			if (map.find(i1, 0) != map.find(j1, 1))
 				break;
-			pgroup0->m_lines0.Remove(i1);
-			pgroup1->m_lines1.Remove(j1);
+			map.Remove(i1, 0);
+			map.Remove(j1, 1);
 		}
 		++i1;
 		++j1;
@@ -160,12 +173,10 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 		int j2 = j+1;
 		for ( ; i2-(e->line0) < (e->deleted); ++i2,++j2)
 		{
-			EqGroup * pgroup0 = map.find(fd[0].equivs[i2]);
-			EqGroup * pgroup1 = map.find(fd[1].equivs[j2]);
-			if (pgroup0 != pgroup1)
+			if (map.find(i2, 0) != map.find(j2, 1))
 				break;
-			pgroup0->m_lines0.Remove(i2);
-			pgroup1->m_lines1.Remove(j2);
+			map.Remove(i2, 0);
+			map.Remove(j2, 1);
 		}
 		--i2;
 		--j2;
@@ -237,24 +248,24 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 	{
 		// scan down block for a match
 		p = e->link;
-		EqGroup * pgroup = 0;
+		int group = -1;
 		int j=0;
 		for (j=e->line1; j-(e->line1) < (e->inserted); ++j)
 		{
-			EqGroup * tempgroup = map.find(fd[1].equivs[j]);
-			if (tempgroup->isPerfectMatch())
+			int tempgroup = map.find(j, 1);
+			if (map.isPerfectMatch(tempgroup))
 			{
-				pgroup = tempgroup;
+				group = tempgroup;
 				break;
 			}
 		}
 
 		// if no match, go to next diff block
-		if (!pgroup)
+		if (group < 0)
 			continue;
 
 		// found a match
-		int i = pgroup->m_lines0.getSingle();
+		int i = map.getSingle(group, 0);
 		// Ok, now our moved block is the single line i,j
 
 		// extend moved block upward as far as possible
@@ -262,12 +273,10 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 		int j1 = j-1;
 		for ( ; j1>=e->line1; --i1, --j1)
 		{
-			EqGroup * pgroup0 = map.find(fd[0].equivs[i1]);
-			EqGroup * pgroup1 = map.find(fd[1].equivs[j1]);
-			if (pgroup0 != pgroup1)
+			if (map.find(i1, 0) != map.find(j1, 1))
 				break;
-			pgroup0->m_lines0.Remove(i1);
-			pgroup1->m_lines1.Remove(j1);
+			map.Remove(i1, 0);
+			map.Remove(j1, 1);
 		}
 		++i1;
 		++j1;
@@ -278,12 +287,10 @@ extern "C" void moved_block_analysis(struct change ** pscript, struct file_data
 		int j2 = j+1;
 		for ( ; j2-(e->line1) < (e->inserted); ++i2,++j2)
 		{
-			EqGroup * pgroup0 = map.find(fd[0].equivs[i2]);
-			EqGroup * pgroup1 = map.find(fd[1].equivs[j2]);
-			if (pgroup0 != pgroup1)
+			if (map.find(i2, 0) != map.find(j2, 1))
 				break;
-			pgroup0->m_lines0.Remove(i2);
-			pgroup1->m_lines1.Remove(j2);
+			map.Remove(i2, 0);
+			map.Remove(j2, 1);
 		}
 		--i2;
 		--j2;
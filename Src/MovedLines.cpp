@@ -29,6 +29,8 @@ void MovedLines::Add(ML_SIDE side1, unsigned line1,	unsigned line2)
 	else
 		list = &m_moved1;
 
+	if (line1 >= list->size())
+		list->resize(line1 + 1, -1);
 	(*list)[line1] = line2;
 }
 
@@ -50,12 +52,7 @@ int MovedLines::LineInBlock(unsigned line, ML_SIDE side) const
  */
 int MovedLines::FirstSideInMovedBlock(unsigned secondSideLine) const
 {
-	MovedLinesMap::const_iterator iter;
-	iter = m_moved1.find(secondSideLine);
-	if (iter != m_moved1.end())
-		return iter->second;
-	else
-		return -1;
+	return Find(m_moved1, secondSideLine);
 }
 
 /**
@@ -63,10 +60,16 @@ int MovedLines::FirstSideInMovedBlock(unsigned secondSideLine) const
  */
 int MovedLines::SecondSideInMovedBlock(unsigned firstSideLine) const
 {
-	MovedLinesMap::const_iterator iter;
-	iter = m_moved0.find(firstSideLine);
-	if (iter != m_moved0.end())
-		return iter->second;
+	return Find(m_moved0, firstSideLine);
+}
+
+/**
+ * @brief Get the line a line was moved to, or -1 if it was not moved.
+ */
+int MovedLines::Find(const MovedLinesMap &list, unsigned line)
+{
+	if (line < list.size())
+		return list[line];
 	else
 		return -1;
 }
@@ -5,12 +5,13 @@
  */
 #pragma once
 
-#include <map>
+#include <vector>
 
 /**
  * @brief Container class for moved lines/blocks.
  * This class contains list of moved blocs/lines we detect
- * when comparing files.
+ * when comparing files. The lines are kept in arrays indexed by line
+ * number, as most lines are looked up when flagging the moved lines.
  */
 class MovedLines
 {
@@ -31,7 +32,8 @@ protected:
 	int SecondSideInMovedBlock(unsigned firstSideLine) const;
 
 private:
-	typedef std::map<int, int> MovedLinesMap;
-	MovedLinesMap m_moved0; /**< Moved lines map for first side */
-	MovedLinesMap m_moved1; /**< Moved lines map for second side */
+	typedef std::vector<int> MovedLinesMap;
+	static int Find(const MovedLinesMap &list, unsigned line);
+	MovedLinesMap m_moved0; /**< Moved lines map for first side, -1 for lines not moved */
+	MovedLinesMap m_moved1; /**< Moved lines map for second side, -1 for lines not moved */
 };
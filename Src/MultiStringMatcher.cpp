@@ -0,0 +1,144 @@
+/**
+ * @file  MultiStringMatcher.cpp
+ *
+ * @brief Implementation file for MultiStringMatcher class.
+ */
+
+#include "MultiStringMatcher.h"
+#include <cstring>
+
+/**
+ * @brief Constructor.
+ */
+MultiStringMatcher::MultiStringMatcher()
+: m_nclasses(1)
+{
+	memset(m_classOf, 0, sizeof(m_classOf));
+}
+
+/**
+ * @brief Remove all strings.
+ */
+void MultiStringMatcher::Clear()
+{
+	memset(m_classOf, 0, sizeof(m_classOf));
+	m_nclasses = 1;
+	m_strings.clear();
+	m_ids.clear();
+	m_next.clear();
+	m_output.clear();
+	m_outputs.clear();
+}
+
+/**
+ * @brief Add a string to find.
+ * @param [in] str String to find, empty strings are ignored.
+ * @param [in] id Id reported when the string is found.
+ * @note Build() must be called after the strings are added.
+ */
+void MultiStringMatcher::Add(const std::string& str, int id)
+{
+	if (str.empty())
+		return;
+	m_strings.push_back(str);
+	m_ids.push_back(id);
+}
+
+/**
+ * @brief Add a state without transitions.
+ * @return Number of the state.
+ */
+int MultiStringMatcher::AddState()
+{
+	int state = static_cast<int>(m_output.size());
+	m_next.resize(m_next.size() + m_nclasses, -1);
+	m_output.push_back(-1);
+	return state;
+}
+
+/**
+ * @brief Compile the added strings to the automaton.
+ * First a trie of the strings is built, then the missing transitions are
+ * filled in breadth first order from the longest suffix of each state
+ * that is also a state, and the outputs of those suffixes are linked to
+ * the outputs of the state.
+ */
+void MultiStringMatcher::Build()
+{
+	memset(m_classOf, 0, sizeof(m_classOf));
+	m_nclasses = 1;
+	m_next.clear();
+	m_output.clear();
+	m_outputs.clear();
+	if (m_ids.empty())
+		return;
+
+	for (size_t i = 0; i < m_strings.size(); ++i)
+	{
+		for (size_t j = 0; j < m_strings[i].length(); ++j)
+		{
+			unsigned char c = static_cast<unsigned char>(m_strings[i][j]);
+			if (m_classOf[c] == 0)
+				m_classOf[c] = static_cast<unsigned short>(m_nclasses++);
+		}
+	}
+
+	// Trie of the strings
+	AddState();
+	for (size_t i = 0; i < m_strings.size(); ++i)
+	{
+		int state = 0;
+		for (size_t j = 0; j < m_strings[i].length(); ++j)
+		{
+			int cls = m_classOf[static_cast<unsigned char>(m_strings[i][j])];
+			if (m_next[state * m_nclasses + cls] < 0)
+			{
+				int newState = AddState();
+				m_next[state * m_nclasses + cls] = newState;
+			}
+			state = m_next[state * m_nclasses + cls];
+		}
+		Output output = { m_ids[i], m_output[state] };
+		m_output[state] = static_cast<int>(m_outputs.size());
+		m_outputs.push_back(output);
+	}
+
+	// Fill in missing transitions, states in breadth first order
+	std::vector<int> fail(m_output.size(), 0);
+	std::vector<int> queue;
+	queue.reserve(m_output.size());
+	for (int cls = 0; cls < m_nclasses; ++cls)
+	{
+		int& next = m_next[cls];
+		if (next < 0)
+			next = 0;
+		else
+			queue.push_back(next);
+	}
+	for (size_t head = 0; head < queue.size(); ++head)
+	{
+		int state = queue[head];
+		// Strings ending at the longest suffix state also end here
+		if (m_output[state] < 0)
+			m_output[state] = m_output[fail[state]];
+		else
+		{
+			int out = m_output[state];
+			while (m_outputs[out].next >= 0)
+				out = m_outputs[out].next;
+			m_outputs[out].next = m_output[fail[state]];
+		}
+		for (int cls = 0; cls < m_nclasses; ++cls)
+		{
+			int& next = m_next[state * m_nclasses + cls];
+			int suffixNext = m_next[fail[state] * m_nclasses + cls];
+			if (next < 0)
+				next = suffixNext;
+			else
+			{
+				fail[next] = suffixNext;
+				queue.push_back(next);
+			}
+		}
+	}
+}
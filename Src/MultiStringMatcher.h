@@ -0,0 +1,70 @@
+/**
+ * @file  MultiStringMatcher.h
+ *
+ * @brief Declaration file for MultiStringMatcher class.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Finds occurrences of many strings in a text with one scan.
+ *
+ * The strings are compiled to an Aho-Corasick automaton. Scanning a text
+ * costs one table lookup per byte, however many strings there are. Bytes
+ * not occurring in any string share one column of the table, so the table
+ * stays small for the strings of line and file filters.
+ */
+class MultiStringMatcher
+{
+public:
+	MultiStringMatcher();
+
+	void Clear();
+	void Add(const std::string& str, int id);
+	void Build();
+	bool IsEmpty() const { return m_ids.empty(); }
+
+	/**
+	 * @brief Report the strings occurring in a text.
+	 * @param [in] text Text to scan.
+	 * @param [in] len Length of text in bytes.
+	 * @param [in] found Called with the id of each string found, once per
+	 *  occurrence.
+	 * @note Build() must be called after the strings are added.
+	 */
+	template <class Found>
+	void FindAll(const char *text, size_t len, Found found) const
+	{
+		if (m_ids.empty())
+			return;
+		const unsigned char *p = reinterpret_cast<const unsigned char *>(text);
+		const unsigned char *end = p + len;
+		int state = 0;
+		for (; p < end; ++p)
+		{
+			state = m_next[state * m_nclasses + m_classOf[*p]];
+			for (int out = m_output[state]; out >= 0; out = m_outputs[out].next)
+				found(m_outputs[out].id);
+		}
+	}
+
+private:
+	int AddState();
+
+	/** @brief Id of a string ending in a state, linked to the next one. */
+	struct Output
+	{
+		int id;
+		int next;
+	};
+
+	unsigned short m_classOf[256]; /**< Column of each byte in m_next */
+	int m_nclasses; /**< Count of columns in m_next */
+	std::vector<std::string> m_strings; /**< Added strings */
+	std::vector<int> m_ids; /**< Ids of added strings */
+	std::vector<int> m_next; /**< Transitions, indexed by state and column */
+	std::vector<int> m_output; /**< First output of each state, or -1 */
+	std::vector<Output> m_outputs; /**< Outputs of all states */
+};
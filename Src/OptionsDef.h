@@ -155,12 +155,18 @@ extern const String OPT_CMP_IGNORE_CODEPAGE OP("Settings/IgnoreCodepage");
 extern const String OPT_CMP_METHOD OP("Settings/CompMethod2");
 extern const String OPT_CMP_MOVED_BLOCKS OP("Settings/MovedBlocks");
 extern const String OPT_CMP_MATCH_SIMILAR_LINES OP("Settings/MatchSimilarLines");
+extern const String OPT_CMP_DIFF_ALGORITHM OP("Settings/DiffAlgorithm");
 extern const String OPT_CMP_STOP_AFTER_FIRST OP("Settings/StopAfterFirst");
 extern const String OPT_CMP_QUICK_LIMIT OP("Settings/QuickMethodLimit");
 extern const String OPT_CMP_COMPARE_THREADS OP("Settings/CompareThreads");
+extern const String OPT_CMP_COLLECT_THREADS OP("Settings/CollectThreads");
 extern const String OPT_CMP_WALK_UNIQUE_DIRS OP("Settings/ScanUnpairedDir");
 extern const String OPT_CMP_IGNORE_REPARSE_POINTS OP("Settings/IgnoreReparsePoints");
 extern const String OPT_CMP_INCLUDE_SUBDIRS OP("Settings/Recurse");
+extern const String OPT_CMP_INMEMORY_RESCAN OP("Settings/InMemoryRescan");
+extern const String OPT_CMP_INCREMENTAL_RESCAN OP("Settings/IncrementalRescan");
+extern const String OPT_CMP_CONTENT_CACHE OP("Settings/ContentCache");
+extern const String OPT_CMP_CONTENT_CACHE_LIMIT OP("Settings/ContentCacheLimit");
 
 // Image Compare options
 extern const String OPT_CMP_IMG_FILEPATTERNS OP("Settings/ImageFilePatterns");
@@ -123,10 +123,15 @@ void Init(COptionsMgr *pOptions)
 	pOptions->InitOption(OPT_CMP_STOP_AFTER_FIRST, false);
 	pOptions->InitOption(OPT_CMP_QUICK_LIMIT, 4 * 1024 * 1024); // 4 Megs
 	pOptions->InitOption(OPT_CMP_COMPARE_THREADS, -1);
+	pOptions->InitOption(OPT_CMP_COLLECT_THREADS, 0);
 	pOptions->InitOption(OPT_CMP_WALK_UNIQUE_DIRS, false);
 	pOptions->InitOption(OPT_CMP_IGNORE_REPARSE_POINTS, false);
 	pOptions->InitOption(OPT_CMP_IGNORE_CODEPAGE, true);
 	pOptions->InitOption(OPT_CMP_INCLUDE_SUBDIRS, true);
+	pOptions->InitOption(OPT_CMP_INMEMORY_RESCAN, true);
+	pOptions->InitOption(OPT_CMP_INCREMENTAL_RESCAN, true);
+	pOptions->InitOption(OPT_CMP_CONTENT_CACHE, false);
+	pOptions->InitOption(OPT_CMP_CONTENT_CACHE_LIMIT, 100000); // files
 
 	pOptions->InitOption(OPT_CMP_BIN_FILEPATTERNS, _T("*.bin;*.frx"));
 
@@ -0,0 +1,430 @@
+/**
+ * @file  PatchFileWriter.cpp
+ *
+ * @brief Implementation file for PatchFileWriter
+ */
+
+#include "PatchFileWriter.h"
+#include <cassert>
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <io.h>
+#include <fcntl.h>
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/Thread.h>
+#include <Poco/Runnable.h>
+#include <Poco/Mutex.h>
+#include <Poco/Condition.h>
+#include <Poco/Exception.h>
+#include "IAbortable.h"
+#include "Environment.h"
+
+using Poco::FastMutex;
+using Poco::Condition;
+
+/** @brief Size of the buffer used for copying parts to the patch file. */
+static const size_t CopyBufferSize = 64 * 1024;
+
+/** @brief Milliseconds between checks for abort while waiting for parts. */
+static const long AbortCheckInterval = 100;
+
+/**
+ * @brief Runs the workers rendering parts, and hands the parts to the
+ * writing thread in order.
+ */
+class PatchFileWriter::Scheduler
+{
+public:
+	Scheduler(PatchFileWriter& writer, size_t count, const RenderFunc& render);
+	~Scheduler();
+	int Start(int nworkers);
+	size_t Write(const IAbortable *pAbortable);
+
+private:
+	/** @brief State of a part. */
+	enum PartState { PART_PENDING, PART_DONE, PART_FAILED };
+
+	class Worker: public Poco::Runnable
+	{
+	public:
+		Worker(Scheduler& scheduler, int id): m_scheduler(scheduler), m_id(id) {}
+		void run() { m_scheduler.Run(m_id); }
+	private:
+		Scheduler& m_scheduler;
+		int m_id;
+	};
+
+	void Run(int id);
+	void Stop();
+
+	PatchFileWriter& m_writer;
+	const RenderFunc& m_render;
+	size_t m_count; /**< Count of parts */
+	size_t m_next; /**< Index of the next part to render */
+	int m_nMaxBuffers; /**< Max count of buffers in use */
+	std::vector<FILE *> m_parts; /**< Buffers of parts rendered and not written */
+	std::vector<char> m_states; /**< PartState of each part */
+	std::vector<std::exception_ptr> m_exceptions; /**< Exceptions thrown by rendering parts */
+	std::vector<std::unique_ptr<Worker> > m_workers;
+	std::vector<std::unique_ptr<Poco::Thread> > m_threads; /**< Started threads */
+	FastMutex m_mutex;
+	Condition m_condition; /**< Signaled when parts are done or buffers freed */
+	bool m_bStop;
+};
+
+PatchFileWriter::Scheduler::Scheduler(PatchFileWriter& writer, size_t count, const RenderFunc& render)
+: m_writer(writer)
+, m_render(render)
+, m_count(count)
+, m_next(0)
+, m_nMaxBuffers(0)
+, m_parts(count, NULL)
+, m_states(count, PART_PENDING)
+, m_exceptions(count)
+, m_bStop(false)
+{
+}
+
+PatchFileWriter::Scheduler::~Scheduler()
+{
+	Stop();
+}
+
+/**
+ * @brief Start worker threads.
+ * @return Count of threads started.
+ */
+int PatchFileWriter::Scheduler::Start(int nworkers)
+{
+	m_nMaxBuffers = 2 * nworkers;
+	for (int i = 0; i < nworkers; ++i)
+	{
+		m_workers.push_back(std::unique_ptr<Worker>(new Worker(*this, i)));
+		std::unique_ptr<Poco::Thread> thread(new Poco::Thread);
+		try
+		{
+			thread->start(*m_workers.back());
+		}
+		catch (Poco::Exception&)
+		{
+			m_workers.pop_back();
+			break;
+		}
+		m_threads.push_back(std::move(thread));
+	}
+	return static_cast<int>(m_threads.size());
+}
+
+/**
+ * @brief Stop the workers and free the buffers of the parts not written.
+ */
+void PatchFileWriter::Scheduler::Stop()
+{
+	{
+		FastMutex::ScopedLock lock(m_mutex);
+		m_bStop = true;
+		m_condition.broadcast();
+	}
+	for (size_t i = 0; i < m_threads.size(); ++i)
+		m_threads[i]->join();
+	m_threads.clear();
+	for (size_t i = 0; i < m_parts.size(); ++i)
+	{
+		if (m_parts[i])
+		{
+			m_writer.ReleaseBuffer(m_parts[i]);
+			m_parts[i] = NULL;
+		}
+	}
+}
+
+/**
+ * @brief Render parts in a worker thread, in the order of their indexes.
+ * A part is taken only when a buffer is available for it, so that workers
+ * do not get too far ahead of the writing thread.
+ */
+void PatchFileWriter::Scheduler::Run(int id)
+{
+	for (;;)
+	{
+		size_t index;
+		FILE *buffer = NULL;
+		{
+			FastMutex::ScopedLock lock(m_mutex);
+			while (!m_bStop && m_next < m_count &&
+				m_writer.m_freeBuffers.empty() && m_writer.m_nBuffers >= m_nMaxBuffers)
+				m_condition.wait(m_mutex);
+			if (m_bStop || m_next >= m_count)
+				return;
+			index = m_next++;
+			buffer = m_writer.AcquireBuffer();
+			if (!buffer)
+			{
+				m_states[index] = PART_FAILED;
+				m_condition.broadcast();
+				return;
+			}
+		}
+
+		bool bRendered = false;
+		std::exception_ptr exception;
+		try
+		{
+			bRendered = m_render(id, index, buffer);
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		FastMutex::ScopedLock lock(m_mutex);
+		m_parts[index] = buffer;
+		m_exceptions[index] = exception;
+		m_states[index] = bRendered ? PART_DONE : PART_FAILED;
+		m_condition.broadcast();
+	}
+}
+
+/**
+ * @brief Write the parts in order as they are rendered.
+ * An exception thrown by rendering a part is thrown once the parts before
+ * it have been written.
+ * @return Count of parts written.
+ */
+size_t PatchFileWriter::Scheduler::Write(const IAbortable *pAbortable)
+{
+	size_t written = 0;
+	while (written < m_count)
+	{
+		FILE *buffer;
+		PartState state;
+		{
+			FastMutex::ScopedLock lock(m_mutex);
+			for (;;)
+			{
+				if (pAbortable && pAbortable->ShouldAbort())
+					return written;
+				if (m_states[written] != PART_PENDING)
+					break;
+				m_condition.tryWait(m_mutex, AbortCheckInterval);
+			}
+			state = static_cast<PartState>(m_states[written]);
+			buffer = m_parts[written];
+			m_parts[written] = NULL;
+		}
+
+		bool bCopied = false;
+		if (state == PART_DONE)
+			bCopied = m_writer.CopyBuffer(buffer);
+		else if (!buffer)
+			m_writer.m_bFailed = true;
+		{
+			FastMutex::ScopedLock lock(m_mutex);
+			if (buffer)
+				m_writer.ReleaseBuffer(buffer);
+			m_condition.broadcast();
+		}
+		if (m_exceptions[written])
+		{
+			Stop();
+			std::rethrow_exception(m_exceptions[written]);
+		}
+		if (!bCopied)
+			break;
+		++written;
+	}
+	return written;
+}
+
+/**
+ * @brief Constructor.
+ * @param [in] nworkers Count of threads rendering parts. Parts are
+ *  rendered in the calling thread if less than two.
+ */
+PatchFileWriter::PatchFileWriter(int nworkers)
+: m_pFile(NULL)
+, m_nBuffers(0)
+, m_nWorkers(nworkers < 1 ? 1 : nworkers)
+, m_bFailed(false)
+{
+}
+
+/**
+ * @brief Destructor, closes the patch file.
+ */
+PatchFileWriter::~PatchFileWriter()
+{
+	Close();
+}
+
+/**
+ * @brief Open the patch file.
+ * @param [in] path Path of the patch file.
+ * @param [in] bAppend Append to an existing file?
+ * @return true if the file was opened.
+ */
+bool PatchFileWriter::Open(const String& path, bool bAppend)
+{
+	assert(!m_pFile);
+	m_bFailed = false;
+	m_pFile = _tfopen(path.c_str(), bAppend ? _T("ab") : _T("wb"));
+	if (!m_pFile)
+		m_bFailed = true;
+	return m_pFile != NULL;
+}
+
+/**
+ * @brief Print to the patch file in the calling thread.
+ * @param [in] print Function printing to the given stream.
+ * @return true if @p print succeeded and its output was written.
+ */
+bool PatchFileWriter::Write(const PrintFunc& print)
+{
+	FILE *buffer = AcquireBuffer();
+	if (!buffer)
+	{
+		m_bFailed = true;
+		return false;
+	}
+	bool bWritten = false;
+	try
+	{
+		bWritten = print(buffer) && CopyBuffer(buffer);
+	}
+	catch (...)
+	{
+		ReleaseBuffer(buffer);
+		throw;
+	}
+	ReleaseBuffer(buffer);
+	return bWritten;
+}
+
+/**
+ * @brief Render parts of the patch concurrently and write them in order.
+ * Writing stops before the first part which could not be rendered or
+ * written, and when @p pAbortable asks to abort. Parts rendered after it
+ * are discarded.
+ * @param [in] count Count of parts.
+ * @param [in] render Function printing a part.
+ * @param [in] pAbortable Asked whether to abort while waiting for parts,
+ *  or NULL.
+ * @return Count of parts written.
+ */
+size_t PatchFileWriter::WriteParts(size_t count, const RenderFunc& render, const IAbortable *pAbortable)
+{
+	if (!m_pFile || m_bFailed)
+		return 0;
+	if (m_nWorkers > 1 && count > 1)
+	{
+		Scheduler scheduler(*this, count, render);
+		if (scheduler.Start(static_cast<int>((std::min)(count, static_cast<size_t>(m_nWorkers)))) > 0)
+			return scheduler.Write(pAbortable);
+	}
+	return WritePartsSerial(count, render, pAbortable);
+}
+
+/**
+ * @brief Render and write parts one after the other in the calling thread.
+ */
+size_t PatchFileWriter::WritePartsSerial(size_t count, const RenderFunc& render, const IAbortable *pAbortable)
+{
+	size_t written = 0;
+	while (written < count)
+	{
+		if (pAbortable && pAbortable->ShouldAbort())
+			break;
+		if (!Write([&render, written](FILE *stream) { return render(0, written, stream); }))
+			break;
+		++written;
+	}
+	return written;
+}
+
+/**
+ * @brief Close the patch file and free the buffers.
+ * @return true if all parts were written to the file.
+ */
+bool PatchFileWriter::Close()
+{
+	for (size_t i = 0; i < m_freeBuffers.size(); ++i)
+		fclose(m_freeBuffers[i]);
+	m_freeBuffers.clear();
+	m_nBuffers = 0;
+	if (m_pFile)
+	{
+		if (fclose(m_pFile) != 0)
+			m_bFailed = true;
+		m_pFile = NULL;
+	}
+	return !m_bFailed;
+}
+
+/**
+ * @brief Get a buffer to print a part to.
+ * The buffer is a temporary file in text mode, deleted when it is closed.
+ * Windows keeps temporary files in memory as long as there is enough.
+ * @return Buffer, or NULL if no buffer could be created.
+ */
+FILE *PatchFileWriter::AcquireBuffer()
+{
+	if (!m_freeBuffers.empty())
+	{
+		FILE *buffer = m_freeBuffers.back();
+		m_freeBuffers.pop_back();
+		return buffer;
+	}
+	String path = env::GetTemporaryFileName(env::GetTemporaryPath(), _T("PAT"));
+	FILE *buffer = path.empty() ? NULL : _tfopen(path.c_str(), _T("w+TD"));
+	if (buffer)
+		++m_nBuffers;
+	return buffer;
+}
+
+/**
+ * @brief Empty a buffer to be reused.
+ */
+void PatchFileWriter::ReleaseBuffer(FILE *buffer)
+{
+	rewind(buffer);
+	if (_chsize(_fileno(buffer), 0) != 0 || _setmode(_fileno(buffer), _O_TEXT) == -1)
+	{
+		fclose(buffer);
+		--m_nBuffers;
+		return;
+	}
+	m_freeBuffers.push_back(buffer);
+}
+
+/**
+ * @brief Copy what was printed to a buffer to the patch file.
+ * The buffer is read in binary mode to get the bytes printed in text mode.
+ * @return true if the whole buffer was copied.
+ */
+bool PatchFileWriter::CopyBuffer(FILE *buffer)
+{
+	if (fflush(buffer) != 0 || ferror(buffer) || _setmode(_fileno(buffer), _O_BINARY) == -1)
+	{
+		m_bFailed = true;
+		return false;
+	}
+	rewind(buffer);
+	if (m_copyBuffer.empty())
+		m_copyBuffer.resize(CopyBufferSize);
+	size_t size;
+	while ((size = fread(&m_copyBuffer[0], 1, m_copyBuffer.size(), buffer)) > 0)
+	{
+		if (fwrite(&m_copyBuffer[0], 1, size, m_pFile) != size)
+		{
+			m_bFailed = true;
+			return false;
+		}
+	}
+	if (ferror(buffer))
+	{
+		m_bFailed = true;
+		return false;
+	}
+	return true;
+}
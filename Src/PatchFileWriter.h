@@ -0,0 +1,68 @@
+/**
+ * @file  PatchFileWriter.h
+ *
+ * @brief Declaration file for PatchFileWriter.
+ */
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "UnicodeString.h"
+
+class IAbortable;
+
+/**
+ * @brief Writes a patch file from parts rendered concurrently.
+ *
+ * diffutils prints patches to a text mode stream. Each part of the patch
+ * (the patch of one file pair) is printed by a worker thread into a buffer
+ * of its own, which is a short-lived temporary file opened in text mode
+ * the same way the patch file used to be. The buffers are copied byte by
+ * byte, in the order of the parts, to the patch file, which is opened
+ * once in binary mode. So the patch file gets the bytes it would have
+ * gotten if the parts had been printed to it one after the other.
+ *
+ * At most two buffers per worker are in use at a time; a buffer is reused
+ * once its part has been copied.
+ */
+class PatchFileWriter
+{
+public:
+	/**
+	 * @brief Prints one part of the patch.
+	 * Called in worker threads; during one WriteParts() call a worker index
+	 * is always called in the same thread. Returns false if the part could
+	 * not be created, which stops writing before the part.
+	 */
+	typedef std::function<bool(int worker, size_t index, FILE *stream)> RenderFunc;
+	/** @brief Prints to the patch in the calling thread. */
+	typedef std::function<bool(FILE *stream)> PrintFunc;
+
+	explicit PatchFileWriter(int nworkers);
+	~PatchFileWriter();
+	bool Open(const String& path, bool bAppend);
+	bool Write(const PrintFunc& print);
+	size_t WriteParts(size_t count, const RenderFunc& render, const IAbortable *pAbortable = NULL);
+	bool Close();
+	int GetWorkerCount() const { return m_nWorkers; }
+	bool IsFailed() const { return m_bFailed; }
+
+private:
+	PatchFileWriter(const PatchFileWriter&);
+	PatchFileWriter& operator=(const PatchFileWriter&);
+
+	class Scheduler;
+
+	FILE *AcquireBuffer();
+	void ReleaseBuffer(FILE *buffer);
+	bool CopyBuffer(FILE *buffer);
+	size_t WritePartsSerial(size_t count, const RenderFunc& render, const IAbortable *pAbortable);
+
+	FILE *m_pFile; /**< Patch file, opened in binary mode */
+	std::vector<FILE *> m_freeBuffers; /**< Buffers not in use */
+	int m_nBuffers; /**< Count of buffers open */
+	std::vector<char> m_copyBuffer; /**< Buffer for copying parts */
+	int m_nWorkers; /**< Count of worker threads */
+	bool m_bFailed; /**< Did writing to the patch file or a buffer fail? */
+};
@@ -22,10 +22,15 @@
 
 #include "StdAfx.h"
 #include "PatchTool.h"
+#include <algorithm>
+#include <memory>
+#include <Poco/Environment.h>
 #include "UnicodeString.h"
 #include "DiffWrapper.h"
 #include "PathContext.h"
 #include "PatchDlg.h"
+#include "PatchFileWriter.h"
+#include "IAbortable.h"
 #include "paths.h"
 #include "Merge.h"
 
@@ -33,10 +38,47 @@
 #define new DEBUG_NEW
 #endif
 
+using Poco::Environment;
+
+namespace
+{
+
+/**
+ * @brief Aborts creating a patch when Esc is pressed.
+ */
+class PatchAbortable : public IAbortable
+{
+public:
+	PatchAbortable() : m_bAborted(false) {}
+	virtual bool ShouldAbort() const
+	{
+		if (!m_bAborted && ::GetAsyncKeyState(VK_ESCAPE) < 0)
+			m_bAborted = true;
+		return m_bAborted;
+	}
+private:
+	mutable bool m_bAborted;
+};
+
+/**
+ * @brief Result of creating the patch of one file pair.
+ */
+struct PatchResult
+{
+	bool bDiffSuccess;
+	DIFFSTATUS status;
+	PatchResult() : bDiffSuccess(false) {}
+};
+
+}
+
 /**
  * @brief Default constructor.
  */
-CPatchTool::CPatchTool() : m_bOpenToEditor(false)
+CPatchTool::CPatchTool()
+: m_diffOptions()
+, m_patchOptions()
+, m_bOpenToEditor(false)
 {
 }
 
@@ -88,12 +130,15 @@ void CPatchTool::AddFiles(const String &file1, const String &altPath1,
 
 /** 
  * @brief Create a patch from files given.
+ * Patches of the file pairs are created concurrently, each thread diffing
+ * with a CDiffWrapper of its own as diffutils state is thread-local, and
+ * are written to the patch file in the order of the files. Pressing Esc
+ * stops creating the patch.
  * @note Files can be given using AddFiles() or selecting using
  * CPatchDlg.
  */
 int CPatchTool::CreatePatch()
 {
-	DIFFSTATUS status;
 	int retVal = 0;
 
 	CPatchDlg dlgPatch;
@@ -114,51 +159,96 @@ int CPatchTool::CreatePatch()
 			return 0;
 		}
 
-		// Select patch create -mode
-		m_diffWrapper.SetCreatePatchFile(dlgPatch.m_fileResult);
-		m_diffWrapper.SetAppendFiles(dlgPatch.m_appendFile);
-		m_diffWrapper.SetPrediffer(NULL);
-
 		size_t fileCount = dlgPatch.GetItemCount();
-
-		m_diffWrapper.WritePatchFileHeader(dlgPatch.m_outputStyle, dlgPatch.m_appendFile);
-		m_diffWrapper.SetAppendFiles(true);
-
+		std::vector<PATCHFILES> fileList;
 		for (size_t index = 0; index < fileCount; index++)
+			fileList.push_back(dlgPatch.GetItemAt(index));
+
+		String errMsg = strutils::format_string1(_("Could not write to file %1."), dlgPatch.m_fileResult);
+		PatchFileWriter writer(static_cast<int>((std::min)(fileCount, static_cast<size_t>(Environment::processorCount()))));
+		if (!writer.Open(dlgPatch.m_fileResult, dlgPatch.m_appendFile))
 		{
-			const PATCHFILES& files = dlgPatch.GetItemAt(index);
-			String filename1 = files.lfile.length() == 0 ? _T("NUL") : files.lfile;
-			String filename2 = files.rfile.length() == 0 ? _T("NUL") : files.rfile;
-			
-			// Set up DiffWrapper
-			m_diffWrapper.SetPaths(PathContext(filename1, filename2), false);
-			m_diffWrapper.SetAlternativePaths(PathContext(files.pathLeft, files.pathRight));
-			m_diffWrapper.SetCompareFiles(PathContext(files.lfile, files.rfile));
-			bool bDiffSuccess = m_diffWrapper.RunFileDiff();
-			m_diffWrapper.GetDiffStatus(&status);
-
-			if (!bDiffSuccess)
-			{
-				LangMessageBox(IDS_FILEERROR, MB_ICONSTOP);
-				bResult = false;
-				break;
-			}
-			else if (status.bBinaries)
+			AfxMessageBox(errMsg.c_str(), MB_ICONSTOP);
+			dlgPatch.ClearItems();
+			return 0;
+		}
+
+		const enum output_style outputStyle = dlgPatch.m_outputStyle;
+		writer.Write([this, outputStyle](FILE *stream)
 			{
-				LangMessageBox(IDS_CANNOT_CREATE_BINARYPATCH, MB_ICONSTOP);
-				bResult = false;
-				break;
-			}
-			else if (status.bPatchFileFailed)
+				m_diffWrapper.SetCreatePatchStream(stream);
+				m_diffWrapper.WritePatchFileHeader(outputStyle, false);
+				return true;
+			});
+
+		std::vector<std::unique_ptr<CDiffWrapper> > diffWrappers(writer.GetWorkerCount());
+		std::vector<PatchResult> results(fileCount);
+		PatchAbortable abortable;
+		const bool bConcurrent = writer.GetWorkerCount() > 1;
+		size_t written;
+		{
+			CWaitCursor waitstatus;
+			written = writer.WriteParts(fileCount, [&](int worker, size_t index, FILE *stream)
+				{
+					// Created in the thread using it, diffutils state is thread-local
+					std::unique_ptr<CDiffWrapper>& pDiffWrapper = diffWrappers[worker];
+					if (!pDiffWrapper)
+					{
+						pDiffWrapper.reset(new CDiffWrapper);
+						InitDiffWrapper(*pDiffWrapper);
+					}
+					CDiffWrapper& diffWrapper = *pDiffWrapper;
+					const PATCHFILES& files = fileList[index];
+					String filename1 = files.lfile.length() == 0 ? _T("NUL") : files.lfile;
+					String filename2 = files.rfile.length() == 0 ? _T("NUL") : files.rfile;
+
+					// Set up DiffWrapper
+					diffWrapper.SetCreatePatchStream(stream);
+					diffWrapper.SetPaths(PathContext(filename1, filename2), false);
+					diffWrapper.SetAlternativePaths(PathContext(files.pathLeft, files.pathRight));
+					diffWrapper.SetCompareFiles(PathContext(files.lfile, files.rfile));
+					PatchResult& result = results[index];
+					// Files compared concurrently hash their lines on their own
+					// thread only; serial parts run in the calling thread, which
+					// gets its limit back.
+					const int nMaxHashThreads = max_hash_threads;
+					if (bConcurrent)
+						max_hash_threads = 1;
+					result.bDiffSuccess = diffWrapper.RunFileDiff();
+					max_hash_threads = nMaxHashThreads;
+					diffWrapper.GetDiffStatus(&result.status);
+					return result.bDiffSuccess && !result.status.bBinaries && !result.status.bPatchFileFailed;
+				}, &abortable);
+		}
+
+		if (written < fileCount)
+		{
+			// Report why the first file not written failed, if not aborted
+			bResult = false;
+			if (!abortable.ShouldAbort())
 			{
-				String errMsg = strutils::format_string1(_("Could not write to file %1."), dlgPatch.m_fileResult);
-				AfxMessageBox(errMsg.c_str(), MB_ICONSTOP);
-				bResult = false;
-				break;
+				if (writer.IsFailed())
+					AfxMessageBox(errMsg.c_str(), MB_ICONSTOP);
+				else if (!results[written].bDiffSuccess)
+					LangMessageBox(IDS_FILEERROR, MB_ICONSTOP);
+				else if (results[written].status.bBinaries)
+					LangMessageBox(IDS_CANNOT_CREATE_BINARYPATCH, MB_ICONSTOP);
+				else
+					AfxMessageBox(errMsg.c_str(), MB_ICONSTOP);
 			}
 		}
 		
-		m_diffWrapper.WritePatchFileTerminator(dlgPatch.m_outputStyle);
+		writer.Write([this, outputStyle](FILE *stream)
+			{
+				m_diffWrapper.SetCreatePatchStream(stream);
+				m_diffWrapper.WritePatchFileTerminator(outputStyle);
+				return true;
+			});
+		if (!writer.Close() && bResult)
+		{
+			AfxMessageBox(errMsg.c_str(), MB_ICONSTOP);
+			bResult = false;
+		}
 
 		if (bResult && fileCount > 0)
 		{
@@ -185,8 +275,8 @@ int CPatchTool::CreatePatch()
  */
 bool CPatchTool::ShowDialog(CPatchDlg *pDlgPatch)
 {
-	DIFFOPTIONS diffOptions = {0};
-	PATCHOPTIONS patchOptions;
+	DIFFOPTIONS &diffOptions = m_diffOptions;
+	PATCHOPTIONS &patchOptions = m_patchOptions;
 	bool bRetVal = true;
 
 	if (pDlgPatch->DoModal() == IDOK)
@@ -201,22 +291,31 @@ bool CPatchTool::ShowDialog(CPatchDlg *pDlgPatch)
 
 		// Checkbox - can't be wrong
 		patchOptions.bAddCommandline = !!pDlgPatch->m_includeCmdLine;
-		m_diffWrapper.SetPatchOptions(&patchOptions);
 
 		// These are from checkboxes and radiobuttons - can't be wrong
 		diffOptions.nIgnoreWhitespace = pDlgPatch->m_whitespaceCompare;
 		diffOptions.bIgnoreBlankLines = pDlgPatch->m_ignoreBlanks;
-		m_diffWrapper.SetAppendFiles(pDlgPatch->m_appendFile);
 
 		// Use this because non-sensitive setting can't write
 		// patch file EOLs correctly
 		diffOptions.bIgnoreEol = pDlgPatch->m_ignoreEOLDifference;
 		
 		diffOptions.bIgnoreCase = pDlgPatch->m_caseSensitive == false;
-		m_diffWrapper.SetOptions(&diffOptions);
+		InitDiffWrapper(m_diffWrapper);
 	}
 	else
 		return false;
 
 	return bRetVal;
 }
+
+/**
+ * @brief Set up a CDiffWrapper to create patches with the options selected.
+ * @param [in,out] diffWrapper DiffWrapper to set up.
+ */
+void CPatchTool::InitDiffWrapper(CDiffWrapper &diffWrapper) const
+{
+	diffWrapper.SetPatchOptions(&m_patchOptions);
+	diffWrapper.SetOptions(&m_diffOptions);
+	diffWrapper.SetPrediffer(NULL);
+}
@@ -70,10 +70,13 @@ public:
 
 protected:
 	bool ShowDialog(CPatchDlg *pDlgPatch);
+	void InitDiffWrapper(CDiffWrapper &diffWrapper) const;
 
 private:
     std::vector<PATCHFILES> m_fileList; /**< List of files to patch. */
-	CDiffWrapper m_diffWrapper; /**< DiffWrapper instance we use to create patch. */
+	CDiffWrapper m_diffWrapper; /**< DiffWrapper instance writing patch header and terminator. */
+	DIFFOPTIONS m_diffOptions; /**< Compare options selected for the patch. */
+	PATCHOPTIONS m_patchOptions; /**< Patch options selected. */
 	String m_sPatchFile; /**< Patch file path and filename. */
 	bool m_bOpenToEditor; /**< Is patch file opened to external editor? */
 };
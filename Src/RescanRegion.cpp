@@ -0,0 +1,113 @@
+/**
+ * @file  RescanRegion.cpp
+ *
+ * @brief Implementation file for RescanRegion struct
+ */
+
+#include "RescanRegion.h"
+#include <algorithm>
+#include <vector>
+#include "DiffWrapper.h"
+
+/**
+ * @brief Find the lines to compare again.
+ * @param [in] diffList Diffs of the previous compare.
+ * @param [in] nRealLines Line counts of the previous compare.
+ * @param [in] nFirst First edited line of each file, or INT_MAX if the
+ *  file was not edited.
+ * @param [in] nLast Last edited line of each file, or -1 if the file was
+ *  not edited.
+ * @return true if the edited lines lie between unchanged line pairs,
+ *  false if the files must be compared again as a whole.
+ */
+bool RescanRegion::Find(const DiffList & diffList, const int nRealLines[2],
+		const int nFirst[2], const int nLast[2])
+{
+	// Run n starts after diff n-1 and ends before diff n
+	const int nDiffs = diffList.GetSize();
+	int nBuffer;
+	nStartDiff = -1;
+	nEndDiff = -1;
+	std::fill(nStart, nStart + 2, 0);
+	std::fill(nEnd, nEnd + 2, 0);
+	for (int nRun = 0; nRun <= nDiffs && nEndDiff < 0; nRun++)
+	{
+		int nRunBegin[2], nRunLength[2];
+		for (nBuffer = 0; nBuffer < 2; nBuffer++)
+		{
+			nRunBegin[nBuffer] = (nRun == 0) ? 0 : diffList.DiffRangeAt(nRun - 1)->end[nBuffer] + 1;
+			int nRunEnd = (nRun < nDiffs) ?
+				diffList.DiffRangeAt(nRun)->begin[nBuffer] : nRealLines[nBuffer];
+			nRunLength[nBuffer] = nRunEnd - nRunBegin[nBuffer];
+		}
+		// Lines of a run pair one-to-one; only the tail may differ by EOL at EOF
+		if (nRun < nDiffs && nRunLength[0] != nRunLength[1])
+			return false;
+		const int nLength = (std::max)(0, (std::min)(nRunLength[0], nRunLength[1]));
+
+		// Diffs next to the region could join diffs in it, so an unchanged
+		// line pair is left between them
+		int t = (std::min)(nLength, (std::min)(nFirst[0] - nRunBegin[0], nFirst[1] - nRunBegin[1]));
+		if (t > 0 || (t == 0 && nRun == 0))
+		{
+			nStartDiff = nRun;
+			for (nBuffer = 0; nBuffer < 2; nBuffer++)
+				nStart[nBuffer] = nRunBegin[nBuffer] + t;
+		}
+
+		t = (std::max)(0, (std::max)(nLast[0] + 1 - nRunBegin[0], nLast[1] + 1 - nRunBegin[1]));
+		if (t < nLength && nStartDiff >= 0)
+		{
+			nEndDiff = nRun;
+			for (nBuffer = 0; nBuffer < 2; nBuffer++)
+				nEnd[nBuffer] = nRunBegin[nBuffer] + t;
+		}
+	}
+	if (nStartDiff < 0)
+		return false;
+	bToEOF = (nEndDiff < 0);
+	if (bToEOF)
+		nEndDiff = nDiffs;
+	return true;
+}
+
+/**
+ * @brief Replace the diffs of the region by the diffs of comparing it again.
+ * @param [in,out] diffList Diffs of the previous compare, updated.
+ * @param [in] regionDiffs Diffs of the lines of the region, numbered from
+ *  the start of the region.
+ * @param [in] regionStatus Status of comparing the lines of the region.
+ * @param [in] nDelta Count of lines inserted (or deleted, if negative) in
+ *  each file by the edit.
+ * @param [out] status Status of comparing the files as a whole.
+ */
+void RescanRegion::Splice(DiffList & diffList, const DiffList & regionDiffs,
+		const DIFFSTATUS & regionStatus, const int nDelta[2], DIFFSTATUS & status) const
+{
+	const int nDiffs = diffList.GetSize();
+	const bool bKeepDiffs = nStartDiff > 0 || nEndDiff < nDiffs;
+	std::vector<DiffRangeInfo> olddiffs = diffList.GetDiffRangeInfoVector();
+	diffList.Clear();
+	int nDiff;
+	for (nDiff = 0; nDiff < nStartDiff; nDiff++)
+		diffList.AddDiff(olddiffs[nDiff]);
+	int offset[3] = {nStart[0], nStart[1], 0};
+	diffList.AppendDiffList(regionDiffs, offset);
+	for (nDiff = nEndDiff; nDiff < nDiffs; nDiff++)
+	{
+		DIFFRANGE dr = olddiffs[nDiff];
+		for (int nBuffer = 0; nBuffer < 2; nBuffer++)
+		{
+			dr.begin[nBuffer] += nDelta[nBuffer];
+			dr.end[nBuffer] += nDelta[nBuffer];
+		}
+		diffList.AddDiff(dr);
+	}
+
+	// Only a region reaching EOF knows about missing EOLs. A kept diff
+	// means the files differ, trivially or not, as for a whole compare.
+	status = DIFFSTATUS();
+	if (bToEOF)
+		std::copy(regionStatus.bMissingNL, regionStatus.bMissingNL + 2, status.bMissingNL);
+	status.Identical = bKeepDiffs ? IDENTLEVEL_NONE : regionStatus.Identical;
+}
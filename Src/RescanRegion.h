@@ -0,0 +1,36 @@
+/**
+ * @file  RescanRegion.h
+ *
+ * @brief Declaration of RescanRegion struct
+ */
+#pragma once
+
+#include "DiffList.h"
+
+struct DIFFSTATUS;
+
+/**
+ * @brief Lines of a 2-way compare to compare again after an edit.
+ *
+ * The equal line runs between the diffs of the previous compare are
+ * searched for the last line pair before and the first line pair after
+ * the edited lines. Diffs outside these anchors are kept (diffs after
+ * the region are shifted by the count of inserted/deleted lines), diffs
+ * between them are replaced by a diff of the text between the anchors.
+ *
+ * Line numbers are real line numbers (without ghost lines) of the
+ * previous compare unless told otherwise.
+ */
+struct RescanRegion
+{
+	int nStartDiff; /**< Diffs before this diff are kept */
+	int nEndDiff; /**< Diffs from this diff on are kept and shifted */
+	int nStart[2]; /**< First line compared again */
+	int nEnd[2]; /**< Line after the lines compared again */
+	bool bToEOF; /**< Are lines compared again up to end of files? */
+
+	bool Find(const DiffList & diffList, const int nRealLines[2],
+		const int nFirst[2], const int nLast[2]);
+	void Splice(DiffList & diffList, const DiffList & regionDiffs,
+		const DIFFSTATUS & regionStatus, const int nDelta[2], DIFFSTATUS & status) const;
+};
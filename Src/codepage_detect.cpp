@@ -189,12 +189,14 @@ static unsigned demoGuessEncoding_rc(const char *src, size_t len, int defcodepag
  * @param [in] ext File extension.
  * @param [in] src File contents (as a string).
  * @param [in] len Size of the file contents string.
+ * @param [out] pbPureAscii Gets true if contents are only ASCII.
  * @return Codepage number.
  */
-static unsigned GuessEncoding_from_bytes(const String& ext, const char *src, size_t len, int guessEncodingType)
+static unsigned GuessEncoding_from_bytes(const String& ext, const char *src, size_t len, int guessEncodingType,
+		bool *pbPureAscii)
 {
 	unsigned cp = ucr::getDefaultCodepage();
-	if (!ucr::CheckForInvalidUtf8(src, len))
+	if (!ucr::CheckForInvalidUtf8(src, len, pbPureAscii))
 		cp = ucr::CP_UTF_8;
 	else if (guessEncodingType & 2)
 	{
@@ -225,15 +227,20 @@ static unsigned GuessEncoding_from_bytes(const String& ext, const char *src, siz
 }
 
 /**
- * @brief Try to deduce encoding for this file.
+ * @brief Try to deduce encoding from file image.
  * @param [in] filepath Full path to the file.
- * @param [in] bGuessEncoding Try to guess codepage (not just unicode encoding).
+ * @param [in] fi Beginning of the file contents.
+ * @param [in] guessEncodingType Try to guess codepage (not just unicode encoding).
+ * @param [in] mapmaxlen Max count of bytes in file image.
+ * @param [out] pbPureAscii If not NULL, gets true if whole file is in the
+ * image and has only ASCII bytes.
  * @return Structure getting the encoding info.
  */
-FileTextEncoding GuessCodepageEncoding(const String& filepath, int guessEncodingType, int mapmaxlen)
+static FileTextEncoding GuessCodepageEncoding(const String& filepath, const CMarkdown::FileImage& fi,
+		int guessEncodingType, int mapmaxlen, bool *pbPureAscii)
 {
 	FileTextEncoding encoding;
-	CMarkdown::FileImage fi(filepath.c_str(), mapmaxlen);
+	bool bPureAscii = false;
 	encoding.SetCodepage(ucr::getDefaultCodepage());
 	encoding.m_bom = false;
 	switch (fi.nByteOrder)
@@ -277,10 +284,51 @@ FileTextEncoding GuessCodepageEncoding(const String& filepath, int guessEncoding
 				}
 			}
 		}
-		if (unsigned cp = GuessEncoding_from_bytes(ext, src, len, guessEncodingType))
+		if (unsigned cp = GuessEncoding_from_bytes(ext, src, len, guessEncodingType, &bPureAscii))
 			encoding.SetCodepage(cp);
 		else
 			encoding.SetCodepage(ucr::getDefaultCodepage());
 	}
+	else if (fi.nByteOrder < 4 && pbPureAscii)
+	{
+		ucr::CheckForInvalidUtf8((const char *)fi.pImage, fi.cbImage, &bPureAscii);
+	}
+	if (pbPureAscii)
+		*pbPureAscii = bPureAscii && (mapmaxlen < 0 || fi.cbImage < static_cast<size_t>(mapmaxlen));
 	return encoding;
 }
+
+/**
+ * @brief Try to deduce encoding for this file.
+ * @param [in] filepath Full path to the file.
+ * @param [in] bGuessEncoding Try to guess codepage (not just unicode encoding).
+ * @param [out] pbPureAscii If not NULL, gets true if file has only ASCII
+ * bytes, so its text is the same in all ASCII based codepages.
+ * @return Structure getting the encoding info.
+ */
+FileTextEncoding GuessCodepageEncoding(const String& filepath, int guessEncodingType, int mapmaxlen,
+		bool *pbPureAscii)
+{
+	CMarkdown::FileImage fi(filepath.c_str(), mapmaxlen);
+	return GuessCodepageEncoding(filepath, fi, guessEncodingType, mapmaxlen, pbPureAscii);
+}
+
+/**
+ * @brief Try to deduce encoding for file contents already read to memory.
+ * Gives the same result as reading the file by its path.
+ * @param [in] filepath Full path to the file (for its extension).
+ * @param [in] src Beginning of the file contents.
+ * @param [in] len Count of bytes in src.
+ * @param [in] guessEncodingType Try to guess codepage (not just unicode encoding).
+ * @param [out] pbPureAscii If not NULL, gets true if src is the whole file
+ * and has only ASCII bytes.
+ * @return Structure getting the encoding info.
+ */
+FileTextEncoding GuessCodepageEncoding(const String& filepath, const char *src, size_t len,
+		int guessEncodingType, int mapmaxlen, bool *pbPureAscii)
+{
+	if (mapmaxlen >= 0 && len > static_cast<size_t>(mapmaxlen))
+		len = mapmaxlen;
+	CMarkdown::FileImage fi(reinterpret_cast<const TCHAR *>(src), len, CMarkdown::FileImage::Mapping);
+	return GuessCodepageEncoding(filepath, fi, guessEncodingType, mapmaxlen, pbPureAscii);
+}
@@ -11,4 +11,7 @@
 /** @brief Buffer size used in this file. */
 static const int BufSize = 65536;
 
-FileTextEncoding GuessCodepageEncoding(const String& filepath, int guessEncodingType, int mapmaxlen = BufSize);
+FileTextEncoding GuessCodepageEncoding(const String& filepath, int guessEncodingType, int mapmaxlen = BufSize,
+		bool *pbPureAscii = nullptr);
+FileTextEncoding GuessCodepageEncoding(const String& filepath, const char *src, size_t len,
+		int guessEncodingType, int mapmaxlen = BufSize, bool *pbPureAscii = nullptr);
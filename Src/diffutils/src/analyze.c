@@ -67,6 +67,7 @@ static struct change *build_reverse_script PARAMS((struct file_data const[]));
 static struct change *build_script PARAMS((struct file_data const[]));
 static void briefly_report PARAMS((int, struct file_data const[]));
 static void compareseq PARAMS((int, int, int, int, int));
+static void compareseq_fallback PARAMS((int, int, int, int));
 static void discard_confusing_lines PARAMS((struct file_data[]));
 static void shift_boundaries PARAMS((struct file_data[]));
 
@@ -396,6 +397,16 @@ compareseq (xoff, xlim, yoff, ylim, minimal)
     }
 }
 
+/* Compare the subsequences of the two files like `compareseq',
+   for parts that the histogram algorithm can't anchor.  */
+
+static void
+compareseq_fallback (xoff, xlim, yoff, ylim)
+     int xoff, xlim, yoff, ylim;
+{
+  compareseq (xoff, xlim, yoff, ylim, no_discards);
+}
+
 /* Discard lines from one file that have no matches in the other file.
 
    A line which is discarded will not be considered by the actual
@@ -857,7 +868,7 @@ struct change * diff_2_files (struct file_data filevec[], int depth, int * bin_s
 		//  We can now safely assume to have a pair of Binary files.
 
 		// Are both files Open and Regular (no Pipes, Directories, Devices (e.g. NUL))
-		if (filevec[0].desc < 0 || filevec[1].desc < 0 ||
+		if (!FILE_PRESENT_P (&filevec[0]) || !FILE_PRESENT_P (&filevec[1]) ||
 			!(S_ISREG (filevec[0].stat.st_mode)) || !(S_ISREG (filevec[1].stat.st_mode))   )
 			changes = 1;
 		else
@@ -866,7 +877,7 @@ struct change * diff_2_files (struct file_data filevec[], int depth, int * bin_s
 			changes = 1;
 		else
 		//  Identical descriptor implies identical files
-		if (filevec[0].desc == filevec[1].desc)
+		if (SAME_FILE_P (filevec))
 			changes = 0;
 		//  Scan both files, a buffer at a time, looking for a difference.  
 		else
@@ -877,8 +888,10 @@ struct change * diff_2_files (struct file_data filevec[], int depth, int * bin_s
 			for (;;)
 			{
 				//  Read a buffer's worth from both files.  
+				//  Preloaded buffers already hold the whole text,
+				// once consumed they behave like files at end-of-file.
 				for (i = 0; i < 2; i++)
-					while (filevec[i].buffered_chars < buffer_size)
+					while (!filevec[i].preloaded && filevec[i].buffered_chars < buffer_size)
 					  {
 						int r = read (filevec[i].desc,
 									  filevec[i].buffer	+ filevec[i].buffered_chars,
@@ -966,8 +979,10 @@ struct change * diff_2_files (struct file_data filevec[], int depth, int * bin_s
 		files[0] = filevec[0];
 		files[1] = filevec[1];
 		
-		compareseq (0, filevec[0].nondiscarded_lines,
-		  0, filevec[1].nondiscarded_lines, no_discards);
+		if (diff_algorithm != ALGORITHM_HISTOGRAM
+			|| !histogram_diff (filevec, compareseq_fallback))
+		  compareseq (0, filevec[0].nondiscarded_lines,
+		    0, filevec[1].nondiscarded_lines, no_discards);
 		
 		free (fdiag - (filevec[1].nondiscarded_lines + 1));
 		
@@ -109,6 +109,20 @@ EXTERN int      ignore_blank_lines_flag;
 /* WinMerge moved block code */
 EXTERN int moved_blocks_flag;
 
+/* WinMerge: algorithms for finding the changed lines.  */
+enum diff_algorithm {
+  /* Myers' algorithm, with heuristics for big files (default).  */
+  ALGORITHM_MYERS,
+  /* Histogram algorithm, anchored on lines that are rare in the files.  */
+  ALGORITHM_HISTOGRAM
+};
+
+EXTERN int diff_algorithm;
+
+/* WinMerge: most threads to find and hash the lines of files on,
+   0 for a thread per processor.  */
+EXTERN int max_hash_threads;
+
 /* 1 if lines may match even if their lengths are different.
    This depends on various options.  */
 EXTERN int      length_varies;
@@ -236,6 +250,7 @@ struct file_data {
     struct stat     stat;	/* File status from fstat()  */
 #endif
     int             dir_p;	/* nonzero if file is a directory  */
+    int             preloaded;	/* WinMerge: nonzero if buffer was filled from memory, desc is unused  */
 
     /* Buffer in which text of file is read.  */
     char HUGE *	    buffer;
@@ -295,6 +310,15 @@ struct file_data {
     int count_crlfs, count_crs, count_lfs, count_zeros;
 };
 
+/* WinMerge: nonzero if file F can be read, either through its descriptor
+   or because its whole text was preloaded into F->buffer.  */
+#define FILE_PRESENT_P(f) ((f)->desc >= 0 || (f)->preloaded)
+
+/* WinMerge: nonzero if FILEVEC[0] and FILEVEC[1] are the very same file.
+   Preloaded buffers are never shared, even though their descs are equal.  */
+#define SAME_FILE_P(filevec) \
+  ((filevec)[0].desc == (filevec)[1].desc && !(filevec)[0].preloaded && !(filevec)[1].preloaded)
+
 /* Describe the two files currently being compared.  */
 
 EXTERN struct file_data files[2];
@@ -324,6 +348,9 @@ int excluded_filename PARAMS((char const *));
 void print_ed_script PARAMS((struct change *));
 void pr_forward_ed_script PARAMS((struct change *));
 
+/* histogram.c */
+int histogram_diff PARAMS((struct file_data[], void (*) PARAMS((int, int, int, int))));
+
 /* ifdef.c */
 void print_ifdef_script PARAMS((struct change *));
 
@@ -0,0 +1,248 @@
+/* Histogram diff for GNU DIFF (WinMerge addition).
+
+This file is part of GNU DIFF.
+
+GNU DIFF is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+GNU DIFF is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with GNU DIFF; see the file COPYING.  If not, write to
+the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
+
+/* The histogram algorithm extends the patience diff of Bram Cohen:
+   instead of only anchoring on lines that occur once in both files, the
+   run of common lines containing the rarest lines of file 0 is taken as
+   the anchor, and the parts before and after it are compared the same
+   way.  Lines that occur many times (blank lines, braces, repeated log
+   lines) therefore never decide the alignment, and the cost does not
+   grow with the number of differences like the Myers algorithm does.
+
+   The algorithm works on the same vectors as `compareseq': the
+   `undiscarded' equivalence classes and `realindexes' of both files,
+   and it stores its results in their `changed_flag' vectors.  */
+
+#include "diff.h"
+
+/* Lines occurring more often than this in the part of file 0 being
+   compared are not used as anchors.  */
+#define MAX_CHAIN_LENGTH 64
+
+/* Index of the lines of a part of file 0 by equivalence class.  */
+struct histogram
+{
+  int const *xv, *yv;	/* Vectors being compared.  */
+  int *head;		/* Indexed by class: first line of the part in the class.  */
+  int *count;		/* Indexed by class: number of lines of the part in the class.
+			   Zero for all classes between calls of find_anchor.  */
+  int *next;		/* Indexed by line of file 0: next line of the part
+			   in the same class, or -1.  */
+};
+
+/* Lines [XOFF, XLIM) of file 0 and [YOFF, YLIM) of file 1.  */
+struct region
+{
+  int xoff, xlim, yoff, ylim;
+};
+
+static int find_anchor PARAMS((struct histogram *, struct region const *, struct region *));
+static void mark_changed PARAMS((struct file_data[], struct region const *));
+
+/* Find the run of common lines in region R to split it at.
+   Of the runs that contain a line occurring at most MAX_CHAIN_LENGTH
+   times in file 0, the one with the rarest line is chosen; longer runs
+   win over equally rare ones.
+   Return 1 and set ANCHOR to the run if one was found, 0 if the parts
+   of the files have no common lines, or -1 if all their common lines
+   occur too often.  */
+
+static int
+find_anchor (struct histogram *h, struct region const *r, struct region *anchor)
+{
+  int const *xv = h->xv;
+  int const *yv = h->yv;
+  int *count = h->count;
+  int mincount = MAX_CHAIN_LENGTH;
+  int found = 0, has_common = 0;
+  int x, y, ynext;
+
+  /* Index the lines of file 0, each class in ascending line order.  */
+  for (x = r->xlim - 1; x >= r->xoff; x--)
+    {
+      int c = xv[x];
+      h->next[x] = count[c] ? h->head[c] : -1;
+      h->head[c] = x;
+      count[c]++;
+    }
+
+  for (y = r->yoff; y < r->ylim; y = ynext)
+    {
+      int c = yv[y];
+      ynext = y + 1;
+      if (count[c] == 0)
+	continue;
+      has_common = 1;
+      if (count[c] > mincount)
+	continue;
+      for (x = h->head[c]; x >= 0; )
+	{
+	  int x0 = x, y0 = y, x1 = x + 1, y1 = y + 1;
+	  int rarest = count[c];
+
+	  /* Extend the match to a run of common lines.  */
+	  while (x0 > r->xoff && y0 > r->yoff && xv[x0 - 1] == yv[y0 - 1])
+	    {
+	      --x0, --y0;
+	      if (count[xv[x0]] < rarest)
+		rarest = count[xv[x0]];
+	    }
+	  while (x1 < r->xlim && y1 < r->ylim && xv[x1] == yv[y1])
+	    {
+	      if (count[xv[x1]] < rarest)
+		rarest = count[xv[x1]];
+	      ++x1, ++y1;
+	    }
+	  /* Lines of file 1 in this run can't start a better run.  */
+	  if (ynext < y1)
+	    ynext = y1;
+
+	  if (!found || rarest < mincount
+	      || (rarest == mincount && anchor->xlim - anchor->xoff < x1 - x0))
+	    {
+	      anchor->xoff = x0;
+	      anchor->xlim = x1;
+	      anchor->yoff = y0;
+	      anchor->ylim = y1;
+	      mincount = rarest;
+	      found = 1;
+	    }
+
+	  /* Skip the lines of file 0 in this run.  */
+	  for (x = h->next[x]; x >= 0 && x < x1; x = h->next[x])
+	    ;
+	}
+    }
+
+  for (x = r->xoff; x < r->xlim; x++)
+    count[xv[x]] = 0;
+
+  return found ? 1 : has_common ? -1 : 0;
+}
+
+/* Mark all lines of region R of both files as changed.  */
+
+static void
+mark_changed (struct file_data filevec[], struct region const *r)
+{
+  int i;
+
+  for (i = r->xoff; i < r->xlim; i++)
+    filevec[0].changed_flag[filevec[0].realindexes[i]] = 1;
+  for (i = r->yoff; i < r->ylim; i++)
+    filevec[1].changed_flag[filevec[1].realindexes[i]] = 1;
+}
+
+/* Compare the undiscarded lines of FILEVEC with the histogram algorithm,
+   recording the results in the `changed_flag' vectors.
+   Parts whose common lines all occur too often to be anchors are compared
+   with FALLBACK (given the bounds of the parts like `compareseq'), or are
+   marked as changed if FALLBACK is null.
+   Return 0 without changing any flags if memory could not be allocated,
+   nonzero otherwise.  */
+
+int
+histogram_diff (struct file_data filevec[], void (*fallback) PARAMS((int, int, int, int)))
+{
+  int xn = filevec[0].nondiscarded_lines;
+  int yn = filevec[1].nondiscarded_lines;
+  int const *xv = filevec[0].undiscarded;
+  int const *yv = filevec[1].undiscarded;
+  struct histogram h;
+  struct region *stack;
+  int depth;
+
+  h.xv = xv;
+  h.yv = yv;
+  h.head = (int *) malloc (filevec[0].equiv_max * sizeof (int));
+  h.count = (int *) calloc (filevec[0].equiv_max, sizeof (int));
+  h.next = (int *) malloc ((xn + 1) * sizeof (int));
+  /* Regions on the stack don't overlap and have lines of file 0,
+     so there are never more of them than lines of file 0.  */
+  stack = (struct region *) malloc ((xn + 1) * sizeof (struct region));
+  if (!h.head || !h.count || !h.next || !stack)
+    {
+      free (h.head);
+      free (h.count);
+      free (h.next);
+      free (stack);
+      return 0;
+    }
+
+  stack[0].xoff = 0;
+  stack[0].xlim = xn;
+  stack[0].yoff = 0;
+  stack[0].ylim = yn;
+  depth = 1;
+  while (depth > 0)
+    {
+      struct region r = stack[--depth];
+      struct region anchor, part[2];
+      int i;
+
+      /* Slide down the bottom initial diagonal. */
+      while (r.xoff < r.xlim && r.yoff < r.ylim && xv[r.xoff] == yv[r.yoff])
+	++r.xoff, ++r.yoff;
+      /* Slide up the top initial diagonal. */
+      while (r.xlim > r.xoff && r.ylim > r.yoff && xv[r.xlim - 1] == yv[r.ylim - 1])
+	--r.xlim, --r.ylim;
+
+      if (r.xoff == r.xlim || r.yoff == r.ylim)
+	{
+	  mark_changed (filevec, &r);
+	  continue;
+	}
+
+      switch (find_anchor (&h, &r, &anchor))
+	{
+	case 1:
+	  /* Compare the parts before and after the anchor.  */
+	  part[0].xoff = r.xoff;
+	  part[0].xlim = anchor.xoff;
+	  part[0].yoff = r.yoff;
+	  part[0].ylim = anchor.yoff;
+	  part[1].xoff = anchor.xlim;
+	  part[1].xlim = r.xlim;
+	  part[1].yoff = anchor.ylim;
+	  part[1].ylim = r.ylim;
+	  for (i = 0; i < 2; i++)
+	    {
+	      if (part[i].xoff == part[i].xlim || part[i].yoff == part[i].ylim)
+		mark_changed (filevec, &part[i]);
+	      else
+		stack[depth++] = part[i];
+	    }
+	  break;
+	case 0:
+	  mark_changed (filevec, &r);
+	  break;
+	default:
+	  if (fallback)
+	    fallback (r.xoff, r.xlim, r.yoff, r.ylim);
+	  else
+	    mark_changed (filevec, &r);
+	  break;
+	}
+    }
+
+  free (h.head);
+  free (h.count);
+  free (h.next);
+  free (stack);
+  return 1;
+}
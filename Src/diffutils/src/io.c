@@ -20,9 +20,18 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #include "diff.h"
 #ifdef _WIN32
 #  include <io.h>
+#  include <process.h>
+#  include <windows.h>
 #  define read _read
 #endif
 #include <cassert>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#  define IO_SSE2 1
+#  include <emmintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+#endif
 
 /* Rotate a value n bits to the left. */
 #define UINT_BIT (sizeof (unsigned) * CHAR_BIT)
@@ -31,6 +40,18 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 /* Given a hash value and a new character, return a new hash value. */
 #define HASH(h, c) ((c) + ROL (h, 7))
 
+/* Slot of the hash table for hash value H; the multiply spreads the
+   bits of H, which depend mostly on the last characters of a line.  */
+#define SLOT_INDEX(h) (((h) * 2654435761U) >> (UINT_BIT - nslots_bits))
+
+/* Files are split into parts of at least this many characters for
+   hashing their lines on several threads.  */
+#define HASH_JOB_MIN_CHARS (512 * 1024)
+
+/* Lines of files having fewer characters than this in all are hashed
+   on the calling thread, as starting threads would take longer.  */
+#define HASH_THREADS_MIN_CHARS (4 * HASH_JOB_MIN_CHARS)
+
 /* Guess remaining number of lines from number N of lines so far,
    size S so far, and total size T.  */
 #define GUESS_LINES(n,s,t) (((t) - (s)) / ((n) < 10 ? 32 : (s) / ((n)-1)) + 5)
@@ -55,20 +76,36 @@ enum UNICODESET
    Afterward, each class is represented by a number.  */
 struct equivclass
 {
-  int next;	/* Next item in this bucket. */
+  int next;	/* Next item with the same hash. */
   unsigned hash;	/* Hash of lines in this class.  */
   char const HUGE *line;	/* A line that fits this class. */
   size_t length;	/* The length of that line.  */
 };
 
-/* Hash-table: array of buckets, each being a chain of equivalence classes.  */
-static DECL_TLS int *buckets;
-  
-/* Number of buckets in the hash table array. */
-static DECL_TLS int nbuckets;
+/* Slot of the open addressing hash table of equivalence classes.
+   All classes of one hash value are chained from the same slot, newest
+   first, so lines are matched against the classes in the same order
+   as with a table of bucket chains.  */
+struct equivslot
+{
+  unsigned hash;	/* Hash of lines in the classes of this slot.  */
+  int head;	/* Newest class with this hash, 0 if slot is empty.  */
+};
+
+/* Hash-table: array of slots, probed linearly.  */
+static DECL_TLS struct equivslot *slots;
+
+/* Number of slots in the hash table, a power of two.  */
+static DECL_TLS int nslots;
+
+/* Base 2 logarithm of nslots.  */
+static DECL_TLS int nslots_bits;
+
+/* Number of slots in use.  The table is grown when it gets half full.  */
+static DECL_TLS int nslots_used;
 
 /* Array in which the equivalence classes are allocated.
-   The bucket-chains go through the elements in this array.
+   The hash chains go through the elements in this array.
    The number of an equivalence class is its index in this array.  */
 static DECL_TLS struct equivclass HUGE *equivs;
 
@@ -78,7 +115,29 @@ static DECL_TLS int equivs_index;
 /* Number of elements allocated in the array `equivs'.  */
 static DECL_TLS int equivs_alloc;
 
-static void find_and_hash_each_line PARAMS((struct file_data *));
+/* A part of a file whose lines are split and hashed by hash_lines.
+   The parts of both files can be hashed concurrently, as hash_lines uses
+   only the fields of the job and no thread local options.  The lines are
+   put into equivalence classes afterwards, in order, so the classes do
+   not depend on how the files were split.  */
+struct hash_job
+{
+  unsigned char const HUGE *begin;	/* Start of the first line.  */
+  char const HUGE *end;	/* Lines starting before this are hashed.  */
+  char const HUGE *bufend;	/* End of the text of the file.  */
+  unsigned char const *fold;	/* Case folding table for HASH.  */
+  int exact;	/* Nonzero if lines are compared exactly.  */
+  int all_space;	/* Copy of ignore_all_space_flag.  */
+  int space_change;	/* Copy of ignore_space_change_flag.  */
+  char const HUGE **lines;	/* Start of each line.  */
+  unsigned *hashes;	/* Hash of each line.  */
+  int count;	/* Number of lines.  */
+  int alloc;	/* Number of elements allocated in lines and hashes.  */
+  char const HUGE *next;	/* End of the last line.  */
+  int failed;	/* Nonzero if memory ran out.  */
+};
+
+static void find_and_hash_each_line PARAMS((struct file_data *, struct hash_job *, int));
 static void find_identical_ends PARAMS((struct file_data[]));
 static char *prepare_text_end PARAMS((struct file_data *, short));
 static enum UNICODESET get_unicode_signature(struct file_data *, unsigned *bom);
@@ -145,6 +204,16 @@ sip (current, skip_test)
      int skip_test;
 {
   int isbinary = 0;
+  if (current->preloaded)
+    {
+      /* WinMerge: the whole text is already in the buffer (in-memory rescan,
+         or file read by folder compare).
+         Test only the first block, as we would have read it from the file. */
+      if (!skip_test && !get_unicode_signature(current, NULL))
+        isbinary = binary_file_p(current->buffer,
+          min(current->buffered_chars, (FSIZE)STAT_BLOCKSIZE (current->stat)));
+      return isbinary;
+    }
   /* If we have a nonexistent file (or NUL: device) at this stage, treat it as empty.  */
   if (current->desc < 0 || !(S_ISREG (current->stat.st_mode)))
     {
@@ -193,7 +262,23 @@ slurp (current)
 {
   size_t cc;
 
-  if (current->desc < 0)
+  if (current->preloaded)
+    {
+      /* WinMerge: nothing to read, the whole text is already in memory.
+         Just make sure there is room for a necessary transcoding to UTF-8,
+         appended newline and sentinel. */
+      enum UNICODESET sig = get_unicode_signature(current, NULL);
+      size_t alloc_extra
+        = (1 << sig) & ((1 << UCS2LE) | (1 << UCS2BE) | (1 << UCS4LE) | (1 << UCS4BE))
+          ? ~0U : 0U;
+      FSIZE tmp_bufsize = current->buffered_chars + (alloc_extra & current->buffered_chars / 2) + sizeof (word) + 1;
+      if (tmp_bufsize > current->bufsize)
+        {
+          current->buffer = xrealloc (current->buffer, tmp_bufsize);
+          current->bufsize = tmp_bufsize;
+        }
+    }
+  else if (current->desc < 0)
     /* The file is nonexistent.  */
     ;
   else if (always_text_flag || current->buffered_chars != 0)
@@ -262,38 +347,111 @@ ISWSPACE (char ch)
   return ch==' ' || ch=='\t';
 }
 
-/* Split the file into lines, simultaneously computing the equivalence class for
-   each line. */
+#ifdef IO_SSE2
+/* Return index of the lowest set bit of nonzero MASK. */
+static int
+lowest_bit (unsigned mask)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward (&index, mask);
+  return (int) index;
+#else
+  return __builtin_ctz (mask);
+#endif
+}
+#endif
+
+/* Return the count of characters from P before the first \r or \n.
+   END is the end of the text, which ends with an end of line character.  */
+static size_t
+count_line_chars (p, end)
+     unsigned char const HUGE *p;
+     char const HUGE *end;
+{
+  unsigned char const HUGE *q = p;
+#ifdef IO_SSE2
+  __m128i const cr = _mm_set1_epi8 ('\r');
+  __m128i const lf = _mm_set1_epi8 ('\n');
+
+  while (end - (char const HUGE *) q >= 16)
+    {
+      __m128i v = _mm_loadu_si128 ((__m128i const *) q);
+      unsigned mask = (unsigned) _mm_movemask_epi8 (
+        _mm_or_si128 (_mm_cmpeq_epi8 (v, cr), _mm_cmpeq_epi8 (v, lf)));
+      if (mask)
+        return q - p + lowest_bit (mask);
+      q += 16;
+    }
+#endif
+  while (*q != '\n' && *q != '\r')
+    q++;
+  return q - p;
+}
+
+/* Hash N characters from P a word at a time, in two independent lanes.
+   Only used when lines are compared exactly, as this hash is not the
+   one of HASH over the same characters.  */
+static unsigned
+hash_chars (p, n)
+     unsigned char const HUGE *p;
+     size_t n;
+{
+  unsigned h0 = (unsigned) n, h1 = 0;
+  word w0, w1;
+
+  for (; n >= 2 * sizeof (word); n -= 2 * sizeof (word), p += 2 * sizeof (word))
+    {
+      memcpy (&w0, p, sizeof (word));
+      memcpy (&w1, p + sizeof (word), sizeof (word));
+      h0 = ROL (h0 ^ w0, 13) * 2654435761U;
+      h1 = ROL (h1 ^ w1, 13) * 2246822519U;
+    }
+  for (w0 = 0; n > 0; n--)
+    w0 = w0 << 8 | *p++;
+  h0 = ROL (h0 ^ w0, 13) * 2654435761U;
+  return h0 ^ ROL (h1, 16);
+}
+
+/* Double the size of the hash table of equivalence classes.  */
 static void
-find_and_hash_each_line (current)
-     struct file_data *current;
+grow_slots ()
+{
+  struct equivslot *old = slots;
+  int nold = nslots;
+  int i;
+
+  nslots_bits++;
+  nslots = 1 << nslots_bits;
+  slots = (struct equivslot *) xmalloc (nslots * sizeof (*slots));
+  bzero (slots, nslots * sizeof (*slots));
+  for (i = 0; i < nold; i++)
+    if (old[i].head)
+      {
+        unsigned k = SLOT_INDEX (old[i].hash);
+        while (slots[k].head)
+          k = (k + 1) & (nslots - 1);
+        slots[k] = old[i];
+      }
+  free (old);
+}
+
+/* Split the part of a file given by JOB into lines, computing the hash
+   of each line.  */
+static void
+hash_lines (job)
+     struct hash_job *job;
 {
   unsigned h;
-  unsigned char const HUGE *p = (unsigned char const HUGE *) current->prefix_end;
+  unsigned char const HUGE *p = job->begin;
+  unsigned char const *fold = job->fold;
   unsigned char c;
-  int i, *bucket;
-  size_t length;
-
-  /* Cache often-used quantities in local variables to help the compiler.  */
-  char const HUGE **linbuf = current->linbuf;
-  int alloc_lines = current->alloc_lines;
-  int line = 0;
-  int linbuf_base = current->linbuf_base;
-  int *cureqs = (int *) xmalloc (alloc_lines * sizeof (int));
-  struct equivclass HUGE *eqs = equivs;
-  int eqs_index = equivs_index;
-  int eqs_alloc = equivs_alloc;
-  char const HUGE *suffix_begin = current->suffix_begin;
-  char const HUGE *bufend = current->buffer + current->buffered_chars;
-  char const HUGE *incomplete_tail
-    = current->missing_newline && ROBUST_OUTPUT_STYLE (output_style)
-      ? bufend : (char const HUGE *) 0;
-  int varies = length_varies;
+  size_t n;
 
   /* prepare_text_end put a zero word at the end of the buffer, 
   so we're not in danger of overrunning the end of the file */
 
-  while ((char const HUGE *) p < suffix_begin)
+  while ((char const HUGE *) p < job->end)
     {
       char const HUGE *ip = (char const HUGE *) p;
 
@@ -305,134 +463,340 @@ find_and_hash_each_line (current)
       /* loops advance pointer to eol (end of line)
          respecting UNIX (\r), MS-DOS/Windows (\r\n), and MAC (\r) eols */
 
-      /* Hash this line until we find a newline. */
-      if (ignore_case_flag)
+      if (job->exact)
         {
-          if (ignore_all_space_flag)
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (! ISWSPACE (c))
-                  h = HASH (h, isupper (c) ? tolower (c) : c);
-              }
-          else if (ignore_space_change_flag)
-            /* Note that \r must be hashed (if !ignore_eol_diff) */
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+          /* Lines match only if they are identical, so the characters
+             before the eol can be hashed with any function. */
+          n = count_line_chars (p, job->bufend);
+          h = hash_chars (p, n);
+          p += n;
+          if (*p++ == '\r' && *p == '\n')
+            p++;
+        }
+      else if (job->all_space)
+        while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+          {
+            if (! ISWSPACE (c))
+              h = HASH (h, fold[c]);
+          }
+      else if (job->space_change)
+        /* Note that \r must be hashed (if !ignore_eol_diff) */
+        while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+          {
+            if (ISWSPACE (c))
               {
-                if (ISWSPACE (c))
+                /* skip whitespace after whitespace */
+                while (ISWSPACE (c = *p++))
+                  ;
+                if (c == '\n')
                   {
-                    /* skip whitespace after whitespace */
-                    while (ISWSPACE (c = *p++))
-                      ;
-                    if (c == '\n')
-                      {
-                        goto hashing_done; /* never hash trailing \n */
-                      }
-                    else if (c != '\r')
-                      {
-                  /* runs of whitespace not ending line hashed as one space */
-                        h = HASH (h, ' ');
-                      }
+                    goto hashing_done; /* never hash trailing \n */
                   }
-                /* c is now the first non-space.  */
-                /* c can be a \r (CR) if !ignore_eol_diff */
-                h = HASH (h, isupper (c) ? tolower (c) : c);
-                if (c == '\r' && *p != '\n')
-                  goto hashing_done;
-              }
-          else
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                h = HASH (h, isupper (c) ? tolower (c) : c);
-              }
-        }
-      else
-        {
-          if (ignore_all_space_flag)
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (! ISWSPACE (c))
-                  h = HASH (h, c);
-              }
-          else if (ignore_space_change_flag)
-            /* Note that \r must be hashed (if !ignore_eol_diff) */
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (ISWSPACE (c))
+                else if (c != '\r')
                   {
-                    /* skip whitespace after whitespace */
-                    while (ISWSPACE (c = *p++))
-                      ;
-                    if (c == '\n')
-                      {
-                        goto hashing_done; /* never hash trailing \n */
-                      }
-                    else if (c != '\r')
-                      {
-                  /* runs of whitespace not ending line hashed as one space */
-                        h = HASH (h, ' ');
-                      }
+              /* runs of whitespace not ending line hashed as one space */
+                    h = HASH (h, ' ');
                   }
-                /* c is now the first non-space.  */
-                /* c can be a \r (CR) if !ignore_eol_diff */
-                h = HASH (h, c);
-                if (c == '\r' && *p != '\n')
-                  goto hashing_done;
-              }
-          else
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                h = HASH (h, c);
               }
+            /* c is now the first non-space.  */
+            /* c can be a \r (CR) if !ignore_eol_diff */
+            h = HASH (h, fold[c]);
+            if (c == '\r' && *p != '\n')
+              goto hashing_done;
+          }
+      else
+        {
+          /* Hash the characters before the eol without testing each one. */
+          n = count_line_chars (p, job->bufend);
+          for (; n >= 4; n -= 4, p += 4)
+            {
+              h = HASH (h, fold[p[0]]);
+              h = HASH (h, fold[p[1]]);
+              h = HASH (h, fold[p[2]]);
+              h = HASH (h, fold[p[3]]);
+            }
+          for (; n > 0; n--)
+            h = HASH (h, fold[*p++]);
+          /* \r of \r\n is hashed */
+          if (*p++ == '\r' && *p == '\n')
+            {
+              h = HASH (h, fold['\r']);
+              p++;
+            }
         }
 hashing_done:;
 
-      bucket = &buckets[h % nbuckets];
-      length = (char const HUGE *) p - ip - ((char const HUGE *) p == incomplete_tail);
-      for (i = *bucket;  ;  i = eqs[i].next)
-        if (!i)
-          {
-            /* Create a new equivalence class in this bucket. */
-            i = eqs_index++;
-            if (i == eqs_alloc)
-#ifdef __MSDOS__
-              if ((eqs = (struct equivclass HUGE *) farrealloc (eqs, (long) (eqs_alloc*=2) * sizeof(*eqs))) == NULL)
-                fatal ("far memory exhausted");
+      if (job->count == job->alloc)
+        {
+          char const HUGE **lines;
+          unsigned *hashes;
+          job->alloc = 2 * job->alloc + 64;
+          lines = (char const HUGE **) realloc ((void *) job->lines,
+                                                job->alloc * sizeof (*lines));
+          if (lines)
+            job->lines = lines;
+          hashes = (unsigned *) realloc (job->hashes, job->alloc * sizeof (*hashes));
+          if (hashes)
+            job->hashes = hashes;
+          if (!lines || !hashes)
+            {
+              job->failed = 1;
+              return;
+            }
+        }
+      job->lines[job->count] = ip;
+      job->hashes[job->count] = h;
+      job->count++;
+    }
+  job->next = (char const HUGE *) p;
+}
+
+#ifdef _WIN32
+/* Jobs shared by the threads of run_hash_jobs.  */
+struct hash_work
+{
+  struct hash_job *jobs;
+  LONG njobs;
+  LONG volatile next;	/* Index of the next job to take.  */
+};
+
+/* Take and do jobs until there are none left.  */
+static unsigned __stdcall
+hash_worker (void *arg)
+{
+  struct hash_work *work = (struct hash_work *) arg;
+  LONG i;
+
+  while ((i = InterlockedIncrement (&work->next) - 1) < work->njobs)
+    hash_lines (&work->jobs[i]);
+  return 0;
+}
+#endif
+
+/* Return the number of threads to use for hashing lines.  */
+static int
+hash_thread_count ()
+{
+#ifdef _WIN32
+  SYSTEM_INFO si;
+  int n;
+
+  GetSystemInfo (&si);
+  n = min ((int) si.dwNumberOfProcessors, 16);
+  if (max_hash_threads > 0)
+    n = min (n, max_hash_threads);
+  return n;
 #else
-              eqs = (struct equivclass *)
-                xrealloc (eqs, (eqs_alloc*=2) * sizeof(*eqs));
-#endif /*__MSDOS__*/
-            eqs[i].next = *bucket;
-            eqs[i].hash = h;
-            eqs[i].line = ip;
-            eqs[i].length = length;
-            *bucket = i;
-            break;
-          }
-        /* "line_cmp" changed to "lines_differ" by diffutils 2.8.1 */
-        else if (eqs[i].hash == h
-           && (eqs[i].length == length || varies)
-           && ! line_cmp (eqs[i].line, eqs[i].length, ip, length))
-          /* Reuse existing equivalence class.  */
-            break;
+  /* Jobs are done one after the other, split as on Windows. */
+  return max_hash_threads > 0 ? min (max_hash_threads, 16) : 1;
+#endif
+}
 
-      /* Maybe increase the size of the line table. */
-      if (line == alloc_lines)
+/* Do the NJOBS JOBS, on up to NTHREADS threads.  */
+static void
+run_hash_jobs (jobs, njobs, nthreads)
+     struct hash_job *jobs;
+     int njobs, nthreads;
+{
+  FSIZE total = 0;
+  int i;
+#ifdef _WIN32
+  HANDLE threads[16];
+  int nstarted = 0;
+  struct hash_work work;
+#endif
+
+  for (i = 0; i < njobs; i++)
+    total += (char const HUGE *) jobs[i].end - (char const HUGE *) jobs[i].begin;
+  /* With a job per file or small files, do the jobs here.  */
+  if (nthreads < 2 || njobs <= 2 || total < HASH_THREADS_MIN_CHARS)
+    {
+      for (i = 0; i < njobs; i++)
+        hash_lines (&jobs[i]);
+      return;
+    }
+
+#ifdef _WIN32
+  work.jobs = jobs;
+  work.njobs = njobs;
+  work.next = 0;
+  nthreads = min (min (nthreads, njobs), 16);
+  /* The calling thread works too; if a thread can't be started,
+     the other threads do its share.  */
+  while (nstarted < nthreads - 1)
+    {
+      uintptr_t h = _beginthreadex (NULL, 0, hash_worker, &work, 0, NULL);
+      if (!h)
+        break;
+      threads[nstarted++] = (HANDLE) h;
+    }
+  hash_worker (&work);
+  if (nstarted > 0)
+    {
+      WaitForMultipleObjects (nstarted, threads, TRUE, INFINITE);
+      while (nstarted > 0)
+        CloseHandle (threads[--nstarted]);
+    }
+#else
+  for (i = 0; i < njobs; i++)
+    hash_lines (&jobs[i]);
+#endif
+}
+
+/* Split the lines to hash of the file CURRENT into at most MAXJOBS jobs
+   of about equal size.  Return the number of jobs put into JOBS.  */
+static int
+split_hash_jobs (current, fold, jobs, maxjobs)
+     struct file_data *current;
+     unsigned char const *fold;
+     struct hash_job *jobs;
+     int maxjobs;
+{
+  char const HUGE *begin = current->prefix_end;
+  char const HUGE *end = current->suffix_begin;
+  int njobs = 0;
+  int i;
+
+  if (begin < end)
+    maxjobs = (int) min ((FSIZE) maxjobs, (FSIZE) (end - begin) / HASH_JOB_MIN_CHARS + 1);
+  else
+    maxjobs = 1;
+  for (i = 1; i <= maxjobs; i++)
+    {
+      char const HUGE *split = end;
+      struct hash_job *job = &jobs[njobs++];
+
+      /* Every \n ends a line, so a job can start after one. */
+      if (i < maxjobs)
         {
-          /* Double (alloc_lines - linbuf_base) by adding to alloc_lines.  */
-          alloc_lines = 2 * alloc_lines - linbuf_base;
-          cureqs = (int *) xrealloc (cureqs, alloc_lines * sizeof (*cureqs));
-          linbuf = (char const HUGE **) xrealloc ((void *)(linbuf + linbuf_base),
-                     (alloc_lines - linbuf_base)
-                     * sizeof (*linbuf))
-             - linbuf_base;
+          char const HUGE *nl = begin + (end - begin) / (maxjobs - i + 1);
+          nl = (char const HUGE *) memchr (nl, '\n', end - nl);
+          if (nl && nl + 1 < end)
+            split = nl + 1;
         }
-      linbuf[line] = ip;
-      cureqs[line] = i;
-      ++line;
+      bzero (job, sizeof (*job));
+      job->begin = (unsigned char const HUGE *) begin;
+      job->end = split;
+      job->bufend = current->buffer + current->buffered_chars;
+      job->fold = fold;
+      job->exact = !(ignore_case_flag | ignore_space_change_flag
+                     | ignore_all_space_flag | ignore_eol_diff);
+      job->all_space = ignore_all_space_flag;
+      job->space_change = ignore_space_change_flag;
+      if (split == end)
+        break;
+      begin = split;
+    }
+  return njobs;
+}
+
+/* Put the lines of the file CURRENT, split and hashed by its NJOBS JOBS,
+   into equivalence classes.  */
+static void
+find_and_hash_each_line (current, jobs, njobs)
+     struct file_data *current;
+     struct hash_job *jobs;
+     int njobs;
+{
+  unsigned h;
+  unsigned char const HUGE *p;
+  int i, j, n;
+  size_t length;
+  unsigned k;
+
+  /* Cache often-used quantities in local variables to help the compiler.  */
+  char const HUGE **linbuf = current->linbuf;
+  int alloc_lines = current->alloc_lines;
+  int line = 0;
+  int linbuf_base = current->linbuf_base;
+  int *cureqs = (int *) xmalloc (alloc_lines * sizeof (int));
+  struct equivclass HUGE *eqs = equivs;
+  int eqs_index = equivs_index;
+  int eqs_alloc = equivs_alloc;
+  char const HUGE *bufend = current->buffer + current->buffered_chars;
+  char const HUGE *incomplete_tail
+    = current->missing_newline && ROBUST_OUTPUT_STYLE (output_style)
+      ? bufend : (char const HUGE *) 0;
+  int varies = length_varies;
+
+  for (j = 0; j < njobs; j++)
+    {
+      if (jobs[j].failed)
+        fatal ("virtual memory exhausted");
+      /* Jobs are in order and each starts where the previous one ended. */
+      assert (j == 0 || (char const HUGE *) jobs[j].begin == jobs[j - 1].next);
     }
 
+  for (j = 0; j < njobs; j++)
+    for (n = 0; n < jobs[j].count; n++)
+      {
+        char const HUGE *ip = jobs[j].lines[n];
+        char const HUGE *next
+          = n + 1 < jobs[j].count ? jobs[j].lines[n + 1] : jobs[j].next;
+
+        h = jobs[j].hashes[n];
+        length = next - ip - (next == incomplete_tail);
+
+        /* Find the slot of this hash, and the classes having this hash. */
+        for (k = SLOT_INDEX (h);  slots[k].head && slots[k].hash != h;
+             k = (k + 1) & (nslots - 1))
+          ;
+        for (i = slots[k].head;  ;  i = eqs[i].next)
+          if (!i)
+            {
+              /* Create a new equivalence class in this slot. */
+              i = eqs_index++;
+              if (i == eqs_alloc)
+#ifdef __MSDOS__
+                if ((eqs = (struct equivclass HUGE *) farrealloc (eqs, (long) (eqs_alloc*=2) * sizeof(*eqs))) == NULL)
+                  fatal ("far memory exhausted");
+#else
+                eqs = (struct equivclass *)
+                  xrealloc (eqs, (eqs_alloc*=2) * sizeof(*eqs));
+#endif /*__MSDOS__*/
+              eqs[i].next = slots[k].head;
+              eqs[i].hash = h;
+              eqs[i].line = ip;
+              eqs[i].length = length;
+              if (!slots[k].head)
+                {
+                  slots[k].hash = h;
+                  if (2 * ++nslots_used > nslots)
+                    {
+                      slots[k].head = i;
+                      grow_slots ();
+                      break;
+                    }
+                }
+              slots[k].head = i;
+              break;
+            }
+          /* "line_cmp" changed to "lines_differ" by diffutils 2.8.1 */
+          else if (eqs[i].hash == h
+             && (eqs[i].length == length || varies)
+             && ! line_cmp (eqs[i].line, eqs[i].length, ip, length))
+            /* Reuse existing equivalence class.  */
+              break;
+
+        /* Maybe increase the size of the line table. */
+        if (line == alloc_lines)
+          {
+            /* Double (alloc_lines - linbuf_base) by adding to alloc_lines.  */
+            alloc_lines = 2 * alloc_lines - linbuf_base;
+            cureqs = (int *) xrealloc (cureqs, alloc_lines * sizeof (*cureqs));
+            linbuf = (char const HUGE **) xrealloc ((void *)(linbuf + linbuf_base),
+                       (alloc_lines - linbuf_base)
+                       * sizeof (*linbuf))
+               - linbuf_base;
+          }
+        linbuf[line] = ip;
+        cureqs[line] = i;
+        ++line;
+      }
+
   current->buffered_lines = line;
 
+  p = (unsigned char const HUGE *) jobs[njobs - 1].next;
   for (i = 0;  ;  i++)
     {
       /* Record the line start for lines in the suffix that we care about.
@@ -727,7 +1091,7 @@ find_identical_ends (filevec)
   int buffered_prefix, prefix_count, prefix_mask;
   int ttt;
 
-  if (filevec[0].desc != filevec[1].desc)
+  if (!SAME_FILE_P (filevec))
     {
       slurp (&filevec[0]);
       buffer0 = prepare_text_end (&filevec[0], 0);
@@ -949,39 +1313,6 @@ find_identical_ends (filevec)
   filevec[0].prefix_lines = filevec[1].prefix_lines = lines;
 }
 
-/* Largest primes less than some power of two, for nbuckets.  Values range
-   from useful to preposterous.  If one of these numbers isn't prime
-   after all, don't blame it on me, blame it on primes (6) . . . */
-static int const primes[] =
-{
-  509,
-  1021,
-  2039,
-  4093,
-  8191,
-  16381,
-  32749,
-#if 32767 < INT_MAX
-  65521,
-  131071,
-  262139,
-  524287,
-  1048573,
-  2097143,
-  4194301,
-  8388593,
-  16777213,
-  33554393,
-  67108859,     /* Preposterously large . . . */
-  134217689,
-  268435399,
-  536870909,
-  1073741789,
-  2147483647,
-#endif
-  0
-};
-
 /* Given a vector of two file_data objects, read the file associated
    with each one, and build the table of equivalence classes.
    Return 1 if either file appears to be a binary file.
@@ -998,6 +1329,9 @@ read_files (filevec, pretend_binary, bin_file)
   int i;
   int skip_test = always_text_flag | pretend_binary;
   int appears_binary = 0;
+  unsigned char fold[256];
+  struct hash_job *jobs;
+  int njobs[2], nthreads;
 
   if (bin_file)
     *bin_file = 0;
@@ -1007,7 +1341,7 @@ read_files (filevec, pretend_binary, bin_file)
       *bin_file = 1;
     }
 
-  if (filevec[0].desc != filevec[1].desc)
+  if (!SAME_FILE_P (filevec))
     {
       if (bin_file)
         {
@@ -1020,7 +1354,7 @@ read_files (filevec, pretend_binary, bin_file)
     }
 	
 	// Are both files Open and Regular (no Pipes, Directories, Devices (e.g. NUL))
-	if (filevec[0].desc < 0 || filevec[1].desc < 0 ||
+	if (!FILE_PRESENT_P (&filevec[0]) || !FILE_PRESENT_P (&filevec[1]) ||
 		!(S_ISREG (filevec[0].stat.st_mode)) || !(S_ISREG (filevec[1].stat.st_mode))   )
 	{
 		assert(!S_ISCHR(filevec[0].stat.st_mode) || strcmp(filevec[0].name, "NUL")==0);
@@ -1052,14 +1386,14 @@ read_files (filevec, pretend_binary, bin_file)
 			filevec[0].buffer = xrealloc (filevec[0].buffer, tmax_bufsize);
 			filevec[0].bufsize = tmax_bufsize;
 		  }
-		if (filevec[0].desc != filevec[1].desc && tmax_bufsize > filevec[1].bufsize)
+		if (!SAME_FILE_P (filevec) && tmax_bufsize > filevec[1].bufsize)
 		  {
 			filevec[1].buffer = xrealloc (filevec[1].buffer, tmax_bufsize);
 			filevec[1].bufsize = tmax_bufsize;
 		  }
 	}
 	  
-  if (filevec[0].desc == filevec[1].desc)
+  if (SAME_FILE_P (filevec))
 	{
 		// The files may be exactly the same file.  Give them the same buffer, etc.
 		assert( filevec[1].buffer == NULL );
@@ -1079,7 +1413,7 @@ read_files (filevec, pretend_binary, bin_file)
   find_identical_ends (filevec);
 
   /* Don't slurp rest of file when comparing file to itself. */
-  if (filevec[0].desc == filevec[1].desc)
+  if (SAME_FILE_P (filevec))
     {
 	  filevec[1].count_crs = filevec[0].count_crs;
 	  filevec[1].count_lfs = filevec[0].count_lfs;
@@ -1099,21 +1433,37 @@ read_files (filevec, pretend_binary, bin_file)
      hashed.  Real equivalence classes start at 1. */
   equivs_index = 1;
 
-  for (i = 0;  primes[i] < equivs_alloc / 3;  i++)
-    if (! primes[i])
-      abort ();
-  nbuckets = primes[i];
-
-  buckets = (int *) xmalloc (nbuckets * sizeof (*buckets));
-  bzero (buckets, nbuckets * sizeof (*buckets));
-
-  for (i = 0; i < 2; ++i)
-    find_and_hash_each_line (&filevec[i]);
+  /* Size the hash table for a file pair with mostly repeated lines;
+     it is grown if there are more distinct lines. */
+  for (nslots_bits = 9;  (1 << nslots_bits) < equivs_alloc / 2;  nslots_bits++)
+    ;
+  nslots = 1 << nslots_bits;
+  nslots_used = 0;
+  slots = (struct equivslot *) xmalloc (nslots * sizeof (*slots));
+  bzero (slots, nslots * sizeof (*slots));
+
+  /* Find and hash the lines of both files on several threads,
+     then put them into equivalence classes in order. */
+  for (i = 0; i < 256; i++)
+    fold[i] = (unsigned char) (ignore_case_flag && isupper (i) ? tolower (i) : i);
+  nthreads = hash_thread_count ();
+  jobs = (struct hash_job *) xmalloc (2 * nthreads * sizeof (*jobs));
+  njobs[0] = split_hash_jobs (&filevec[0], fold, jobs, nthreads);
+  njobs[1] = split_hash_jobs (&filevec[1], fold, jobs + njobs[0], nthreads);
+  run_hash_jobs (jobs, njobs[0] + njobs[1], nthreads);
+  find_and_hash_each_line (&filevec[0], jobs, njobs[0]);
+  find_and_hash_each_line (&filevec[1], jobs + njobs[0], njobs[1]);
+  for (i = 0; i < njobs[0] + njobs[1]; i++)
+    {
+      free ((void *) jobs[i].lines);
+      free (jobs[i].hashes);
+    }
+  free (jobs);
 
   filevec[0].equiv_max = filevec[1].equiv_max = equivs_index;
 
   free (equivs);
-  free (buckets);
+  free (slots);
 
   return 0;
 }
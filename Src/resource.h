@@ -807,6 +807,8 @@
 #define IDS_ELAPSED_TIME                17881
 #define IDS_STATUS_SELITEM1             17882
 #define IDS_STATUS_SELITEMS             17883
+#define IDS_COMPARED_ITEMS_PER_SECOND   17884
+#define IDS_CONTENT_CACHE_STATS         17885
 #define IDS_COLDESC_FILENAME            17901
 #define IDS_COLDESC_DIR                 17902
 #define IDS_COLDESC_RESULT              17903
@@ -848,6 +850,7 @@
 #define IDS_REPORT_FILEOVERWRITE        17967
 #define IDS_REPORT_ERROR                17968
 #define IDS_REPORT_SUCCESS              17969
+#define IDS_REPORT_JSONLINES            17970
 #define IDS_FILE_TO_ITSELF              18100
 #define IDS_FILESSAME                   18101
 #define IDS_FILEERROR                   18103
@@ -913,6 +916,7 @@
 #define IDS_TEXT_REPORT_FILES           18540
 #define IDS_HTML_REPORT_FILES           18541
 #define IDS_XML_REPORT_FILES            18542
+#define IDS_JSONL_REPORT_FILES          18543
 #define IDS_EOL_DOS                     30400
 #define IDS_EOL_MAC                     30401
 #define IDS_EOL_UNIX                    30402
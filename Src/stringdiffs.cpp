@@ -25,6 +25,17 @@ static bool CustomChars;
 static TCHAR *BreakChars;
 static TCHAR BreakCharDefaults[] = _T(",.;:");
 
+/** @brief Size the edit script trace may grow to before it is compacted. */
+static const size_t DefaultMinTraceCollect = 65536;
+/**
+ * @brief Size the edit script trace may grow to at most.
+ * If more than half of it is still in use after compacting, the words are
+ * not compared and the whole lines are shown as different.
+ */
+static const size_t DefaultMaxTraceNodes = 4 * 1024 * 1024;
+static size_t MinTraceCollect = DefaultMinTraceCollect;
+static size_t MaxTraceNodes = DefaultMaxTraceNodes;
+
 static bool isSafeWhitespace(TCHAR ch);
 static bool isWordBreak(int breakType, const TCHAR *str, int index);
 
@@ -42,6 +53,8 @@ void Close()
 		BreakChars = NULL;
 		CustomChars = false;
 	}
+	MinTraceCollect = DefaultMinTraceCollect;
+	MaxTraceNodes = DefaultMaxTraceNodes;
 	Initialized = false;
 }
 
@@ -56,6 +69,16 @@ void SetBreakChars(const TCHAR *breakChars)
 	BreakChars = _tcsdup(breakChars);
 }
 
+/**
+ * @brief Set the sizes the edit script trace is compacted at and may grow
+ * to at most, 0 for the defaults. Close() restores the defaults.
+ */
+void SetTraceLimits(size_t minCollect, size_t maxNodes)
+{
+	MinTraceCollect = minCollect ? minCollect : DefaultMinTraceCollect;
+	MaxTraceNodes = maxNodes ? maxNodes : DefaultMaxTraceNodes;
+}
+
 void
 ComputeWordDiffs(const String& str1, const String& str2,
 	bool case_sensitive, int whitespace, int breakType, bool byte_level,
@@ -260,7 +283,8 @@ stringdiffs::BuildWordDiffList_DP()
 
 	//if (dp(edscript) <= 0)
 	//	return false;
-	onp(edscript);
+	if (onp(edscript) < 0)
+		return false;
 
 	int i = 1, j = 1;
 	for (size_t k = 0; k < edscript.size(); k++)
@@ -341,20 +365,18 @@ stringdiffs::BuildWordDiffList()
 	BuildWordsArray(m_str2, m_words2);
 
 #ifdef _WIN64
-	if (m_words1.size() > 20480 || m_words2.size() > 20480)
+	if (m_words1.size() > 20480 || m_words2.size() > 20480 || !BuildWordDiffList_DP())
 #else
-	if (m_words1.size() > 2048 || m_words2.size() > 2048)
+	if (m_words1.size() > 2048 || m_words2.size() > 2048 || !BuildWordDiffList_DP())
 #endif
 	{
+		// Too many words or differences, show the lines as one difference
 		int s1 = m_words1[0].start;
 		int e1 = m_words1[m_words1.size() - 1].end;
 		int s2 = m_words2[0].start;
 		int e2 = m_words2[m_words2.size() - 1].end;
 		m_wdiffs.push_back(wdiff(s1, e1, s2, e2));		
-		return;
 	}
-
-	BuildWordDiffList_DP();
 }
 
 /**
@@ -524,6 +546,13 @@ stringdiffs::caseMatch(TCHAR ch1, TCHAR ch2) const
 
 /**
  * @ brief An O(NP) Sequence Comparison Algorithm. Sun Wu, Udi Manber, Gene Myers
+ *
+ * The edit script of each diagonal is kept as a path in a trace shared by
+ * all diagonals: a node holds one insertion or deletion, the count of
+ * matching words following it and the index of the node before it. Nodes
+ * no diagonal refers to anymore are dropped from time to time, so the
+ * trace stays small unless the strings are very different.
+ * @return Count of differences, or -1 if the trace grew too big.
  */
 int
 stringdiffs::onp(std::vector<char> &edscript)
@@ -537,42 +566,47 @@ stringdiffs::onp(std::vector<char> &edscript)
 		N = static_cast<int>(m_words1.size() - 1);
 		exchanged = true;
 	}
-	int *fp = (new int[(M+1) + 1 + (N+1)]) + (M+1);
-	std::vector<char> *es = (new std::vector<char>[(M+1) + 1 + (N+1)]) + (M+1);
+	std::vector<int> fpbuf((M+1) + 1 + (N+1), -1);
+	std::vector<int> esbuf((M+1) + 1 + (N+1), -1);
+	int *fp = &fpbuf[M+1];
+	int *es = &esbuf[M+1]; // Last trace node of the edit script of each diagonal, -1 if empty
+	std::vector<TraceNode> trace;
+	size_t nCollect = MinTraceCollect;
 	int DELTA = N - M;
 	
 	int k;
-	for (k = -(M+1); k <= (N+1); k++)
-		fp[k] = -1; 
 	int p = -1;
 	do
 	{
 		p = p + 1;
-		for (k = -p; k <= DELTA-1; k++)
+		// Compact the trace when the nodes of this round would not fit
+		size_t nNew = DELTA + 2 * p + 1;
+		if (trace.size() + nNew > nCollect)
 		{
-			fp[k] = snake(k, std::max(fp[k-1] + 1, fp[k+1]), exchanged);
-	
-			es[k] = fp[k-1] + 1 > fp[k+1] ? es[k-1] : es[k+1];
-			es[k].push_back(fp[k-1] + 1 > fp[k+1] ? '+' : '-');
-			es[k].resize(es[k].size() + fp[k] - std::max(fp[k-1] + 1, fp[k+1]), '=');
+			CollectTrace(trace, es - (M+1), esbuf.size());
+			if (trace.size() > MaxTraceNodes / 2)
+				return -1;
+			nCollect = std::min(std::max(MinTraceCollect, 2 * trace.size()), MaxTraceNodes);
+			trace.reserve(std::max(nCollect, trace.size() + nNew));
 		}
+		for (k = -p; k <= DELTA-1; k++)
+			SnakeDiagonal(k, fp, es, trace, exchanged);
 		for (k = DELTA + p; k >= DELTA+1; k--)
-		{
-			fp[k] = snake(k, std::max(fp[k-1] + 1, fp[k+1]), exchanged);
-	
-			es[k] = fp[k-1] + 1 > fp[k+1] ? es[k-1] : es[k+1];
-			es[k].push_back(fp[k-1] + 1 > fp[k+1] ? '+' : '-');
-			es[k].resize(es[k].size() + fp[k] - std::max(fp[k-1] + 1, fp[k+1]), '=');
-		}
+			SnakeDiagonal(k, fp, es, trace, exchanged);
 		k = DELTA;
-		fp[k] = snake(k, std::max(fp[k-1] + 1, fp[k+1]), exchanged);
-	
-		es[k] = fp[k-1] + 1 > fp[k+1] ? es[k-1] : es[k+1];
-		es[k].push_back(fp[k-1] + 1 > fp[k+1] ? '+' : '-');
-		es[k].resize(es[k].size() + fp[k] - std::max(fp[k-1] + 1, fp[k+1]), '=');
+		SnakeDiagonal(k, fp, es, trace, exchanged);
 	} while (fp[k] != N);
 
-	std::vector<char> &ses = es[DELTA]; // Shortest edit script
+	// Shortest edit script
+	std::vector<int> path;
+	for (int node = es[DELTA]; node >= 0; node = trace[node].prev)
+		path.push_back(node);
+	std::vector<char> ses;
+	for (size_t i = path.size(); i-- > 0; )
+	{
+		ses.push_back(trace[path[i]].insert ? '+' : '-');
+		ses.resize(ses.size() + trace[path[i]].equal, '=');
+	}
 	edscript.clear();
 
 	int D = 0;
@@ -610,13 +644,64 @@ stringdiffs::onp(std::vector<char> &edscript)
 			edscript.push_back('=');
 		}
 	}
-		
-	delete [] (es - (M+1));
-	delete [] (fp - (M+1));
 
 	return D;
 }
 
+/**
+ * @brief Extend the furthest reaching path of a diagonal by one edit and
+ * the snake following it, and add the edit to the trace.
+ */
+void
+stringdiffs::SnakeDiagonal(int k, int *fp, int *es, std::vector<TraceNode> &trace, bool exchanged)
+{
+	int y = std::max(fp[k-1] + 1, fp[k+1]);
+	fp[k] = snake(k, y, exchanged);
+
+	TraceNode node;
+	node.prev = fp[k-1] + 1 > fp[k+1] ? es[k-1] : es[k+1];
+	node.insert = fp[k-1] + 1 > fp[k+1];
+	node.equal = fp[k] - y;
+	es[k] = static_cast<int>(trace.size());
+	trace.push_back(node);
+}
+
+/**
+ * @brief Remove the trace nodes no edit script refers to.
+ * A node is always added after the node before it, so compacting the
+ * trace in order keeps the indexes of earlier nodes valid for later ones.
+ * @param [in,out] trace Trace to compact.
+ * @param [in,out] es Last nodes of the edit scripts, updated to the new indexes.
+ * @param [in] count Count of edit scripts.
+ */
+void
+stringdiffs::CollectTrace(std::vector<TraceNode> &trace, int *es, size_t count)
+{
+	std::vector<int> index(trace.size(), -1);
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int node = es[i]; node >= 0 && index[node] < 0; node = trace[node].prev)
+			index[node] = 0;
+	}
+	int n = 0;
+	for (size_t node = 0; node < trace.size(); node++)
+	{
+		if (index[node] < 0)
+			continue;
+		index[node] = n;
+		trace[n] = trace[node];
+		if (trace[n].prev >= 0)
+			trace[n].prev = index[trace[n].prev];
+		n++;
+	}
+	trace.resize(n);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (es[i] >= 0)
+			es[i] = index[es[i]];
+	}
+}
+
 int
 stringdiffs::snake(int k, int y, bool exchanged)
 {
@@ -45,6 +45,7 @@ void Init();
 void Close();
 
 void SetBreakChars(const TCHAR *breakChars);
+void SetTraceLimits(size_t minCollect, size_t maxNodes);
 
 void ComputeWordDiffs(const String& str1, const String& str2,
 	bool case_sensitive, int whitespace, int breakType, bool byte_level,
@@ -64,6 +64,11 @@ private:
 		word(int s = 0, int e = 0, int b = 0, int h = 0) : start(s), end(e), bBreak(b),hash(h) { }
 		int length() const { return end+1-start; }
 	};
+	struct TraceNode {
+		int prev;              // index of the node before this in the edit script, -1 if none
+		unsigned equal : 31;   // count of matching words after the edit
+		unsigned insert : 1;   // edit is '+', else '-'
+	};
 
 // Implementation methods
 private:
@@ -98,6 +103,8 @@ private:
 	int dp(std::vector<char> & edscript);
 	int onp(std::vector<char> & edscript);
 	int snake(int k, int y, bool exchanged);
+	void SnakeDiagonal(int k, int *fp, int *es, std::vector<TraceNode> &trace, bool exchanged);
+	static void CollectTrace(std::vector<TraceNode> &trace, int *es, size_t count);
 #ifdef STRINGDIFF_LOGGING
 	void debugoutput();
 #endif
@@ -8,10 +8,12 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <fstream>
+#include <vector>
 
 namespace
 {
 	const int WMCMPBUFF = 32 * 1024;
+	const int LARGECMPBUFF = 1024 * 1024;
 
 	struct TempFile
 	{
@@ -538,4 +540,99 @@ namespace
 
 	}
 
+	TEST_F(ByteCompareTest, LargeFiles)
+	{
+		CompareEngines::ByteCompare bc;
+		QuickCompareOptions option;
+		std::string filename_left  = "_tmp_.txt";
+		std::string filename_right = "_tmp_2.txt";
+		const int size = LARGECMPBUFF * 3;
+		std::vector<char> buf_left(size, 'A');
+
+		// CR/LF split between blocks
+		buf_left[LARGECMPBUFF - 1] = '\r';
+		buf_left[LARGECMPBUFF    ] = '\n';
+		buf_left[LARGECMPBUFF * 2 - 1] = '\r';
+		buf_left[LARGECMPBUFF * 2 + 1] = '\n';
+		for (int i = 100; i < size; i += LARGECMPBUFF / 2)
+			buf_left[i] = '\n';
+		std::vector<char> buf_right(buf_left);
+
+		bc.SetCompareOptions(option);
+
+		{
+			TempFile file_left (filename_left,  &buf_left[0],  size);
+			TempFile file_right(filename_right, &buf_right[0], size);
+
+			FilePair pair(filename_left, filename_right);
+			bc.SetFileData(2, pair.filedata);
+
+			EXPECT_EQ(DIFFCODE::TEXT|DIFFCODE::SAME, bc.CompareFiles(pair.location));
+			FileTextStats stats[2];
+			bc.GetTextStats(0, &stats[0]);
+			bc.GetTextStats(1, &stats[1]);
+			for (int i = 0; i < 2; ++i)
+			{
+				EXPECT_EQ(1, stats[i].ncrlfs);
+				EXPECT_EQ(1, stats[i].ncrs);
+				EXPECT_EQ(7, stats[i].nlfs);
+				EXPECT_EQ(0, stats[i].nzeros);
+			}
+		}
+
+		buf_right[size - 10] = 'B';
+
+		{
+			TempFile file_left (filename_left,  &buf_left[0],  size);
+			TempFile file_right(filename_right, &buf_right[0], size);
+
+			FilePair pair(filename_left, filename_right);
+			bc.SetFileData(2, pair.filedata);
+
+			EXPECT_EQ(DIFFCODE::TEXT|DIFFCODE::DIFF, bc.CompareFiles(pair.location));
+		}
+	}
+
+	TEST_F(ByteCompareTest, IgnoreAfterIdenticalBlocks)
+	{
+		CompareEngines::ByteCompare bc;
+		QuickCompareOptions option;
+		std::string filename_left  = "_tmp_.txt";
+		std::string filename_right = "_tmp_2.txt";
+		std::string text_left, text_right;
+
+		while (text_left.size() < LARGECMPBUFF * 2)
+			text_left += "abc def\n\n";
+		text_right = text_left;
+		text_left  += "abc  def\n\n \n";
+		text_right += "abc def\n \n";
+
+		option.m_ignoreWhitespace = WHITESPACE_IGNORE_CHANGE;
+		option.m_bIgnoreBlankLines = true;
+		option.m_bIgnoreEOLDifference = true;
+		bc.SetCompareOptions(option);
+
+		{
+			TempFile file_left (filename_left,  text_left.c_str(),  text_left.size());
+			TempFile file_right(filename_right, text_right.c_str(), text_right.size());
+
+			FilePair pair(filename_left, filename_right);
+			bc.SetFileData(2, pair.filedata);
+
+			EXPECT_EQ(DIFFCODE::TEXT|DIFFCODE::SAME, bc.CompareFiles(pair.location));
+		}
+
+		text_right += "abc";
+
+		{
+			TempFile file_left (filename_left,  text_left.c_str(),  text_left.size());
+			TempFile file_right(filename_right, text_right.c_str(), text_right.size());
+
+			FilePair pair(filename_left, filename_right);
+			bc.SetFileData(2, pair.filedata);
+
+			EXPECT_EQ(DIFFCODE::TEXT|DIFFCODE::DIFF, bc.CompareFiles(pair.location));
+		}
+	}
+
 }  // namespace
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/Thread.h>
+#include <Poco/Timestamp.h>
+#include "Environment.h"
+#include "paths.h"
+#include "ContentCache.h"
+
+namespace
+{
+	// The fixture for testing the folder compare content cache.
+	class ContentCacheTest : public testing::Test
+	{
+	protected:
+		ContentCacheTest()
+		{
+			m_path = paths::ConcatPath(env::GetProgPath(), _T("../TestData/_tmp_contentcache.txt"));
+		}
+
+		virtual ~ContentCacheTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+			_tremove(m_path.c_str());
+		}
+
+		virtual void TearDown()
+		{
+			_tremove(m_path.c_str());
+		}
+
+		// Create an entry with data depending on N.
+		static ContentCache::Entry MakeEntry(int n)
+		{
+			ContentCache::Entry entry;
+			entry.size = 1000 + n;
+			entry.mtime = 1500000000 * Poco::Timestamp::resolution() + n;
+			entry.options = 31 + n;
+			ContentCache::Hasher hasher;
+			hasher.update(std::string(n + 1, 'x'));
+			entry.digest = hasher.GetDigest();
+			entry.stats.ncrs = n;
+			entry.stats.nlfs = n + 1;
+			entry.stats.ncrlfs = n + 2;
+			entry.stats.nzeros = n + 3;
+			entry.encoding.m_unicoding = ucr::UTF8;
+			entry.encoding.m_codepage = 65001;
+			entry.encoding.m_bom = (n % 2) != 0;
+			entry.bBinary = (n % 3) == 0;
+			return entry;
+		}
+
+		static String FilePath(int n)
+		{
+			return strutils::format(_T("c:\\dir\\file%d.txt"), n);
+		}
+
+		// Look up the entry of N stored with MakeEntry().
+		static bool Lookup(ContentCache& cache, int n, ContentCache::Entry& entry)
+		{
+			ContentCache::Entry expected = MakeEntry(n);
+			return cache.Lookup(FilePath(n), expected.size, expected.mtime, expected.options, entry);
+		}
+
+		String m_path;
+	};
+
+	TEST_F(ContentCacheTest, LoadMissingFile)
+	{
+		ContentCache cache(m_path, 10);
+		EXPECT_FALSE(cache.Load());
+		ContentCache::Entry entry;
+		EXPECT_FALSE(Lookup(cache, 0, entry));
+	}
+
+	TEST_F(ContentCacheTest, SaveAndLoad)
+	{
+		{
+			ContentCache cache(m_path, 10);
+			for (int n = 0; n < 5; ++n)
+			{
+				ContentCache::Entry entry = MakeEntry(n);
+				cache.Store(FilePath(n), entry);
+			}
+			EXPECT_TRUE(cache.Save());
+		}
+
+		ContentCache cache(m_path, 10);
+		ASSERT_TRUE(cache.Load());
+		for (int n = 0; n < 5; ++n)
+		{
+			ContentCache::Entry expected = MakeEntry(n);
+			ContentCache::Entry entry;
+			ASSERT_TRUE(Lookup(cache, n, entry));
+			EXPECT_EQ(expected.size, entry.size);
+			EXPECT_EQ(expected.mtime, entry.mtime);
+			EXPECT_EQ(expected.options, entry.options);
+			EXPECT_EQ(expected.digest, entry.digest);
+			EXPECT_EQ(expected.stats.ncrs, entry.stats.ncrs);
+			EXPECT_EQ(expected.stats.nlfs, entry.stats.nlfs);
+			EXPECT_EQ(expected.stats.ncrlfs, entry.stats.ncrlfs);
+			EXPECT_EQ(expected.stats.nzeros, entry.stats.nzeros);
+			EXPECT_EQ(expected.encoding.m_unicoding, entry.encoding.m_unicoding);
+			EXPECT_EQ(expected.encoding.m_codepage, entry.encoding.m_codepage);
+			EXPECT_EQ(expected.encoding.m_bom, entry.encoding.m_bom);
+			EXPECT_EQ(expected.bBinary, entry.bBinary);
+		}
+	}
+
+	TEST_F(ContentCacheTest, InvalidFile)
+	{
+		FILE *file = _tfopen(m_path.c_str(), _T("w"));
+		ASSERT_TRUE(file != NULL);
+		fprintf(file, "WinMerge content cache 0\nc:\\file.txt\t1\t2\n");
+		fclose(file);
+
+		ContentCache cache(m_path, 10);
+		EXPECT_FALSE(cache.Load());
+		ContentCache::Entry entry;
+		EXPECT_FALSE(cache.Lookup(_T("c:\\file.txt"), 1, 2, 0, entry));
+	}
+
+	TEST_F(ContentCacheTest, ChangedFilesAreNotFound)
+	{
+		ContentCache cache(m_path, 10);
+		ContentCache::Entry stored = MakeEntry(1);
+		cache.Store(FilePath(1), stored);
+
+		ContentCache::Entry entry;
+		EXPECT_TRUE(cache.Lookup(FilePath(1), stored.size, stored.mtime, stored.options, entry));
+		EXPECT_FALSE(cache.Lookup(FilePath(2), stored.size, stored.mtime, stored.options, entry));
+		EXPECT_FALSE(cache.Lookup(FilePath(1), stored.size + 1, stored.mtime, stored.options, entry));
+		EXPECT_FALSE(cache.Lookup(FilePath(1), stored.size, stored.mtime + 1, stored.options, entry));
+		EXPECT_FALSE(cache.Lookup(FilePath(1), stored.size, stored.mtime, stored.options + 1, entry));
+
+		// Replaced entry is valid for new file data only
+		ContentCache::Entry changed = MakeEntry(1);
+		changed.size += 10;
+		cache.Store(FilePath(1), changed);
+		EXPECT_FALSE(cache.Lookup(FilePath(1), stored.size, stored.mtime, stored.options, entry));
+		EXPECT_TRUE(cache.Lookup(FilePath(1), changed.size, changed.mtime, changed.options, entry));
+	}
+
+	TEST_F(ContentCacheTest, LeastRecentlyUsedEntriesAreDropped)
+	{
+		{
+			ContentCache cache(m_path, 4);
+			for (int n = 0; n < 4; ++n)
+			{
+				ContentCache::Entry entry = MakeEntry(n);
+				cache.Store(FilePath(n), entry);
+			}
+			EXPECT_TRUE(cache.Save());
+		}
+
+		// Entries used in a later compare are kept
+		Poco::Thread::sleep(50);
+		{
+			ContentCache cache(m_path, 4);
+			ASSERT_TRUE(cache.Load());
+			ContentCache::Entry entry;
+			EXPECT_TRUE(Lookup(cache, 1, entry));
+			EXPECT_TRUE(Lookup(cache, 3, entry));
+			for (int n = 4; n < 6; ++n)
+			{
+				entry = MakeEntry(n);
+				cache.Store(FilePath(n), entry);
+			}
+			EXPECT_TRUE(cache.Save());
+		}
+
+		ContentCache cache(m_path, 4);
+		ASSERT_TRUE(cache.Load());
+		ContentCache::Entry entry;
+		EXPECT_FALSE(Lookup(cache, 0, entry));
+		EXPECT_TRUE(Lookup(cache, 1, entry));
+		EXPECT_FALSE(Lookup(cache, 2, entry));
+		EXPECT_TRUE(Lookup(cache, 3, entry));
+		EXPECT_TRUE(Lookup(cache, 4, entry));
+		EXPECT_TRUE(Lookup(cache, 5, entry));
+	}
+
+	TEST_F(ContentCacheTest, RecentlyModifiedFilesAreNotCacheable)
+	{
+		Poco::Timestamp now;
+		EXPECT_FALSE(ContentCache::IsCacheable(now));
+		EXPECT_FALSE(ContentCache::IsCacheable(now + Poco::Timestamp::resolution()));
+		EXPECT_FALSE(ContentCache::IsCacheable(Poco::Timestamp(0)));
+		EXPECT_TRUE(ContentCache::IsCacheable(now - 10 * Poco::Timestamp::resolution()));
+	}
+
+	TEST_F(ContentCacheTest, HasherCountsHashedBytes)
+	{
+		ContentCache::Hasher hasher;
+		hasher.update("abc", 3);
+		hasher.update(std::string(1000, 'x'));
+		EXPECT_EQ(1003, hasher.GetSize());
+		std::string digest = hasher.GetDigest();
+		EXPECT_EQ(40u, digest.size());
+
+		ContentCache::Hasher hasher2;
+		hasher2.update(std::string("abc") + std::string(1000, 'x'));
+		EXPECT_EQ(digest, hasher2.GetDigest());
+	}
+
+}  // namespace
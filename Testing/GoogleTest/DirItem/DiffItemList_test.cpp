@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <ctime>
+#include <vector>
+#include "UnicodeString.h"
+#include "DiffItemList.h"
+
+namespace
+{
+	// The fixture for testing the list of folder compare items.
+	class DiffItemListTest : public testing::Test
+	{
+	protected:
+		DiffItemListTest()
+		{
+		}
+
+		virtual ~DiffItemListTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Add NFOLDERS folders having NFILES files each, like a 2-way
+		// compare of identical trees, and walk and remove them. The time
+		// and the memory of the items are recorded.
+		void Benchmark(int nFolders, int nFiles)
+		{
+			std::vector<String> names(nFiles);
+			for (int i = 0; i < nFiles; ++i)
+				names[i] = strutils::format(_T("file%d.txt"), i);
+			FileTextStats stats;
+			stats.ncrlfs = 10;
+
+			clock_t start = clock();
+			DiffItemList list;
+			for (int i = 0; i < nFolders; ++i)
+			{
+				String folder = strutils::format(_T("folder%d"), i);
+				DIFFITEM *dir = list.AddDiff(NULL);
+				dir->diffcode.diffcode = DIFFCODE::DIR | DIFFCODE::BOTH | DIFFCODE::SAME;
+				for (int j = 0; j < nFiles; ++j)
+				{
+					DIFFITEM *file = list.AddDiff(dir);
+					file->diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::BOTH | DIFFCODE::TEXT | DIFFCODE::SAME;
+					for (int k = 0; k < 2; ++k)
+					{
+						file->diffFileInfo[k].path = folder;
+						file->diffFileInfo[k].filename = names[j];
+						file->diffFileInfo[k].size = j;
+						// Some of the files were compared
+						if (j % 10 == 0)
+							file->diffFileInfo[k].SetTextStats(stats);
+					}
+				}
+			}
+
+			long long nItems = 0;
+			long long nSize = 0;
+			uintptr_t pos = list.GetFirstDiffPosition();
+			while (pos)
+			{
+				const DIFFITEM &di = list.GetNextDiffPosition(pos);
+				if (!di.diffcode.isDirectory())
+					nSize += di.diffFileInfo[0].size;
+				++nItems;
+			}
+			list.RemoveAll();
+			clock_t elapsed = clock() - start;
+
+			EXPECT_EQ(static_cast<long long>(nFolders) * (nFiles + 1), nItems);
+			EXPECT_EQ(static_cast<long long>(nFolders) * nFiles * (nFiles - 1) / 2, nSize);
+			RecordProperty("milliseconds", static_cast<int>(elapsed * 1000 / CLOCKS_PER_SEC));
+			RecordProperty("item_bytes", static_cast<int>(sizeof(DIFFITEM)));
+			RecordProperty("megabytes", static_cast<int>(nItems * sizeof(DIFFITEM) / (1024 * 1024)));
+		}
+	};
+
+	TEST_F(DiffItemListTest, AddAndWalk)
+	{
+		DiffItemList list;
+		EXPECT_EQ(0u, list.GetFirstDiffPosition());
+		DIFFITEM *dir = list.AddDiff(NULL);
+		DIFFITEM *file1 = list.AddDiff(dir);
+		DIFFITEM *file2 = list.AddDiff(dir);
+		DIFFITEM *file3 = list.AddDiff(NULL);
+		EXPECT_EQ(dir, file1->parent);
+		EXPECT_TRUE(file3->parent == NULL);
+		EXPECT_EQ(1, file2->GetDepth());
+		EXPECT_TRUE(dir->HasChildren());
+		EXPECT_FALSE(file1->HasChildren());
+
+		uintptr_t pos = list.GetFirstDiffPosition();
+		EXPECT_EQ(dir, &list.GetNextDiffRefPosition(pos));
+		EXPECT_EQ(file1, &list.GetNextDiffRefPosition(pos));
+		EXPECT_EQ(file2, &list.GetNextDiffRefPosition(pos));
+		EXPECT_EQ(file3, &list.GetNextDiffRefPosition(pos));
+		EXPECT_EQ(0u, pos);
+
+		pos = list.GetFirstDiffPosition();
+		EXPECT_EQ(dir, &list.GetNextSiblingDiffRefPosition(pos));
+		EXPECT_EQ(file3, &list.GetNextSiblingDiffRefPosition(pos));
+		EXPECT_EQ(0u, pos);
+	}
+
+	TEST_F(DiffItemListTest, RemoveItems)
+	{
+		DiffItemList list;
+		DIFFITEM *dir = list.AddDiff(NULL);
+		DIFFITEM *file1 = list.AddDiff(dir);
+		DIFFITEM *file2 = list.AddDiff(dir);
+		DIFFITEM *file3 = list.AddDiff(NULL);
+		file1->diffFileInfo[0].filename = _T("file1");
+
+		list.RemoveChildren(reinterpret_cast<uintptr_t>(dir));
+		EXPECT_FALSE(dir->HasChildren());
+		// Removed items are reused
+		DIFFITEM *file4 = list.AddDiff(dir);
+		EXPECT_TRUE(file4 == file1 || file4 == file2);
+		EXPECT_EQ(String(), file4->diffFileInfo[0].filename.get());
+		EXPECT_EQ(dir, file4->parent);
+
+		list.RemoveDiff(reinterpret_cast<uintptr_t>(dir));
+		uintptr_t pos = list.GetFirstDiffPosition();
+		EXPECT_EQ(file3, &list.GetNextDiffRefPosition(pos));
+		EXPECT_EQ(0u, pos);
+
+		list.RemoveAll();
+		EXPECT_EQ(0u, list.GetFirstDiffPosition());
+		DIFFITEM *file5 = list.AddDiff(NULL);
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(file5), list.GetFirstDiffPosition());
+	}
+
+	TEST_F(DiffItemListTest, TextInfo)
+	{
+		DiffFileInfo dfi;
+		EXPECT_EQ(-1, dfi.GetEncoding().m_codepage);
+		EXPECT_EQ(0u, dfi.GetTextStats().nlfs);
+		EXPECT_TRUE(dfi.IsEditableEncoding());
+
+		FileTextEncoding encoding;
+		encoding.SetCodepage(1252);
+		dfi.SetEncoding(encoding);
+		FileTextStats stats;
+		stats.nlfs = 3;
+		dfi.SetTextStats(stats);
+		EXPECT_EQ(1252, dfi.GetEncoding().m_codepage);
+		EXPECT_EQ(3u, dfi.GetTextStats().nlfs);
+
+		DiffFileInfo copy(dfi);
+		EXPECT_EQ(1252, copy.GetEncoding().m_codepage);
+		EXPECT_EQ(3u, copy.GetTextStats().nlfs);
+		dfi.ClearPartial();
+		EXPECT_EQ(-1, dfi.GetEncoding().m_codepage);
+		EXPECT_EQ(0u, dfi.GetTextStats().nlfs);
+		EXPECT_EQ(1252, copy.GetEncoding().m_codepage);
+		copy = dfi;
+		EXPECT_EQ(-1, copy.GetEncoding().m_codepage);
+		EXPECT_EQ(0u, copy.GetTextStats().nlfs);
+	}
+
+	TEST_F(DiffItemListTest, DISABLED_Memory1M)
+	{
+		Benchmark(1000, 1000);
+	}
+
+	// Takes some GB of memory
+	TEST_F(DiffItemListTest, DISABLED_Memory10M)
+	{
+		Benchmark(10000, 1000);
+	}
+
+}  // namespace
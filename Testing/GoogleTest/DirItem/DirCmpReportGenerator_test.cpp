@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+#include <ctime>
+#include <sstream>
+#include <vector>
+#include "UnicodeString.h"
+#include "DiffItemList.h"
+#include "DirViewListModel.h"
+#include "DirCmpReportGenerator.h"
+#include "Utf8Writer.h"
+
+namespace
+{
+	const unsigned EXPANDED = 0x4;
+
+	// Columns showing the name and the size of the left item.
+	struct TestColumns : public IDirCmpReportColumns
+	{
+		int GetColumnCount() const { return 2; }
+		String GetColumnName(int col) const { return col == 0 ? _T("Name") : _T("Size"); }
+		String GetItemText(const DIFFITEM &di, int col) const
+		{
+			if (col == 0)
+				return di.diffFileInfo[0].filename.get();
+			return di.diffcode.isDirectory() ? String() : strutils::to_str(di.diffFileInfo[0].size);
+		}
+		int GetBackColor(const DIFFITEM &di) const { return di.diffcode.isResultDiff() ? 0x0000ff : 0xffffff; }
+		int GetIconIndex(const DIFFITEM &di) const { return di.diffcode.isDirectory() ? 1 : 0; }
+		int GetIconCount() const { return 3; }
+		std::string GetIconPNGData(int iconIndex) const { return std::string(3, static_cast<char>('a' + iconIndex)); }
+	};
+
+	// The fixture for testing folder compare reports.
+	class DirCmpReportGeneratorTest : public testing::Test
+	{
+	protected:
+		DirCmpReportGeneratorTest()
+		{
+			m_colRegKeys.push_back(_T("Name"));
+			m_colRegKeys.push_back(_T("Size"));
+		}
+
+		virtual ~DirCmpReportGeneratorTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Add an item existing on both sides of a 2-way compare.
+		DIFFITEM *Add(DIFFITEM *parent, const String& name, bool bDir, int64_t size = 0, unsigned flags = 0)
+		{
+			DIFFITEM *di = m_list.AddDiff(parent);
+			di->diffcode.diffcode = (bDir ? DIFFCODE::DIR : DIFFCODE::FILE) | DIFFCODE::BOTH | DIFFCODE::SAME;
+			di->diffFileInfo[0].filename = name;
+			di->diffFileInfo[1].filename = name;
+			di->diffFileInfo[0].size = size;
+			di->customFlags1 = flags;
+			return di;
+		}
+
+		// Set up MODEL to show all items, expanded folders in tree mode.
+		static void SetMode(DirViewListModel& model, bool bTreeMode)
+		{
+			model.SetMode(bTreeMode, true, 2);
+			model.SetPredicates(
+				[](const DIFFITEM &) { return true; },
+				[](const DIFFITEM &di) { return (di.customFlags1 & EXPANDED) != 0; });
+		}
+
+		// Generate a report of all items MODEL would show, in compare order.
+		std::string Generate(const DirViewListModel& model, REPORT_TYPE nReportType, bool bCrLf = false)
+		{
+			DirCmpReportGenerator generator(m_list, model, m_columns, m_colRegKeys);
+			generator.SetDisplayOrder(false);
+			generator.SetHeader(_T("Compare"), _T("c:\\a&b"), _T("c:\\c"), _T("now"));
+			std::ostringstream stream;
+			{
+				Utf8Writer writer(stream, bCrLf);
+				generator.Generate(nReportType, writer);
+			}
+			return stream.str();
+		}
+
+		DiffItemList m_list;
+		TestColumns m_columns;
+		std::vector<String> m_colRegKeys;
+	};
+
+	TEST_F(DirCmpReportGeneratorTest, Writer)
+	{
+		std::ostringstream stream;
+		{
+			Utf8Writer writer(stream);
+			writer.Write(_T("a\nb"));
+			writer.Write(String(_T("<\"&'>")), Utf8Writer::ESCAPE_XML);
+			writer.Write(String(_T("\"\\\t\x01")), Utf8Writer::ESCAPE_JSON);
+			const TCHAR text[] = { 0xe4, 0x20ac, 0 };
+			writer.Write(text);
+			writer.WriteBytes("xyz", 3);
+		}
+		EXPECT_EQ("a\r\nb&lt;&quot;&amp;&#39;&gt;\\\"\\\\\\t\\u0001\xc3\xa4\xe2\x82\xacxyz", stream.str());
+
+		// Text longer than the buffer
+		std::ostringstream stream2;
+		{
+			Utf8Writer writer(stream2, false);
+			String text(100000, _T('\n'));
+			writer.Write(text);
+			writer.Write(_T("end"));
+		}
+		EXPECT_EQ(std::string(100000, '\n') + "end", stream2.str());
+	}
+
+	TEST_F(DirCmpReportGeneratorTest, CommaList)
+	{
+		DIFFITEM *dir = Add(NULL, _T("dir"), true);
+		Add(dir, _T("a,b.txt"), false, 10);
+		Add(dir, _T("say \"hi\".txt"), false, 20);
+		DirViewListModel model;
+		SetMode(model, false);
+		EXPECT_EQ("Compare\r\nnow\r\nName,Size"
+			"\r\n\"a,b.txt\",10"
+			"\r\n\"say \"\"hi\"\".txt\",20", Generate(model, REPORT_TYPE_COMMALIST, true));
+		EXPECT_EQ("Compare\nnow\nName\tSize"
+			"\na,b.txt\t10"
+			"\n\"say \"\"hi\"\".txt\"\t20", Generate(model, REPORT_TYPE_TABLIST));
+	}
+
+	TEST_F(DirCmpReportGeneratorTest, Xml)
+	{
+		Add(NULL, _T("R&D"), true);
+		const TCHAR name[] = { 'f', 0xe4, '.', 't', 'x', 't', 0 };
+		Add(NULL, name, false, 5);
+		DirViewListModel model;
+		SetMode(model, true);
+		EXPECT_EQ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			"<WinMergeDiffReport version=\"1\">\n"
+			"<left>c:\\a&amp;b</left>\n<right>c:\\c</right>\n<time>now</time>\n"
+			"<column_name><Name>Name</Name><Size>Size</Size></column_name>\n"
+			"<filediff><Name>R&amp;D</Name><Size></Size></filediff>\n"
+			"<filediff><Name>f\xc3\xa4.txt</Name><Size>5</Size></filediff>\n"
+			"</WinMergeDiffReport>\n", Generate(model, REPORT_TYPE_SIMPLEXML));
+	}
+
+	TEST_F(DirCmpReportGeneratorTest, Html)
+	{
+		DIFFITEM *dir = Add(NULL, _T("dir"), true, 0, EXPANDED);
+		Add(dir, _T("a.txt"), false, 1)->diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::BOTH | DIFFCODE::DIFF;
+		DirViewListModel model;
+		SetMode(model, true);
+		std::string html = Generate(model, REPORT_TYPE_SIMPLEHTML);
+		// Styles of the icons and the indents in use
+		EXPECT_NE(std::string::npos, html.find(".icon0 { background-image: url('data:image/png;base64,YWFh');"));
+		EXPECT_NE(std::string::npos, html.find(".icon1 { background-image: url('data:image/png;base64,YmJi');"));
+		EXPECT_EQ(std::string::npos, html.find(".icon2"));
+		EXPECT_NE(std::string::npos, html.find(".indent1 {"));
+		EXPECT_EQ(std::string::npos, html.find(".indent2 {"));
+		EXPECT_NE(std::string::npos, html.find("<th>Name</th><th>Size</th></tr>\n"
+			"<tr style='background-color: #ffffff'><td class=\"icon1 indent0\">dir</td><td></td></tr>\n"
+			"<tr style='background-color: #ff0000'><td class=\"icon0 indent1\">a.txt</td><td>1</td></tr>\n"
+			"</table>\n</div>\n</body>\n</html>\n"));
+	}
+
+	TEST_F(DirCmpReportGeneratorTest, JsonLines)
+	{
+		DIFFITEM *dir = Add(NULL, _T("dir"), true);
+		Add(dir, _T("a\"b\\c.txt"), false, 7);
+		Add(NULL, _T("d.txt"), false, 8);
+		DirViewListModel model;
+		SetMode(model, false);
+		EXPECT_EQ("{\"Name\":\"a\\\"b\\\\c.txt\",\"Size\":\"7\"}\n"
+			"{\"Name\":\"d.txt\",\"Size\":\"8\"}\n", Generate(model, REPORT_TYPE_JSONLINES));
+	}
+
+	TEST_F(DirCmpReportGeneratorTest, DisplayOrder)
+	{
+		Add(NULL, _T("b.txt"), false, 1);
+		Add(NULL, _T("a.txt"), false, 2);
+		DirViewListModel model;
+		SetMode(model, false);
+		model.AddSpecialItem();
+		int alldiffs = 0;
+		model.InsertChildren(m_list, 1, m_list.GetFirstDiffPosition(), 0, alldiffs);
+		model.Sort(m_list, [](const DIFFITEM &di, DirSortKey &key) { key.text = di.diffFileInfo[0].filename.get(); }, true);
+
+		DirCmpReportGenerator generator(m_list, model, m_columns, m_colRegKeys);
+		std::ostringstream stream;
+		{
+			Utf8Writer writer(stream, false);
+			generator.Generate(REPORT_TYPE_JSONLINES, writer);
+		}
+		// The special item is not reported
+		EXPECT_EQ("{\"Name\":\"a.txt\",\"Size\":\"2\"}\n"
+			"{\"Name\":\"b.txt\",\"Size\":\"1\"}\n", stream.str());
+	}
+
+	// Stream buffer counting the bytes written to it.
+	class CountingBuf : public std::streambuf
+	{
+	public:
+		CountingBuf() : m_count(0) {}
+		long long m_count;
+	protected:
+		std::streamsize xsputn(const char *, std::streamsize n) { m_count += n; return n; }
+		int_type overflow(int_type ch) { ++m_count; return ch; }
+	};
+
+	// Report 1000 folders having 1000 files each.
+	TEST_F(DirCmpReportGeneratorTest, DISABLED_Benchmark1M)
+	{
+		const int nFolders = 1000;
+		const int nFiles = 1000;
+		std::vector<String> names(nFiles);
+		for (int i = 0; i < nFiles; ++i)
+			names[i] = strutils::format(_T("File%d.txt"), i);
+		for (int i = 0; i < nFolders; ++i)
+		{
+			DIFFITEM *dir = Add(NULL, strutils::format(_T("folder%d"), i), true, 0, EXPANDED);
+			for (int j = 0; j < nFiles; ++j)
+				Add(dir, names[j], false, j);
+		}
+		DirViewListModel model;
+		SetMode(model, true);
+		DirCmpReportGenerator generator(m_list, model, m_columns, m_colRegKeys);
+		generator.SetDisplayOrder(false);
+
+		const REPORT_TYPE types[] = { REPORT_TYPE_COMMALIST, REPORT_TYPE_SIMPLEHTML, REPORT_TYPE_SIMPLEXML, REPORT_TYPE_JSONLINES };
+		const char *properties[] = { "csv_milliseconds", "html_milliseconds", "xml_milliseconds", "jsonl_milliseconds" };
+		for (int i = 0; i < 4; ++i)
+		{
+			CountingBuf buf;
+			std::ostream stream(&buf);
+			clock_t start = clock();
+			{
+				Utf8Writer writer(stream);
+				generator.Generate(types[i], writer);
+			}
+			clock_t elapsed = clock() - start;
+			EXPECT_LT(static_cast<long long>(nFolders) * nFiles * 10, buf.m_count);
+			RecordProperty(properties[i], static_cast<int>(elapsed * 1000 / CLOCKS_PER_SEC));
+		}
+	}
+
+}  // namespace
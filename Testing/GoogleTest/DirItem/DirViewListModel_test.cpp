@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include <ctime>
+#include <vector>
+#include "UnicodeString.h"
+#include "DiffItemList.h"
+#include "DirViewListModel.h"
+
+namespace
+{
+	const unsigned EXPANDED = 0x4;
+
+	// The fixture for testing the rows of the folder compare list.
+	class DirViewListModelTest : public testing::Test
+	{
+	protected:
+		DirViewListModelTest()
+		{
+		}
+
+		virtual ~DirViewListModelTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Add an item existing on both sides of a 2-way compare.
+		DIFFITEM *Add(DIFFITEM *parent, const String& name, bool bDir, unsigned flags = 0)
+		{
+			DIFFITEM *di = m_list.AddDiff(parent);
+			di->diffcode.diffcode = (bDir ? DIFFCODE::DIR : DIFFCODE::FILE) | DIFFCODE::BOTH | DIFFCODE::SAME;
+			di->diffFileInfo[0].filename = name;
+			di->diffFileInfo[1].filename = name;
+			di->customFlags1 = flags;
+			return di;
+		}
+
+		// Set up MODEL to show all items, expanded folders in tree mode.
+		static void SetMode(DirViewListModel& model, bool bTreeMode, bool bRecursive)
+		{
+			model.SetMode(bTreeMode, bRecursive, 2);
+			model.SetPredicates(
+				[](const DIFFITEM &) { return true; },
+				[](const DIFFITEM &di) { return (di.customFlags1 & EXPANDED) != 0; });
+		}
+
+		static void NameKey(const DIFFITEM &di, DirSortKey &key)
+		{
+			key.number = di.diffcode.isDirectory() ? 0 : 1;
+			key.text = di.diffFileInfo[0].filename.get();
+		}
+
+		static void SizeKey(const DIFFITEM &di, DirSortKey &key)
+		{
+			key.number = di.diffFileInfo[0].size;
+		}
+
+		// Names in the rows of MODEL, indented by their levels.
+		String Rows(const DirViewListModel& model) const
+		{
+			String s;
+			for (int i = 0; i < model.GetRowCount(); ++i)
+			{
+				uintptr_t diffpos = model.GetDiffPos(i);
+				s += String(model.GetLevel(i), ' ');
+				s += (diffpos == SPECIAL_ITEM_POS) ? _T("..") : m_list.GetDiffAt(diffpos).diffFileInfo[0].filename.get();
+				s += ';';
+			}
+			return s;
+		}
+
+		DiffItemList m_list;
+	};
+
+	TEST_F(DirViewListModelTest, FlatMode)
+	{
+		DIFFITEM *dir = Add(NULL, _T("dir"), true);
+		Add(dir, _T("b.txt"), false);
+		Add(dir, _T("a.txt"), false);
+		DIFFITEM *unique = Add(NULL, _T("new"), true);
+		unique->diffcode.diffcode = DIFFCODE::DIR | DIFFCODE::FIRST | DIFFCODE::DIFF;
+		Add(NULL, _T("c.txt"), false);
+
+		DirViewListModel model;
+		SetMode(model, false, true);
+		int alldiffs = 0;
+		EXPECT_EQ(4, model.InsertChildren(m_list, 0, m_list.GetFirstDiffPosition(), 0, alldiffs));
+		// Folders existing on all sides are not shown in flat mode
+		EXPECT_EQ(_T("b.txt;a.txt;new;c.txt;"), Rows(model));
+		EXPECT_EQ(1, alldiffs);
+		EXPECT_EQ(0, model.GetLevel(1));
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(unique), model.GetDiffPos(2));
+		EXPECT_EQ(2, model.FindRow(reinterpret_cast<uintptr_t>(unique)));
+		EXPECT_EQ(-1, model.FindRow(reinterpret_cast<uintptr_t>(dir)));
+		EXPECT_EQ(0u, model.GetDiffPos(4));
+
+		model.Clear();
+		SetMode(model, false, false);
+		model.AddSpecialItem();
+		alldiffs = 0;
+		model.InsertChildren(m_list, 1, m_list.GetFirstDiffPosition(), 0, alldiffs);
+		EXPECT_EQ(_T("..;dir;b.txt;a.txt;new;c.txt;"), Rows(model));
+
+		model.SetPredicates([](const DIFFITEM &di) { return !di.diffcode.isDirectory(); }, nullptr);
+		model.Clear();
+		model.InsertChildren(m_list, 0, m_list.GetFirstDiffPosition(), 0, alldiffs);
+		EXPECT_EQ(_T("c.txt;"), Rows(model));
+	}
+
+	TEST_F(DirViewListModelTest, TreeMode)
+	{
+		DIFFITEM *dir1 = Add(NULL, _T("dir1"), true, EXPANDED);
+		DIFFITEM *dir2 = Add(dir1, _T("dir2"), true);
+		Add(dir2, _T("x.txt"), false);
+		Add(dir1, _T("y.txt"), false);
+		Add(NULL, _T("z.txt"), false);
+
+		DirViewListModel model;
+		SetMode(model, true, true);
+		int alldiffs = 0;
+		model.InsertChildren(m_list, 0, m_list.GetFirstDiffPosition(), 0, alldiffs);
+		EXPECT_EQ(_T("dir1; dir2; y.txt;z.txt;"), Rows(model));
+
+		// Expand dir2
+		dir2->customFlags1 |= EXPANDED;
+		EXPECT_EQ(1, model.InsertChildren(m_list, 2, m_list.GetFirstChildDiffPosition(reinterpret_cast<uintptr_t>(dir2)), 2, alldiffs));
+		EXPECT_EQ(_T("dir1; dir2;  x.txt; y.txt;z.txt;"), Rows(model));
+
+		// Collapse dir1
+		EXPECT_EQ(3, model.RemoveChildRows(0));
+		EXPECT_EQ(_T("dir1;z.txt;"), Rows(model));
+		EXPECT_EQ(0, model.RemoveChildRows(1));
+		model.RemoveRow(0);
+		EXPECT_EQ(_T("z.txt;"), Rows(model));
+	}
+
+	TEST_F(DirViewListModelTest, SortFlat)
+	{
+		Add(NULL, _T("b.txt"), false)->diffFileInfo[0].size = 1;
+		Add(NULL, _T("C.txt"), false)->diffFileInfo[0].size = 2;
+		Add(NULL, _T("sub"), true);
+		Add(NULL, _T("a.txt"), false)->diffFileInfo[0].size = 2;
+		Add(NULL, _T("B.TXT"), false)->diffFileInfo[0].size = 0;
+
+		DirViewListModel model;
+		SetMode(model, false, false);
+		model.AddSpecialItem();
+		int alldiffs = 0;
+		model.InsertChildren(m_list, 1, m_list.GetFirstDiffPosition(), 0, alldiffs);
+
+		// Folders first, names compared case-insensitively, equal names
+		// in their earlier order
+		model.Sort(m_list, NameKey, true);
+		EXPECT_EQ(_T("..;sub;a.txt;b.txt;B.TXT;C.txt;"), Rows(model));
+		model.Sort(m_list, NameKey, false);
+		EXPECT_EQ(_T("..;C.txt;b.txt;B.TXT;a.txt;sub;"), Rows(model));
+		model.Sort(m_list, SizeKey, true);
+		EXPECT_EQ(_T("..;sub;B.TXT;b.txt;C.txt;a.txt;"), Rows(model));
+		model.Sort(m_list, SizeKey, false);
+		EXPECT_EQ(_T("..;C.txt;a.txt;b.txt;B.TXT;sub;"), Rows(model));
+	}
+
+	TEST_F(DirViewListModelTest, SortTree)
+	{
+		DIFFITEM *dirB = Add(NULL, _T("B"), true, EXPANDED);
+		Add(dirB, _T("z.txt"), false);
+		DIFFITEM *dirC = Add(dirB, _T("c"), true, EXPANDED);
+		Add(dirC, _T("2.txt"), false);
+		Add(dirC, _T("1.txt"), false);
+		Add(dirB, _T("y.txt"), false);
+		Add(NULL, _T("x.txt"), false);
+		DIFFITEM *dirA = Add(NULL, _T("a"), true, EXPANDED);
+		Add(dirA, _T("w.txt"), false);
+		Add(dirA, _T("d"), true);
+
+		DirViewListModel model;
+		SetMode(model, true, true);
+		int alldiffs = 0;
+		model.InsertChildren(m_list, 0, m_list.GetFirstDiffPosition(), 0, alldiffs);
+
+		// Children are sorted among themselves and follow their folder
+		model.Sort(m_list, NameKey, true);
+		EXPECT_EQ(_T("a; d; w.txt;B; c;  1.txt;  2.txt; y.txt; z.txt;x.txt;"), Rows(model));
+		model.Sort(m_list, NameKey, false);
+		EXPECT_EQ(_T("x.txt;B; z.txt; y.txt; c;  2.txt;  1.txt;a; w.txt; d;"), Rows(model));
+
+		// Collapse and expand c
+		int row = model.FindRow(reinterpret_cast<uintptr_t>(dirC));
+		EXPECT_EQ(2, model.RemoveChildRows(row));
+		model.InsertChildren(m_list, row + 1, m_list.GetFirstChildDiffPosition(reinterpret_cast<uintptr_t>(dirC)), 2, alldiffs);
+		model.Sort(m_list, NameKey, true);
+		EXPECT_EQ(_T("a; d; w.txt;B; c;  1.txt;  2.txt; y.txt; z.txt;x.txt;"), Rows(model));
+	}
+
+	// Show and sort a tree of 1000 expanded folders having 1000 files each.
+	TEST_F(DirViewListModelTest, DISABLED_Benchmark1M)
+	{
+		const int nFolders = 1000;
+		const int nFiles = 1000;
+		std::vector<String> names(nFiles);
+		for (int i = 0; i < nFiles; ++i)
+			names[i] = strutils::format(_T("File%d.txt"), (i * 7919) % nFiles);
+		for (int i = 0; i < nFolders; ++i)
+		{
+			DIFFITEM *dir = Add(NULL, strutils::format(_T("folder%d"), (i * 613) % nFolders), true, EXPANDED);
+			for (int j = 0; j < nFiles; ++j)
+				Add(dir, names[j], false)->diffFileInfo[0].size = (i * 31 + j * 17) % 1000;
+		}
+
+		clock_t start = clock();
+		DirViewListModel model;
+		SetMode(model, true, true);
+		int alldiffs = 0;
+		model.InsertChildren(m_list, 0, m_list.GetFirstDiffPosition(), 0, alldiffs);
+		clock_t build = clock() - start;
+		start = clock();
+		model.Sort(m_list, NameKey, true);
+		clock_t sortName = clock() - start;
+		start = clock();
+		model.Sort(m_list, SizeKey, false);
+		clock_t sortSize = clock() - start;
+
+		ASSERT_EQ(nFolders * (nFiles + 1), model.GetRowCount());
+		int64_t last = 0;
+		for (int i = 0; i < model.GetRowCount(); ++i)
+		{
+			const DIFFITEM &di = m_list.GetDiffAt(model.GetDiffPos(i));
+			if (di.diffcode.isDirectory())
+				last = 1000;
+			else
+			{
+				EXPECT_GE(last, di.diffFileInfo[0].size);
+				last = di.diffFileInfo[0].size;
+			}
+		}
+		RecordProperty("build_milliseconds", static_cast<int>(build * 1000 / CLOCKS_PER_SEC));
+		RecordProperty("sort_name_milliseconds", static_cast<int>(sortName * 1000 / CLOCKS_PER_SEC));
+		RecordProperty("sort_size_milliseconds", static_cast<int>(sortSize * 1000 / CLOCKS_PER_SEC));
+	}
+
+}  // namespace
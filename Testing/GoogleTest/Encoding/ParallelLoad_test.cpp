@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/Thread.h>
+#include <Poco/Timestamp.h>
+#include "Environment.h"
+#include "paths.h"
+#include "unicoder.h"
+#include "UniFile.h"
+#include "LoadProgress.h"
+#include "ParallelInvoke.h"
+
+namespace
+{
+	// The fixture for testing loading the files of all panes at the same time.
+	class ParallelLoadTest : public testing::Test
+	{
+	protected:
+		ParallelLoadTest()
+		{
+			for (int i = 0; i < 3; ++i)
+				m_paths[i] = paths::ConcatPath(env::GetProgPath(), strutils::format(_T("../TestData/_tmp_load%d.txt"), i));
+		}
+
+		virtual ~ParallelLoadTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+			for (int i = 0; i < 3; ++i)
+				_tremove(m_paths[i].c_str());
+		}
+
+		// Write a file of LINES lines to the path of pane INDEX.
+		// Returns the size of the file.
+		int64_t WriteFile(int index, int lines)
+		{
+			FILE *file = _tfopen(m_paths[index].c_str(), _T("wb"));
+			EXPECT_TRUE(file != NULL);
+			if (!file)
+				return 0;
+			for (int i = 0; i < lines; ++i)
+				fprintf(file, "line %d of pane %d, with some text after it\r\n", i, index);
+			int64_t size = ftell(file);
+			fclose(file);
+			return size;
+		}
+
+		// Read the lines of a file the way CDiffTextBuffer::LoadFromFile()
+		// does, reporting the bytes read to PROGRESS.
+		// Returns the count of lines, or -1 if the file can't be opened.
+		static int LoadFile(const String& path, LoadProgress& progress)
+		{
+			UniMemFile file;
+			if (!file.OpenReadOnly(path))
+				return -1;
+			if (!file.IsUnicode())
+				file.SetCodepage(ucr::CP_UTF_8);
+			std::vector<String> lines;
+			String line, eol;
+			int64_t pos = 0;
+			bool done = false;
+			do
+			{
+				bool lossy = false;
+				done = !file.ReadString(line, eol, &lossy);
+				lines.push_back(line);
+				if ((lines.size() & 4095) == 0)
+				{
+					int64_t newPos = file.GetPosition();
+					progress.AddLoaded(newPos - pos);
+					pos = newPos;
+				}
+			} while (!done);
+			progress.AddLoaded(file.GetPosition() - pos);
+			file.Close();
+			return static_cast<int>(lines.size());
+		}
+
+		String m_paths[3];
+	};
+
+	TEST_F(ParallelLoadTest, InvokeEach)
+	{
+		const int count = 3;
+		std::atomic<int> calls[count];
+		Poco::Thread *threads[count] = { NULL };
+		int waits = 0;
+		for (int i = 0; i < count; ++i)
+			calls[i] = 0;
+		ParallelInvokeEach(count, [&](int index)
+			{
+				++calls[index];
+				threads[index] = Poco::Thread::current();
+				Poco::Thread::sleep(50);
+			}, [&]() { ++waits; }, 5);
+		for (int i = 0; i < count; ++i)
+		{
+			EXPECT_EQ(1, calls[i]);
+			EXPECT_TRUE(threads[i] != NULL);
+		}
+		EXPECT_NE(threads[0], threads[1]);
+		EXPECT_NE(threads[1], threads[2]);
+		EXPECT_LT(0, waits);
+	}
+
+	TEST_F(ParallelLoadTest, InvokeEachException)
+	{
+		std::atomic<int> calls(0);
+		try
+		{
+			ParallelInvokeEach(3, [&](int index)
+				{
+					++calls;
+					if (index == 2)
+						throw std::runtime_error("2");
+					if (index == 1)
+					{
+						Poco::Thread::sleep(20);
+						throw std::runtime_error("1");
+					}
+				}, []() {}, 5);
+			FAIL();
+		}
+		catch (std::runtime_error& e)
+		{
+			// The exception of the lowest index, once all have returned
+			EXPECT_STREQ("1", e.what());
+		}
+		EXPECT_EQ(3, calls);
+	}
+
+	TEST_F(ParallelLoadTest, Progress)
+	{
+		LoadProgress progress;
+		EXPECT_EQ(0, progress.GetPercent());
+		progress.AddTotal(100);
+		progress.AddTotal(300);
+		progress.AddLoaded(100);
+		EXPECT_EQ(25, progress.GetPercent());
+		progress.AddLoaded(400);
+		EXPECT_EQ(100, progress.GetPercent());
+	}
+
+	TEST_F(ParallelLoadTest, LoadPanes)
+	{
+		LoadProgress progress;
+		int lines[3] = { 10000, 0, 12345 };
+		for (int i = 0; i < 3; ++i)
+			progress.AddTotal(WriteFile(i, lines[i]));
+		int loaded[3] = { 0 };
+		ParallelInvokeEach(3, [&](int index) { loaded[index] = LoadFile(m_paths[index], progress); }, []() {}, 10);
+		for (int i = 0; i < 3; ++i)
+			EXPECT_EQ(lines[i] + 1, loaded[i]) << "pane " << i;
+		EXPECT_EQ(progress.GetTotal(), progress.GetLoaded());
+	}
+
+	// Load 2 and 3 panes of 500000 lines each, one after the other and at
+	// the same time.
+	TEST_F(ParallelLoadTest, DISABLED_Benchmark)
+	{
+		const int nLines = 500000;
+		for (int i = 0; i < 3; ++i)
+			WriteFile(i, nLines);
+		const char *properties[2][2] = {
+			{ "serial_2_panes_milliseconds", "parallel_2_panes_milliseconds" },
+			{ "serial_3_panes_milliseconds", "parallel_3_panes_milliseconds" } };
+		for (int nPanes = 2; nPanes <= 3; ++nPanes)
+		{
+			for (int concurrent = 0; concurrent < 2; ++concurrent)
+			{
+				LoadProgress progress;
+				int loaded[3] = { 0 };
+				int percent = 0;
+				auto load = [&](int index) { loaded[index] = LoadFile(m_paths[index], progress); };
+				Poco::Timestamp start;
+				if (concurrent)
+					ParallelInvokeEach(nPanes, load, [&]() { percent = progress.GetPercent(); }, 10);
+				else
+				{
+					for (int i = 0; i < nPanes; ++i)
+						load(i);
+				}
+				RecordProperty(properties[nPanes - 2][concurrent], static_cast<int>(start.elapsed() / 1000));
+				for (int i = 0; i < nPanes; ++i)
+					EXPECT_EQ(nLines + 1, loaded[i]);
+				EXPECT_LE(percent, 100);
+			}
+		}
+	}
+
+}  // namespace
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
+#include <cstdio>
 #include "codepage_detect.h"
 #include "charsets.h"
+#include "Environment.h"
+#include "paths.h"
 
 namespace
 {
@@ -91,5 +94,31 @@ namespace
 		EXPECT_EQ(ucr::NONE, enc.m_unicoding);
 	}
 
+	// ISO-2022-JP files have only ASCII bytes, but they are not ASCII text
+	TEST_F(CodepageDetectTest, PureAsciiIso2022Jp)
+	{
+		String path = paths::ConcatPath(env::GetProgPath(), _T("../TestData/_tmp_iso2022jp.xml"));
+		FILE *file = _tfopen(path.c_str(), _T("wb"));
+		ASSERT_TRUE(file != NULL);
+		fputs("<?xml version=\"1.0\" encoding=\"iso-2022-jp\"?>\r\n"
+			"<a>\x1b$B$3$s$K$A$O\x1b(B</a>\r\n", file);
+		fclose(file);
+
+		bool bPureAscii = false;
+		FileTextEncoding enc = GuessCodepageEncoding(path, 1, BufSize, &bPureAscii);
+		_tremove(path.c_str());
+		EXPECT_EQ(50220, enc.m_codepage);
+		EXPECT_EQ(ucr::NONE, enc.m_unicoding);
+		EXPECT_TRUE(bPureAscii);
+		// Folder compare must still convert it to UTF-8
+		EXPECT_FALSE(ucr::IsAsciiCompatibleCodepage(enc.m_codepage));
+
+		EXPECT_TRUE(ucr::IsAsciiCompatibleCodepage(28591));
+		EXPECT_TRUE(ucr::IsAsciiCompatibleCodepage(932));
+		EXPECT_TRUE(ucr::IsAsciiCompatibleCodepage(ucr::CP_UTF_8));
+		EXPECT_FALSE(ucr::IsAsciiCompatibleCodepage(65000));
+		EXPECT_FALSE(ucr::IsAsciiCompatibleCodepage(52936));
+	}
+
 
 }  // namespace
@@ -179,6 +179,17 @@ namespace
 		EXPECT_EQ(true, m_fileFilterHelper.includeDir(_T("svn")));
 		EXPECT_EQ(true, m_fileFilterHelper.includeDir(_T("a.b")));
 		EXPECT_EQ(true, m_fileFilterHelper.includeDir(_T("a.b.c")));
+
+		m_fileFilterHelper.SetMask(_T("*.c;*.cpp;"));
+		EXPECT_EQ(true, m_fileFilterHelper.includeFile(_T("a.c")));
+		EXPECT_EQ(true, m_fileFilterHelper.includeFile(_T("a.ext")));
+
+		m_fileFilterHelper.SetMask(_T("?.H makefile.*"));
+		EXPECT_EQ(true, m_fileFilterHelper.includeFile(_T("a.h")));
+		EXPECT_EQ(false, m_fileFilterHelper.includeFile(_T("ab.h")));
+		EXPECT_EQ(true, m_fileFilterHelper.includeFile(_T("Makefile")));
+		EXPECT_EQ(true, m_fileFilterHelper.includeFile(_T("makefile.in")));
+		EXPECT_EQ(false, m_fileFilterHelper.includeFile(_T("gnumakefile")));
 	}
 
 
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <Poco/RegularExpression.h>
+#include <Poco/Exception.h>
+#include "UnicodeString.h"
+#include "unicoder.h"
+#include "FileNameMatcher.h"
+
+using Poco::RegularExpression;
+
+namespace
+{
+	// The fixture for testing the file name matcher.
+	class FileNameMatcherTest : public testing::Test
+	{
+	protected:
+		FileNameMatcherTest()
+		{
+		}
+
+		virtual ~FileNameMatcherTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Match NAME against filter file RULES one by one, like filters
+		// were matched before they were compiled.
+		static bool MatchRules(const std::vector<std::string>& rules, const String& name)
+		{
+			std::string compString = ucr::toUTF8(name);
+			for (size_t i = 0; i < rules.size(); ++i)
+			{
+				RegularExpression::Match match;
+				try
+				{
+					RegularExpression re(rules[i], RegularExpression::RE_CASELESS | RegularExpression::RE_UTF8);
+					if (re.match(compString, 0, match) > 0)
+						return true;
+				}
+				catch (...)
+				{
+				}
+			}
+			return false;
+		}
+
+		// Match NAME against MASKS converted to one regular expression, like
+		// masks were matched before they were compiled.
+		static bool MatchMasks(const std::vector<String>& masks, const String& name)
+		{
+			String pattern;
+			for (size_t i = 0; i < masks.size(); ++i)
+			{
+				if (!pattern.empty())
+					pattern += '|';
+				pattern += _T("(^|\\\\)");
+				for (size_t j = 0; j < masks[i].length(); ++j)
+				{
+					TCHAR c = masks[i][j];
+					if (c == '.' || c == '(' || c == ')' || c == '[' || c == ']' || c == '$')
+						pattern += '\\';
+					if (c == '?')
+						pattern += '.';
+					else if (c == '*')
+						pattern += _T(".*");
+					else
+						pattern += c;
+				}
+				pattern += '$';
+			}
+			String text;
+			for (size_t i = 0; i < name.length(); ++i)
+				text += static_cast<TCHAR>(_totlower(name[i]));
+			for (size_t i = 0; i < pattern.length(); ++i)
+				pattern[i] = static_cast<TCHAR>(_totlower(pattern[i]));
+			if (text.empty() || text[0] != '\\')
+				text = _T("\\") + text;
+			if (text.find('.') == String::npos)
+				text += '.';
+			try
+			{
+				RegularExpression re(ucr::toUTF8(pattern), RegularExpression::RE_UTF8);
+				RegularExpression::Match match;
+				return re.match(ucr::toUTF8(text), 0, match) > 0;
+			}
+			catch (...)
+			{
+				return false;
+			}
+		}
+
+		static std::vector<String> Names()
+		{
+			static const TCHAR *names[] = {
+				_T(""), _T("a"), _T("a.c"), _T("A.C"), _T("a.cpp"), _T("a.cpp.h"), _T(".cpp"),
+				_T("cpp"), _T("a.o"), _T("A.O"), _T("a.obj"), _T("a.lib"), _T("foo.LIB"),
+				_T("\\.svn"), _T("\\.SVN"), _T("x\\.svn"), _T(".svn"), _T("\\_svn"), _T("cvs"),
+				_T("CVS"), _T("\\cvs"), _T("dir\\cvs"), _T("~foo"), _T("abc.tmp.c"), _T("12.log"),
+				_T("a.log"), _T("makefile"), _T("Makefile"), _T("dir\\makefile"), _T("Makefile.in"),
+				_T("x.tar.gz"), _T("x.TAR.GZ"), _T("fooXbar.txt"), _T("foobar"), _T("abc.txt"),
+				_T("aXc.txt"), _T("ac.txt"), _T("c++1.txt"), _T("aa.txt"), _T("sub.c"),
+				_T("\\sub\\x.c"), _T("sub\\x.c"), _T("(x)y.h"), _T("(x)y.c"), _T("$xy"), _T("readme"),
+				_T("README"), _T("x\\readme"), _T("x.readme"), _T("\\"), _T("."), _T(".."),
+				_T("\x00e9.c"), _T("\x00c9.C"), _T("\x00e9.o"), _T("\xd83d\xde00.txt"),
+				_T("\xd83d\xde00\xd83d\xde00.txt"), _T("a\\b\\c.d"),
+			};
+			return std::vector<String>(names, names + sizeof(names) / sizeof(names[0]));
+		}
+	};
+
+	TEST_F(FileNameMatcherTest, Empty)
+	{
+		FileNameMatcher rules;
+		EXPECT_FALSE(rules.Match(_T("a.c")));
+		EXPECT_FALSE(rules.Match(_T("")));
+		FileNameMatcher masks(FileNameMatcher::MASK);
+		EXPECT_FALSE(masks.Match(_T("a.c")));
+	}
+
+	TEST_F(FileNameMatcherTest, Rules)
+	{
+		FileNameMatcher matcher;
+		matcher.AddRegExp("\\.o$");
+		matcher.AddRegExp("\\\\\\.svn$");
+		matcher.AddRegExp("^cvs$");
+		EXPECT_TRUE(matcher.Match(_T("a.o")));
+		EXPECT_TRUE(matcher.Match(_T("A.O")));
+		EXPECT_FALSE(matcher.Match(_T("a.obj")));
+		EXPECT_TRUE(matcher.Match(_T("\\.svn")));
+		EXPECT_TRUE(matcher.Match(_T("dir\\.SVN")));
+		EXPECT_FALSE(matcher.Match(_T(".svn")));
+		EXPECT_TRUE(matcher.Match(_T("CVS")));
+		EXPECT_FALSE(matcher.Match(_T("\\cvs")));
+
+		matcher.Clear();
+		EXPECT_FALSE(matcher.Match(_T("a.o")));
+		EXPECT_THROW(matcher.AddRegExp("(a"), Poco::RegularExpressionException);
+	}
+
+	TEST_F(FileNameMatcherTest, RulesMatchLikeRegularExpressions)
+	{
+		static const char *rules[] = {
+			"\\.o$", "\\.LIB$", "\\\\\\.svn$", "\\\\_svn$", "^cvs$", "\\\\cvs$", "^\\.", "$", "^$",
+			"\\.(obj|pch)$", "^~", "tmp", "\\d+\\.log$", "\\.tar\\.gz$", "\xc3\xa9\\.o$", "\\\\$",
+			"a\\$", "readme$", "\\.c$",
+		};
+		std::vector<String> names = Names();
+		for (size_t i = 0; i < sizeof(rules) / sizeof(rules[0]); ++i)
+		{
+			std::vector<std::string> list(1, rules[i]);
+			FileNameMatcher matcher;
+			matcher.AddRegExp(rules[i]);
+			for (size_t j = 0; j < names.size(); ++j)
+				EXPECT_EQ(MatchRules(list, names[j]), matcher.Match(names[j])) << rules[i] << " " << ucr::toUTF8(names[j]);
+		}
+
+		// All rules except the ones matching everything
+		std::vector<std::string> list(rules, rules + 7);
+		list.insert(list.end(), rules + 9, rules + sizeof(rules) / sizeof(rules[0]));
+		FileNameMatcher matcher;
+		for (size_t i = 0; i < list.size(); ++i)
+			matcher.AddRegExp(list[i]);
+		for (size_t j = 0; j < names.size(); ++j)
+			EXPECT_EQ(MatchRules(list, names[j]), matcher.Match(names[j])) << ucr::toUTF8(names[j]);
+	}
+
+	TEST_F(FileNameMatcherTest, Masks)
+	{
+		FileNameMatcher matcher(FileNameMatcher::MASK);
+		matcher.AddMask(_T("*.c"));
+		matcher.AddMask(_T("*.CPP"));
+		matcher.AddMask(_T("readme.txt"));
+		matcher.AddMask(_T("a?c.*"));
+		EXPECT_TRUE(matcher.Match(_T("a.c")));
+		EXPECT_TRUE(matcher.Match(_T("A.Cpp")));
+		EXPECT_FALSE(matcher.Match(_T("a.cpp.h")));
+		EXPECT_TRUE(matcher.Match(_T("Readme.TXT")));
+		EXPECT_TRUE(matcher.Match(_T("dir\\readme.txt")));
+		EXPECT_FALSE(matcher.Match(_T("myreadme.txt")));
+		EXPECT_TRUE(matcher.Match(_T("abc.txt")));
+		EXPECT_TRUE(matcher.Match(_T("ABC")));
+		EXPECT_FALSE(matcher.Match(_T("abbc.txt")));
+
+		// An invalid mask makes nothing match
+		matcher.AddMask(_T("a{2,1}"));
+		EXPECT_FALSE(matcher.Match(_T("a.c")));
+		matcher.Clear();
+		matcher.AddMask(_T("*"));
+		EXPECT_TRUE(matcher.Match(_T("a.c")));
+		EXPECT_TRUE(matcher.Match(_T("")));
+	}
+
+	TEST_F(FileNameMatcherTest, MasksMatchLikeRegularExpressions)
+	{
+		static const TCHAR *masks[] = {
+			_T("*.c"), _T("*.cpp"), _T("*.h"), _T("*.*"), _T("*"), _T("*."), _T("a?c.txt"),
+			_T("makefile"), _T("*.tar.gz"), _T("foo*bar.*"), _T("c++*.txt"), _T("a{2}.txt"),
+			_T("sub\\*.c"), _T("?"), _T("?.txt"), _T("*.C"), _T("Readme"), _T("(x)*.[ch]"),
+			_T("$x*"), _T("*\x00e9*"), _T("\x00c9.c"), _T("**.c"), _T("*a*c*"), _T("\\*"), _T("^a*"), _T("+"), _T("a{2,1}"),
+		};
+		std::vector<String> names = Names();
+		for (size_t i = 0; i < sizeof(masks) / sizeof(masks[0]); ++i)
+		{
+			std::vector<String> list(1, masks[i]);
+			FileNameMatcher matcher(FileNameMatcher::MASK);
+			matcher.AddMask(masks[i]);
+			for (size_t j = 0; j < names.size(); ++j)
+				EXPECT_EQ(MatchMasks(list, names[j]), matcher.Match(names[j])) << ucr::toUTF8(masks[i]) << " " << ucr::toUTF8(names[j]);
+		}
+
+		static const TCHAR *lists[][4] = {
+			{ _T("*.c"), _T("*.cpp"), _T("*.h"), _T("*.cxx") },
+			{ _T("makefile"), _T("*.mak"), _T("readme"), _T("*.txt") },
+			{ _T("a?c.txt"), _T("*.gz"), _T("sub\\*.c"), _T("$x*") },
+		};
+		for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); ++i)
+		{
+			std::vector<String> list(lists[i], lists[i] + 4);
+			FileNameMatcher matcher(FileNameMatcher::MASK);
+			for (size_t k = 0; k < list.size(); ++k)
+				matcher.AddMask(list[k]);
+			for (size_t j = 0; j < names.size(); ++j)
+				EXPECT_EQ(MatchMasks(list, names[j]), matcher.Match(names[j])) << i << " " << ucr::toUTF8(names[j]);
+		}
+	}
+
+}  // namespace
@@ -0,0 +1,297 @@
+#include <gtest/gtest.h>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <Poco/RegularExpression.h>
+#include "FilterList.h"
+
+namespace
+{
+	// Line filters of the kind users have: timestamps, version strings,
+	// generated comments, keywords of version control systems...
+	const char *RealisticFilters[] =
+	{
+		"^\\s*//",
+		"^\\s*#",
+		"^\\s*$",
+		"\\$Id[:$]",
+		"\\$Revision[:$]",
+		"\\$Date[:$]",
+		"\\$Author[:$]",
+		"\\$Header[:$]",
+		"^\\d{4}-\\d{2}-\\d{2}[ T]\\d{2}:\\d{2}:\\d{2}",
+		"\\b\\d{1,2}/\\d{1,2}/\\d{4}\\b",
+		"[Gg]enerated (by|on|at)",
+		"^\\s*\\* @date",
+		"^\\s*\\* @version",
+		"Copyright \\(c\\) \\d{4}",
+		"AssemblyVersion\\(\"[0-9.]+\"\\)",
+		"AssemblyFileVersion\\(\"[0-9.]+\"\\)",
+		"^\\s*<ProjectGuid>",
+		"^\\s*<RootNamespace>",
+		"(?i)^\\s*rem\\b",
+		"(?i)build (number|date)",
+		"^\\[\\d{2}:\\d{2}:\\d{2}\\]",
+		"\\bDEBUG\\b.*\\btrace\\b",
+		"^\\s*<!--.*-->\\s*$",
+		"^\\s*;",
+		"^\\s*--",
+		"timestamp=\"[^\"]*\"",
+		"^\\s*\\d+\\s*$",
+		"^Last-Modified:",
+		"^Content-Length: \\d+",
+		"\\b[0-9a-f]{40}\\b",
+	};
+
+	// The fixture for testing the line filter list.
+	class FilterListTest : public testing::Test
+	{
+	protected:
+		FilterListTest()
+		{
+		}
+
+		virtual ~FilterListTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Match STRING against each of FILTERS like the list did before
+		// the expressions were combined.
+		static bool MatchSequentially(const std::vector<std::string>& filters, const std::string& string)
+		{
+			for (size_t i = 0; i < filters.size(); i++)
+			{
+				Poco::RegularExpression re(filters[i], Poco::RegularExpression::RE_UTF8);
+				Poco::RegularExpression::Match match;
+				if (re.match(string, 0, match) > 0)
+					return true;
+			}
+			return false;
+		}
+
+		// Return line LINE of a file with a mix of filtered and code lines.
+		static std::string MakeLine(int line)
+		{
+			char buf[128];
+			switch (line % 8)
+			{
+			case 0: sprintf(buf, "\tint value%d = compute(%d, buffer[%d]);", line, line, line % 17); break;
+			case 1: sprintf(buf, "    // comment of line %d", line); break;
+			case 2: sprintf(buf, "2016-05-%02d 12:%02d:%02d worker started", line % 28 + 1, line % 60, line % 59); break;
+			case 3: sprintf(buf, "\tif (value%d > limit && !done) return false;", line); break;
+			case 4: sprintf(buf, "  <Compile Include=\"File%d.cs\" />", line); break;
+			case 5: sprintf(buf, "$Id: file.c %d 2016-05-01 agent $", line); break;
+			case 6: sprintf(buf, "\tfor (size_t i = 0; i < count%d; ++i)", line); break;
+			default: sprintf(buf, "%s", ""); break;
+			}
+			return buf;
+		}
+	};
+
+	TEST_F(FilterListTest, EmptyList)
+	{
+		FilterList list;
+		EXPECT_FALSE(list.HasRegExps());
+		EXPECT_FALSE(list.Match("anything"));
+		EXPECT_FALSE(list.Match(""));
+	}
+
+	TEST_F(FilterListTest, MatchAnyExpression)
+	{
+		FilterList list;
+		list.AddRegExp("^abc");
+		list.AddRegExp("xyz$");
+		list.AddRegExp("[0-9]{3}");
+		EXPECT_TRUE(list.HasRegExps());
+		EXPECT_TRUE(list.Match("abcdef"));
+		EXPECT_TRUE(list.Match("uvwxyz"));
+		EXPECT_TRUE(list.Match("a123b"));
+		EXPECT_FALSE(list.Match("xabc"));
+		EXPECT_FALSE(list.Match("xyzu"));
+		EXPECT_FALSE(list.Match("a12b"));
+	}
+
+	TEST_F(FilterListTest, LastMatchExpression)
+	{
+		FilterList list;
+		EXPECT_EQ(NULL, list.GetLastMatchExpression());
+		list.AddRegExp("^abc");
+		list.AddRegExp("xyz$");
+		EXPECT_TRUE(list.Match("uvwxyz"));
+		EXPECT_STREQ("xyz$", list.GetLastMatchExpression());
+		EXPECT_TRUE(list.Match("abcdef"));
+		EXPECT_STREQ("^abc", list.GetLastMatchExpression());
+		EXPECT_FALSE(list.Match("def"));
+		EXPECT_STREQ("^abc", list.GetLastMatchExpression());
+	}
+
+	TEST_F(FilterListTest, RemoveAllFilters)
+	{
+		FilterList list;
+		list.AddRegExp("a");
+		EXPECT_TRUE(list.Match("a"));
+		list.RemoveAllFilters();
+		EXPECT_FALSE(list.HasRegExps());
+		EXPECT_FALSE(list.Match("a"));
+		EXPECT_EQ(NULL, list.GetLastMatchExpression());
+		list.AddRegExp("b");
+		EXPECT_FALSE(list.Match("a"));
+		EXPECT_TRUE(list.Match("b"));
+	}
+
+	TEST_F(FilterListTest, InvalidExpressionIgnored)
+	{
+		FilterList list;
+		list.AddRegExp("a(b");
+		list.AddRegExp("c)d");
+		list.AddRegExp("x");
+		EXPECT_FALSE(list.Match("a(b"));
+		EXPECT_FALSE(list.Match("c)d"));
+		EXPECT_TRUE(list.Match("x"));
+	}
+
+	TEST_F(FilterListTest, CanCombine)
+	{
+		EXPECT_TRUE(FilterList::CanCombine("abc"));
+		EXPECT_TRUE(FilterList::CanCombine("^\\s*(//|#)"));
+		EXPECT_TRUE(FilterList::CanCombine("(?i)rem"));
+		EXPECT_TRUE(FilterList::CanCombine("(?<=a)b(?=c)"));
+		EXPECT_TRUE(FilterList::CanCombine("(?>a+)b"));
+		EXPECT_FALSE(FilterList::CanCombine("(a)\\1"));
+		EXPECT_FALSE(FilterList::CanCombine("(a)\\g1"));
+		EXPECT_FALSE(FilterList::CanCombine("(?<name>a)\\k<name>"));
+		EXPECT_FALSE(FilterList::CanCombine("(?P<name>a)"));
+		EXPECT_FALSE(FilterList::CanCombine("(a|(?1))"));
+		EXPECT_FALSE(FilterList::CanCombine("\\Q)|(\\E"));
+		EXPECT_FALSE(FilterList::CanCombine("(?x)a # comment"));
+		EXPECT_FALSE(FilterList::CanCombine("(*UTF8)a"));
+	}
+
+	TEST_F(FilterListTest, IsAnchored)
+	{
+		EXPECT_TRUE(FilterList::IsAnchored("^abc"));
+		EXPECT_TRUE(FilterList::IsAnchored("\\Aabc"));
+		EXPECT_TRUE(FilterList::IsAnchored("(?i)^abc"));
+		EXPECT_TRUE(FilterList::IsAnchored("^(a|b)[|]\\|"));
+		EXPECT_FALSE(FilterList::IsAnchored("abc"));
+		EXPECT_FALSE(FilterList::IsAnchored("^a|b"));
+		EXPECT_FALSE(FilterList::IsAnchored("(^a)"));
+		EXPECT_FALSE(FilterList::IsAnchored("\\^a"));
+	}
+
+	TEST_F(FilterListTest, GetRequiredLiteral)
+	{
+		EXPECT_EQ("abc", FilterList::GetRequiredLiteral("abc"));
+		EXPECT_EQ("$Id", FilterList::GetRequiredLiteral("\\$Id[:$]"));
+		EXPECT_EQ("Copyright (c) ", FilterList::GetRequiredLiteral("Copyright \\(c\\) \\d{4}"));
+		EXPECT_EQ("enerated ", FilterList::GetRequiredLiteral("[Gg]enerated (by|on|at)"));
+		EXPECT_EQ("timestamp=\"", FilterList::GetRequiredLiteral("timestamp=\"[^\"]*\""));
+		EXPECT_EQ("ab", FilterList::GetRequiredLiteral("abc?d"));
+		EXPECT_EQ("ab", FilterList::GetRequiredLiteral("abc*d"));
+		EXPECT_EQ("ab", FilterList::GetRequiredLiteral("abc{0,2}d"));
+		EXPECT_EQ("abc", FilterList::GetRequiredLiteral("abc+d"));
+		EXPECT_EQ("abc", FilterList::GetRequiredLiteral("abc{2}d"));
+		EXPECT_EQ("x{y", FilterList::GetRequiredLiteral("x{y"));
+		EXPECT_EQ("longer", FilterList::GetRequiredLiteral("ab(cd)?longer"));
+		EXPECT_EQ("\xC3\xA4\xC3\xB6", FilterList::GetRequiredLiteral("\xC3\xA4\xC3\xB6\xC3\xBC?"));
+		EXPECT_EQ("", FilterList::GetRequiredLiteral("ab|cd"));
+		EXPECT_EQ("", FilterList::GetRequiredLiteral("(?i)abc"));
+		EXPECT_EQ("", FilterList::GetRequiredLiteral("(?x)a b c"));
+		EXPECT_EQ("", FilterList::GetRequiredLiteral("\\x41BC"));
+		EXPECT_EQ("", FilterList::GetRequiredLiteral("\\d+"));
+	}
+
+	TEST_F(FilterListTest, ExpressionsKeepMeaning)
+	{
+		// Anchors, options and groups of one expression don't affect others
+		FilterList list;
+		list.AddRegExp("^a|b$");
+		list.AddRegExp("(?i)c");
+		list.AddRegExp("(x)\\1");
+		list.AddRegExp("(?<n>y)\\k<n>");
+		EXPECT_TRUE(list.Match("a--"));
+		EXPECT_TRUE(list.Match("--b"));
+		EXPECT_FALSE(list.Match("-a-b-"));
+		EXPECT_TRUE(list.Match("C"));
+		EXPECT_TRUE(list.Match("-xx-"));
+		EXPECT_FALSE(list.Match("-xX-"));
+		EXPECT_TRUE(list.Match("yy"));
+		EXPECT_FALSE(list.Match("yY"));
+	}
+
+	TEST_F(FilterListTest, SameResultsAsSequentialMatch)
+	{
+		std::vector<std::string> filters(RealisticFilters,
+			RealisticFilters + sizeof(RealisticFilters) / sizeof(RealisticFilters[0]));
+		filters.push_back("(\\w+) \\1");
+		FilterList list;
+		for (size_t i = 0; i < filters.size(); i++)
+			list.AddRegExp(filters[i]);
+		for (int line = 0; line < 400; line++)
+		{
+			std::string string = MakeLine(line);
+			EXPECT_EQ(MatchSequentially(filters, string), list.Match(string)) << string;
+		}
+		EXPECT_TRUE(list.Match("the the"));
+		EXPECT_FALSE(list.Match("the cat"));
+	}
+
+	TEST_F(FilterListTest, DISABLED_Benchmark)
+	{
+		// Compare the combined list against matching the expressions
+		// one by one, as the list did before
+		const int count = 20000;
+		std::vector<std::string> lines;
+		for (int line = 0; line < count; line++)
+			lines.push_back(MakeLine(line));
+
+		const size_t nfilters = sizeof(RealisticFilters) / sizeof(RealisticFilters[0]);
+		std::vector<Poco::RegularExpression *> sequential;
+		FilterList list;
+		for (size_t i = 0; i < nfilters; i++)
+		{
+			sequential.push_back(new Poco::RegularExpression(RealisticFilters[i], Poco::RegularExpression::RE_UTF8));
+			list.AddRegExp(RealisticFilters[i]);
+		}
+
+		int matchedSequential = 0;
+		clock_t start = clock();
+		for (int line = 0; line < count; line++)
+		{
+			for (size_t i = 0; i < nfilters; i++)
+			{
+				Poco::RegularExpression::Match match;
+				if (sequential[i]->match(lines[line], 0, match) > 0)
+				{
+					matchedSequential++;
+					break;
+				}
+			}
+		}
+		clock_t sequentialTime = clock() - start;
+
+		int matchedCombined = 0;
+		start = clock();
+		for (int line = 0; line < count; line++)
+		{
+			if (list.Match(lines[line]))
+				matchedCombined++;
+		}
+		clock_t combinedTime = clock() - start;
+
+		for (size_t i = 0; i < nfilters; i++)
+			delete sequential[i];
+
+		EXPECT_EQ(matchedSequential, matchedCombined);
+		RecordProperty("sequential_milliseconds", static_cast<int>(sequentialTime * 1000 / CLOCKS_PER_SEC));
+		RecordProperty("combined_milliseconds", static_cast<int>(combinedTime * 1000 / CLOCKS_PER_SEC));
+	}
+}
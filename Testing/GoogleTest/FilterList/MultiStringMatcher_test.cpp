@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "MultiStringMatcher.h"
+
+namespace
+{
+	// The fixture for testing the multiple string matcher.
+	class MultiStringMatcherTest : public testing::Test
+	{
+	protected:
+		MultiStringMatcherTest()
+		{
+		}
+
+		virtual ~MultiStringMatcherTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Return ids of strings found in TEXT, in the order found.
+		static std::vector<int> Find(const MultiStringMatcher& matcher, const std::string& text)
+		{
+			std::vector<int> ids;
+			matcher.FindAll(text.data(), text.length(), [&](int id) { ids.push_back(id); });
+			return ids;
+		}
+
+		// Return ids of STRINGS occurring in TEXT, found with std::string::find.
+		static std::vector<int> FindEach(const std::vector<std::string>& strings, const std::string& text)
+		{
+			std::vector<int> ids;
+			for (size_t i = 0; i < strings.size(); i++)
+			{
+				for (size_t pos = text.find(strings[i]); pos != std::string::npos; pos = text.find(strings[i], pos + 1))
+					ids.push_back(static_cast<int>(i));
+			}
+			return ids;
+		}
+	};
+
+	TEST_F(MultiStringMatcherTest, Empty)
+	{
+		MultiStringMatcher matcher;
+		EXPECT_TRUE(matcher.IsEmpty());
+		matcher.Build();
+		EXPECT_TRUE(Find(matcher, "abc").empty());
+		matcher.Add("", 1);
+		matcher.Build();
+		EXPECT_TRUE(matcher.IsEmpty());
+		EXPECT_TRUE(Find(matcher, "abc").empty());
+	}
+
+	TEST_F(MultiStringMatcherTest, Overlapping)
+	{
+		// The classic example: he, she, his, hers in "ushers"
+		MultiStringMatcher matcher;
+		matcher.Add("he", 0);
+		matcher.Add("she", 1);
+		matcher.Add("his", 2);
+		matcher.Add("hers", 3);
+		matcher.Build();
+		EXPECT_FALSE(matcher.IsEmpty());
+		std::vector<int> ids = Find(matcher, "ushers");
+		ASSERT_EQ(3u, ids.size());
+		// "she" and "he" end at the same position
+		EXPECT_TRUE((ids[0] == 1 && ids[1] == 0) || (ids[0] == 0 && ids[1] == 1));
+		EXPECT_EQ(3, ids[2]);
+		EXPECT_TRUE(Find(matcher, "hi s h e").empty());
+	}
+
+	TEST_F(MultiStringMatcherTest, SameStringTwice)
+	{
+		MultiStringMatcher matcher;
+		matcher.Add("ab", 5);
+		matcher.Add("ab", 7);
+		matcher.Build();
+		std::vector<int> ids = Find(matcher, "xabyab");
+		EXPECT_EQ(4u, ids.size());
+	}
+
+	TEST_F(MultiStringMatcherTest, Clear)
+	{
+		MultiStringMatcher matcher;
+		matcher.Add("ab", 0);
+		matcher.Build();
+		matcher.Clear();
+		EXPECT_TRUE(matcher.IsEmpty());
+		EXPECT_TRUE(Find(matcher, "ab").empty());
+		matcher.Add("cd", 1);
+		matcher.Build();
+		EXPECT_TRUE(Find(matcher, "ab").empty());
+		EXPECT_EQ(1u, Find(matcher, "cd").size());
+	}
+
+	TEST_F(MultiStringMatcherTest, AllBytes)
+	{
+		// Strings with all byte values, including zero
+		std::string all;
+		for (int c = 0; c < 256; c++)
+			all += static_cast<char>(c);
+		MultiStringMatcher matcher;
+		matcher.Add(all, 0);
+		matcher.Add(std::string(1, '\0'), 1);
+		matcher.Add("\xFF\xFE", 2);
+		matcher.Build();
+		std::vector<int> ids = Find(matcher, all + "\xFE");
+		std::sort(ids.begin(), ids.end());
+		ASSERT_EQ(3u, ids.size());
+		EXPECT_EQ(0, ids[0]);
+		EXPECT_EQ(1, ids[1]);
+		EXPECT_EQ(2, ids[2]);
+	}
+
+	TEST_F(MultiStringMatcherTest, SameAsFind)
+	{
+		// Strings over a small alphabet overlap often
+		srand(1);
+		for (int round = 0; round < 200; round++)
+		{
+			std::vector<std::string> strings;
+			MultiStringMatcher matcher;
+			int count = 1 + rand() % 10;
+			for (int i = 0; i < count; i++)
+			{
+				std::string str;
+				int len = 1 + rand() % 4;
+				for (int j = 0; j < len; j++)
+					str += static_cast<char>('a' + rand() % 3);
+				strings.push_back(str);
+				matcher.Add(str, i);
+			}
+			matcher.Build();
+			std::string text;
+			int len = rand() % 40;
+			for (int j = 0; j < len; j++)
+				text += static_cast<char>('a' + rand() % 4);
+			std::vector<int> expected = FindEach(strings, text);
+			std::vector<int> actual = Find(matcher, text);
+			std::sort(expected.begin(), expected.end());
+			std::sort(actual.begin(), actual.end());
+			EXPECT_EQ(expected, actual) << text;
+		}
+	}
+}
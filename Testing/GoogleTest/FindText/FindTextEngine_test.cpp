@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include "FindTextEngine.h"
+
+using std::vector;
+
+namespace
+{
+	// The fixture for testing finding text in editor lines.
+	class FindTextEngineTest : public testing::Test
+	{
+	protected:
+		FindTextEngineTest()
+		{
+		}
+
+		virtual ~FindTextEngineTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Find TEXT in LINE from START, and return the position found.
+		static int Find(LPCTSTR text, DWORD flags, LPCTSTR line, int start, int *len = NULL, RxMatchRes *rxmatch = NULL)
+		{
+			FindTextEngine engine;
+			EXPECT_TRUE(engine.Compile(text, flags));
+			int nLen = -1;
+			int nPos = engine.Find(line, static_cast<int>(_tcslen(line)), start, nLen, rxmatch);
+			if (len)
+				*len = nLen;
+			return nPos;
+		}
+
+		// Find all matches of TEXT in LINE, and return their positions.
+		static vector<int> FindAll(LPCTSTR text, DWORD flags, LPCTSTR line)
+		{
+			FindTextEngine engine;
+			EXPECT_TRUE(engine.Compile(text, flags));
+			vector<FindTextEngine::Match> matches;
+			engine.FindAll(line, static_cast<int>(_tcslen(line)), matches);
+			vector<int> positions;
+			for (size_t i = 0; i < matches.size(); ++i)
+				positions.push_back(matches[i].nPos);
+			return positions;
+		}
+	};
+
+	TEST_F(FindTextEngineTest, Literal)
+	{
+		int len;
+		EXPECT_EQ(2, Find(_T("cd"), FIND_MATCH_CASE, _T("abcdcd"), 0, &len));
+		EXPECT_EQ(2, len);
+		EXPECT_EQ(4, Find(_T("cd"), FIND_MATCH_CASE, _T("abcdcd"), 3));
+		EXPECT_EQ(-1, Find(_T("CD"), FIND_MATCH_CASE, _T("abcdcd"), 0));
+		EXPECT_EQ(2, Find(_T("CD"), 0, _T("abcdcd"), 0));
+		EXPECT_EQ(-1, Find(_T("cd"), FIND_WHOLE_WORD, _T("abcd cde"), 0));
+		EXPECT_EQ(3, Find(_T("cd"), FIND_WHOLE_WORD, _T("ab cd"), 0));
+		// A whole word may start where the search starts
+		EXPECT_EQ(2, Find(_T("cd"), FIND_WHOLE_WORD, _T("abcd"), 2));
+		EXPECT_EQ((vector<int>{ 0, 3, 6 }), FindAll(_T("ab"), 0, _T("abcABcaB")));
+	}
+
+	TEST_F(FindTextEngineTest, RegExp)
+	{
+		int len;
+		RxMatchRes rxmatch;
+		EXPECT_EQ(1, Find(_T("b+(c)"), FIND_REGEXP, _T("abbcbc"), 0, &len, &rxmatch));
+		EXPECT_EQ(3, len);
+		EXPECT_EQ(3, rxmatch.Open[1]);
+		EXPECT_EQ(4, rxmatch.Close[1]);
+		// Positions and groups are relative to the start of the line
+		EXPECT_EQ(4, Find(_T("b+(c)"), FIND_REGEXP, _T("abbcbc"), 3, &len, &rxmatch));
+		EXPECT_EQ(2, len);
+		EXPECT_EQ(5, rxmatch.Open[1]);
+		EXPECT_EQ(-1, Find(_T("B"), FIND_REGEXP | FIND_MATCH_CASE, _T("abc"), 0));
+		EXPECT_EQ(1, Find(_T("B"), FIND_REGEXP, _T("abc"), 0));
+	}
+
+	TEST_F(FindTextEngineTest, ZeroLengthRegExp)
+	{
+		int len;
+		// ^ matches only at the start of the line, not where the search
+		// starts after a replacement
+		EXPECT_EQ(0, Find(_T("^"), FIND_REGEXP, _T("abc"), 0, &len));
+		EXPECT_EQ(0, len);
+		EXPECT_EQ(-1, Find(_T("^"), FIND_REGEXP, _T("Xabc"), 1));
+		EXPECT_EQ(-1, Find(_T("^a"), FIND_REGEXP, _T("Xabc"), 1));
+		EXPECT_EQ(3, Find(_T("$"), FIND_REGEXP, _T("abc"), 0, &len));
+		EXPECT_EQ(0, len);
+		EXPECT_EQ(0, Find(_T("^$"), FIND_REGEXP, _T(""), 0, &len));
+		EXPECT_EQ(0, len);
+		EXPECT_EQ(-1, Find(_T("^$"), FIND_REGEXP, _T("abc"), 0));
+		// Lookbehind sees the text before the start
+		EXPECT_EQ(-1, Find(_T("(?<!a)b"), FIND_REGEXP, _T("ab"), 1));
+
+		// Each zero-length match is found once
+		EXPECT_EQ((vector<int>{ 0 }), FindAll(_T("^"), FIND_REGEXP, _T("abc")));
+		EXPECT_EQ((vector<int>{ 3 }), FindAll(_T("$"), FIND_REGEXP, _T("abc")));
+		EXPECT_EQ((vector<int>{ 0 }), FindAll(_T("^$"), FIND_REGEXP, _T("")));
+		EXPECT_EQ((vector<int>{ 0, 1, 3 }), FindAll(_T("(?=a)"), FIND_REGEXP, _T("aaba")));
+		EXPECT_EQ((vector<int>{ 0, 2, 3 }), FindAll(_T("a*"), FIND_REGEXP, _T("aab")));
+	}
+
+	TEST_F(FindTextEngineTest, InvalidRegExp)
+	{
+		FindTextEngine engine;
+		EXPECT_FALSE(engine.Compile(_T("(a"), FIND_REGEXP));
+		// Compiling again doesn't make it valid
+		EXPECT_FALSE(engine.Compile(_T("(a"), FIND_REGEXP));
+		EXPECT_TRUE(engine.Compile(_T("(a"), 0));
+	}
+
+}  // namespace
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <windows.h>
 #include <tchar.h>
+#include <cstdint>
 #include <vector>
 #include "stringdiffs.h"
 
@@ -42,7 +43,38 @@ namespace
 			// before the destructor).
 		}
 
-		// Objects declared here can be used by all tests in the test case for Foo.
+		// Return COUNT words of a few letters, chosen by SEED.
+		static String MakeWords(int count, unsigned seed)
+		{
+			static const TCHAR *words[] = { _T("a "), _T("bc "), _T("d, "), _T("ef "), _T("gh. ") };
+			String str;
+			for (int i = 0; i < count; i++)
+			{
+				seed = seed * 1103515245 + 12345;
+				str += words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+			}
+			return str;
+		}
+
+		// Check that STR1 and STR2 give the same diffs with the trace limited
+		// to the given sizes as with an unlimited trace.
+		static void ExpectSameDiffs(const String& str1, const String& str2, size_t minCollect, size_t maxNodes)
+		{
+			std::vector<strdiff::wdiff> unlimited, limited;
+			strdiff::SetTraceLimits(SIZE_MAX, SIZE_MAX);
+			strdiff::ComputeWordDiffs(str1, str2, true, 0, 1, false, &unlimited);
+			strdiff::SetTraceLimits(minCollect, maxNodes);
+			strdiff::ComputeWordDiffs(str1, str2, true, 0, 1, false, &limited);
+			strdiff::SetTraceLimits(0, 0);
+			ASSERT_EQ(unlimited.size(), limited.size());
+			for (size_t i = 0; i < unlimited.size(); i++)
+			{
+				EXPECT_EQ(unlimited[i].begin[0], limited[i].begin[0]);
+				EXPECT_EQ(unlimited[i].end[0], limited[i].end[0]);
+				EXPECT_EQ(unlimited[i].begin[1], limited[i].begin[1]);
+				EXPECT_EQ(unlimited[i].end[1], limited[i].end[1]);
+			}
+		}
 	};
 
 	// strdiff::ComputeWordDiffs() parameters are:
@@ -711,4 +743,68 @@ namespace
 		}
 	}
 
+	// Long lines having different words between the same spaces
+	TEST_F(StringDiffsTest, ManyWordsDiffer)
+	{
+		std::vector<strdiff::wdiff> diffs;
+		String str1, str2;
+		for (int i = 0; i < 1000; i++)
+		{
+			str1 += _T("ab ");
+			str2 += _T("cd ");
+		}
+		strdiff::ComputeWordDiffs(str1, str2, true, 0, 0, false, &diffs);
+		EXPECT_EQ(1000, diffs.size());
+		strdiff::wdiff *pDiff;
+		if (diffs.size() == 1000)
+		{
+			pDiff = &diffs[999];
+			EXPECT_EQ(2997, pDiff->begin[0]);
+			EXPECT_EQ(2998, pDiff->end[0]);
+			EXPECT_EQ(2997, pDiff->begin[1]);
+			EXPECT_EQ(2998, pDiff->end[1]);
+		}
+	}
+
+	// Trace compacted before every round of the compare
+	TEST_F(StringDiffsTest, TraceCompaction)
+	{
+		String str1, str2;
+		for (int i = 0; i < 300; i++)
+		{
+			str1 += _T("ab ");
+			str2 += _T("cd ");
+		}
+		ExpectSameDiffs(str1, str2, 16, SIZE_MAX);
+		ExpectSameDiffs(MakeWords(500, 1), MakeWords(500, 2), 16, SIZE_MAX);
+		ExpectSameDiffs(MakeWords(400, 3), MakeWords(600, 3), 16, SIZE_MAX);
+		ExpectSameDiffs(MakeWords(500, 4), MakeWords(20, 5) + MakeWords(500, 4), 16, SIZE_MAX);
+	}
+
+	// Trace growing too big: the lines are one difference
+	TEST_F(StringDiffsTest, TraceGuard)
+	{
+		String str1, str2;
+		for (int i = 0; i < 300; i++)
+		{
+			str1 += _T("ab ");
+			str2 += _T("cd ");
+		}
+		std::vector<strdiff::wdiff> diffs;
+		strdiff::SetTraceLimits(16, 64);
+		strdiff::ComputeWordDiffs(str1, str2, true, 0, 0, false, &diffs);
+		ASSERT_EQ(1, diffs.size());
+		EXPECT_EQ(0, diffs[0].begin[0]);
+		EXPECT_EQ(899, diffs[0].end[0]);
+		EXPECT_EQ(0, diffs[0].begin[1]);
+		EXPECT_EQ(899, diffs[0].end[1]);
+
+		// Lines differing in a few words stay below the limit
+		String str3 = MakeWords(500, 6);
+		String str4 = str3;
+		str4.replace(100, 1, _T("x"));
+		str4.insert(1000, _T("yz "));
+		ExpectSameDiffs(str3, str4, 16, 64);
+	}
+
 }  // namespace
@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include "Environment.h"
+#include "paths.h"
+#include "CompareOptions.h"
+#include "DiffList.h"
+#include "DiffWrapper.h"
+
+namespace
+{
+	// The fixture for testing comparing texts from memory against
+	// comparing the same texts written to files.
+	class DiffWrapperTest : public testing::Test
+	{
+	protected:
+		DiffWrapperTest()
+		{
+			m_paths[0] = paths::ConcatPath(env::GetProgPath(), _T("../TestData/_tmp_diffwrapper0.txt"));
+			m_paths[1] = paths::ConcatPath(env::GetProgPath(), _T("../TestData/_tmp_diffwrapper1.txt"));
+			m_patchPaths[0] = paths::ConcatPath(env::GetProgPath(), _T("../TestData/_tmp_diffwrapper_patchfile.txt"));
+			m_patchPaths[1] = paths::ConcatPath(env::GetProgPath(), _T("../TestData/_tmp_diffwrapper_patchstream.txt"));
+		}
+
+		virtual ~DiffWrapperTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+			_tremove(m_paths[0].c_str());
+			_tremove(m_paths[1].c_str());
+			_tremove(m_patchPaths[0].c_str());
+			_tremove(m_patchPaths[1].c_str());
+		}
+
+		// Write TEXT to PATH as is.
+		static void WriteFile(const String& path, const std::string& text)
+		{
+			FILE *file = _tfopen(path.c_str(), _T("wb"));
+			ASSERT_TRUE(file != NULL);
+			fwrite(text.data(), 1, text.size(), file);
+			fclose(file);
+		}
+
+		static std::string ReadFile(const String& path)
+		{
+			std::string text;
+			FILE *file = _tfopen(path.c_str(), _T("rb"));
+			if (file)
+			{
+				char buf[4096];
+				size_t size;
+				while ((size = fread(buf, 1, sizeof(buf), file)) > 0)
+					text.append(buf, size);
+				fclose(file);
+			}
+			return text;
+		}
+
+		// Write the patch of the temp files, and of them swapped, to a patch
+		// file when bStream is false, or to a stream like the patch tool does
+		// otherwise. Return what was written.
+		std::string WritePatch(const PATCHOPTIONS& patchOptions, bool bStream)
+		{
+			const String& patchPath = m_patchPaths[bStream ? 1 : 0];
+			DIFFOPTIONS options = {0};
+			CDiffWrapper diffWrapper;
+			diffWrapper.SetPatchOptions(&patchOptions);
+			diffWrapper.SetOptions(&options);
+			FILE *stream = NULL;
+			if (bStream)
+			{
+				stream = _tfopen(patchPath.c_str(), _T("w"));
+				EXPECT_TRUE(stream != NULL);
+				diffWrapper.SetCreatePatchStream(stream);
+			}
+			else
+			{
+				diffWrapper.SetCreatePatchFile(patchPath);
+			}
+			diffWrapper.WritePatchFileHeader(patchOptions.outputStyle, false);
+			diffWrapper.SetAppendFiles(true);
+			for (int i = 0; i < 2; ++i)
+			{
+				PathContext files(m_paths[i], m_paths[1 - i]);
+				diffWrapper.SetPaths(files, false);
+				diffWrapper.SetAlternativePaths(PathContext(i ? _T("right.txt") : _T("left.txt"), i ? _T("left.txt") : _T("right.txt")));
+				diffWrapper.SetCompareFiles(files);
+				EXPECT_TRUE(diffWrapper.RunFileDiff());
+			}
+			diffWrapper.WritePatchFileTerminator(patchOptions.outputStyle);
+			if (stream)
+				fclose(stream);
+			return ReadFile(patchPath);
+		}
+
+		// Compare TEXTS with OPTIONS, from memory when bInMemory is true or
+		// from the temp files otherwise.
+		void Diff(const std::string texts[2], const DIFFOPTIONS& options, bool bInMemory, DiffList& diffList, DIFFSTATUS& status)
+		{
+			CDiffWrapper diffWrapper;
+			diffWrapper.SetOptions(&options);
+			diffWrapper.SetPaths(PathContext(m_paths[0], m_paths[1]), true);
+			diffWrapper.SetCompareFiles(PathContext(m_paths[0], m_paths[1]));
+			if (bInMemory)
+			{
+				ASSERT_TRUE(diffWrapper.CanDiffInMemory());
+				diffWrapper.SetInMemoryTexts(texts);
+			}
+			else
+			{
+				WriteFile(m_paths[0], texts[0]);
+				WriteFile(m_paths[1], texts[1]);
+			}
+			diffList.Clear();
+			diffWrapper.SetCreateDiffList(&diffList);
+			ASSERT_TRUE(diffWrapper.RunFileDiff());
+			diffWrapper.GetDiffStatus(&status);
+		}
+
+		// Check that TEXTS give the same diffs from memory and from files
+		// with each whitespace and EOL option.
+		void ExpectSameDiffs(const std::string texts[2])
+		{
+			for (int nIgnoreWhitespace = WHITESPACE_COMPARE_ALL; nIgnoreWhitespace <= WHITESPACE_IGNORE_ALL; ++nIgnoreWhitespace)
+			{
+				for (int bIgnoreEol = 0; bIgnoreEol < 2; ++bIgnoreEol)
+				{
+					DIFFOPTIONS options = {0};
+					options.nIgnoreWhitespace = nIgnoreWhitespace;
+					options.bIgnoreEol = !!bIgnoreEol;
+					options.bIgnoreBlankLines = nIgnoreWhitespace == WHITESPACE_IGNORE_ALL;
+
+					DiffList fileList, memoryList;
+					DIFFSTATUS fileStatus, memoryStatus;
+					Diff(texts, options, false, fileList, fileStatus);
+					Diff(texts, options, true, memoryList, memoryStatus);
+
+					SCOPED_TRACE(testing::Message() << "whitespace " << nIgnoreWhitespace << ", ignore EOL " << bIgnoreEol);
+					ASSERT_EQ(fileList.GetSize(), memoryList.GetSize());
+					for (int i = 0; i < fileList.GetSize(); ++i)
+					{
+						DIFFRANGE fileDiff, memoryDiff;
+						fileList.GetDiff(i, fileDiff);
+						memoryList.GetDiff(i, memoryDiff);
+						EXPECT_EQ(fileDiff.begin[0], memoryDiff.begin[0]);
+						EXPECT_EQ(fileDiff.end[0], memoryDiff.end[0]);
+						EXPECT_EQ(fileDiff.begin[1], memoryDiff.begin[1]);
+						EXPECT_EQ(fileDiff.end[1], memoryDiff.end[1]);
+						EXPECT_EQ(fileDiff.blank[0], memoryDiff.blank[0]);
+						EXPECT_EQ(fileDiff.blank[1], memoryDiff.blank[1]);
+						EXPECT_EQ(fileDiff.op, memoryDiff.op);
+					}
+					EXPECT_EQ(fileStatus.Identical, memoryStatus.Identical);
+					EXPECT_EQ(fileStatus.bBinaries, memoryStatus.bBinaries);
+					EXPECT_EQ(fileStatus.bMissingNL[0], memoryStatus.bMissingNL[0]);
+					EXPECT_EQ(fileStatus.bMissingNL[1], memoryStatus.bMissingNL[1]);
+				}
+			}
+		}
+
+		String m_paths[2];
+		String m_patchPaths[2];
+	};
+
+	TEST_F(DiffWrapperTest, Identical)
+	{
+		std::string texts[2] = { "a\r\nb\r\nc\r\n", "a\r\nb\r\nc\r\n" };
+		ExpectSameDiffs(texts);
+	}
+
+	TEST_F(DiffWrapperTest, ChangedLines)
+	{
+		std::string texts[2] = {
+			"one\ntwo\nthree\nfour\nfive\nsix\n",
+			"one\n2\nthree\nfour\nfive and a half\nsix\nseven\n" };
+		ExpectSameDiffs(texts);
+	}
+
+	TEST_F(DiffWrapperTest, Whitespace)
+	{
+		std::string texts[2] = {
+			"int a = 1;\n\tint b;\n\nreturn a  +  b;\n",
+			"int a=1;\n    int b;\nreturn a + b;\n\n\n" };
+		ExpectSameDiffs(texts);
+	}
+
+	TEST_F(DiffWrapperTest, MixedEol)
+	{
+		std::string texts[2] = {
+			"a\r\nb\r\nc\nd\re\r\n",
+			"a\nb\r\nc\r\nd\ne\n" };
+		ExpectSameDiffs(texts);
+	}
+
+	TEST_F(DiffWrapperTest, MissingEolAtEnd)
+	{
+		std::string texts[2] = { "a\nb\nc", "a\nb\nc\n" };
+		ExpectSameDiffs(texts);
+		std::string texts2[2] = { "a\r\nb", "a\r\nx" };
+		ExpectSameDiffs(texts2);
+	}
+
+	TEST_F(DiffWrapperTest, EmptyText)
+	{
+		std::string texts[2] = { "", "a\nb\n" };
+		ExpectSameDiffs(texts);
+		std::string texts2[2] = { "a\nb\n", "" };
+		ExpectSameDiffs(texts2);
+	}
+
+	TEST_F(DiffWrapperTest, PatchToStream)
+	{
+		WriteFile(m_paths[0], "one\ntwo\nthree\nfour\nfive\nsix\n");
+		WriteFile(m_paths[1], "one\n2\nthree\nfour\nfive & a half\nsix\nseven\n");
+		const enum output_style styles[] = { OUTPUT_UNIFIED, OUTPUT_CONTEXT, OUTPUT_HTML };
+		for (size_t i = 0; i < sizeof(styles) / sizeof(styles[0]); ++i)
+		{
+			for (int bAddCmdLine = 0; bAddCmdLine < 2; ++bAddCmdLine)
+			{
+				SCOPED_TRACE(testing::Message() << "style " << styles[i] << ", command line " << bAddCmdLine);
+				PATCHOPTIONS patchOptions = { styles[i], 3, !!bAddCmdLine };
+				std::string file = WritePatch(patchOptions, false);
+				std::string stream = WritePatch(patchOptions, true);
+				EXPECT_FALSE(file.empty());
+				EXPECT_EQ(bAddCmdLine && styles[i] != OUTPUT_HTML, file.compare(0, 4, "diff") == 0);
+				EXPECT_EQ(file, stream);
+			}
+		}
+	}
+
+}  // namespace
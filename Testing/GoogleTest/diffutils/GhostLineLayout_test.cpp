@@ -0,0 +1,355 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include "DiffList.h"
+#include "MergeLineFlags.h"
+#include "GhostLineLayout.h"
+
+namespace
+{
+	// Flags of the editor, declared with the MFC text buffers
+	const unsigned long GHOST = 0x00400000;
+	const unsigned long INVISIBLE = 0x80000000;
+	const unsigned long BOOKMARK = 0x00000001;
+
+	// A line of a text buffer: its flags, and which line it was in its
+	// pane before ghost lines were added (-1 for ghost lines).
+	struct TestLine
+	{
+		unsigned long m_dwFlags;
+		int id;
+	};
+
+	// The fixture for testing the layout of lines with ghost lines.
+	class GhostLineLayoutTest : public testing::Test
+	{
+	protected:
+		GhostLineLayoutTest()
+		{
+		}
+
+		virtual ~GhostLineLayoutTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Create NFILES panes with random diffs between them, NDIFFS diffs
+		// of up to MAXLINES lines each, matched lines having random flags.
+		static void Generate(int nFiles, int nDiffs, int maxLines, std::vector<TestLine> lines[3], DiffList& diffList)
+		{
+			const OP_TYPE ops[] = { OP_NONE, OP_1STONLY, OP_2NDONLY, OP_3RDONLY, OP_DIFF, OP_TRIVIAL };
+			const unsigned long flags[] = { 0, BOOKMARK, INVISIBLE, LF_MOVED, BOOKMARK | INVISIBLE };
+			int file;
+			diffList.Clear();
+			for (file = 0; file < nFiles; file++)
+				lines[file].clear();
+			for (int nDiff = 0; nDiff <= nDiffs; nDiff++)
+			{
+				int matched = rand() % (maxLines + 1);
+				for (file = 0; file < nFiles; file++)
+				{
+					// matched lines after the last diff may differ
+					int count = (nDiff == nDiffs) ? rand() % 3 : matched;
+					for (int i = 0; i < count; i++)
+						AddLine(lines[file], flags[rand() % 5]);
+				}
+				if (nDiff == nDiffs)
+					break;
+				DIFFRANGE dr;
+				dr.op = ops[rand() % 6];
+				bool bEmpty = true;
+				for (file = 0; file < nFiles; file++)
+				{
+					dr.begin[file] = static_cast<int>(lines[file].size());
+					int count = rand() % (maxLines + 1);
+					if (file == nFiles - 1 && bEmpty)
+						count = 1 + count % maxLines;
+					if (count > 0)
+						bEmpty = false;
+					for (int i = 0; i < count; i++)
+						AddLine(lines[file], flags[rand() % 5]);
+					dr.end[file] = dr.begin[file] + count - 1;
+				}
+				// dbegin, dend and blank of other ops are left as they are
+				dr.dbegin = dr.dend = -2;
+				diffList.AddDiff(dr);
+			}
+		}
+
+		static void AddLine(std::vector<TestLine>& lines, unsigned long flags)
+		{
+			TestLine line = { flags, static_cast<int>(lines.size()) };
+			lines.push_back(line);
+		}
+
+		// CMergeDoc::PrimeTextBuffers() as it used to be: walk the diff
+		// list backward, move lines to their place and add ghost lines.
+		static int PrimeOld(int nFiles, std::vector<TestLine> aLines[3], DiffList& diffList)
+		{
+			int nTrivialDiffs = 0;
+			int nDiffCount = diffList.GetSize();
+			int file;
+			int extras[3] = {0};
+			diffList.GetExtraLinesCounts(nFiles, extras);
+			int lcount[3] = {0};
+			int lcountnew[3] = {0};
+			for (file = 0; file < nFiles; file++)
+			{
+				lcount[file] = static_cast<int>(aLines[file].size());
+				lcountnew[file] = lcount[file] + extras[file];
+				aLines[file].resize(lcountnew[file]);
+			}
+			for (int nDiff = nDiffCount - 1; nDiff >= 0; nDiff--)
+			{
+				DIFFRANGE curDiff;
+				diffList.GetDiff(nDiff, curDiff);
+				int nline[3] = {0};
+				int nmaxline = 0;
+				for (file = 0; file < nFiles; file++)
+				{
+					nline[file] = lcount[file] - curDiff.end[file] - 1;
+					MoveLine(aLines[file], curDiff.end[file] + 1, lcount[file] - 1, lcountnew[file] - nline[file]);
+					lcountnew[file] -= nline[file];
+					lcount[file] -= nline[file];
+					nline[file] = curDiff.end[file] - curDiff.begin[file] + 1;
+					nmaxline = (std::max)(nmaxline, nline[file]);
+				}
+				for (file = 0; file < nFiles; file++)
+				{
+					MoveLine(aLines[file], curDiff.begin[file], curDiff.end[file], lcountnew[file] - nmaxline);
+					int nextra = nmaxline - nline[file];
+					if (nextra > 0)
+					{
+						unsigned long dflag = GHOST;
+						if ((file == 0 && curDiff.op == OP_3RDONLY) || (file == 2 && curDiff.op == OP_1STONLY))
+							dflag |= LF_SNP;
+						for (int i = 1; i <= nextra; i++)
+						{
+							TestLine ghost = { dflag, -1 };
+							aLines[file][lcountnew[file] - i] = ghost;
+						}
+					}
+					lcountnew[file] -= nmaxline;
+					lcount[file] -= nline[file];
+				}
+				curDiff.dbegin = lcountnew[0];
+				switch (curDiff.op)
+				{
+				case OP_TRIVIAL:
+					++nTrivialDiffs;
+				case OP_DIFF:
+				case OP_1STONLY:
+				case OP_2NDONLY:
+				case OP_3RDONLY:
+					curDiff.dend = lcountnew[0] + nmaxline - 1;
+					for (file = 0; file < nFiles; file++)
+					{
+						curDiff.blank[file] = -1;
+						int nextra = nmaxline - nline[file];
+						if (nmaxline > nline[file])
+							curDiff.blank[file] = curDiff.dend + 1 - nextra;
+					}
+					for (file = 0; file < nFiles; file++)
+					{
+						for (int i = curDiff.dbegin; i <= curDiff.dend; i++)
+						{
+							if (curDiff.blank[file] == -1 || i < curDiff.blank[file])
+							{
+								unsigned long dflag = (curDiff.op == OP_TRIVIAL) ? LF_TRIVIAL : LF_DIFF;
+								if ((file == 0 && curDiff.op == OP_3RDONLY) || (file == 2 && curDiff.op == OP_1STONLY))
+									dflag |= LF_SNP;
+								aLines[file][i].m_dwFlags |= dflag;
+								aLines[file][i].m_dwFlags &= ~INVISIBLE;
+							}
+							else if (curDiff.op == OP_TRIVIAL)
+								aLines[file][i].m_dwFlags |= LF_TRIVIAL;
+						}
+					}
+					break;
+				}
+				diffList.SetDiff(nDiff, curDiff);
+			}
+			return nTrivialDiffs;
+		}
+
+		static void MoveLine(std::vector<TestLine>& lines, int line1, int line2, int newline1)
+		{
+			int ldiff = newline1 - line1;
+			if (ldiff > 0)
+			{
+				for (int l = line2; l >= line1; l--)
+					lines[l + ldiff] = lines[l];
+			}
+			else if (ldiff < 0)
+			{
+				for (int l = line1; l <= line2; l++)
+					lines[l + ldiff] = lines[l];
+			}
+		}
+
+		// CMergeDoc::HideLines() as it used to be.
+		static void HideLinesOld(int nFiles, std::vector<TestLine> aLines[3], int nContext)
+		{
+			int file;
+			int nLineCount = 0x7fffffff;
+			for (file = 0; file < nFiles; file++)
+				nLineCount = (std::min)(nLineCount, static_cast<int>(aLines[file].size()));
+			const unsigned long diffFlags = LF_DIFF | GHOST;
+			for (int nLine = 0; nLine < nLineCount;)
+			{
+				if (!(aLines[0][nLine].m_dwFlags & diffFlags))
+				{
+					for (file = 0; file < nFiles; file++)
+						aLines[file][nLine].m_dwFlags |= INVISIBLE;
+					nLine++;
+				}
+				else
+				{
+					int nLine2 = (nLine - nContext < 0) ? 0 : (nLine - nContext);
+					for (; nLine2 < nLine; nLine2++)
+					{
+						for (file = 0; file < nFiles; file++)
+							aLines[file][nLine2].m_dwFlags &= ~INVISIBLE;
+					}
+					for (; nLine < nLineCount; nLine++)
+					{
+						if (!(aLines[0][nLine].m_dwFlags & diffFlags))
+							break;
+						for (file = 0; file < nFiles; file++)
+							aLines[file][nLine].m_dwFlags &= ~INVISIBLE;
+					}
+					int nLineEnd2 = (nLine + nContext >= nLineCount) ? nLineCount - 1 : (nLine + nContext);
+					for (; nLine < nLineEnd2; nLine++)
+					{
+						for (file = 0; file < nFiles; file++)
+							aLines[file][nLine].m_dwFlags &= ~INVISIBLE;
+						if (aLines[0][nLine].m_dwFlags & diffFlags)
+							nLineEnd2 = (nLine + 1 + nContext >= nLineCount) ? nLineCount - 1 : (nLine + 1 + nContext);
+					}
+				}
+			}
+		}
+
+		static int Prime(int nFiles, std::vector<TestLine> lines[3], DiffList& diffList)
+		{
+			std::vector<TestLine> *aLines[3] = { &lines[0], &lines[1], &lines[2] };
+			TestLine ghost = { 0, -1 };
+			return LayOutGhostLines(diffList, nFiles, aLines, ghost, GHOST, INVISIBLE);
+		}
+
+		static void HideLines(int nFiles, std::vector<TestLine> lines[3], int nContext)
+		{
+			std::vector<TestLine> *aLines[3] = { &lines[0], &lines[1], &lines[2] };
+			HideLinesOutOfContext(nFiles, aLines, nContext, LF_DIFF | GHOST, INVISIBLE);
+		}
+
+		static void ExpectSameLines(int nFiles, const std::vector<TestLine> expected[3], const std::vector<TestLine> actual[3])
+		{
+			for (int file = 0; file < nFiles; file++)
+			{
+				ASSERT_EQ(expected[file].size(), actual[file].size()) << "pane " << file;
+				for (size_t i = 0; i < expected[file].size(); i++)
+				{
+					ASSERT_EQ(expected[file][i].id, actual[file][i].id) << "pane " << file << " line " << i;
+					ASSERT_EQ(expected[file][i].m_dwFlags, actual[file][i].m_dwFlags) << "pane " << file << " line " << i;
+				}
+			}
+		}
+
+		static void ExpectSameDiffs(const DiffList& expected, const DiffList& actual)
+		{
+			ASSERT_EQ(expected.GetSize(), actual.GetSize());
+			for (int nDiff = 0; nDiff < expected.GetSize(); nDiff++)
+			{
+				DIFFRANGE e, a;
+				expected.GetDiff(nDiff, e);
+				actual.GetDiff(nDiff, a);
+				EXPECT_EQ(e.dbegin, a.dbegin) << "diff " << nDiff;
+				EXPECT_EQ(e.dend, a.dend) << "diff " << nDiff;
+				for (int file = 0; file < 3; file++)
+					EXPECT_EQ(e.blank[file], a.blank[file]) << "diff " << nDiff << " pane " << file;
+			}
+		}
+	};
+
+	TEST_F(GhostLineLayoutTest, GhostLines)
+	{
+		// a b c d / a x c  =>  a b c d / a x c <ghost>
+		std::vector<TestLine> lines[3];
+		for (int i = 0; i < 4; i++)
+			AddLine(lines[0], 0);
+		for (int i = 0; i < 3; i++)
+			AddLine(lines[1], 0);
+		DiffList diffList;
+		DIFFRANGE dr;
+		dr.begin[0] = 1; dr.end[0] = 1; dr.begin[1] = 1; dr.end[1] = 1; dr.op = OP_DIFF;
+		diffList.AddDiff(dr);
+		dr.begin[0] = 3; dr.end[0] = 3; dr.begin[1] = 3; dr.end[1] = 2; dr.op = OP_1STONLY;
+		diffList.AddDiff(dr);
+
+		EXPECT_EQ(0, Prime(2, lines, diffList));
+		ASSERT_EQ(4u, lines[1].size());
+		EXPECT_EQ(-1, lines[1][3].id);
+		EXPECT_EQ(GHOST, lines[1][3].m_dwFlags);
+		EXPECT_EQ(LF_DIFF, lines[0][1].m_dwFlags);
+		EXPECT_EQ(LF_DIFF, lines[0][3].m_dwFlags);
+		const DIFFRANGE *pdr = diffList.DiffRangeAt(1);
+		EXPECT_EQ(3, pdr->dbegin);
+		EXPECT_EQ(3, pdr->dend);
+		EXPECT_EQ(-1, pdr->blank[0]);
+		EXPECT_EQ(3, pdr->blank[1]);
+
+		HideLines(2, lines, 0);
+		EXPECT_EQ(INVISIBLE, lines[0][0].m_dwFlags);
+		EXPECT_EQ(LF_DIFF, lines[0][1].m_dwFlags);
+		EXPECT_EQ(INVISIBLE, lines[1][2].m_dwFlags);
+		EXPECT_EQ(GHOST, lines[1][3].m_dwFlags);
+	}
+
+	TEST_F(GhostLineLayoutTest, SameAsBefore)
+	{
+		srand(1);
+		const int nDiffs[] = { 0, 1, 2, 5, 50 };
+		const int maxLines[] = { 1, 2, 4 };
+		const int contexts[] = { 0, 1, 2, 5 };
+		for (int nFiles = 2; nFiles <= 3; nFiles++)
+		{
+			for (int d = 0; d < 5; d++)
+			{
+				for (int m = 0; m < 3; m++)
+				{
+					for (int n = 0; n < 20; n++)
+					{
+						std::vector<TestLine> expected[3];
+						DiffList expectedDiffs;
+						Generate(nFiles, nDiffs[d], maxLines[m], expected, expectedDiffs);
+						std::vector<TestLine> actual[3] = { expected[0], expected[1], expected[2] };
+						DiffList actualDiffs = expectedDiffs;
+
+						EXPECT_EQ(PrimeOld(nFiles, expected, expectedDiffs), Prime(nFiles, actual, actualDiffs));
+						ExpectSameDiffs(expectedDiffs, actualDiffs);
+						ExpectSameLines(nFiles, expected, actual);
+
+						for (int c = 0; c < 4; c++)
+						{
+							HideLinesOld(nFiles, expected, contexts[c]);
+							HideLines(nFiles, actual, contexts[c]);
+							ExpectSameLines(nFiles, expected, actual);
+						}
+						if (HasFatalFailure())
+							return;
+					}
+				}
+			}
+		}
+	}
+
+}  // namespace
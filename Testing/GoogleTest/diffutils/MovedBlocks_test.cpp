@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "diff.h"
+#include "MovedLines.h"
+
+namespace
+{
+	// The fixture for testing moved block detection.
+	class MovedBlocksTest : public testing::Test
+	{
+	protected:
+		MovedBlocksTest()
+		{
+		}
+
+		virtual ~MovedBlocksTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Create a change block.
+		static change *Change(int line0, int line1, int deleted, int inserted, change *link = NULL)
+		{
+			change *e = static_cast<change *>(calloc(1, sizeof(change)));
+			e->line0 = line0;
+			e->line1 = line1;
+			e->deleted = deleted;
+			e->inserted = inserted;
+			e->match0 = -1;
+			e->match1 = -1;
+			e->link = link;
+			return e;
+		}
+
+		// Detect moved blocks in SCRIPT, where LINES are the equivalence
+		// classes of the lines of both files.
+		static void Analyze(change **script, std::vector<int> lines[2], int equiv_max)
+		{
+			file_data fd[2];
+			memset(fd, 0, sizeof(fd));
+			for (int f = 0; f < 2; f++)
+			{
+				fd[f].buffered_lines = static_cast<int>(lines[f].size());
+				// Keep vectors non-empty for taking their addresses
+				lines[f].push_back(0);
+				fd[f].equivs = &lines[f][0];
+				fd[f].equiv_max = equiv_max;
+			}
+			moved_block_analysis(script, fd);
+			for (int f = 0; f < 2; f++)
+				lines[f].pop_back();
+		}
+
+		// Lines are given as strings, one character per line;
+		// the character is the equivalence class of the line.
+		static void Analyze(change **script, const std::string& lines0, const std::string& lines1)
+		{
+			std::vector<int> lines[2];
+			for (size_t i = 0; i < lines0.length(); i++)
+				lines[0].push_back(static_cast<unsigned char>(lines0[i]));
+			for (size_t i = 0; i < lines1.length(); i++)
+				lines[1].push_back(static_cast<unsigned char>(lines1[i]));
+			Analyze(script, lines, 256);
+		}
+
+		// Return the blocks of SCRIPT as text, and free them.
+		static std::string Blocks(change *script)
+		{
+			std::string result;
+			while (script)
+			{
+				char buf[80];
+				sprintf(buf, "%d,%d,%d,%d,%d,%d;", script->line0, script->line1,
+					script->deleted, script->inserted, script->match0, script->match1);
+				result += buf;
+				change *next = script->link;
+				free(script);
+				script = next;
+			}
+			return result;
+		}
+	};
+
+	TEST_F(MovedBlocksTest, BlockMoved)
+	{
+		// AB moved after xyz
+		change *script = Change(0, 0, 2, 0, Change(5, 3, 0, 2));
+		Analyze(&script, "ABxyz", "xyzAB");
+		EXPECT_EQ("0,0,2,0,-1,3;5,3,0,2,0,-1;", Blocks(script));
+	}
+
+	TEST_F(MovedBlocksTest, RepeatedLinesNotMoved)
+	{
+		change *script = Change(0, 0, 2, 0, Change(3, 1, 0, 2));
+		Analyze(&script, "AAx", "xAA");
+		EXPECT_EQ("0,0,2,0,-1,-1;3,1,0,2,-1,-1;", Blocks(script));
+	}
+
+	TEST_F(MovedBlocksTest, BlocksSplit)
+	{
+		// AB is in the middle of the change on the left side and at its
+		// start on the right side
+		change *script = Change(0, 0, 4, 3);
+		Analyze(&script, "pABq", "ABr");
+		EXPECT_EQ("0,0,0,2,1,-1;0,2,1,1,-1,-1;1,3,2,0,-1,0;3,3,1,0,-1,-1;", Blocks(script));
+	}
+
+	TEST_F(MovedBlocksTest, DISABLED_ReorderedBlocks)
+	{
+		// Blocks of ten unique lines in another order
+		const int count = 100000;
+		std::vector<int> lines[2];
+		for (int i = 0; i < count; i++)
+			lines[0].push_back(1 + i);
+		std::vector<int> blocks;
+		for (int i = 0; i < count; i += 10)
+			blocks.push_back(i);
+		unsigned seed = 1;
+		for (size_t i = blocks.size() - 1; i > 0; i--)
+		{
+			seed = seed * 1103515245 + 12345;
+			std::swap(blocks[i], blocks[(seed >> 8) % (i + 1)]);
+		}
+		for (size_t i = 0; i < blocks.size(); i++)
+			lines[1].insert(lines[1].end(), lines[0].begin() + blocks[i], lines[0].begin() + blocks[i] + 10);
+
+		change *script = Change(0, 0, count, count);
+		clock_t start = clock();
+		Analyze(&script, lines, count + 1);
+		clock_t elapsed = clock() - start;
+		RecordProperty("milliseconds", static_cast<int>(elapsed * 1000 / CLOCKS_PER_SEC));
+
+		int moved[2] = {0, 0};
+		for (change *e = script; e; e = e->link)
+		{
+			if (e->match1 >= 0)
+			{
+				for (int i = 0; i < e->deleted; i++)
+					EXPECT_EQ(lines[0][e->line0 + i], lines[1][e->match1 + i]);
+				moved[0] += e->deleted;
+			}
+			if (e->match0 >= 0)
+			{
+				for (int i = 0; i < e->inserted; i++)
+					EXPECT_EQ(lines[1][e->line1 + i], lines[0][e->match0 + i]);
+				moved[1] += e->inserted;
+			}
+		}
+		Blocks(script);
+		EXPECT_EQ(count, moved[0]);
+		EXPECT_EQ(count, moved[1]);
+	}
+
+	TEST_F(MovedBlocksTest, MovedLines)
+	{
+		MovedLines moved;
+		EXPECT_EQ(-1, moved.LineInBlock(0, MovedLines::SIDE_LEFT));
+		moved.Add(MovedLines::SIDE_LEFT, 5, 10);
+		moved.Add(MovedLines::SIDE_RIGHT, 10, 5);
+		EXPECT_EQ(10, moved.LineInBlock(5, MovedLines::SIDE_LEFT));
+		EXPECT_EQ(5, moved.LineInBlock(10, MovedLines::SIDE_RIGHT));
+		EXPECT_EQ(-1, moved.LineInBlock(4, MovedLines::SIDE_LEFT));
+		EXPECT_EQ(-1, moved.LineInBlock(6, MovedLines::SIDE_LEFT));
+		EXPECT_EQ(-1, moved.LineInBlock(5, MovedLines::SIDE_RIGHT));
+		moved.Clear();
+		EXPECT_EQ(-1, moved.LineInBlock(5, MovedLines::SIDE_LEFT));
+	}
+}
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/Thread.h>
+#include <Poco/Timestamp.h>
+#include "Environment.h"
+#include "paths.h"
+#include "IAbortable.h"
+#include "PatchFileWriter.h"
+
+namespace
+{
+	// Aborts once a count of parts have been rendered.
+	class CountAbortable : public IAbortable
+	{
+	public:
+		CountAbortable(const std::atomic<int>& rendered, int count) : m_rendered(rendered), m_count(count) {}
+		bool ShouldAbort() const { return m_rendered >= m_count; }
+	private:
+		const std::atomic<int>& m_rendered;
+		int m_count;
+	};
+
+	// The fixture for testing writing patch files from concurrently
+	// rendered parts.
+	class PatchFileWriterTest : public testing::Test
+	{
+	protected:
+		PatchFileWriterTest()
+		{
+			m_serialPath = paths::ConcatPath(env::GetProgPath(), _T("../TestData/_tmp_patch_serial.txt"));
+			m_path = paths::ConcatPath(env::GetProgPath(), _T("../TestData/_tmp_patch.txt"));
+		}
+
+		virtual ~PatchFileWriterTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+			_tremove(m_serialPath.c_str());
+			_tremove(m_path.c_str());
+		}
+
+		// Print a part of a patch, with line endings, control characters
+		// and sizes varying by part.
+		static bool Print(size_t index, FILE *stream)
+		{
+			const int lines = (index % 7 == 3) ? 20000 : static_cast<int>(index % 5);
+			fprintf(stream, "diff part%u\n", static_cast<unsigned>(index));
+			for (int i = 0; i < lines; ++i)
+				fprintf(stream, "+line %d\r\n-\x1a%d\n", i, i);
+			_ftprintf(stream, _T("end %u\n"), static_cast<unsigned>(index));
+			return !ferror(stream);
+		}
+
+		// Print the header, COUNT parts and the terminator one after the
+		// other to a patch file in text mode, as patches were written before.
+		void WriteSerial(size_t count)
+		{
+			FILE *file = _tfopen(m_serialPath.c_str(), _T("w+"));
+			ASSERT_TRUE(file != NULL);
+			fprintf(file, "<html>\n");
+			for (size_t i = 0; i < count; ++i)
+				Print(i, file);
+			fprintf(file, "</html>\n");
+			fclose(file);
+		}
+
+		// Print the header and the parts with WRITER to the patch file.
+		size_t Write(PatchFileWriter& writer, size_t count, const PatchFileWriter::RenderFunc& render, const IAbortable *pAbortable = NULL)
+		{
+			EXPECT_TRUE(writer.Open(m_path, false));
+			EXPECT_TRUE(writer.Write([](FILE *stream) { fprintf(stream, "<html>\n"); return true; }));
+			return writer.WriteParts(count, render, pAbortable);
+		}
+
+		// Print the terminator with WRITER and close the patch file.
+		static void Close(PatchFileWriter& writer)
+		{
+			EXPECT_TRUE(writer.Write([](FILE *stream) { fprintf(stream, "</html>\n"); return true; }));
+			EXPECT_TRUE(writer.Close());
+		}
+
+		static std::string ReadFile(const String& path)
+		{
+			std::ifstream stream(path.c_str(), std::ios::binary);
+			return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		}
+
+		String m_serialPath;
+		String m_path;
+	};
+
+	TEST_F(PatchFileWriterTest, SameAsSerial)
+	{
+		const size_t count = 50;
+		WriteSerial(count);
+		const std::string expected = ReadFile(m_serialPath);
+		ASSERT_LT(100000u, expected.size());
+
+		const int workers[] = { 1, 2, 8 };
+		for (int w = 0; w < 3; ++w)
+		{
+			PatchFileWriter writer(workers[w]);
+			EXPECT_EQ(workers[w], writer.GetWorkerCount());
+			EXPECT_EQ(count, Write(writer, count, [](int worker, size_t index, FILE *stream)
+				{
+					// Parts are completed out of order
+					Poco::Thread::sleep(static_cast<long>((index * 7) % 3));
+					return Print(index, stream);
+				}));
+			Close(writer);
+			EXPECT_EQ(expected, ReadFile(m_path)) << workers[w] << " workers";
+		}
+	}
+
+	TEST_F(PatchFileWriterTest, WorkerThreads)
+	{
+		const size_t count = 40;
+		const int nworkers = 4;
+		std::vector<Poco::Thread *> threads(nworkers, NULL);
+		bool bSameThread = true;
+		PatchFileWriter writer(nworkers);
+		EXPECT_EQ(count, Write(writer, count, [&](int worker, size_t index, FILE *stream)
+			{
+				// Each worker index is called in one thread
+				if (!threads[worker])
+					threads[worker] = Poco::Thread::current();
+				else if (threads[worker] != Poco::Thread::current())
+					bSameThread = false;
+				return Print(index, stream);
+			}));
+		Close(writer);
+		EXPECT_TRUE(bSameThread);
+	}
+
+	TEST_F(PatchFileWriterTest, StopAtFailedPart)
+	{
+		WriteSerial(5);
+		const int workers[] = { 1, 4 };
+		for (int w = 0; w < 2; ++w)
+		{
+			PatchFileWriter writer(workers[w]);
+			EXPECT_EQ(5u, Write(writer, 20, [](int worker, size_t index, FILE *stream)
+				{
+					return Print(index, stream) && index != 5;
+				}));
+			Close(writer);
+			EXPECT_FALSE(writer.IsFailed());
+			EXPECT_EQ(ReadFile(m_serialPath), ReadFile(m_path)) << workers[w] << " workers";
+		}
+	}
+
+	TEST_F(PatchFileWriterTest, Abort)
+	{
+		const int workers[] = { 1, 4 };
+		for (int w = 0; w < 2; ++w)
+		{
+			std::atomic<int> rendered(0);
+			CountAbortable abortable(rendered, 10);
+			PatchFileWriter writer(workers[w]);
+			size_t written = Write(writer, 1000, [&rendered](int worker, size_t index, FILE *stream)
+				{
+					++rendered;
+					return Print(index, stream);
+				}, &abortable);
+			Close(writer);
+			if (workers[w] == 1)
+				EXPECT_EQ(10u, written);
+			else
+				EXPECT_LT(written, 1000u);
+			// The parts written are complete and in order
+			WriteSerial(written);
+			EXPECT_EQ(ReadFile(m_serialPath), ReadFile(m_path)) << workers[w] << " workers";
+		}
+	}
+
+	TEST_F(PatchFileWriterTest, Exception)
+	{
+		WriteSerial(3);
+		PatchFileWriter writer(4);
+		EXPECT_THROW(Write(writer, 20, [](int worker, size_t index, FILE *stream) -> bool
+			{
+				if (index == 3)
+					throw std::runtime_error("render");
+				return Print(index, stream);
+			}), std::runtime_error);
+		Close(writer);
+		EXPECT_EQ(ReadFile(m_serialPath), ReadFile(m_path));
+	}
+
+	TEST_F(PatchFileWriterTest, OpenFails)
+	{
+		PatchFileWriter writer(2);
+		EXPECT_FALSE(writer.Open(paths::ConcatPath(env::GetProgPath(), _T("../TestData/nonexistent/patch.txt")), false));
+		EXPECT_TRUE(writer.IsFailed());
+		EXPECT_EQ(0u, writer.WriteParts(3, [](int worker, size_t index, FILE *stream) { return true; }));
+		EXPECT_FALSE(writer.Close());
+	}
+
+	// Write 400 parts, each taking some time to render, serially and with
+	// 8 workers.
+	TEST_F(PatchFileWriterTest, DISABLED_Benchmark)
+	{
+		const size_t count = 400;
+		const int workers[] = { 1, 8 };
+		const char *properties[] = { "serial_milliseconds", "parallel_milliseconds" };
+		std::string output[2];
+		for (int w = 0; w < 2; ++w)
+		{
+			Poco::Timestamp start;
+			PatchFileWriter writer(workers[w]);
+			EXPECT_EQ(count, Write(writer, count, [](int worker, size_t index, FILE *stream)
+				{
+					Poco::Thread::sleep(2);
+					return Print(index, stream);
+				}));
+			Close(writer);
+			RecordProperty(properties[w], static_cast<int>(start.elapsed() / 1000));
+			output[w] = ReadFile(m_path);
+		}
+		EXPECT_EQ(output[0], output[1]);
+	}
+
+}  // namespace
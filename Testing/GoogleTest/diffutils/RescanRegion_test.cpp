@@ -0,0 +1,251 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+#include "CompareOptions.h"
+#include "DiffList.h"
+#include "DiffWrapper.h"
+#include "RescanRegion.h"
+
+namespace
+{
+	// An edit replacing lines of one file.
+	struct Edit
+	{
+		int nBuffer;
+		int nLine; // first replaced line
+		int nDeleted; // count of replaced lines
+		const char *pszInserted; // lines replacing them, with EOLs
+	};
+
+	// The fixture for testing that comparing an edited region again gives
+	// the diffs of comparing whole files again.
+	class RescanRegionTest : public testing::Test
+	{
+	protected:
+		RescanRegionTest()
+		{
+		}
+
+		virtual ~RescanRegionTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Split TEXT to lines as the editor does: each line keeps its EOL,
+		// and the line after the last EOL is a line too.
+		static std::vector<std::string> SplitLines(const std::string& text)
+		{
+			std::vector<std::string> lines;
+			size_t begin = 0;
+			for (size_t i = 0; i < text.size(); ++i)
+			{
+				if (text[i] == '\r' && i + 1 < text.size() && text[i + 1] == '\n')
+					++i;
+				if (text[i] == '\r' || text[i] == '\n')
+				{
+					lines.push_back(text.substr(begin, i + 1 - begin));
+					begin = i + 1;
+				}
+			}
+			lines.push_back(text.substr(begin));
+			return lines;
+		}
+
+		// Join COUNT lines from FIRST, or lines up to the end if COUNT is -1.
+		static std::string JoinLines(const std::vector<std::string>& lines, int first, int count)
+		{
+			const int last = (count < 0) ? static_cast<int>(lines.size()) : first + count;
+			std::string text;
+			for (int i = first; i < last; ++i)
+				text += lines[i];
+			return text;
+		}
+
+		// Compare TEXTS and fix the last diff as CMergeDoc::Rescan() does.
+		static void Diff(const std::string texts[2], const DIFFOPTIONS& options,
+			CDiffWrapper& diffWrapper, DiffList& diffList, DIFFSTATUS& status)
+		{
+			diffWrapper.SetOptions(&options);
+			diffWrapper.SetPaths(PathContext(_T("left.txt"), _T("right.txt")), false);
+			diffWrapper.SetInMemoryTexts(texts);
+			diffWrapper.SetCreateDiffList(&diffList);
+			ASSERT_TRUE(diffWrapper.RunFileDiff());
+			diffWrapper.GetDiffStatus(&status);
+			diffWrapper.SetInMemoryTexts(NULL);
+		}
+
+		static void FixLastDiffRange(const std::string texts[2], const DIFFOPTIONS& options,
+			CDiffWrapper& diffWrapper, DiffList& diffList, DIFFSTATUS& status)
+		{
+			if (!options.nIgnoreWhitespace && !options.bIgnoreBlankLines &&
+				status.bMissingNL[0] != status.bMissingNL[1])
+			{
+				int lineCount[2];
+				for (int nBuffer = 0; nBuffer < 2; nBuffer++)
+					lineCount[nBuffer] = static_cast<int>(SplitLines(texts[nBuffer]).size());
+				diffWrapper.SetCreateDiffList(&diffList);
+				diffWrapper.FixLastDiffRange(2, lineCount, status.bMissingNL, options.bIgnoreBlankLines);
+			}
+		}
+
+		// Compare OLDTEXTS, apply EDITS, and check that comparing the edited
+		// region again gives the diffs and identical level of comparing the
+		// edited texts as a whole.
+		static void ExpectSameAsFullRescan(const std::string oldTexts[2], const Edit *edits, int nEdits, const DIFFOPTIONS& options)
+		{
+			CDiffWrapper diffWrapper;
+			DiffList diffList;
+			DIFFSTATUS status;
+			Diff(oldTexts, options, diffWrapper, diffList, status);
+			FixLastDiffRange(oldTexts, options, diffWrapper, diffList, status);
+
+			// Apply edits, remembering edited lines like CDiffTextBuffer::GetEditedRealLines()
+			std::vector<std::string> lines[2] = { SplitLines(oldTexts[0]), SplitLines(oldTexts[1]) };
+			int nRealLines[2], nFirst[2] = { INT_MAX, INT_MAX }, nLast[2] = { -1, -1 }, nDelta[2];
+			int nBuffer;
+			for (nBuffer = 0; nBuffer < 2; nBuffer++)
+				nRealLines[nBuffer] = static_cast<int>(lines[nBuffer].size());
+			for (int i = 0; i < nEdits; i++)
+			{
+				const Edit& edit = edits[i];
+				std::vector<std::string>& l = lines[edit.nBuffer];
+				std::vector<std::string> inserted = SplitLines(edit.pszInserted);
+				// Inserted text is joined with the line after it
+				inserted.back() += l[edit.nLine + edit.nDeleted];
+				l.erase(l.begin() + edit.nLine, l.begin() + edit.nLine + edit.nDeleted + 1);
+				l.insert(l.begin() + edit.nLine, inserted.begin(), inserted.end());
+				const int nEditLast = edit.nLine + static_cast<int>(inserted.size()) - 1;
+				if (nFirst[edit.nBuffer] != INT_MAX)
+				{
+					// Lines edited before are shifted by this edit
+					if (nLast[edit.nBuffer] >= edit.nLine + edit.nDeleted)
+						nLast[edit.nBuffer] += static_cast<int>(inserted.size()) - 1 - edit.nDeleted;
+				}
+				nFirst[edit.nBuffer] = (std::min)(nFirst[edit.nBuffer], edit.nLine);
+				nLast[edit.nBuffer] = (std::max)(nLast[edit.nBuffer], nEditLast);
+			}
+			std::string newTexts[2];
+			for (nBuffer = 0; nBuffer < 2; nBuffer++)
+			{
+				newTexts[nBuffer] = JoinLines(lines[nBuffer], 0, -1);
+				nDelta[nBuffer] = static_cast<int>(lines[nBuffer].size()) - nRealLines[nBuffer];
+				// Edited range in line numbers of previous compare
+				if (nLast[nBuffer] >= 0)
+					nLast[nBuffer] -= nDelta[nBuffer];
+			}
+
+			// Compare the edited region again, as CMergeDoc::RescanEditedRegion() does
+			RescanRegion region;
+			ASSERT_TRUE(region.Find(diffList, nRealLines, nFirst, nLast));
+			std::string regionTexts[2];
+			for (nBuffer = 0; nBuffer < 2; nBuffer++)
+			{
+				regionTexts[nBuffer] = JoinLines(lines[nBuffer], region.nStart[nBuffer], region.bToEOF ? -1 :
+					region.nEnd[nBuffer] + nDelta[nBuffer] - region.nStart[nBuffer]);
+			}
+			DiffList regionDiffs;
+			DIFFSTATUS regionStatus;
+			Diff(regionTexts, options, diffWrapper, regionDiffs, regionStatus);
+			region.Splice(diffList, regionDiffs, regionStatus, nDelta, status);
+			FixLastDiffRange(newTexts, options, diffWrapper, diffList, status);
+
+			DiffList fullDiffs;
+			DIFFSTATUS fullStatus;
+			Diff(newTexts, options, diffWrapper, fullDiffs, fullStatus);
+			FixLastDiffRange(newTexts, options, diffWrapper, fullDiffs, fullStatus);
+
+			ASSERT_EQ(fullDiffs.GetSize(), diffList.GetSize());
+			for (int i = 0; i < fullDiffs.GetSize(); ++i)
+			{
+				const DIFFRANGE *pFull = fullDiffs.DiffRangeAt(i);
+				const DIFFRANGE *pSpliced = diffList.DiffRangeAt(i);
+				SCOPED_TRACE(testing::Message() << "diff " << i);
+				EXPECT_EQ(pFull->begin[0], pSpliced->begin[0]);
+				EXPECT_EQ(pFull->end[0], pSpliced->end[0]);
+				EXPECT_EQ(pFull->begin[1], pSpliced->begin[1]);
+				EXPECT_EQ(pFull->end[1], pSpliced->end[1]);
+				EXPECT_EQ(pFull->op, pSpliced->op);
+			}
+			EXPECT_EQ(fullStatus.Identical, status.Identical);
+		}
+
+		// Check ExpectSameAsFullRescan() with each whitespace option.
+		static void ExpectSameAsFullRescan(const std::string oldTexts[2], const Edit *edits, int nEdits)
+		{
+			for (int nIgnoreWhitespace = WHITESPACE_COMPARE_ALL; nIgnoreWhitespace <= WHITESPACE_IGNORE_ALL; ++nIgnoreWhitespace)
+			{
+				SCOPED_TRACE(testing::Message() << "whitespace " << nIgnoreWhitespace);
+				DIFFOPTIONS options = {0};
+				options.nIgnoreWhitespace = nIgnoreWhitespace;
+				ExpectSameAsFullRescan(oldTexts, edits, nEdits, options);
+				options.bIgnoreBlankLines = true;
+				ExpectSameAsFullRescan(oldTexts, edits, nEdits, options);
+			}
+		}
+	};
+
+	const std::string Texts[2] = {
+		"one\ntwo\nthree\nfour\nfive\nsix\nseven\neight\nnine\nten\n",
+		"one\ntwo\n3\nfour\nfive\nsix\nseven\neight\n9\nten\n" };
+
+	TEST_F(RescanRegionTest, ChangeLineBetweenDiffs)
+	{
+		const Edit edits[] = { { 0, 5, 1, "SIX\n" } };
+		ExpectSameAsFullRescan(Texts, edits, 1);
+	}
+
+	TEST_F(RescanRegionTest, ChangeLineInDiff)
+	{
+		const Edit edits[] = { { 1, 2, 1, "three\n" } };
+		ExpectSameAsFullRescan(Texts, edits, 1);
+	}
+
+	TEST_F(RescanRegionTest, InsertAndDeleteLines)
+	{
+		const Edit edits[] = { { 0, 3, 0, "new\nlines\n" }, { 1, 6, 2, "" } };
+		ExpectSameAsFullRescan(Texts, edits, 2);
+	}
+
+	TEST_F(RescanRegionTest, EditFirstAndLastLines)
+	{
+		const Edit edits[] = { { 0, 0, 1, "zero\none\n" }, { 1, 9, 1, "ten" } };
+		ExpectSameAsFullRescan(Texts, edits, 2);
+	}
+
+	TEST_F(RescanRegionTest, WhitespaceOnlyChange)
+	{
+		// Files differing only in whitespace are not identical, even if
+		// the diff is ignored
+		const std::string texts[2] = { "a\nb\nc\n\nd\ne\n", "a\nb\nc\n\nd\ne\n" };
+		const Edit edits[] = { { 1, 1, 1, "b  \n" } };
+		ExpectSameAsFullRescan(texts, edits, 1);
+		const Edit edits2[] = { { 1, 3, 1, "" } };
+		ExpectSameAsFullRescan(texts, edits2, 1);
+	}
+
+	TEST_F(RescanRegionTest, UndoLastDiff)
+	{
+		const std::string texts[2] = { "a\nb\nc\nd\ne\n", "a\nb\nc\nD\ne\n" };
+		const Edit edits[] = { { 1, 3, 1, "d\n" } };
+		ExpectSameAsFullRescan(texts, edits, 1);
+	}
+
+	TEST_F(RescanRegionTest, MissingEolAtEnd)
+	{
+		const std::string texts[2] = { "a\nb\nc\nd\ne", "a\nb\nc\nd\ne\n" };
+		const Edit edits[] = { { 0, 1, 1, "B\n" } };
+		ExpectSameAsFullRescan(texts, edits, 1);
+		const Edit edits2[] = { { 0, 3, 1, "D\n" } };
+		ExpectSameAsFullRescan(texts, edits2, 1);
+	}
+
+}  // namespace
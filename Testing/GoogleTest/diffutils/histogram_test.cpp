@@ -0,0 +1,396 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "CompareOptions.h"
+#include "DiffFileData.h"
+#include "diff.h"
+
+namespace
+{
+	// Lines are given as strings, one character per line;
+	// the character is the equivalence class of the line.
+	struct DiffCase
+	{
+		const char *lines0;
+		const char *lines1;
+	};
+
+	// Inputs checked by every test comparing algorithm results
+	const DiffCase SharedCases[] =
+	{
+		{ "", "" },
+		{ "abc", "" },
+		{ "", "abc" },
+		{ "abc", "abc" },
+		{ "abcde", "abXcde" },
+		{ "abXcde", "abcde" },
+		{ "abc", "xyz" },
+		{ "abcabcabc", "cbacbacba" },
+		{ "a}b}c}d}", "c}d}a}b}" },
+		{ "AaaaBaaaC", "CaaaBaaaA" },
+		{ "x{a}y{b}", "y{b}x{a}" },
+		{ "0123456789", "0193456782" },
+		{ "aaaaabaaaaa", "aaaaacaaaaa" },
+	};
+
+	// The fixture for testing the histogram diff algorithm.
+	class HistogramDiffTest : public testing::Test
+	{
+	protected:
+		HistogramDiffTest()
+		{
+		}
+
+		virtual ~HistogramDiffTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+			DIFFOPTIONS options = {0};
+			DiffutilsOptions diffutilsOptions;
+			diffutilsOptions.SetFromDiffOptions(options);
+			diffutilsOptions.SetToDiffUtils();
+		}
+
+		virtual void TearDown()
+		{
+		}
+
+		// Compare the equivalence classes of LINES, setting CHANGED flags.
+		static bool DiffLines(std::vector<int> lines[2], int equiv_max,
+			std::vector<char> changed[2], void (*fallback)(int, int, int, int) = NULL)
+		{
+			std::vector<int> realindexes[2];
+			file_data filevec[2] = {};
+			for (int f = 0; f < 2; f++)
+			{
+				int count = static_cast<int>(lines[f].size());
+				for (int i = 0; i < count; i++)
+					realindexes[f].push_back(i);
+				// Keep vectors non-empty for taking their addresses
+				lines[f].push_back(0);
+				realindexes[f].push_back(0);
+				changed[f].assign(count + 1, 0);
+				filevec[f].undiscarded = &lines[f][0];
+				filevec[f].realindexes = &realindexes[f][0];
+				filevec[f].nondiscarded_lines = count;
+				filevec[f].changed_flag = &changed[f][0];
+				filevec[f].equiv_max = equiv_max;
+			}
+			bool result = histogram_diff(filevec, fallback) != 0;
+			for (int f = 0; f < 2; f++)
+			{
+				lines[f].pop_back();
+				changed[f].pop_back();
+			}
+			return result;
+		}
+
+		// Compare LINES0 and LINES1, returning the changed flags of both
+		// as strings of '.' (unchanged) and 'x' (changed).
+		static bool Diff(const std::string& lines0, const std::string& lines1,
+			std::string& changed0, std::string& changed1,
+			void (*fallback)(int, int, int, int) = NULL)
+		{
+			std::vector<int> lines[2];
+			std::vector<char> changed[2];
+			for (size_t i = 0; i < lines0.length(); i++)
+				lines[0].push_back(static_cast<unsigned char>(lines0[i]));
+			for (size_t i = 0; i < lines1.length(); i++)
+				lines[1].push_back(static_cast<unsigned char>(lines1[i]));
+			bool result = DiffLines(lines, 256, changed, fallback);
+			changed0.clear();
+			changed1.clear();
+			for (size_t i = 0; i < changed[0].size(); i++)
+				changed0 += changed[0][i] ? 'x' : '.';
+			for (size_t i = 0; i < changed[1].size(); i++)
+				changed1 += changed[1][i] ? 'x' : '.';
+			return result;
+		}
+
+		// Compare TEXTS with diff_2_files() and ALGORITHM, setting CHANGED
+		// flags of each line of TEXTS.
+		static void DiffTexts(const std::string texts[2], int algorithm, std::vector<char> changed[2])
+		{
+			for (int f = 0; f < 2; f++)
+				changed[f].assign(std::count(texts[f].begin(), texts[f].end(), '\n'), 0);
+
+			DiffFileData diffdata;
+			ASSERT_TRUE(diffdata.OpenBuffers(texts[0], texts[1]));
+			diff_algorithm = algorithm;
+			int bin_status = 0;
+			struct change *script = diff_2_files(diffdata.m_inf, 0, &bin_status, 0, NULL);
+			diff_algorithm = ALGORITHM_MYERS;
+			// Lines of the script follow the identical lines at the beginning
+			const int prefix0 = diffdata.m_inf[0].prefix_lines, prefix1 = diffdata.m_inf[1].prefix_lines;
+			for (struct change *e = script, *next; e; e = next)
+			{
+				std::fill_n(changed[0].begin() + prefix0 + e->line0, e->deleted, 1);
+				std::fill_n(changed[1].begin() + prefix1 + e->line1, e->inserted, 1);
+				next = e->link;
+				free(e);
+			}
+		}
+
+		// Compare LINES0 and LINES1 as texts of a line per character with
+		// diff_2_files() and ALGORITHM, returning changed flags like Diff().
+		static void DiffTexts(const std::string& lines0, const std::string& lines1, int algorithm,
+			std::string& changed0, std::string& changed1)
+		{
+			std::string texts[2];
+			for (size_t i = 0; i < lines0.length(); i++)
+				(texts[0] += lines0[i]) += '\n';
+			for (size_t i = 0; i < lines1.length(); i++)
+				(texts[1] += lines1[i]) += '\n';
+			std::vector<char> changed[2];
+			DiffTexts(texts, algorithm, changed);
+			changed0.clear();
+			changed1.clear();
+			for (size_t i = 0; i < changed[0].size(); i++)
+				changed0 += changed[0][i] ? 'x' : '.';
+			for (size_t i = 0; i < changed[1].size(); i++)
+				changed1 += changed[1][i] ? 'x' : '.';
+		}
+
+		// Return the unchanged lines of LINES.
+		static std::string Unchanged(const std::string& lines, const std::string& changed)
+		{
+			std::string result;
+			for (size_t i = 0; i < lines.length(); i++)
+			{
+				if (changed[i] == '.')
+					result += lines[i];
+			}
+			return result;
+		}
+
+		// Check that REMOVED lines of file 0 and INSERTED lines of file 1
+		// are CHANGED, and the other lines are common.
+		static void ExpectChanged(const std::vector<int> lines[2], const std::vector<char> changed[2],
+			int removed, int inserted)
+		{
+			int nchanged[2] = {0, 0};
+			std::vector<int> unchanged[2];
+			for (int f = 0; f < 2; f++)
+			{
+				for (size_t i = 0; i < lines[f].size(); i++)
+				{
+					if (changed[f][i])
+						nchanged[f]++;
+					else
+						unchanged[f].push_back(lines[f][i]);
+				}
+			}
+			EXPECT_EQ(removed, nchanged[0]);
+			EXPECT_EQ(inserted, nchanged[1]);
+			EXPECT_TRUE(unchanged[0] == unchanged[1]);
+		}
+
+		// Return length of the longest common subsequence of A and B.
+		static size_t LCSLength(const std::string& a, const std::string& b)
+		{
+			std::vector<size_t> row(b.length() + 1), prev(b.length() + 1);
+			for (size_t i = 1; i <= a.length(); i++)
+			{
+				row.swap(prev);
+				for (size_t j = 1; j <= b.length(); j++)
+					row[j] = (a[i - 1] == b[j - 1]) ? prev[j - 1] + 1 : (std::max)(prev[j], row[j - 1]);
+			}
+			return row[b.length()];
+		}
+	};
+
+	TEST_F(HistogramDiffTest, UnchangedLinesAreCommon)
+	{
+		for (size_t i = 0; i < sizeof(SharedCases) / sizeof(SharedCases[0]); i++)
+		{
+			std::string lines0 = SharedCases[i].lines0, lines1 = SharedCases[i].lines1;
+			std::string changed0, changed1;
+			EXPECT_TRUE(Diff(lines0, lines1, changed0, changed1)) << lines0 << " " << lines1;
+			EXPECT_EQ(Unchanged(lines0, changed0), Unchanged(lines1, changed1)) << lines0 << " " << lines1;
+		}
+	}
+
+	TEST_F(HistogramDiffTest, AddedLinesOnly)
+	{
+		// If one file only adds lines to the other,
+		// no lines of the shorter file are changed
+		for (size_t i = 0; i < sizeof(SharedCases) / sizeof(SharedCases[0]); i++)
+		{
+			std::string lines0 = SharedCases[i].lines0, lines1 = SharedCases[i].lines1;
+			std::string changed0, changed1;
+			Diff(lines0, lines1, changed0, changed1);
+			if (LCSLength(lines0, lines1) == (std::min)(lines0.length(), lines1.length()))
+			{
+				EXPECT_EQ((std::min)(lines0.length(), lines1.length()),
+					Unchanged(lines0, changed0).length()) << lines0 << " " << lines1;
+			}
+		}
+	}
+
+	TEST_F(HistogramDiffTest, InsertAndDelete)
+	{
+		std::string changed0, changed1;
+		Diff("abcde", "abXcde", changed0, changed1);
+		EXPECT_EQ(".....", changed0);
+		EXPECT_EQ("..x...", changed1);
+		Diff("abXcde", "abcde", changed0, changed1);
+		EXPECT_EQ("..x...", changed0);
+		EXPECT_EQ(".....", changed1);
+		Diff("abc", "", changed0, changed1);
+		EXPECT_EQ("xxx", changed0);
+		EXPECT_EQ("", changed1);
+		Diff("abc", "xyz", changed0, changed1);
+		EXPECT_EQ("xxx", changed0);
+		EXPECT_EQ("xxx", changed1);
+	}
+
+	TEST_F(HistogramDiffTest, AnchorsOnRareLines)
+	{
+		std::string changed0, changed1;
+
+		// Moved block: the unique lines y and b are kept together,
+		// the repeated braces don't pull the alignment apart
+		Diff("x{a}y{b}", "y{b}x{a}", changed0, changed1);
+		EXPECT_EQ("xxxx....", changed0);
+		EXPECT_EQ("y{b}", Unchanged("y{b}x{a}", changed1));
+
+		// Unique lines A and C are moved, B anchors the repeated lines
+		Diff("AaaaBaaaC", "CaaaBaaaA", changed0, changed1);
+		EXPECT_EQ("x.......x", changed0);
+		EXPECT_EQ("x.......x", changed1);
+
+		// A unique line wins over a longer run of repeated lines
+		Diff("}{}{U", "U}{}{", changed0, changed1);
+		EXPECT_EQ("xxxx.", changed0);
+		EXPECT_EQ(".xxxx", changed1);
+	}
+
+	static int FallbackCalls;
+	static int FallbackBounds[4];
+
+	static void RecordFallback(int xoff, int xlim, int yoff, int ylim)
+	{
+		FallbackCalls++;
+		FallbackBounds[0] = xoff;
+		FallbackBounds[1] = xlim;
+		FallbackBounds[2] = yoff;
+		FallbackBounds[3] = ylim;
+	}
+
+	TEST_F(HistogramDiffTest, FallbackForFrequentLines)
+	{
+		// Every line occurs more often than an anchor may
+		std::string lines0, lines1;
+		for (int i = 0; i < 100; i++)
+		{
+			lines0 += "ab";
+			lines1 += "ba";
+		}
+		std::string changed0, changed1;
+		FallbackCalls = 0;
+		Diff(lines0, lines1, changed0, changed1, RecordFallback);
+		EXPECT_EQ(1, FallbackCalls);
+		EXPECT_EQ(0, FallbackBounds[0]);
+		EXPECT_EQ(200, FallbackBounds[1]);
+		EXPECT_EQ(0, FallbackBounds[2]);
+		EXPECT_EQ(200, FallbackBounds[3]);
+
+		// Without fallback the lines are changed
+		Diff(lines0, lines1, changed0, changed1);
+		EXPECT_EQ(std::string(200, 'x'), changed0);
+		EXPECT_EQ(std::string(200, 'x'), changed1);
+
+		// A rare line in the middle splits the frequent lines
+		FallbackCalls = 0;
+		Diff(lines0 + "U" + lines0, lines1 + "U" + lines1, changed0, changed1, RecordFallback);
+		EXPECT_EQ(2, FallbackCalls);
+		EXPECT_EQ('.', changed0[200]);
+		EXPECT_EQ('.', changed1[200]);
+	}
+
+	TEST_F(HistogramDiffTest, ComparedToMyers)
+	{
+		for (size_t i = 0; i < sizeof(SharedCases) / sizeof(SharedCases[0]); i++)
+		{
+			std::string lines0 = SharedCases[i].lines0, lines1 = SharedCases[i].lines1;
+			SCOPED_TRACE(testing::Message() << lines0 << " " << lines1);
+			std::string histogram0, histogram1, myers0, myers1;
+			DiffTexts(lines0, lines1, ALGORITHM_HISTOGRAM, histogram0, histogram1);
+			DiffTexts(lines0, lines1, ALGORITHM_MYERS, myers0, myers1);
+
+			// Both keep common lines; Myers keeps as many as can be kept,
+			// histogram may give up some lines to anchor on rare ones
+			std::string histogramUnchanged = Unchanged(lines0, histogram0);
+			std::string myersUnchanged = Unchanged(lines0, myers0);
+			EXPECT_EQ(histogramUnchanged, Unchanged(lines1, histogram1));
+			EXPECT_EQ(myersUnchanged, Unchanged(lines1, myers1));
+			EXPECT_EQ(LCSLength(lines0, lines1), myersUnchanged.length());
+			EXPECT_LE(histogramUnchanged.length(), myersUnchanged.length());
+
+			// Without repeated lines there is nothing to choose between
+			std::string sorted0 = lines0, sorted1 = lines1;
+			std::sort(sorted0.begin(), sorted0.end());
+			std::sort(sorted1.begin(), sorted1.end());
+			if (std::unique(sorted0.begin(), sorted0.end()) == sorted0.end() &&
+				std::unique(sorted1.begin(), sorted1.end()) == sorted1.end())
+			{
+				EXPECT_EQ(myers0, histogram0);
+				EXPECT_EQ(myers1, histogram1);
+			}
+		}
+	}
+
+	TEST_F(HistogramDiffTest, DISABLED_RepetitiveInput)
+	{
+		// Log-like input: every fourth line has a unique timestamp, the
+		// other lines are repeated over and over. Some unique lines are
+		// removed from file 0 and added to file 1.
+		const int count = 400000;
+		std::vector<int> lines[2];
+		int removed = 0, inserted = 0;
+		for (int i = 0; i < count; i++)
+		{
+			int line = (i % 4 == 0) ? 100 + i : 1 + i % 7;
+			if (i % 1000 == 4)
+				removed++;
+			else
+				lines[1].push_back(line);
+			if (i % 1000 == 504)
+			{
+				lines[1].push_back(100 + count + i);
+				inserted++;
+			}
+			lines[0].push_back(line);
+		}
+
+		std::vector<char> changed[2];
+		clock_t start = clock();
+		EXPECT_TRUE(DiffLines(lines, 100 + 2 * count, changed));
+		clock_t elapsed = clock() - start;
+		RecordProperty("milliseconds", static_cast<int>(elapsed * 1000 / CLOCKS_PER_SEC));
+		ExpectChanged(lines, changed, removed, inserted);
+
+		// Baseline: the same lines as texts, compared by both algorithms
+		std::string texts[2];
+		for (int f = 0; f < 2; f++)
+		{
+			for (size_t i = 0; i < lines[f].size(); i++)
+				(texts[f] += std::to_string(lines[f][i])) += '\n';
+		}
+		const int algorithms[] = { ALGORITHM_HISTOGRAM, ALGORITHM_MYERS };
+		const char *properties[] = { "histogram_texts_milliseconds", "myers_texts_milliseconds" };
+		for (int a = 0; a < 2; a++)
+		{
+			start = clock();
+			DiffTexts(texts, algorithms[a], changed);
+			elapsed = clock() - start;
+			RecordProperty(properties[a], static_cast<int>(elapsed * 1000 / CLOCKS_PER_SEC));
+			ExpectChanged(lines, changed, removed, inserted);
+		}
+	}
+}
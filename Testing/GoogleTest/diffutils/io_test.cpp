@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/Timestamp.h>
+#include "CompareOptions.h"
+#include "DiffFileData.h"
+#include "diff.h"
+
+namespace
+{
+	// The fixture for testing finding and hashing the lines of files.
+	class IoTest : public testing::Test
+	{
+	protected:
+		IoTest()
+		{
+		}
+
+		virtual ~IoTest()
+		{
+		}
+
+		virtual void SetUp()
+		{
+			DIFFOPTIONS options = {0};
+			SetOptions(options);
+		}
+
+		virtual void TearDown()
+		{
+			max_hash_threads = 0;
+		}
+
+		static void SetOptions(const DIFFOPTIONS& options)
+		{
+			DiffutilsOptions diffutilsOptions;
+			diffutilsOptions.SetFromDiffOptions(options);
+			diffutilsOptions.SetToDiffUtils();
+		}
+
+		// Read TEXTS with read_files() and return the equivalence classes of
+		// their lines. The first and last lines of the texts must differ, so
+		// that no lines are left out as identical prefix or suffix.
+		static void ReadLines(const std::string texts[2], std::vector<int> equivs[2])
+		{
+			DiffFileData diffdata;
+			ASSERT_TRUE(diffdata.OpenBuffers(texts[0], texts[1]));
+			ASSERT_EQ(0, read_files(diffdata.m_inf, 0, NULL));
+			for (int f = 0; f < 2; f++)
+				equivs[f].assign(diffdata.m_inf[f].equivs, diffdata.m_inf[f].equivs + diffdata.m_inf[f].buffered_lines);
+		}
+
+		// Put the lines of TEXTS into equivalence classes as io.c did before
+		// lines were hashed a word at a time: a character at a time into
+		// chains of a prime count of buckets. Only exact compare is done.
+		static void OldHashLines(const std::string texts[2], std::vector<int> equivs[2])
+		{
+			static const int primes[] =
+			{
+				509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071, 262139,
+				524287, 1048573, 2097143, 4194301, 8388593, 16777213, 33554393,
+				67108859, 134217689, 268435399, 536870909, 1073741789, 2147483647, 0
+			};
+			struct EquivClass
+			{
+				int next;
+				unsigned hash;
+				const char *line;
+				size_t length;
+			};
+
+			size_t nlines = 1;
+			for (int f = 0; f < 2; f++)
+				nlines += std::count(texts[f].begin(), texts[f].end(), '\n');
+			int nbuckets = primes[0];
+			for (int i = 0; primes[i] && primes[i] < static_cast<int>(nlines / 3); i++)
+				nbuckets = primes[i + 1];
+			std::vector<int> buckets(nbuckets);
+			std::vector<EquivClass> eqs(1);
+			eqs.reserve(nlines);
+
+			for (int f = 0; f < 2; f++)
+			{
+				equivs[f].clear();
+				const char *p = texts[f].c_str();
+				const char *end = p + texts[f].size();
+				while (p < end)
+				{
+					const char *ip = p;
+					unsigned h = 0;
+					unsigned char c;
+					while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+						h = c + (h << 7 | h >> (sizeof(h) * 8 - 7));
+					const size_t length = p - ip;
+					int *bucket = &buckets[h % nbuckets];
+					int i;
+					for (i = *bucket; ; i = eqs[i].next)
+					{
+						if (!i)
+						{
+							EquivClass eq = { *bucket, h, ip, length };
+							i = static_cast<int>(eqs.size());
+							eqs.push_back(eq);
+							*bucket = i;
+							break;
+						}
+						else if (eqs[i].hash == h && eqs[i].length == length &&
+							!line_cmp(eqs[i].line, eqs[i].length, ip, length))
+							break;
+					}
+					equivs[f].push_back(i);
+				}
+			}
+		}
+
+		// Make a text of COUNT lines like source code: indented, repeated
+		// lines mixed with unique ones. SEED changes the first and last line.
+		static std::string MakeText(int count, int seed)
+		{
+			static const char *repeated[] =
+			{
+				"\t{\r\n", "\t}\r\n", "\r\n", "\t\treturn result;\r\n",
+				"\t\tif (i < count)\r\n", "\t\t\tbreak;\r\n",
+			};
+			std::string text = "// file " + std::to_string(seed) + "\r\n";
+			for (int i = 1; i < count - 1; i++)
+			{
+				if (i % 3 == 0)
+					text += "\t\tint value" + std::to_string(i) + " = Compute(value" + std::to_string(i - 3) + ", " + std::to_string(i * 7 % 101) + ");\r\n";
+				else
+					text += repeated[i % (sizeof(repeated) / sizeof(repeated[0]))];
+			}
+			text += "// end " + std::to_string(seed) + "\r\n";
+			return text;
+		}
+	};
+
+	TEST_F(IoTest, SameClassesAsOldHashing)
+	{
+		const std::string texts[2] = {
+			"first\na\r\nb\nc\r\n\r\na\nb\rc\n\nlast0\n",
+			"begin\nb\r\na\nc\r\n\nb\nb\ra\n\r\nend1\n" };
+		std::vector<int> equivs[2], oldEquivs[2];
+		ReadLines(texts, equivs);
+		OldHashLines(texts, oldEquivs);
+		EXPECT_EQ(oldEquivs[0], equivs[0]);
+		EXPECT_EQ(oldEquivs[1], equivs[1]);
+	}
+
+	TEST_F(IoTest, SplitJobsGiveSameClasses)
+	{
+		// Large enough texts to be split into 4 jobs each
+		const int count = 100000;
+		const std::string texts[2] = { MakeText(count, 0), MakeText(count, 1) };
+		for (int nIgnoreWhitespace = WHITESPACE_COMPARE_ALL; nIgnoreWhitespace <= WHITESPACE_IGNORE_ALL; ++nIgnoreWhitespace)
+		{
+			for (int bIgnoreCase = 0; bIgnoreCase < 2; ++bIgnoreCase)
+			{
+				SCOPED_TRACE(testing::Message() << "whitespace " << nIgnoreWhitespace << ", ignore case " << bIgnoreCase);
+				DIFFOPTIONS options = {0};
+				options.nIgnoreWhitespace = nIgnoreWhitespace;
+				options.bIgnoreCase = !!bIgnoreCase;
+				SetOptions(options);
+
+				std::vector<int> equivs[2], splitEquivs[2];
+				max_hash_threads = 1;
+				ReadLines(texts, equivs);
+				max_hash_threads = 4;
+				ReadLines(texts, splitEquivs);
+				EXPECT_EQ(count, static_cast<int>(equivs[0].size()));
+				EXPECT_TRUE(equivs[0] == splitEquivs[0]);
+				EXPECT_TRUE(equivs[1] == splitEquivs[1]);
+			}
+		}
+	}
+
+	// Time hashing 2 x 400000 lines with the old and the new hashing; the
+	// new time includes copying the texts to the buffers of diffutils.
+	TEST_F(IoTest, DISABLED_Benchmark)
+	{
+		const int count = 400000;
+		const std::string texts[2] = { MakeText(count, 0), MakeText(count, 1) };
+		std::vector<int> equivs[2], oldEquivs[2];
+
+		Poco::Timestamp start;
+		OldHashLines(texts, oldEquivs);
+		RecordProperty("old_milliseconds", static_cast<int>(start.elapsed() / 1000));
+
+		start.update();
+		ReadLines(texts, equivs);
+		RecordProperty("new_milliseconds", static_cast<int>(start.elapsed() / 1000));
+
+		EXPECT_EQ(count, static_cast<int>(equivs[0].size()));
+		EXPECT_TRUE(oldEquivs[0] == equivs[0]);
+		EXPECT_TRUE(oldEquivs[1] == equivs[1]);
+	}
+
+}  // namespace